@@ -0,0 +1,459 @@
+#include "baselinekernels.h"
+
+#include <QColor>
+#include <QTransform>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void rgb2hsv(double r, double g, double b, double& h, double& s, double& v)
+{
+    double maxv = std::max({r, g, b});
+    double minv = std::min({r, g, b});
+    double d = maxv - minv;
+
+    v = maxv;
+
+    if (maxv == 0) {
+        s = 0;
+    } else {
+        s = d / maxv;
+    }
+
+    if (d == 0) {
+        h = 0;
+    } else if (maxv == r) {
+        h = 60 * ((g - b) / d);
+        if (h < 0) h += 360;
+    } else if (maxv == g) {
+        h = 60 * (((b - r) / d) + 2.0);
+    } else {
+        h = 60 * (((r - g) / d) + 4.0);
+    }
+}
+
+QRgb hsv2rgb(double h, double s, double v)
+{
+    while (h < 0) h += 360;
+    while (h >= 360) h -= 360;
+
+    double c = v * s;
+    double x = c * (1 - std::fabs(std::fmod(h / 60.0, 2.0) - 1));
+    double m = v - c;
+
+    double r, g, b;
+
+    if      (h < 60)  { r=c; g=x; b=0; }
+    else if (h < 120) { r=x; g=c; b=0; }
+    else if (h < 180) { r=0; g=c; b=x; }
+    else if (h < 240) { r=0; g=x; b=c; }
+    else if (h < 300) { r=x; g=0; b=c; }
+    else              { r=c; g=0; b=x; }
+
+    return qRgb(
+        int(std::round(std::clamp((r+m) * 255, 0.0, 255.0))),
+        int(std::round(std::clamp((g+m) * 255, 0.0, 255.0))),
+        int(std::round(std::clamp((b+m) * 255, 0.0, 255.0)))
+        );
+}
+
+// Calls fn(QRgb&) for every pixel of a copy of input and returns the copy.
+template <typename Fn>
+QImage mapPixels(const QImage& input, Fn fn)
+{
+    QImage result {input.copy()};
+    for (int y {0}; y < result.height(); ++y) {
+        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
+        for (int x {0}; x < result.width(); ++x)
+            fn(row[x]);
+    }
+    return result;
+}
+
+QRgb clampedRgb(int r, int g, int b)
+{
+    return qRgb(std::clamp(r, 0, 255), std::clamp(g, 0, 255), std::clamp(b, 0, 255));
+}
+
+QImage bw(const QImage& input)
+{
+    return mapPixels(input, [](QRgb& px) {
+        int gray {qGray(px)};
+        px = qRgb(gray, gray, gray);
+    });
+}
+
+QImage brightness(const QImage& input, int brightness)
+{
+    return mapPixels(input, [brightness](QRgb& px) {
+        px = clampedRgb(qRed(px) + brightness, qGreen(px) + brightness, qBlue(px) + brightness);
+    });
+}
+
+QImage contrast(const QImage& input, int contrast)
+{
+    double factor {(259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast))};
+    return mapPixels(input, [factor](QRgb& px) {
+        px = clampedRgb(static_cast<int>((qRed(px) - 128) * factor + 128),
+                        static_cast<int>((qGreen(px) - 128) * factor + 128),
+                        static_cast<int>((qBlue(px) - 128) * factor + 128));
+    });
+}
+
+QImage exposure(const QImage& input, int value)
+{
+    double exposure {1.0 + value / 100.0};
+    return mapPixels(input, [exposure](QRgb& px) {
+        px = clampedRgb(static_cast<int>(qRed(px) * exposure),
+                        static_cast<int>(qGreen(px) * exposure),
+                        static_cast<int>(qBlue(px) * exposure));
+    });
+}
+
+QImage fade(const QImage& input, int value)
+{
+    const double factor = std::clamp(value, 0, 100) / 100.0;
+    return mapPixels(input, [factor](QRgb& px) {
+        px = clampedRgb(static_cast<int>(qRed(px) * (1.0 - factor) + 255.0 * factor),
+                        static_cast<int>(qGreen(px) * (1.0 - factor) + 255.0 * factor),
+                        static_cast<int>(qBlue(px) * (1.0 - factor) + 255.0 * factor));
+    });
+}
+
+QImage gamma(const QImage& input, int value)
+{
+    double gamma {1.0 + value / 100.0};
+    return mapPixels(input, [gamma](QRgb& px) {
+        px = clampedRgb(static_cast<int>(255.0 * std::pow(qRed(px) / 255.0, gamma)),
+                        static_cast<int>(255.0 * std::pow(qGreen(px) / 255.0, gamma)),
+                        static_cast<int>(255.0 * std::pow(qBlue(px) / 255.0, gamma)));
+    });
+}
+
+QImage highlight(const QImage& input, int value)
+{
+    double highlightBoost {value / 100.0};
+    return mapPixels(input, [highlightBoost](QRgb& px) {
+        double luma {0.299 * qRed(px) + 0.587 * qGreen(px) + 0.114 * qBlue(px)};
+        double factor {1.0 - highlightBoost * (luma / 255.0)};
+        px = clampedRgb(static_cast<int>(qRed(px) * factor),
+                        static_cast<int>(qGreen(px) * factor),
+                        static_cast<int>(qBlue(px) * factor));
+    });
+}
+
+QImage shadow(const QImage& input, int value)
+{
+    double shadowBoost {value / 100.0};
+    return mapPixels(input, [shadowBoost](QRgb& px) {
+        double luma {0.299 * qRed(px) + 0.587 * qGreen(px) + 0.114 * qBlue(px)};
+        double factor {1.0 + shadowBoost * (1.0 - luma / 255.0)};
+        px = clampedRgb(static_cast<int>(qRed(px) * factor),
+                        static_cast<int>(qGreen(px) * factor),
+                        static_cast<int>(qBlue(px) * factor));
+    });
+}
+
+QImage saturation(const QImage& input, int value)
+{
+    double factor = static_cast<double>(value) / 100.0 + 1.0;
+    return mapPixels(input, [factor](QRgb& px) {
+        double h, s, v;
+        rgb2hsv(qRed(px) / 255.0, qGreen(px) / 255.0, qBlue(px) / 255.0, h, s, v);
+        s = std::clamp(s * factor, 0.0, 1.0);
+        px = hsv2rgb(h, s, v);
+    });
+}
+
+QImage splitToning(const QImage& input, int value)
+{
+    const double factor = std::clamp(value, 0, 100) / 100.0;
+    const QColor shadowTint{64, 160, 170};
+    const QColor highlightTint{255, 199, 145};
+
+    return mapPixels(input, [&](QRgb& px) {
+        const double luminance = qGray(px) / 255.0;
+        const double shadowWeight = 1.0 - luminance;
+        const double highlightWeight = luminance;
+
+        const double mixR = shadowTint.red() * shadowWeight + highlightTint.red() * highlightWeight;
+        const double mixG = shadowTint.green() * shadowWeight + highlightTint.green() * highlightWeight;
+        const double mixB = shadowTint.blue() * shadowWeight + highlightTint.blue() * highlightWeight;
+
+        px = clampedRgb(static_cast<int>(qRed(px) * (1.0 - factor) + mixR * factor),
+                        static_cast<int>(qGreen(px) * (1.0 - factor) + mixG * factor),
+                        static_cast<int>(qBlue(px) * (1.0 - factor) + mixB * factor));
+    });
+}
+
+QImage temperature(const QImage& input, int temperature)
+{
+    int deltaR {static_cast<int>(temperature * 0.6)};
+    int deltaG {static_cast<int>(temperature * 0.2)};
+    int deltaB {static_cast<int>(-temperature * 0.6)};
+    return mapPixels(input, [=](QRgb& px) {
+        px = clampedRgb(qRed(px) + deltaR, qGreen(px) + deltaG, qBlue(px) + deltaB);
+    });
+}
+
+QImage tint(const QImage& input, int value)
+{
+    double tint {static_cast<double>(value) / 100.0};
+    int deltaR {static_cast<int>(tint * 35.0)};
+    int deltaG {static_cast<int>(tint * 15.0)};
+    int deltaB {static_cast<int>(tint * 35.0)};
+    return mapPixels(input, [=](QRgb& px) {
+        px = clampedRgb(qRed(px) + deltaR, qGreen(px) - deltaG, qBlue(px) + deltaB);
+    });
+}
+
+QImage vibrance(const QImage& input, int value)
+{
+    double vibrance {value / 100.0};
+    return mapPixels(input, [vibrance](QRgb& px) {
+        int red = qRed(px);
+        int green = qGreen(px);
+        int blue = qBlue(px);
+
+        int diff = std::max({red, green, blue}) - std::min({red, green, blue});
+        if (diff < 20)
+            return;
+
+        double h{}, s{}, v{};
+        rgb2hsv(red / 255.0, green / 255.0, blue / 255.0, h, s, v);
+        if (s < 0.08)
+            return;
+        if (v > 0.88 && s < 0.2)
+            return;
+
+        double boost = vibrance * (1.0 - s) * 0.6;
+        if (h >= 5 && h <= 45)
+            boost *= 0.4;
+        else if ((h >= 0 && h <= 5) || (h >= 345 && h <= 360))
+            boost *= 0.5;
+        else if (h >= 45 && h <= 65)
+            boost *= 0.5;
+
+        s = std::clamp(s + boost, 0.0, 1.0);
+        px = hsv2rgb(h, s, v);
+    });
+}
+
+QImage vignette(const QImage& input, int value)
+{
+    QImage result {input.copy()};
+
+    const double vignette {std::clamp(value / 100.0, 0.0, 2.0)};
+    const int width {result.width()};
+    const int height {result.height()};
+    const double centerX {width / 2.0};
+    const double centerY {height / 2.0};
+    const double maxDistance {std::hypot(centerX, centerY)};
+
+    for (int y {0}; y < height; ++y) {
+        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
+        for (int x {0}; x < width; ++x) {
+            const double distanceRatio {std::hypot(x - centerX, y - centerY) / maxDistance};
+            const double factor {std::clamp(1.0 - vignette * distanceRatio * distanceRatio, 0.0, 1.0)};
+
+            const QRgb px {row[x]};
+            row[x] = clampedRgb(static_cast<int>(qRed(px) * factor),
+                                static_cast<int>(qGreen(px) * factor),
+                                static_cast<int>(qBlue(px) * factor));
+        }
+    }
+
+    return result;
+}
+
+void boxBlurHorizontal(QImage& img, int r)
+{
+    int w = img.width();
+    int h = img.height();
+    int size = r * 2 + 1;
+
+    for (int y = 0; y < h; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(img.scanLine(y));
+        int rsum = 0, gsum = 0, bsum = 0, asum = 0;
+
+        for (int i = -r; i <= r; ++i) {
+            QRgb p = line[std::clamp(i, 0, w - 1)];
+            rsum += qRed(p);
+            gsum += qGreen(p);
+            bsum += qBlue(p);
+            asum += qAlpha(p);
+        }
+
+        for (int x = 0; x < w; ++x) {
+            line[x] = qRgba(rsum / size, gsum / size, bsum / size, asum / size);
+
+            QRgb pAdd = line[std::clamp(x + r + 1, 0, w - 1)];
+            QRgb pSub = line[std::clamp(x - r, 0, w - 1)];
+            rsum += qRed(pAdd)   - qRed(pSub);
+            gsum += qGreen(pAdd) - qGreen(pSub);
+            bsum += qBlue(pAdd)  - qBlue(pSub);
+            asum += qAlpha(pAdd) - qAlpha(pSub);
+        }
+    }
+}
+
+void boxBlurVertical(QImage& img, int r)
+{
+    int w = img.width();
+    int h = img.height();
+    int size = r * 2 + 1;
+
+    auto at = [&img](int x, int y) -> QRgb& { return reinterpret_cast<QRgb*>(img.scanLine(y))[x]; };
+
+    for (int x = 0; x < w; ++x) {
+        int rsum = 0, gsum = 0, bsum = 0, asum = 0;
+
+        for (int i = -r; i <= r; ++i) {
+            QRgb p = at(x, std::clamp(i, 0, h - 1));
+            rsum += qRed(p);
+            gsum += qGreen(p);
+            bsum += qBlue(p);
+            asum += qAlpha(p);
+        }
+
+        for (int y = 0; y < h; ++y) {
+            at(x, y) = qRgba(rsum / size, gsum / size, bsum / size, asum / size);
+
+            QRgb pAdd = at(x, std::clamp(y + r + 1, 0, h - 1));
+            QRgb pSub = at(x, std::clamp(y - r, 0, h - 1));
+            rsum += qRed(pAdd)   - qRed(pSub);
+            gsum += qGreen(pAdd) - qGreen(pSub);
+            bsum += qBlue(pAdd)  - qBlue(pSub);
+            asum += qAlpha(pAdd) - qAlpha(pSub);
+        }
+    }
+}
+
+QImage fastBlur(const QImage& input, int radius)
+{
+    if (radius <= 0)
+        return input;
+
+    QImage img = input.copy();
+    for (int i = 0; i < 3; ++i) {
+        boxBlurHorizontal(img, radius);
+        boxBlurVertical(img, radius);
+    }
+    return img;
+}
+
+std::vector<double> gaussianKernel(double sigma)
+{
+    int radius {static_cast<int>(std::ceil(3 * sigma))};
+    std::vector<double> kernel(2 * radius + 1);
+    double sum {0.0};
+
+    for (int i {-radius}; i <= radius; i++) {
+        double value {std::exp(-(i * i) / (2 * sigma * sigma))};
+        kernel[i + radius] = value;
+        sum += value;
+    }
+    for (double& x : kernel)
+        x /= sum;
+
+    return kernel;
+}
+
+QImage gaussianPass(const QImage& input, const std::vector<double>& kernel, bool vertical)
+{
+    QImage result {input.copy()};
+    const int radius {static_cast<int>(kernel.size() - 1) / 2};
+    const int width {result.width()};
+    const int height {result.height()};
+
+    for (int y {0}; y < height; y++) {
+        QRgb* dst {reinterpret_cast<QRgb*>(result.scanLine(y))};
+        for (int x {0}; x < width; x++) {
+            double r {0.0};
+            double g {0.0};
+            double b {0.0};
+
+            for (int i {-radius}; i <= radius; i++) {
+                const int px {vertical ? x : std::clamp(x + i, 0, width - 1)};
+                const int py {vertical ? std::clamp(y + i, 0, height - 1) : y};
+                const QRgb p {reinterpret_cast<const QRgb*>(input.constScanLine(py))[px]};
+                r += qRed(p) * kernel[i + radius];
+                g += qGreen(p) * kernel[i + radius];
+                b += qBlue(p) * kernel[i + radius];
+            }
+
+            dst[x] = clampedRgb(static_cast<int>(r), static_cast<int>(g), static_cast<int>(b));
+        }
+    }
+    return result;
+}
+
+QImage gaussianBlur(const QImage& input, double sigma)
+{
+    if (sigma < 0.001)
+        return input;
+
+    const auto kernel {gaussianKernel(sigma)};
+    return gaussianPass(gaussianPass(input, kernel, false), kernel, true);
+}
+
+QImage sharpen(const QImage& input, int sharpness)
+{
+    QImage result {input.copy()};
+    QImage blurred {fastBlur(input, 1)};
+
+    for (int y {0}; y < result.height(); y++) {
+        const QRgb* src {reinterpret_cast<const QRgb*>(input.constScanLine(y))};
+        const QRgb* blr {reinterpret_cast<const QRgb*>(blurred.constScanLine(y))};
+        QRgb* dst {reinterpret_cast<QRgb*>(result.scanLine(y))};
+
+        for (int x {0}; x < result.width(); x++) {
+            dst[x] = clampedRgb((1 + sharpness) * qRed(src[x]) - sharpness * qRed(blr[x]),
+                                (1 + sharpness) * qGreen(src[x]) - sharpness * qGreen(blr[x]),
+                                (1 + sharpness) * qBlue(src[x]) - sharpness * qBlue(blr[x]));
+        }
+    }
+    return result;
+}
+
+}
+
+std::vector<std::pair<QString, BaselineRun>> baselineFilters()
+{
+    return {
+        {"bw", [](const QImage& in) { return bw(in); }},
+        {"brightness", [](const QImage& in) { return brightness(in, 30); }},
+        {"blur", [](const QImage& in) { return gaussianBlur(in, 10 * 0.4); }},
+        {"contrast", [](const QImage& in) { return contrast(in, 30); }},
+        {"exposure", [](const QImage& in) { return exposure(in, 30); }},
+        {"fade", [](const QImage& in) { return fade(in, 30); }},
+        {"fastblur", [](const QImage& in) { return fastBlur(in, static_cast<int>(10 * 0.4)); }},
+        {"flip", [](const QImage& in) { return in.mirrored(true, false); }},
+        {"gamma", [](const QImage& in) { return gamma(in, 30); }},
+        {"highlight", [](const QImage& in) { return highlight(in, -40); }},
+        {"rotate", [](const QImage& in) { return in.transformed(QTransform().rotate(90)); }},
+        {"saturation", [](const QImage& in) { return saturation(in, 30); }},
+        {"shadow", [](const QImage& in) { return shadow(in, 40); }},
+        {"sharpen", [](const QImage& in) { return sharpen(in, 50); }},
+        {"splittoning", [](const QImage& in) { return splitToning(in, 40); }},
+        {"temperature", [](const QImage& in) { return temperature(in, 30); }},
+        {"tint", [](const QImage& in) { return tint(in, 30); }},
+        {"vignette", [](const QImage& in) { return vignette(in, 50); }}
+    };
+}
+
+QImage baselineFastBlur(const QImage& input, int radius)
+{
+    return fastBlur(input, radius);
+}
+
+QImage baselineGaussianBlur(const QImage& input, double sigma)
+{
+    return gaussianBlur(input, sigma);
+}
+
+QImage baselineBasicStack(const QImage& input)
+{
+    return temperature(saturation(contrast(exposure(input, 20), 20), 20), 10);
+}
@@ -0,0 +1,25 @@
+#ifndef BASELINEKERNELS_H
+#define BASELINEKERNELS_H
+
+#include <QImage>
+#include <QString>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// The filters as they were before any of the optimised kernels, copied
+// verbatim into free functions. They are the golden harness's reference
+// path, so they must never change with the filters they check.
+using BaselineRun = std::function<QImage(const QImage& input)>;
+
+// Named and set up like the matching entries of benchFilters(). Filters
+// whose output was redefined since, or that did not exist, are left out.
+std::vector<std::pair<QString, BaselineRun>> baselineFilters();
+
+QImage baselineFastBlur(const QImage& input, int radius);
+QImage baselineGaussianBlur(const QImage& input, double sigma);
+
+// addBasicStack() run one filter after another.
+QImage baselineBasicStack(const QImage& input);
+
+#endif // BASELINEKERNELS_H
@@ -0,0 +1,347 @@
+#include "benchcases.h"
+#include "benchrunner.h"
+
+#include "filters/BWFilter.h"
+#include "filters/BrightnessFilter.h"
+#include "filters/RotateFilter.h"
+#include "filters/blurfilter.h"
+#include "filters/clarityFilter.h"
+#include "filters/contrastfilter.h"
+#include "filters/curvesfilter.h"
+#include "filters/exposurefilter.h"
+#include "filters/fadefilter.h"
+#include "filters/fastblur.h"
+#include "filters/fastblurfilter.h"
+#include "filters/flipfilter.h"
+#include "filters/gammafilter.h"
+#include "filters/gaussianblurutil.h"
+#include "filters/grainfilter.h"
+#include "filters/highlightfilter.h"
+#include "filters/hslfilter.h"
+#include "filters/rgbhsvutil.h"
+#include "filters/saturationfilter.h"
+#include "filters/shadowfilter.h"
+#include "filters/sharpenfilter.h"
+#include "filters/splittoningfilter.h"
+#include "filters/temperaturefilter.h"
+#include "filters/tintfilter.h"
+#include "filters/vibrancefilter.h"
+#include "filters/vignettefilter.h"
+#include "image/exportencoder.h"
+#include "image/resampler.h"
+#include "layers/layermanager.h"
+#include "parallel/parallelfor.h"
+#include "pipeline/filterpipeline.h"
+#include "scopes/scopes.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+// Keeps results observable so the optimiser cannot drop a timed call.
+volatile qint64 g_sink = 0;
+
+void consume(const QImage& image)
+{
+    g_sink = g_sink + image.cacheKey();
+}
+
+void addFilterCase(BenchRunner& runner, const QString& name, std::shared_ptr<ImageFilter> filter)
+{
+    runner.addCase("filter/" + name, [filter](const QImage& source) -> BenchRunner::Body {
+        return [filter, source]() { consume(filter->apply(source)); };
+    });
+}
+
+void addPipelineCase(BenchRunner& runner,
+                     const QString& name,
+                     void (*build)(FilterPipeline&),
+                     WorkingSpace space)
+{
+    runner.addCase("pipeline/" + name, [build, space](const QImage& source) -> BenchRunner::Body {
+        auto pipeline = std::make_shared<FilterPipeline>();
+        build(*pipeline);
+        return [pipeline, source, space]() { consume(pipeline->process(source, space)); };
+    });
+}
+
+// The source is reused for every pixel layer; the compositor only reads it,
+// so the layers share one buffer without changing the work done.
+void addCompositeCase(BenchRunner& runner,
+                      const QString& name,
+                      int layerCount,
+                      BlendMode mode,
+                      bool clippedAdjustment,
+                      bool adjustment)
+{
+    runner.addCase("composite/" + name,
+                   [layerCount, mode, clippedAdjustment, adjustment](const QImage& source) -> BenchRunner::Body {
+        auto manager = std::make_shared<LayerManager>(source.size());
+
+        for (int i = 0; i < layerCount; ++i) {
+            auto layer = std::make_shared<PixelLayer>(QString("Layer %1").arg(i), source, true,
+                                                      i == 0 ? 1.0f : 0.6f);
+            if (i > 0)
+                layer->setBlendMode(mode);
+            manager->addLayer(layer);
+        }
+
+        if (adjustment) {
+            auto layer = std::make_shared<AdjustmentLayer>("Adjustment");
+            addBasicStack(layer->pipeline());
+            layer->setClipped(clippedAdjustment);
+            manager->addLayer(layer);
+        }
+
+        return [manager]() {
+            manager->clearRenderCache();
+            consume(manager->composite());
+        };
+    });
+}
+
+// An adjustment whose mask hides the left third, reveals the right third
+// and ramps across the middle, so the compositor sees hidden, revealed and
+// mixed tiles in similar amounts.
+void addMaskedCompositeCase(BenchRunner& runner)
+{
+    runner.addCase("composite/masked-adjustment", [](const QImage& source) -> BenchRunner::Body {
+        auto manager = std::make_shared<LayerManager>(source.size());
+        manager->addLayer(std::make_shared<PixelLayer>("Base", source, true, 1.0f));
+
+        auto mask = std::make_shared<LayerMask>(QRect(QPoint(0, 0), source.size()), 0);
+        const int third = source.width() / 3;
+        QImage ramp(source.width() - third, source.height(), QImage::Format_Grayscale8);
+        for (int y = 0; y < ramp.height(); ++y) {
+            uchar* row = ramp.scanLine(y);
+            for (int x = 0; x < ramp.width(); ++x)
+                row[x] = static_cast<uchar>(std::min(255, x * 255 / std::max(1, third)));
+        }
+        mask->write(QPoint(third, 0), ramp);
+
+        auto layer = std::make_shared<AdjustmentLayer>("Adjustment");
+        addBasicStack(layer->pipeline());
+        layer->setMask(mask);
+        manager->addLayer(layer);
+
+        return [manager]() {
+            manager->clearRenderCache();
+            consume(manager->composite());
+        };
+    });
+}
+
+// 200 layers in ten isolated groups, one horizontal band of the canvas
+// each. Every iteration edits one layer, so one group is re-flattened and
+// the other nine are drawn from their cached renders.
+void addGroupedCompositeCase(BenchRunner& runner)
+{
+    runner.addCase("composite/grouped-200", [](const QImage& source) -> BenchRunner::Body {
+        constexpr int Groups = 10;
+        constexpr int LayersPerGroup = 20;
+
+        auto manager = std::make_shared<LayerManager>(source.size());
+        std::shared_ptr<Layer> edited;
+
+        for (int g = 0; g < Groups; ++g) {
+            const int top = source.height() * g / Groups;
+            const QImage band = source.copy(0, top, source.width(), source.height() * (g + 1) / Groups - top);
+
+            std::vector<std::shared_ptr<Layer>> children;
+            for (int i = 0; i < LayersPerGroup; ++i) {
+                auto layer = std::make_shared<PixelLayer>(QString("Layer %1").arg(i), band, true,
+                                                          i == 0 ? 1.0f : 0.6f);
+                layer->setOffset(QPointF(0, top));
+                if (i > 0)
+                    layer->setBlendMode(BlendMode::Multiply);
+                children.push_back(layer);
+            }
+            edited = children.back();
+            manager->addLayer(std::make_shared<GroupLayer>(QString("Group %1").arg(g), std::move(children)));
+        }
+
+        return [manager, edited]() {
+            edited->setOpacity(edited->opacity() > 0.5f ? 0.4f : 0.6f);
+            consume(manager->composite());
+        };
+    });
+}
+
+QString blendModeName(BlendMode mode)
+{
+    switch (mode) {
+    case BlendMode::Normal: return "normal";
+    case BlendMode::Multiply: return "multiply";
+    case BlendMode::Screen: return "screen";
+    case BlendMode::Overlay: return "overlay";
+    }
+    return "unknown";
+}
+
+}
+
+std::vector<NamedFilter> benchFilters()
+{
+    auto curves = std::make_shared<CurvesFilter>();
+    curves->setPoints(CurvesFilter::Channel::Rgb, {QPoint(0, 8), QPoint(64, 56), QPoint(192, 204), QPoint(255, 248)});
+    curves->setPoints(CurvesFilter::Channel::Blue, {QPoint(0, 16), QPoint(255, 240)});
+
+    auto hsl = std::make_shared<HslFilter>();
+    hsl->setAdjustment(HslFilter::Band::Orange, {10, -20, 15});
+    hsl->setAdjustment(HslFilter::Band::Blue, {-15, 30, -20});
+
+    return {
+        {"bw", std::make_shared<BWFilter>(true)},
+        {"brightness", std::make_shared<BrightnessFilter>(30)},
+        {"blur", std::make_shared<BlurFilter>(10)},
+        {"clarity", std::make_shared<ClarityFilter>(40)},
+        {"contrast", std::make_shared<ContrastFilter>(30)},
+        {"curves", curves},
+        {"exposure", std::make_shared<ExposureFilter>(30)},
+        {"fade", std::make_shared<FadeFilter>(30)},
+        {"fastblur", std::make_shared<FastBlurFilter>(10)},
+        {"flip", std::make_shared<FlipFilter>(FlipFilter::Direction::Horizontal, true)},
+        {"gamma", std::make_shared<GammaFilter>(30)},
+        {"grain", std::make_shared<GrainFilter>(40, 50)},
+        {"highlight", std::make_shared<HighlightFilter>(-40)},
+        {"hsl", hsl},
+        {"rotate", std::make_shared<RotateFilter>(90)},
+        {"saturation", std::make_shared<SaturationFilter>(30)},
+        {"shadow", std::make_shared<ShadowFilter>(40)},
+        {"sharpen", std::make_shared<SharpenFilter>(50)},
+        {"splittoning", std::make_shared<SplitToningFilter>(40)},
+        {"temperature", std::make_shared<TemperatureFilter>(30)},
+        {"tint", std::make_shared<TintFilter>(30)},
+        {"vibrance", std::make_shared<VibranceFilter>(40)},
+        {"vignette", std::make_shared<VignetteFilter>(50)}
+    };
+}
+
+std::vector<std::unique_ptr<ImageFilter>> basicStackFilters()
+{
+    std::vector<std::unique_ptr<ImageFilter>> filters;
+    filters.push_back(std::make_unique<ExposureFilter>(20));
+    filters.push_back(std::make_unique<ContrastFilter>(20));
+    filters.push_back(std::make_unique<SaturationFilter>(20));
+    filters.push_back(std::make_unique<TemperatureFilter>(10));
+    return filters;
+}
+
+std::vector<std::unique_ptr<ImageFilter>> fullStackFilters()
+{
+    std::vector<std::unique_ptr<ImageFilter>> filters = basicStackFilters();
+    filters.push_back(std::make_unique<HighlightFilter>(-30));
+    filters.push_back(std::make_unique<ShadowFilter>(30));
+    filters.push_back(std::make_unique<ClarityFilter>(30));
+    filters.push_back(std::make_unique<SharpenFilter>(40));
+    filters.push_back(std::make_unique<VignetteFilter>(40));
+    filters.push_back(std::make_unique<GrainFilter>(20));
+    return filters;
+}
+
+void addBasicStack(FilterPipeline& pipeline)
+{
+    for (auto& filter : basicStackFilters())
+        pipeline.addFilter(std::move(filter));
+}
+
+void addFullStack(FilterPipeline& pipeline)
+{
+    for (auto& filter : fullStackFilters())
+        pipeline.addFilter(std::move(filter));
+}
+
+void registerBenchCases(BenchRunner& runner)
+{
+    for (const auto& [name, filter] : benchFilters())
+        addFilterCase(runner, name, filter);
+
+    runner.addCase("util/fastblur", [](const QImage& source) -> BenchRunner::Body {
+        return [source]() { consume(FastBlur::apply(source, 8)); };
+    });
+
+    runner.addCase("util/gaussian", [](const QImage& source) -> BenchRunner::Body {
+        return [source]() { consume(GaussianBlurUtil::apply(source, 4.0)); };
+    });
+
+    for (const auto& [name, kernel] : {std::pair{QString("box"), Resampler::Kernel::Box},
+                                       std::pair{QString("mitchell"), Resampler::Kernel::Mitchell},
+                                       std::pair{QString("lanczos3"), Resampler::Kernel::Lanczos3}}) {
+        runner.addCase("util/resample-" + name, [kernel = kernel](const QImage& source) -> BenchRunner::Body {
+            const QSize half(source.width() / 2, source.height() / 2);
+            return [source, half, kernel]() { consume(Resampler::resize(source, half, kernel)); };
+        });
+    }
+
+    runner.addCase("util/rgbhsv-roundtrip", [](const QImage& source) -> BenchRunner::Body {
+        return [source]() {
+            QImage out(source.size(), source.format());
+            ParallelFor::run(source.height(), [&](int begin, int end) {
+                for (int y = begin; y < end; ++y) {
+                    const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+                    QRgb* dst = reinterpret_cast<QRgb*>(out.scanLine(y));
+                    for (int x = 0; x < source.width(); ++x) {
+                        double h, s, v;
+                        RgbHsvUtil::rgb2hsv(qRed(in[x]) / 255.0, qGreen(in[x]) / 255.0,
+                                            qBlue(in[x]) / 255.0, h, s, v);
+                        dst[x] = RgbHsvUtil::hsv2rgb(h, s, v);
+                    }
+                }
+            }, 16);
+            consume(out);
+        };
+    });
+
+    runner.addCase("util/scopes-full", [](const QImage& source) -> BenchRunner::Body {
+        return [source]() {
+            Scopes scopes;
+            g_sink = g_sink + scopes.update(source);
+        };
+    });
+
+    // One brush-sized edit between updates, so only a few tiles are redone.
+    runner.addCase("util/scopes-incremental", [](const QImage& source) -> BenchRunner::Body {
+        auto scopes = std::make_shared<Scopes>();
+        auto frames = std::make_shared<std::pair<QImage, QImage>>(source, source.copy());
+        scopes->update(frames->first);
+        const int x0 = source.width() / 3;
+        const int y0 = source.height() / 3;
+        for (int y = y0; y < std::min(y0 + 200, source.height()); ++y) {
+            QRgb* row = reinterpret_cast<QRgb*>(frames->second.scanLine(y));
+            for (int x = x0; x < std::min(x0 + 200, source.width()); ++x)
+                row[x] = qRgb(255, 0, 0);
+        }
+
+        return [scopes, frames]() mutable {
+            g_sink = g_sink + scopes->update(frames->second);
+            std::swap(frames->first, frames->second);
+        };
+    });
+
+    addPipelineCase(runner, "basic", addBasicStack, WorkingSpace::Display8Bit);
+    addPipelineCase(runner, "basic-linear", addBasicStack, WorkingSpace::LinearFloat);
+    addPipelineCase(runner, "full", addFullStack, WorkingSpace::Display8Bit);
+    addPipelineCase(runner, "full-linear", addFullStack, WorkingSpace::LinearFloat);
+    addPipelineCase(runner, "detail", [](FilterPipeline& pipeline) {
+        pipeline.addFilter(std::make_unique<ClarityFilter>(30));
+        pipeline.addFilter(std::make_unique<SharpenFilter>(40, 1, 4));
+    }, WorkingSpace::Display8Bit);
+
+    for (BlendMode mode : {BlendMode::Normal, BlendMode::Multiply, BlendMode::Screen, BlendMode::Overlay})
+        addCompositeCase(runner, blendModeName(mode) + "-4", 4, mode, false, false);
+
+    addCompositeCase(runner, "normal-16", 16, BlendMode::Normal, false, false);
+    addCompositeCase(runner, "adjustment", 2, BlendMode::Normal, false, true);
+    addCompositeCase(runner, "clipped-adjustment", 2, BlendMode::Normal, true, true);
+    addMaskedCompositeCase(runner);
+    addGroupedCompositeCase(runner);
+
+    runner.addCase("export/png", [](const QImage& source) -> BenchRunner::Body {
+        return [source]() { g_sink = g_sink + ExportEncoder::encodePng(source, {}).size(); };
+    });
+
+    runner.addCase("export/jpeg", [](const QImage& source) -> BenchRunner::Body {
+        return [source]() { g_sink = g_sink + ExportEncoder::encodeJpeg(source, {}).size(); };
+    });
+}
@@ -0,0 +1,29 @@
+#ifndef BENCHCASES_H
+#define BENCHCASES_H
+
+#include <QString>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class BenchRunner;
+class FilterPipeline;
+class ImageFilter;
+
+using NamedFilter = std::pair<QString, std::shared_ptr<ImageFilter>>;
+
+// One instance of every ImageFilter with a representative non-zero setting.
+std::vector<NamedFilter> benchFilters();
+
+// Typical adjustment stacks: the basic tone/colour sliders, and those plus
+// local contrast, sharpening, vignette and grain.
+std::vector<std::unique_ptr<ImageFilter>> basicStackFilters();
+std::vector<std::unique_ptr<ImageFilter>> fullStackFilters();
+void addBasicStack(FilterPipeline& pipeline);
+void addFullStack(FilterPipeline& pipeline);
+
+// Registers every filter, blur utility, pipeline stack, compositor and
+// export case. Names are "group/case" so --filter can select a group.
+void registerBenchCases(BenchRunner& runner);
+
+#endif // BENCHCASES_H
@@ -0,0 +1,218 @@
+#include "benchrunner.h"
+
+#include "image/imagepool.h"
+#include "parallel/parallelfor.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+quint32 hash32(quint32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+QString resultKey(const QString& name, int megapixels)
+{
+    return name + QLatin1Char('@') + QString::number(megapixels);
+}
+
+}
+
+double BenchResult::megapixelsPerSecond() const
+{
+    return medianMs > 0.0 ? megapixels * 1000.0 / medianMs : 0.0;
+}
+
+BenchRunner::BenchRunner(Options options)
+    : m_options(std::move(options))
+{
+}
+
+void BenchRunner::addCase(const QString& name, Prepare prepare)
+{
+    m_cases.push_back({name, std::move(prepare)});
+}
+
+QImage BenchRunner::makeImage(int megapixels, quint32 seed)
+{
+    // 3:2, the shape of most camera frames.
+    const double pixels = megapixels * 1e6;
+    const int width = static_cast<int>(std::lround(std::sqrt(pixels * 1.5)));
+    const int height = static_cast<int>(std::lround(pixels / width));
+
+    return makeImage(QSize(width, height), seed);
+}
+
+// Smooth gradients, hard edges and per-pixel noise so that neither flat
+// areas nor pure noise dominate the timing of any kernel.
+QImage BenchRunner::makeImage(const QSize& size, quint32 seed)
+{
+    const int width = size.width();
+    const int height = size.height();
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+
+    ParallelFor::run(height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+            const int band = (y * 8 / height) & 1;
+
+            for (int x = 0; x < width; ++x) {
+                const quint32 n = hash32(seed * 0x9e3779b9U ^ (static_cast<quint32>(y) * 0x85ebca6bU + x));
+                const int noise = static_cast<int>(n & 31) - 16;
+                const int r = x * 255 / std::max(1, width - 1);
+                const int g = y * 255 / std::max(1, height - 1);
+                const int b = band ? 255 - (r + g) / 2 : (r + g) / 2;
+
+                row[x] = qRgb(std::clamp(r + noise, 0, 255),
+                              std::clamp(g + noise, 0, 255),
+                              std::clamp(b + noise, 0, 255));
+            }
+        }
+    }, 16);
+
+    return image;
+}
+
+std::vector<BenchResult> BenchRunner::run(QTextStream& log) const
+{
+    std::vector<BenchResult> results;
+
+    for (int megapixels : m_options.sizes) {
+        const QImage source = makeImage(megapixels);
+
+        for (const auto& c : m_cases) {
+            if (!m_options.filter.isEmpty() && !c.name.contains(m_options.filter))
+                continue;
+
+            const Body body = c.prepare(source);
+            body();
+
+            std::vector<double> samples;
+            QElapsedTimer total;
+            total.start();
+
+            while (static_cast<int>(samples.size()) < m_options.maxIterations
+                   && (static_cast<int>(samples.size()) < m_options.minIterations
+                       || total.nsecsElapsed() < m_options.minSeconds * 1e9)) {
+                QElapsedTimer timer;
+                timer.start();
+                body();
+                samples.push_back(timer.nsecsElapsed() / 1e6);
+            }
+
+            std::sort(samples.begin(), samples.end());
+
+            BenchResult result;
+            result.name = c.name;
+            result.megapixels = megapixels;
+            result.iterations = static_cast<int>(samples.size());
+            result.medianMs = samples[samples.size() / 2];
+            result.minMs = samples.front();
+            results.push_back(result);
+
+            log << QString("%1 %2 MP").arg(c.name, -40).arg(megapixels, 3)
+                << QString("  median %1 ms  min %2 ms  %3 MP/s")
+                       .arg(result.medianMs, 9, 'f', 2)
+                       .arg(result.minMs, 9, 'f', 2)
+                       .arg(result.megapixelsPerSecond(), 8, 'f', 1)
+                << Qt::endl;
+        }
+    }
+
+    return results;
+}
+
+QJsonDocument BenchRunner::toJson(const std::vector<BenchResult>& results)
+{
+    QJsonArray entries;
+    for (const auto& r : results) {
+        QJsonObject entry;
+        entry["name"] = r.name;
+        entry["megapixels"] = r.megapixels;
+        entry["iterations"] = r.iterations;
+        entry["medianMs"] = r.medianMs;
+        entry["minMs"] = r.minMs;
+        entry["megapixelsPerSecond"] = r.megapixelsPerSecond();
+        entries.append(entry);
+    }
+
+    QJsonObject meta;
+    meta["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    meta["threads"] = ParallelFor::threadCount();
+    meta["cpu"] = QSysInfo::currentCpuArchitecture();
+    meta["qt"] = QString::fromLatin1(qVersion());
+    const ImagePool::Stats pool = ImagePool::instance().stats();
+    meta["poolHitRate"] = pool.hitRate();
+    meta["poolResidentMB"] = pool.residentBytes() / (1024.0 * 1024.0);
+
+    QJsonObject root;
+    root["meta"] = meta;
+    root["results"] = entries;
+    return QJsonDocument(root);
+}
+
+std::vector<BenchResult> BenchRunner::fromJson(const QJsonDocument& document)
+{
+    std::vector<BenchResult> results;
+
+    const QJsonArray entries = document.object().value("results").toArray();
+    for (const auto& value : entries) {
+        const QJsonObject entry = value.toObject();
+
+        BenchResult r;
+        r.name = entry.value("name").toString();
+        r.megapixels = entry.value("megapixels").toInt();
+        r.iterations = entry.value("iterations").toInt();
+        r.medianMs = entry.value("medianMs").toDouble();
+        r.minMs = entry.value("minMs").toDouble();
+        results.push_back(r);
+    }
+
+    return results;
+}
+
+int BenchRunner::compare(const std::vector<BenchResult>& baseline,
+                         const std::vector<BenchResult>& current,
+                         double thresholdPercent,
+                         QTextStream& out)
+{
+    QHash<QString, double> baselineMs;
+    for (const auto& r : baseline)
+        baselineMs.insert(resultKey(r.name, r.megapixels), r.medianMs);
+
+    int regressions = 0;
+    for (const auto& r : current) {
+        const double before = baselineMs.value(resultKey(r.name, r.megapixels), 0.0);
+        if (before <= 0.0)
+            continue;
+
+        const double change = (r.medianMs - before) / before * 100.0;
+        if (change <= thresholdPercent)
+            continue;
+
+        ++regressions;
+        out << QString("REGRESSION %1 %2 MP: %3 ms -> %4 ms (+%5%)")
+                   .arg(r.name)
+                   .arg(r.megapixels)
+                   .arg(before, 0, 'f', 2)
+                   .arg(r.medianMs, 0, 'f', 2)
+                   .arg(change, 0, 'f', 1)
+            << Qt::endl;
+    }
+
+    return regressions;
+}
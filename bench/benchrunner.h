@@ -0,0 +1,69 @@
+#ifndef BENCHRUNNER_H
+#define BENCHRUNNER_H
+
+#include <QImage>
+#include <QJsonDocument>
+#include <QList>
+#include <QString>
+#include <QTextStream>
+#include <functional>
+#include <vector>
+
+struct BenchResult
+{
+    QString name;
+    int megapixels {0};
+    int iterations {0};
+    double medianMs {0.0};
+    double minMs {0.0};
+
+    double megapixelsPerSecond() const;
+};
+
+class BenchRunner
+{
+public:
+    // A case prepares its state from the source image outside the timed
+    // region and returns the body that is timed.
+    using Body = std::function<void()>;
+    using Prepare = std::function<Body(const QImage& source)>;
+
+    struct Options
+    {
+        QList<int> sizes {1, 12, 24, 50};
+        QString filter;
+        int minIterations {3};
+        int maxIterations {50};
+        double minSeconds {0.5};
+    };
+
+    explicit BenchRunner(Options options);
+
+    void addCase(const QString& name, Prepare prepare);
+    std::vector<BenchResult> run(QTextStream& log) const;
+
+    static QImage makeImage(int megapixels, quint32 seed = 1);
+    static QImage makeImage(const QSize& size, quint32 seed = 1);
+
+    static QJsonDocument toJson(const std::vector<BenchResult>& results);
+    static std::vector<BenchResult> fromJson(const QJsonDocument& document);
+
+    // Prints every case slower than the baseline by more than thresholdPercent
+    // and returns how many there were.
+    static int compare(const std::vector<BenchResult>& baseline,
+                       const std::vector<BenchResult>& current,
+                       double thresholdPercent,
+                       QTextStream& out);
+
+private:
+    struct Case
+    {
+        QString name;
+        Prepare prepare;
+    };
+
+    Options m_options;
+    std::vector<Case> m_cases;
+};
+
+#endif // BENCHRUNNER_H
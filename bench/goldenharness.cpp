@@ -0,0 +1,546 @@
+#include "goldenharness.h"
+
+#include "baselinekernels.h"
+#include "benchcases.h"
+#include "benchrunner.h"
+
+#include "filters/contrastfilter.h"
+#include "filters/fastblur.h"
+#include "filters/gammafilter.h"
+#include "filters/gaussianblurutil.h"
+#include "filters/imagefilter.h"
+#include "image/resampler.h"
+#include "layers/layermanager.h"
+#include "parallel/parallelfor.h"
+#include "pipeline/filterpipeline.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace {
+
+QImage makeAlphaRamp(const QSize& size)
+{
+    QImage image = BenchRunner::makeImage(size, 7);
+
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int alpha = x * 255 / std::max(1, image.width() - 1);
+            row[x] = qPremultiply(qRgba(qRed(row[x]), qGreen(row[x]), qBlue(row[x]), alpha));
+        }
+    }
+
+    return image;
+}
+
+// Flat blocks of black, white, grey and the primaries: clamping and hue
+// edge cases that noisy photographs rarely hit exactly.
+QImage makeExtremes(const QSize& size)
+{
+    static const QRgb colors[] = {
+        qRgb(0, 0, 0), qRgb(255, 255, 255), qRgb(128, 128, 128), qRgb(255, 0, 0),
+        qRgb(0, 255, 0), qRgb(0, 0, 255), qRgb(255, 255, 0), qRgb(0, 255, 255)
+    };
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            row[x] = colors[((x / 16) + (y / 16) * 3) % 8];
+    }
+
+    return image;
+}
+
+QImage processWith(void (*build)(FilterPipeline&), WorkingSpace space, const QImage& input)
+{
+    FilterPipeline pipeline;
+    build(pipeline);
+    return pipeline.process(input, space);
+}
+
+// Each tile processed on its own and stitched back, as the render graph
+// does for pointwise adjustments.
+QImage processTiled(void (*build)(FilterPipeline&), WorkingSpace space, const QImage& input, int tileSize)
+{
+    FilterPipeline pipeline;
+    build(pipeline);
+
+    QImage result(input.size(), QImage::Format_ARGB32_Premultiplied);
+    for (int top = 0; top < input.height(); top += tileSize) {
+        for (int left = 0; left < input.width(); left += tileSize) {
+            const QRect tile = QRect(left, top, tileSize, tileSize).intersected(input.rect());
+            const QImage part = pipeline.process(input.copy(tile), space);
+            for (int y = 0; y < tile.height(); ++y)
+                std::copy_n(part.constScanLine(y), tile.width() * 4, result.scanLine(tile.top() + y) + tile.left() * 4);
+        }
+    }
+
+    return result;
+}
+
+// The filters one after another, without the pipeline's fused tone curves
+// and detail stages.
+QImage applyEach(const std::vector<std::unique_ptr<ImageFilter>>& filters, const QImage& input)
+{
+    QImage image = input;
+    for (const auto& filter : filters)
+        image = filter->apply(image);
+    return image;
+}
+
+// The per-channel std::pow that LinearLight::power stands in for.
+QImage scalarLinearPower(const QImage& input, float exponent, float pivot)
+{
+    QImage linear = LinearLight::toLinear(input);
+    LinearLight::forEachRow(linear, [=](float* rgba, int width) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                float& v = rgba[x * 4 + c];
+                v = pivot * std::pow(std::max(v, 0.0f) / pivot, exponent);
+            }
+        }
+    });
+    return LinearLight::fromLinear(linear);
+}
+
+// Halving with the box kernel averages exact pixel pairs, one axis at a
+// time with rounding in between, right up to the last row and column.
+QImage boxHalved(const QImage& input)
+{
+    const QImage even = input.copy(0, 0, input.width() & ~1, input.height() & ~1);
+    QImage result(even.size() / 2, QImage::Format_ARGB32_Premultiplied);
+
+    for (int y = 0; y < result.height(); ++y) {
+        const uchar* top = even.constScanLine(y * 2);
+        const uchar* bottom = even.constScanLine(y * 2 + 1);
+        uchar* out = result.scanLine(y);
+
+        for (int x = 0; x < result.width() * 4; ++x) {
+            const int i = (x / 4) * 8 + x % 4;
+            const int upper = (top[i] + top[i + 4] + 1) / 2;
+            const int lower = (bottom[i] + bottom[i + 4] + 1) / 2;
+            out[x] = static_cast<uchar>((upper + lower + 1) / 2);
+        }
+    }
+
+    return result;
+}
+
+QPainter::CompositionMode compositionMode(BlendMode mode)
+{
+    switch (mode) {
+    case BlendMode::Multiply: return QPainter::CompositionMode_Multiply;
+    case BlendMode::Screen:   return QPainter::CompositionMode_Screen;
+    case BlendMode::Overlay:  return QPainter::CompositionMode_Overlay;
+    default:                  return QPainter::CompositionMode_SourceOver;
+    }
+}
+
+std::unique_ptr<LayerManager> makeStack(const QImage& input, BlendMode mode)
+{
+    auto manager = std::make_unique<LayerManager>(input.size());
+    manager->addLayer(std::make_shared<PixelLayer>("Base", input));
+
+    auto top = std::make_shared<PixelLayer>("Top", input.mirrored(true, false), true, 0.7f);
+    top->setBlendMode(mode);
+    manager->addLayer(top);
+
+    auto adjustment = std::make_shared<AdjustmentLayer>("Adjustment");
+    addBasicStack(adjustment->pipeline());
+    adjustment->setClipped(true);
+    manager->addLayer(adjustment);
+
+    return manager;
+}
+
+// makeStack() drawn without the render graph: the clipped adjustment is
+// the frozen basic stack run over the top layer's unpremultiplied colours
+// and premultiplied again by its alpha, then each layer is painted over
+// the one below.
+QImage sequentialComposite(const QImage& input, BlendMode mode)
+{
+    const QImage top = input.mirrored(true, false);
+
+    QImage colours = top.copy();
+    for (int y = 0; y < colours.height(); ++y) {
+        QRgb* row = reinterpret_cast<QRgb*>(colours.scanLine(y));
+        for (int x = 0; x < colours.width(); ++x)
+            row[x] = qUnpremultiply(row[x]) | 0xff000000u;
+    }
+
+    QImage adjusted = baselineBasicStack(colours).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < adjusted.height(); ++y) {
+        const QRgb* alpha = reinterpret_cast<const QRgb*>(top.constScanLine(y));
+        QRgb* row = reinterpret_cast<QRgb*>(adjusted.scanLine(y));
+        for (int x = 0; x < adjusted.width(); ++x)
+            row[x] = qPremultiply((row[x] & 0x00ffffffu) | (alpha[x] & 0xff000000u));
+    }
+
+    QImage result(input.size(), QImage::Format_ARGB32_Premultiplied);
+    result.fill(Qt::transparent);
+    QPainter painter(&result);
+    painter.drawImage(QPoint(0, 0), input);
+    painter.setOpacity(0.7);
+    painter.setCompositionMode(compositionMode(mode));
+    painter.drawImage(QPoint(0, 0), adjusted);
+    painter.end();
+    return result;
+}
+
+// A run of translucent Normal layers, each shifted a little further so
+// that their edges fall inside tiles.
+constexpr int RunLayers = 12;
+
+QPoint runOffset(int i)
+{
+    return QPoint(i * 23, i * 17);
+}
+
+float runOpacity(int i)
+{
+    return 0.25f + 0.05f * i;
+}
+
+QImage compositeRun(const QImage& input)
+{
+    LayerManager manager(input.size());
+    for (int i = 0; i < RunLayers; ++i) {
+        auto layer = std::make_shared<PixelLayer>(QString("Layer %1").arg(i), input, true, runOpacity(i));
+        layer->setOffset(QPointF(runOffset(i)));
+        manager.addLayer(layer);
+    }
+    return manager.composite();
+}
+
+QImage sequentialRun(const QImage& input)
+{
+    QImage result(input.size(), QImage::Format_ARGB32_Premultiplied);
+    result.fill(Qt::transparent);
+    QPainter painter(&result);
+    for (int i = 0; i < RunLayers; ++i) {
+        painter.setOpacity(runOpacity(i));
+        painter.drawImage(runOffset(i), input);
+    }
+    painter.end();
+    return result;
+}
+
+}
+
+bool GoldenTolerance::accepts(const ImageDiff& diff) const
+{
+    return !diff.sizeMismatch && diff.maxAbsError <= maxAbsError && diff.psnr >= minPsnr;
+}
+
+GoldenHarness::GoldenHarness(QString referenceDir)
+    : m_referenceDir(std::move(referenceDir))
+{
+}
+
+void GoldenHarness::addInput(const QString& name, const QImage& image)
+{
+    m_inputs.push_back({name, image.convertToFormat(QImage::Format_ARGB32_Premultiplied)});
+}
+
+void GoldenHarness::addCase(const QString& name, Run run, GoldenTolerance tolerance, Run baseline)
+{
+    m_cases.push_back({name, std::move(run), tolerance, std::move(baseline)});
+}
+
+void GoldenHarness::addCrossCheck(const QString& name, Run run, Run alternative, GoldenTolerance tolerance)
+{
+    m_crossChecks.push_back({name, std::move(run), std::move(alternative), tolerance});
+}
+
+void GoldenHarness::addDefaultInputs(const QString& corpusDir)
+{
+    // Small, as the references are kept in the source tree. The gradient is
+    // larger than a render tile so that its composites cross tile edges.
+    addInput("gradient", BenchRunner::makeImage(QSize(320, 272), 1));
+    addInput("odd-size", BenchRunner::makeImage(QSize(197, 131), 3));
+    addInput("alpha-ramp", makeAlphaRamp(QSize(272, 128)));
+    addInput("extremes", makeExtremes(QSize(256, 256)));
+
+    if (corpusDir.isEmpty())
+        return;
+
+    const QFileInfoList files = QDir(corpusDir).entryInfoList(
+        {"*.png", "*.jpg", "*.jpeg", "*.bmp", "*.tif", "*.tiff"}, QDir::Files, QDir::Name);
+
+    for (const QFileInfo& file : files) {
+        const QImage image(file.absoluteFilePath());
+        if (!image.isNull())
+            addInput(file.completeBaseName(), image);
+    }
+}
+
+void GoldenHarness::addDefaultCases()
+{
+    // Kernels built on float maths may round differently on another
+    // compiler or libm, so they get one level of slack.
+    const GoldenTolerance exact {0, std::numeric_limits<double>::infinity(), true};
+    const GoldenTolerance rounding {1, 50.0, true};
+
+    std::map<QString, Run> baselines;
+    for (auto& [name, run] : baselineFilters())
+        baselines[name] = std::move(run);
+
+    for (const auto& [name, filter] : benchFilters()) {
+        GoldenTolerance tolerance = rounding;
+        if (name == "flip" || name == "rotate")
+            tolerance = exact;
+
+        const auto baseline = baselines.find(name);
+        addCase("filter/" + name, [filter = filter](const QImage& input) {
+            return filter->apply(input);
+        }, tolerance, baseline != baselines.end() ? baseline->second : Run());
+    }
+
+    addCase("util/fastblur", [](const QImage& input) { return FastBlur::apply(input, 8); }, rounding,
+            [](const QImage& input) { return baselineFastBlur(input, 8); });
+    addCase("util/gaussian", [](const QImage& input) { return GaussianBlurUtil::apply(input, 4.0); }, rounding,
+            [](const QImage& input) { return baselineGaussianBlur(input, 4.0); });
+
+    addCase("pipeline/basic", [](const QImage& input) {
+        return processWith(addBasicStack, WorkingSpace::Display8Bit, input);
+    }, rounding, baselineBasicStack);
+    addCase("pipeline/basic-linear", [](const QImage& input) {
+        return processWith(addBasicStack, WorkingSpace::LinearFloat, input);
+    }, rounding);
+    addCase("pipeline/full", [](const QImage& input) {
+        return processWith(addFullStack, WorkingSpace::Display8Bit, input);
+    }, rounding);
+    addCase("pipeline/full-linear", [](const QImage& input) {
+        return processWith(addFullStack, WorkingSpace::LinearFloat, input);
+    }, rounding);
+
+    const std::pair<BlendMode, QString> modes[] = {
+        {BlendMode::Normal, "normal"},
+        {BlendMode::Multiply, "multiply"},
+        {BlendMode::Screen, "screen"},
+        {BlendMode::Overlay, "overlay"}
+    };
+
+    // The frozen kernels and the pipeline's tone curves round apart by up
+    // to a level, which blending can carry into the composite.
+    for (const auto& [mode, modeName] : modes) {
+        addCase("composite/" + modeName, [mode = mode](const QImage& input) {
+            return makeStack(input, mode)->composite();
+        }, rounding, [mode = mode](const QImage& input) {
+            return sequentialComposite(input, mode);
+        });
+    }
+    addCase("composite/run", compositeRun, exact, sequentialRun);
+
+    // Tiles smaller than the inputs, so every input is split.
+    constexpr int TileSize = 96;
+    addCrossCheck("tiled/basic", [](const QImage& input) {
+        return processWith(addBasicStack, WorkingSpace::Display8Bit, input);
+    }, [](const QImage& input) {
+        return processTiled(addBasicStack, WorkingSpace::Display8Bit, input, TileSize);
+    }, exact);
+    addCrossCheck("tiled/basic-linear", [](const QImage& input) {
+        return processWith(addBasicStack, WorkingSpace::LinearFloat, input);
+    }, [](const QImage& input) {
+        return processTiled(addBasicStack, WorkingSpace::LinearFloat, input, TileSize);
+    }, exact);
+
+    // Only the tone curve fusion is checked: consecutive detail filters are
+    // defined to read the same input, which running them one by one does not.
+    addCrossCheck("fused/basic", [](const QImage& input) {
+        return processWith(addBasicStack, WorkingSpace::Display8Bit, input);
+    }, [](const QImage& input) {
+        return applyEach(basicStackFilters(), input);
+    }, rounding);
+
+    addCrossCheck("scalar/gamma-linear", [](const QImage& input) {
+        return processWith([](FilterPipeline& pipeline) {
+            pipeline.addFilter(std::make_unique<GammaFilter>(30));
+        }, WorkingSpace::LinearFloat, input);
+    }, [](const QImage& input) {
+        return scalarLinearPower(input, 1.3f, 1.0f);
+    }, rounding);
+    addCrossCheck("scalar/contrast-linear", [](const QImage& input) {
+        return processWith([](FilterPipeline& pipeline) {
+            pipeline.addFilter(std::make_unique<ContrastFilter>(30));
+        }, WorkingSpace::LinearFloat, input);
+    }, [](const QImage& input) {
+        const float factor = static_cast<float>((259.0 * (30 + 255.0)) / (255.0 * (259.0 - 30)));
+        return scalarLinearPower(input, factor, LinearLight::decode(128));
+    }, rounding);
+
+    addCrossCheck("resample/box-half", [](const QImage& input) {
+        const QImage even = input.copy(0, 0, input.width() & ~1, input.height() & ~1);
+        return Resampler::resize(even, even.size() / 2, Resampler::Kernel::Box);
+    }, boxHalved, exact);
+
+    // The proxy scales each layer before blending and adjusting, which
+    // only commutes approximately with scaling the full composite; noisy
+    // inputs differ by up to a dozen levels at edges.
+    constexpr int ProxyLongSide = 160;
+    addCrossCheck("proxy/composite", [](const QImage& input) {
+        auto manager = makeStack(input, BlendMode::Normal);
+        return manager->compositeUpTo(manager->layerCount(), ProxyLongSide);
+    }, [](const QImage& input) {
+        const QImage full = makeStack(input, BlendMode::Normal)->composite();
+        return Resampler::resize(full, Resampler::fitted(full.size(), ProxyLongSide), Resampler::Kernel::Box);
+    }, {16, 30.0, true});
+}
+
+QString GoldenHarness::referencePath(const Input& input, const Case& c) const
+{
+    QString caseName = c.name;
+    caseName.replace('/', '_');
+    return QDir(m_referenceDir).filePath(input.name + "__" + caseName + ".png");
+}
+
+// References keep the premultiplied bytes untouched: the buffer is written
+// as if it were straight ARGB so that PNG storage is lossless for
+// translucent pixels, and reinterpreted the same way when loaded.
+bool GoldenHarness::saveReference(const QImage& image, const QString& path)
+{
+    const QImage premultiplied = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage raw(premultiplied.constBits(), premultiplied.width(), premultiplied.height(),
+                     premultiplied.bytesPerLine(), QImage::Format_ARGB32);
+    return raw.save(path, "PNG");
+}
+
+QImage GoldenHarness::loadReference(const QString& path)
+{
+    QImage raw(path);
+    if (raw.isNull())
+        return {};
+
+    raw = raw.convertToFormat(QImage::Format_ARGB32);
+    QImage image(raw.size(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < raw.height(); ++y)
+        std::copy_n(raw.constScanLine(y), raw.width() * 4, image.scanLine(y));
+
+    return image;
+}
+
+ImageDiff GoldenHarness::compare(const QImage& a, const QImage& b)
+{
+    ImageDiff diff;
+    if (a.size() != b.size()) {
+        diff.sizeMismatch = true;
+        diff.maxAbsError = 255;
+        diff.psnr = 0.0;
+        return diff;
+    }
+
+    const QImage left = a.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage right = b.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const int rowBytes = left.width() * 4;
+
+    double squared = 0.0;
+    for (int y = 0; y < left.height(); ++y) {
+        const uchar* p = left.constScanLine(y);
+        const uchar* q = right.constScanLine(y);
+        for (int i = 0; i < rowBytes; ++i) {
+            const int d = std::abs(int(p[i]) - int(q[i]));
+            diff.maxAbsError = std::max(diff.maxAbsError, d);
+            squared += d * d;
+        }
+    }
+
+    const double samples = double(rowBytes) * left.height();
+    if (squared > 0.0 && samples > 0.0)
+        diff.psnr = 10.0 * std::log10(255.0 * 255.0 / (squared / samples));
+
+    return diff;
+}
+
+bool GoldenHarness::generate(QTextStream& log) const
+{
+    if (!QDir().mkpath(m_referenceDir)) {
+        log << "Cannot create " << m_referenceDir << Qt::endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (const auto& input : m_inputs) {
+        for (const auto& c : m_cases) {
+            const QString path = referencePath(input, c);
+            const QImage reference = c.baseline ? c.baseline(input.image) : c.run(input.image);
+            if (!saveReference(reference, path)) {
+                log << "Failed to write " << path << Qt::endl;
+                ok = false;
+            }
+        }
+    }
+
+    log << "Wrote " << m_inputs.size() * m_cases.size() << " references to " << m_referenceDir << Qt::endl;
+    return ok;
+}
+
+int GoldenHarness::verify(QTextStream& log) const
+{
+    const int defaultThreads = ParallelFor::threadCount();
+    const int oddThreads = std::max(2, defaultThreads / 2 + 1);
+
+    int failures = 0;
+    auto report = [&](const QString& what, const ImageDiff& diff, bool pass) {
+        if (pass)
+            return;
+
+        ++failures;
+        log << "FAIL " << what
+            << (diff.sizeMismatch ? QString(" size mismatch")
+                                  : QString(" max %1, PSNR %2 dB").arg(diff.maxAbsError).arg(diff.psnr, 0, 'f', 2))
+            << Qt::endl;
+    };
+
+    for (const auto& input : m_inputs) {
+        for (const auto& c : m_cases) {
+            const QString label = input.name + " " + c.name;
+            const QImage output = c.run(input.image);
+
+            const QImage reference = loadReference(referencePath(input, c));
+            if (reference.isNull()) {
+                ++failures;
+                log << "FAIL " << label << " missing reference" << Qt::endl;
+            } else {
+                const ImageDiff diff = compare(output, reference);
+                report(label + " vs reference", diff, c.tolerance.accepts(diff));
+            }
+
+            if (c.baseline) {
+                const ImageDiff diff = compare(output, c.baseline(input.image));
+                report(label + " vs baseline", diff, c.tolerance.accepts(diff));
+            }
+
+            if (!c.tolerance.deterministic)
+                continue;
+
+            for (int threads : {1, oddThreads}) {
+                if (threads == defaultThreads)
+                    continue;
+
+                ParallelFor::setMaxThreads(threads);
+                const QImage alternative = c.run(input.image);
+                ParallelFor::setMaxThreads(defaultThreads);
+
+                const ImageDiff diff = compare(alternative, output);
+                report(label + QString(" with %1 thread(s)").arg(threads), diff,
+                       !diff.sizeMismatch && diff.maxAbsError == 0);
+            }
+        }
+
+        for (const auto& check : m_crossChecks) {
+            const ImageDiff diff = compare(check.run(input.image), check.alternative(input.image));
+            report(input.name + " " + check.name, diff, check.tolerance.accepts(diff));
+        }
+    }
+
+    log << (failures == 0 ? QString("All golden checks passed")
+                          : QString("%1 golden check(s) failed").arg(failures))
+        << Qt::endl;
+    return failures;
+}
@@ -0,0 +1,95 @@
+#ifndef GOLDENHARNESS_H
+#define GOLDENHARNESS_H
+
+#include <QImage>
+#include <QString>
+#include <QTextStream>
+#include <functional>
+#include <limits>
+#include <vector>
+
+struct ImageDiff
+{
+    bool sizeMismatch {false};
+    int maxAbsError {0};
+    double psnr {std::numeric_limits<double>::infinity()};
+};
+
+struct GoldenTolerance
+{
+    int maxAbsError {0};
+    double minPsnr {std::numeric_limits<double>::infinity()};
+    // Cases whose output depends on scheduling or a random source are only
+    // compared against the reference, not across thread counts.
+    bool deterministic {true};
+
+    bool accepts(const ImageDiff& diff) const;
+};
+
+// Runs every case over a fixed input corpus and compares the results with
+// reference images on disk. Cases that existed before the optimised kernels
+// carry a baseline, the frozen pre-series implementation, and composites
+// carry one that paints the layers in turn with QPainter. A baseline's
+// output is what generate() writes, and verify() checks against it live as
+// well, so regenerating the references cannot hide a regression. Each case
+// is also re-run serially and with an odd worker count, which must match the
+// default run exactly, and cross-checks compare two backends that must
+// agree: tiled against whole, fused against unfused, proxy against full
+// size, vectorised against scalar.
+class GoldenHarness
+{
+public:
+    using Run = std::function<QImage(const QImage& input)>;
+
+    explicit GoldenHarness(QString referenceDir);
+
+    void addInput(const QString& name, const QImage& image);
+    void addCase(const QString& name, Run run, GoldenTolerance tolerance = {}, Run baseline = {});
+    // Checked by verify() only; neither side is stored on disk.
+    void addCrossCheck(const QString& name, Run run, Run alternative, GoldenTolerance tolerance = {});
+
+    // Adds the built-in synthetic corpus, plus every readable image in
+    // corpusDir when it is not empty.
+    void addDefaultInputs(const QString& corpusDir = QString());
+    void addDefaultCases();
+
+    bool generate(QTextStream& log) const;
+    // Returns the number of failed comparisons.
+    int verify(QTextStream& log) const;
+
+    static ImageDiff compare(const QImage& a, const QImage& b);
+
+private:
+    struct Input
+    {
+        QString name;
+        QImage image;
+    };
+
+    struct Case
+    {
+        QString name;
+        Run run;
+        GoldenTolerance tolerance;
+        Run baseline;
+    };
+
+    struct CrossCheck
+    {
+        QString name;
+        Run run;
+        Run alternative;
+        GoldenTolerance tolerance;
+    };
+
+    QString referencePath(const Input& input, const Case& c) const;
+    static bool saveReference(const QImage& image, const QString& path);
+    static QImage loadReference(const QString& path);
+
+    QString m_referenceDir;
+    std::vector<Input> m_inputs;
+    std::vector<Case> m_cases;
+    std::vector<CrossCheck> m_crossChecks;
+};
+
+#endif // GOLDENHARNESS_H
@@ -0,0 +1,96 @@
+#include "benchcases.h"
+#include "benchrunner.h"
+#include "goldenharness.h"
+
+#include "parallel/parallelfor.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonDocument>
+
+int main(int argc, char *argv[])
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("imageeditor_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks filters, pipelines, compositing and export.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption("sizes", "Comma separated image sizes in megapixels.", "list", "1,12,24,50");
+    QCommandLineOption filterOption("filter", "Only run cases whose name contains this text.", "text");
+    QCommandLineOption threadsOption("threads", "Limit worker threads (0 = all cores).", "count", "0");
+    QCommandLineOption secondsOption("min-time", "Minimum seconds spent timing each case.", "seconds", "0.5");
+    QCommandLineOption outOption("out", "Write results as JSON to this file.", "file");
+    QCommandLineOption compareOption("compare", "Compare against a baseline JSON file.", "file");
+    QCommandLineOption thresholdOption("threshold", "Allowed slowdown in percent before failing.", "percent", "10");
+    QCommandLineOption goldenGenerateOption("golden-generate", "Write reference images to this directory and exit.", "dir");
+    QCommandLineOption goldenVerifyOption("golden-verify", "Check outputs against the references in this directory and exit.", "dir");
+    QCommandLineOption goldenCorpusOption("golden-corpus", "Add every image in this directory to the golden inputs.", "dir");
+    parser.addOptions({sizesOption, filterOption, threadsOption, secondsOption,
+                       outOption, compareOption, thresholdOption,
+                       goldenGenerateOption, goldenVerifyOption, goldenCorpusOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    BenchRunner::Options options;
+    options.sizes.clear();
+    for (const QString& size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        const int megapixels = size.trimmed().toInt();
+        if (megapixels > 0)
+            options.sizes.append(megapixels);
+    }
+    options.filter = parser.value(filterOption);
+    options.minSeconds = parser.value(secondsOption).toDouble();
+
+    const int threads = parser.value(threadsOption).toInt();
+    if (threads > 0)
+        ParallelFor::setMaxThreads(threads);
+
+    if (parser.isSet(goldenGenerateOption) || parser.isSet(goldenVerifyOption)) {
+        const bool generating = parser.isSet(goldenGenerateOption);
+        GoldenHarness golden(parser.value(generating ? goldenGenerateOption : goldenVerifyOption));
+        golden.addDefaultInputs(parser.value(goldenCorpusOption));
+        golden.addDefaultCases();
+
+        if (generating)
+            return golden.generate(out) ? 0 : 2;
+        return golden.verify(out) == 0 ? 0 : 1;
+    }
+
+    BenchRunner runner(options);
+    registerBenchCases(runner);
+
+    const std::vector<BenchResult> results = runner.run(out);
+
+    if (parser.isSet(outOption)) {
+        QFile file(parser.value(outOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            out << "Failed to write " << file.fileName() << Qt::endl;
+            return 2;
+        }
+        file.write(BenchRunner::toJson(results).toJson());
+    }
+
+    if (parser.isSet(compareOption)) {
+        QFile file(parser.value(compareOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            out << "Failed to read " << file.fileName() << Qt::endl;
+            return 2;
+        }
+
+        const auto baseline = BenchRunner::fromJson(QJsonDocument::fromJson(file.readAll()));
+        const int regressions = BenchRunner::compare(baseline, results,
+                                                     parser.value(thresholdOption).toDouble(), out);
+        if (regressions > 0) {
+            out << regressions << " case(s) regressed" << Qt::endl;
+            return 1;
+        }
+        out << "No regressions" << Qt::endl;
+    }
+
+    return 0;
+}
@@ -3,13 +3,14 @@
 
 #include "command.h"
 #include "layers/layermanager.h"
-#include <QImage>
 #include <QRect>
-#include <functional>
 
+// Moves the canvas window; no layer pixels are copied or dropped, so both
+// directions cost the same whatever the document holds.
 class CropCommand : public Command
 {
 public:
+    // cropRect is in document coordinates, like layer offsets.
     CropCommand(LayerManager& mgr, const QRect& cropRect);
 
     void execute() override;
@@ -17,18 +18,8 @@ public:
 
 private:
     LayerManager& m_mgr;
-    QRect m_cropRect;
-
-    QSize m_oldCanvasSize;
-    QSize m_newCanvasSize;
-
-    struct LayerState {
-        std::shared_ptr<PixelLayer> layer;
-        QImage before;
-        QPointF oldOffset;
-    };
-
-    std::vector<LayerState> m_layers;
+    QRect m_oldCanvasRect;
+    QRect m_newCanvasRect;
 };
 
 
@@ -8,26 +8,23 @@ FlipLayerCommand::FlipLayerCommand(
 
 void FlipLayerCommand::execute()
 {
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(m_mgr.layerAt(m_index));
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_mgr.layerAt(m_index));
     if (!layer) return;
 
-    m_before = layer->image();
+    m_before = layer->transform();
 
-    layer->setImage(
-        layer->image().mirrored(
-            m_dir == Direction::Horizontal,
-            m_dir == Direction::Vertical
-            )
-        );
+    const bool horizontal = m_dir == Direction::Horizontal;
+    layer->setTransform(m_before * QTransform::fromScale(horizontal ? -1.0 : 1.0,
+                                                         horizontal ? 1.0 : -1.0));
 
     m_mgr.notifyLayerChanged();
 }
 
 void FlipLayerCommand::undo()
 {
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(m_mgr.layerAt(m_index));
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_mgr.layerAt(m_index));
     if (!layer) return;
 
-    layer->setImage(m_before);
+    layer->setTransform(m_before);
     m_mgr.notifyLayerChanged();
 }
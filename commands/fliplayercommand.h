@@ -3,6 +3,7 @@
 
 #include "command.h"
 #include "layers/layermanager.h"
+#include <QTransform>
 
 class FlipLayerCommand : public Command {
 public:
@@ -17,7 +18,7 @@ private:
     LayerManager& m_mgr;
     int m_index;
     Direction m_dir;
-    QImage m_before;
+    QTransform m_before;
 };
 
 #endif // FLIPLAYERCOMMAND_H
@@ -40,6 +40,105 @@ void RemoveLayerCommand::undo()
     }
 }
 
+ReplaceLayerCommand::ReplaceLayerCommand(LayerManager &manager, int index, std::shared_ptr<Layer> layer)
+    : m_manager(manager), m_index(index), m_layer(std::move(layer))
+{
+}
+
+// The command holds whichever of the two layers is not in the manager, so
+// execute and undo are the same swap.
+void ReplaceLayerCommand::execute()
+{
+    if (auto previous = m_manager.replaceLayer(m_index, m_layer))
+        m_layer = std::move(previous);
+}
+
+void ReplaceLayerCommand::undo()
+{
+    execute();
+}
+
+SetLayerMaskCommand::SetLayerMaskCommand(LayerManager &manager, int index, std::shared_ptr<LayerMask> mask)
+    : m_manager(manager), m_index(index), m_mask(std::move(mask))
+{
+}
+
+void SetLayerMaskCommand::execute()
+{
+    auto layer = m_manager.layerAt(m_index);
+    if (!layer)
+        return;
+
+    auto previous = layer->mask();
+    layer->setMask(std::move(m_mask));
+    m_mask = std::move(previous);
+    m_manager.notifyLayerChanged();
+}
+
+void SetLayerMaskCommand::undo()
+{
+    execute();
+}
+
+GroupLayersCommand::GroupLayersCommand(LayerManager &manager, int first, int count, std::shared_ptr<GroupLayer> group)
+    : m_manager(manager), m_first(first), m_count(count), m_group(std::move(group))
+{
+}
+
+void GroupLayersCommand::execute()
+{
+    m_manager.groupLayers(m_first, m_count, m_group);
+}
+
+void GroupLayersCommand::undo()
+{
+    m_manager.ungroupLayer(m_first);
+}
+
+UngroupLayerCommand::UngroupLayerCommand(LayerManager &manager, int index)
+    : m_manager(manager), m_index(index)
+{
+}
+
+void UngroupLayerCommand::execute()
+{
+    auto group = std::dynamic_pointer_cast<GroupLayer>(m_manager.layerAt(m_index));
+    if (!group)
+        return;
+
+    m_count = static_cast<int>(group->layers().size());
+    m_group = m_manager.ungroupLayer(m_index);
+}
+
+void UngroupLayerCommand::undo()
+{
+    if (m_group)
+        m_manager.groupLayers(m_index, m_count, m_group);
+}
+
+SetGroupPassThroughCommand::SetGroupPassThroughCommand(LayerManager &manager, int index, bool passThrough)
+    : m_manager(manager), m_index(index), m_passThrough(passThrough)
+{
+}
+
+// Swaps the stored mode with the group's, so undo is the same call.
+void SetGroupPassThroughCommand::execute()
+{
+    auto group = std::dynamic_pointer_cast<GroupLayer>(m_manager.layerAt(m_index));
+    if (!group)
+        return;
+
+    const bool previous = group->isPassThrough();
+    group->setPassThrough(m_passThrough);
+    m_passThrough = previous;
+    m_manager.notifyLayerChanged();
+}
+
+void SetGroupPassThroughCommand::undo()
+{
+    execute();
+}
+
 ReorderLayerCommand::ReorderLayerCommand(LayerManager &manager, int from, int to)
     : m_manager(manager), m_from(from), m_to(to)
 {
@@ -141,7 +240,7 @@ MoveLayerCommand::MoveLayerCommand(LayerManager& manager, int index, QPointF old
 
 void MoveLayerCommand::execute()
 {
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(m_manager.layerAt(m_index));
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_manager.layerAt(m_index));
     if (!layer)
         return;
 
@@ -151,7 +250,7 @@ void MoveLayerCommand::execute()
 
 void MoveLayerCommand::undo()
 {
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(m_manager.layerAt(m_index));
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_manager.layerAt(m_index));
     if (!layer)
         return;
 
@@ -165,7 +264,7 @@ ScaleLayerCommand::ScaleLayerCommand(LayerManager& manager, int index, float old
 
 void ScaleLayerCommand::execute()
 {
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(m_manager.layerAt(m_index));
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_manager.layerAt(m_index));
     if (!layer)
         return;
 
@@ -175,7 +274,7 @@ void ScaleLayerCommand::execute()
 
 void ScaleLayerCommand::undo()
 {
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(m_manager.layerAt(m_index));
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_manager.layerAt(m_index));
     if (!layer)
         return;
 
@@ -209,7 +308,7 @@ TransformLayerCommand::TransformLayerCommand(LayerManager& manager, int index, Q
 
 void TransformLayerCommand::execute()
     {
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(m_manager.layerAt(m_index));
+        auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_manager.layerAt(m_index));
         if (!layer)
             return;
 
@@ -220,7 +319,7 @@ void TransformLayerCommand::execute()
 
 void TransformLayerCommand::undo()
     {
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(m_manager.layerAt(m_index));
+        auto layer = std::dynamic_pointer_cast<PlacedLayer>(m_manager.layerAt(m_index));
         if (!layer)
             return;
 
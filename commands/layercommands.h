@@ -36,6 +36,78 @@ private:
     std::shared_ptr<Layer> m_removedLayer;
 };
 
+class ReplaceLayerCommand : public Command
+{
+public:
+    ReplaceLayerCommand(LayerManager &manager, int index, std::shared_ptr<Layer> layer);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    LayerManager &m_manager;
+    int m_index;
+    std::shared_ptr<Layer> m_layer;
+};
+
+class SetLayerMaskCommand : public Command
+{
+public:
+    SetLayerMaskCommand(LayerManager &manager, int index, std::shared_ptr<LayerMask> mask);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    LayerManager &m_manager;
+    int m_index;
+    std::shared_ptr<LayerMask> m_mask;
+};
+
+class GroupLayersCommand : public Command
+{
+public:
+    GroupLayersCommand(LayerManager &manager, int first, int count, std::shared_ptr<GroupLayer> group);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    LayerManager &m_manager;
+    int m_first;
+    int m_count;
+    std::shared_ptr<GroupLayer> m_group;
+};
+
+class UngroupLayerCommand : public Command
+{
+public:
+    UngroupLayerCommand(LayerManager &manager, int index);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    LayerManager &m_manager;
+    int m_index;
+    int m_count {0};
+    std::shared_ptr<GroupLayer> m_group;
+};
+
+class SetGroupPassThroughCommand : public Command
+{
+public:
+    SetGroupPassThroughCommand(LayerManager &manager, int index, bool passThrough);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    LayerManager &m_manager;
+    int m_index;
+    bool m_passThrough;
+};
+
 class ReorderLayerCommand : public Command
 {
 public:
@@ -0,0 +1,34 @@
+#include "maskstrokecommand.h"
+
+MaskStrokeCommand::MaskStrokeCommand(LayerManager& mgr,
+                                     std::shared_ptr<LayerMask> mask,
+                                     const QRect& rect,
+                                     const QImage& before,
+                                     const QImage& after,
+                                     const QImage& coverage)
+    : m_mgr(mgr),
+    m_mask(std::move(mask)),
+    m_rect(rect),
+    m_before(before),
+    m_after(after),
+    m_coverage(coverage)
+{
+}
+
+void MaskStrokeCommand::execute()
+{
+    if (!m_mask)
+        return;
+
+    m_mask->write(m_rect.topLeft(), m_after, m_coverage);
+    m_mgr.notifyChanged();
+}
+
+void MaskStrokeCommand::undo()
+{
+    if (!m_mask)
+        return;
+
+    m_mask->write(m_rect.topLeft(), m_before, m_coverage);
+    m_mgr.notifyChanged();
+}
@@ -0,0 +1,34 @@
+#ifndef MASKSTROKECOMMAND_H
+#define MASKSTROKECOMMAND_H
+
+#include "command.h"
+#include "layers/layermanager.h"
+#include <QImage>
+#include <QRect>
+#include <memory>
+
+// A brush stroke painted on a layer mask. Before and after hold mask values
+// for rect, in document coordinates; only covered pixels are written back.
+class MaskStrokeCommand : public Command
+{
+public:
+    MaskStrokeCommand(LayerManager& mgr,
+                      std::shared_ptr<LayerMask> mask,
+                      const QRect& rect,
+                      const QImage& before,
+                      const QImage& after,
+                      const QImage& coverage);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    LayerManager& m_mgr;
+    std::shared_ptr<LayerMask> m_mask;
+    QRect m_rect;
+    QImage m_before;
+    QImage m_after;
+    QImage m_coverage;
+};
+
+#endif // MASKSTROKECOMMAND_H
@@ -3,6 +3,7 @@
 
 #include "command.h"
 #include "layers/layermanager.h"
+#include <QTransform>
 
 class RotateLayerCommand : public Command {
 public:
@@ -15,7 +16,7 @@ private:
     LayerManager& m_mgr;
     int m_index;
     int m_angle;
-    QImage m_before;
+    QTransform m_before;
 };
 
 #endif // ROTATELAYERCOMMAND_H
@@ -0,0 +1,113 @@
+#include "trimcommand.h"
+#include "image/imagetransform.h"
+#include "layers/layer.h"
+
+std::vector<TrimCommand::LayerTrim> TrimCommand::snapshot(const LayerManager& mgr)
+{
+    std::vector<LayerTrim> layers;
+
+    for (const auto& layer : mgr.allLayers()) {
+        auto placed = std::dynamic_pointer_cast<PlacedLayer>(layer);
+        if (!placed)
+            continue;
+
+        const auto* pixel = dynamic_cast<const PixelLayer*>(placed.get());
+
+        LayerTrim t;
+        t.layer = placed;
+        t.before = {pixel ? pixel->image() : QImage(), placed->offset(), placed->scale(), placed->transform()};
+        t.after = t.before;
+        layers.push_back(std::move(t));
+    }
+
+    return layers;
+}
+
+// The window is mapped back through each layer's offset, scale and
+// orientation to find the source pixels it covers. The kept block is then
+// placed where its oriented bounding box sat, relative to the new origin.
+void TrimCommand::trim(std::vector<LayerTrim>& layers, const QRect& canvasRect)
+{
+    const QPointF origin(canvasRect.topLeft());
+
+    for (auto& t : layers) {
+        const LayerState& before = t.before;
+        LayerState& after = t.after;
+        after = before;
+        after.offset = before.offset - origin;
+
+        if (before.image.isNull())
+            continue;
+
+        const QTransform imageToLayer = ImageTransform::normalized(before.transform, before.image.size());
+        const QRectF window((QPointF(canvasRect.topLeft()) - before.offset) / before.scale,
+                            QSizeF(canvasRect.size()) / before.scale);
+        const QRect kept = imageToLayer.inverted().mapRect(window).toAlignedRect()
+                               .intersected(before.image.rect());
+
+        if (kept.isEmpty() || kept == before.image.rect())
+            continue;
+
+        const QRectF placed = imageToLayer.mapRect(QRectF(kept));
+        after.image = before.image.copy(kept);
+        after.offset = before.offset + placed.topLeft() * before.scale - origin;
+    }
+}
+
+bool TrimCommand::isCurrent(const LayerManager& mgr, const std::vector<LayerTrim>& layers, const QRect& canvasRect)
+{
+    if (mgr.canvasRect() != canvasRect)
+        return false;
+
+    for (const auto& t : layers) {
+        const PlacedLayer& layer = *t.layer;
+        const auto* pixel = dynamic_cast<const PixelLayer*>(&layer);
+        if ((pixel && pixel->image().cacheKey() != t.before.image.cacheKey())
+            || layer.offset() != t.before.offset
+            || layer.scale() != t.before.scale
+            || layer.transform() != t.before.transform)
+            return false;
+    }
+
+    return true;
+}
+
+TrimCommand::TrimCommand(LayerManager& mgr, std::vector<LayerTrim> layers, const QRect& canvasRect)
+    : m_mgr(mgr),
+    m_layers(std::move(layers)),
+    m_canvasRect(canvasRect)
+{
+    for (const auto& layer : mgr.allLayers()) {
+        if (layer && layer->mask())
+            m_masks.push_back(layer->mask());
+    }
+}
+
+void TrimCommand::restore(PlacedLayer& layer, const LayerState& state)
+{
+    if (auto* pixel = dynamic_cast<PixelLayer*>(&layer))
+        pixel->setImage(state.image);
+    layer.setOffset(state.offset);
+    layer.setScale(state.scale);
+    layer.setTransform(state.transform);
+}
+
+void TrimCommand::execute()
+{
+    for (auto& t : m_layers)
+        restore(*t.layer, t.after);
+    for (auto& mask : m_masks)
+        mask->translate(-m_canvasRect.topLeft());
+
+    m_mgr.setCanvasRect(QRect(QPoint(0, 0), m_canvasRect.size()));
+}
+
+void TrimCommand::undo()
+{
+    for (auto& t : m_layers)
+        restore(*t.layer, t.before);
+    for (auto& mask : m_masks)
+        mask->translate(m_canvasRect.topLeft());
+
+    m_mgr.setCanvasRect(m_canvasRect);
+}
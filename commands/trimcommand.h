@@ -0,0 +1,53 @@
+#ifndef TRIMCOMMAND_H
+#define TRIMCOMMAND_H
+
+#include "command.h"
+#include "layers/layermanager.h"
+#include <QRect>
+#include <QTransform>
+#include <memory>
+#include <vector>
+
+// Drops the pixels of every pixel layer that lie outside the canvas window
+// and moves the window back to the document origin; smart layers and masks
+// only move. The trimmed images are computed beforehand by trim(), which
+// only reads a snapshot and can run on a worker thread while the document
+// stays editable.
+class TrimCommand : public Command
+{
+public:
+    struct LayerState
+    {
+        QImage image;
+        QPointF offset;
+        float scale {1.0f};
+        QTransform transform;
+    };
+
+    struct LayerTrim
+    {
+        std::shared_ptr<PlacedLayer> layer;
+        LayerState before;
+        LayerState after;
+    };
+
+    static std::vector<LayerTrim> snapshot(const LayerManager& mgr);
+    static void trim(std::vector<LayerTrim>& layers, const QRect& canvasRect);
+    // False once any snapshotted layer or the canvas window has changed.
+    static bool isCurrent(const LayerManager& mgr, const std::vector<LayerTrim>& layers, const QRect& canvasRect);
+
+    TrimCommand(LayerManager& mgr, std::vector<LayerTrim> layers, const QRect& canvasRect);
+
+    void execute() override;
+    void undo() override;
+
+private:
+    static void restore(PlacedLayer& layer, const LayerState& state);
+
+    LayerManager& m_mgr;
+    std::vector<LayerTrim> m_layers;
+    std::vector<std::shared_ptr<LayerMask>> m_masks;
+    QRect m_canvasRect;
+};
+
+#endif // TRIMCOMMAND_H
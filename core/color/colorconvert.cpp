@@ -0,0 +1,244 @@
+#include "colorconvert.h"
+
+#include "linearlight.h"
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr float Inv255 = 1.0f / 255.0f;
+
+// Divisors are clamped to this instead of branching on zero; every such
+// division has a zero numerator whenever the divisor is zero.
+constexpr float Tiny = 1e-20f;
+
+// min/max rather than std::clamp, which GCC does not vectorise here.
+inline float clampf(float v, float lo, float hi)
+{
+    return std::min(std::max(v, lo), hi);
+}
+
+inline uint quantize(float v)
+{
+    return static_cast<uint>(clampf(v * 255.0f + 0.5f, 0.0f, 255.5f));
+}
+
+inline QRgb packRgb(float r, float g, float b)
+{
+    return 0xff000000u | (quantize(r) << 16) | (quantize(g) << 8) | quantize(b);
+}
+
+// Shared by HSV and HSL: hue from the channel holding the maximum, with a
+// zero-chroma pixel mapping to hue 0. Every candidate is computed up front
+// and the ternaries only select between finished values, which GCC turns
+// into vector blends; a bool-to-float mask or an arithmetic arm keeps the
+// loop scalar.
+inline float hueOf(float r, float g, float b, float maxv, float d)
+{
+    const float inv = 1.0f / std::max(d, Tiny);
+    const float hr = (g - b) * inv * 60.0f;
+    const float hg = (b - r) * inv * 60.0f + 120.0f;
+    const float hb = (r - g) * inv * 60.0f + 240.0f;
+
+    const float h = maxv == r ? hr : (maxv == g ? hg : hb);
+    const float wrapped = h + 360.0f;
+    return h < 0.0f ? wrapped : h;
+}
+
+// Wraps k from [0, 2 * period) into [0, period).
+inline float wrap(float k, float period)
+{
+    const float wrapped = k - period;
+    return k >= period ? wrapped : k;
+}
+
+constexpr float WhiteX = 0.95047f;
+constexpr float WhiteZ = 1.08883f;
+constexpr float LabDelta = 6.0f / 29.0f;
+
+inline float labF(float t)
+{
+    return t > LabDelta * LabDelta * LabDelta ? std::cbrt(t)
+                                              : t / (3.0f * LabDelta * LabDelta) + 4.0f / 29.0f;
+}
+
+inline float labFInverse(float t)
+{
+    return t > LabDelta ? t * t * t : 3.0f * LabDelta * LabDelta * (t - 4.0f / 29.0f);
+}
+
+void forEachRowPlanar(QImage& image,
+                      void (*toPlanar)(const QRgb*, int, float*, float*, float*),
+                      void (*fromPlanar)(const float*, const float*, const float*, int, QRgb*),
+                      const ColorConvert::PlanarRowFunction& fn)
+{
+    const int width = image.width();
+
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        std::vector<float> planes(static_cast<size_t>(width) * 3);
+        float* c0 = planes.data();
+        float* c1 = c0 + width;
+        float* c2 = c1 + width;
+
+        for (int y = begin; y < end; ++y) {
+            QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+            toPlanar(row, width, c0, c1, c2);
+            fn(c0, c1, c2, width);
+            fromPlanar(c0, c1, c2, width, row);
+        }
+    }, 16);
+}
+
+}
+
+void ColorConvert::rgbToHsv(const QRgb* rgb, int count, float* h, float* s, float* v)
+{
+    for (int i = 0; i < count; ++i) {
+        const float r = qRed(rgb[i]) * Inv255;
+        const float g = qGreen(rgb[i]) * Inv255;
+        const float b = qBlue(rgb[i]) * Inv255;
+
+        const float maxv = std::max(r, std::max(g, b));
+        const float minv = std::min(r, std::min(g, b));
+        const float d = maxv - minv;
+
+        h[i] = hueOf(r, g, b, maxv, d);
+        s[i] = d / std::max(maxv, Tiny);
+        v[i] = maxv;
+    }
+}
+
+// f(n) = v - v*s*clamp(min(k, 4 - k), 0, 1) with k = (n + h/60) mod 6.
+void ColorConvert::hsvToRgb(const float* h, const float* s, const float* v, int count, QRgb* rgb)
+{
+    for (int i = 0; i < count; ++i) {
+        const float hh = h[i] / 60.0f;
+        const float c = v[i] * s[i];
+
+        const float kr = wrap(5.0f + hh, 6.0f);
+        const float kg = wrap(3.0f + hh, 6.0f);
+        const float kb = wrap(1.0f + hh, 6.0f);
+
+        const float r = v[i] - c * clampf(std::min(kr, 4.0f - kr), 0.0f, 1.0f);
+        const float g = v[i] - c * clampf(std::min(kg, 4.0f - kg), 0.0f, 1.0f);
+        const float b = v[i] - c * clampf(std::min(kb, 4.0f - kb), 0.0f, 1.0f);
+
+        rgb[i] = packRgb(r, g, b);
+    }
+}
+
+void ColorConvert::rgbToHsl(const QRgb* rgb, int count, float* h, float* s, float* l)
+{
+    for (int i = 0; i < count; ++i) {
+        const float r = qRed(rgb[i]) * Inv255;
+        const float g = qGreen(rgb[i]) * Inv255;
+        const float b = qBlue(rgb[i]) * Inv255;
+
+        const float maxv = std::max(r, std::max(g, b));
+        const float minv = std::min(r, std::min(g, b));
+        const float d = maxv - minv;
+        const float light = (maxv + minv) * 0.5f;
+        const float denom = 1.0f - std::abs(2.0f * light - 1.0f);
+
+        h[i] = hueOf(r, g, b, maxv, d);
+        s[i] = d / std::max(denom, Tiny);
+        l[i] = light;
+    }
+}
+
+// f(n) = l - a*clamp(min(k - 3, 9 - k), -1, 1) with k = (n + h/30) mod 12
+// and a = s*min(l, 1 - l).
+void ColorConvert::hslToRgb(const float* h, const float* s, const float* l, int count, QRgb* rgb)
+{
+    for (int i = 0; i < count; ++i) {
+        const float hh = h[i] / 30.0f;
+        const float a = s[i] * std::min(l[i], 1.0f - l[i]);
+
+        const float kr = wrap(hh, 12.0f);
+        const float kg = wrap(8.0f + hh, 12.0f);
+        const float kb = wrap(4.0f + hh, 12.0f);
+
+        const float r = l[i] - a * clampf(std::min(kr - 3.0f, 9.0f - kr), -1.0f, 1.0f);
+        const float g = l[i] - a * clampf(std::min(kg - 3.0f, 9.0f - kg), -1.0f, 1.0f);
+        const float b = l[i] - a * clampf(std::min(kb - 3.0f, 9.0f - kb), -1.0f, 1.0f);
+
+        rgb[i] = packRgb(r, g, b);
+    }
+}
+
+// Full-range BT.601, as used by JPEG.
+void ColorConvert::rgbToYCbCr(const QRgb* rgb, int count, float* y, float* cb, float* cr)
+{
+    for (int i = 0; i < count; ++i) {
+        const float r = qRed(rgb[i]) * Inv255;
+        const float g = qGreen(rgb[i]) * Inv255;
+        const float b = qBlue(rgb[i]) * Inv255;
+
+        y[i] = 0.299f * r + 0.587f * g + 0.114f * b;
+        cb[i] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+        cr[i] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+    }
+}
+
+void ColorConvert::yCbCrToRgb(const float* y, const float* cb, const float* cr, int count, QRgb* rgb)
+{
+    for (int i = 0; i < count; ++i) {
+        rgb[i] = packRgb(y[i] + 1.402f * cr[i],
+                         y[i] - 0.344136f * cb[i] - 0.714136f * cr[i],
+                         y[i] + 1.772f * cb[i]);
+    }
+}
+
+// sRGB with a D65 white point; L* is scaled to [0, 1].
+void ColorConvert::rgbToLab(const QRgb* rgb, int count, float* l, float* a, float* b)
+{
+    for (int i = 0; i < count; ++i) {
+        const float r = LinearLight::decode(qRed(rgb[i]));
+        const float g = LinearLight::decode(qGreen(rgb[i]));
+        const float bl = LinearLight::decode(qBlue(rgb[i]));
+
+        const float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * bl) / WhiteX;
+        const float yy = 0.2126729f * r + 0.7151522f * g + 0.0721750f * bl;
+        const float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * bl) / WhiteZ;
+
+        const float fx = labF(x);
+        const float fy = labF(yy);
+        const float fz = labF(z);
+
+        l[i] = (116.0f * fy - 16.0f) / 100.0f;
+        a[i] = 500.0f * (fx - fy);
+        b[i] = 200.0f * (fy - fz);
+    }
+}
+
+void ColorConvert::labToRgb(const float* l, const float* a, const float* b, int count, QRgb* rgb)
+{
+    for (int i = 0; i < count; ++i) {
+        const float fy = (l[i] * 100.0f + 16.0f) / 116.0f;
+        const float fx = fy + a[i] / 500.0f;
+        const float fz = fy - b[i] / 200.0f;
+
+        const float x = labFInverse(fx) * WhiteX;
+        const float y = labFInverse(fy);
+        const float z = labFInverse(fz) * WhiteZ;
+
+        const float r = 3.2404542f * x - 1.5371385f * y - 0.4985314f * z;
+        const float g = -0.9692660f * x + 1.8760108f * y + 0.0415560f * z;
+        const float bl = 0.0556434f * x - 0.2040259f * y + 1.0572252f * z;
+
+        rgb[i] = packRgb(LinearLight::encode(r), LinearLight::encode(g), LinearLight::encode(bl));
+    }
+}
+
+void ColorConvert::forEachRowHsv(QImage& image, const PlanarRowFunction& fn)
+{
+    forEachRowPlanar(image, rgbToHsv, hsvToRgb, fn);
+}
+
+void ColorConvert::forEachRowHsl(QImage& image, const PlanarRowFunction& fn)
+{
+    forEachRowPlanar(image, rgbToHsl, hslToRgb, fn);
+}
@@ -0,0 +1,40 @@
+#ifndef COLORCONVERT_H
+#define COLORCONVERT_H
+
+#include <QImage>
+#include <QRgb>
+#include <functional>
+
+// Batch conversions between 8-bit RGB rows and planar float colour models.
+// The loops are branch-free so the compiler can vectorise them. Hue is in
+// degrees and must be within [0, 360) when converting back; the other
+// HSV/HSL components and Y/L* are normalised to [0, 1], Cb/Cr to
+// [-0.5, 0.5], and a*/b* use the usual CIE range. Writing back to RGB
+// produces opaque pixels, like the per-pixel filters.
+class ColorConvert
+{
+public:
+    // Called per row with three planar buffers of `width` floats that hold
+    // the converted row; whatever the function leaves in them is written
+    // back.
+    using PlanarRowFunction = std::function<void(float* c0, float* c1, float* c2, int width)>;
+
+    static void rgbToHsv(const QRgb* rgb, int count, float* h, float* s, float* v);
+    static void hsvToRgb(const float* h, const float* s, const float* v, int count, QRgb* rgb);
+
+    static void rgbToHsl(const QRgb* rgb, int count, float* h, float* s, float* l);
+    static void hslToRgb(const float* h, const float* s, const float* l, int count, QRgb* rgb);
+
+    static void rgbToYCbCr(const QRgb* rgb, int count, float* y, float* cb, float* cr);
+    static void yCbCrToRgb(const float* y, const float* cb, const float* cr, int count, QRgb* rgb);
+
+    static void rgbToLab(const QRgb* rgb, int count, float* l, float* a, float* b);
+    static void labToRgb(const float* l, const float* a, const float* b, int count, QRgb* rgb);
+
+    // Converts every row of an ARGB32 image in parallel, runs fn on it and
+    // converts back in place.
+    static void forEachRowHsv(QImage& image, const PlanarRowFunction& fn);
+    static void forEachRowHsl(QImage& image, const PlanarRowFunction& fn);
+};
+
+#endif // COLORCONVERT_H
@@ -0,0 +1,122 @@
+#include "colorlut3d.h"
+
+#include "parallel/parallelfor.h"
+
+#include <QColorTransform>
+#include <algorithm>
+
+namespace {
+
+constexpr int Last = ColorLut3D::GridSize - 1;
+
+inline int lerp8(int a, int b, int f)
+{
+    return a + (((b - a) * f) >> 8);
+}
+
+}
+
+ColorLut3D::ColorLut3D(const QColorSpace& source, const QColorSpace& target)
+{
+    if (!source.isValid() || !target.isValid() || source == target)
+        return;
+
+    const QColorTransform transform = source.transformationToColorSpace(target);
+    if (transform.isIdentity())
+        return;
+
+    m_table.resize(static_cast<size_t>(GridSize) * GridSize * GridSize * 3);
+
+    ParallelFor::run(GridSize, [&](int begin, int end) {
+        for (int b = begin; b < end; ++b) {
+            for (int g = 0; g < GridSize; ++g) {
+                for (int r = 0; r < GridSize; ++r) {
+                    const QRgba64 in = qRgba64(static_cast<quint16>(r * 65535 / Last),
+                                               static_cast<quint16>(g * 65535 / Last),
+                                               static_cast<quint16>(b * 65535 / Last),
+                                               65535);
+                    const QRgba64 out = transform.map(in);
+
+                    quint16* cell = &m_table[((static_cast<size_t>(b) * GridSize + g) * GridSize + r) * 3];
+                    cell[0] = static_cast<quint16>(out.red()   * 65280u / 65535u);
+                    cell[1] = static_cast<quint16>(out.green() * 65280u / 65535u);
+                    cell[2] = static_cast<quint16>(out.blue()  * 65280u / 65535u);
+                }
+            }
+        }
+    });
+}
+
+bool ColorLut3D::isIdentity() const
+{
+    return m_table.empty();
+}
+
+void ColorLut3D::apply(QImage& image, const QRect& rect) const
+{
+    if (isIdentity() || image.isNull())
+        return;
+
+    if (image.format() != QImage::Format_ARGB32_Premultiplied
+        && image.format() != QImage::Format_ARGB32
+        && image.format() != QImage::Format_RGB32)
+        image.convertTo(QImage::Format_ARGB32_Premultiplied);
+
+    const QRect area = rect.isNull() ? image.rect() : rect.intersected(image.rect());
+    if (area.isEmpty())
+        return;
+
+    const bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    const quint16* table = m_table.data();
+    const int strideG = GridSize * 3;
+    const int strideB = GridSize * GridSize * 3;
+
+    ParallelFor::run(area.height(), [&](int begin, int end) {
+        for (int y = area.top() + begin; y < area.top() + end; ++y) {
+            QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+            for (int x = area.left(); x <= area.right(); ++x) {
+                const int alpha = qAlpha(row[x]);
+                if (alpha == 0)
+                    continue;
+
+                const QRgb px = premultiplied && alpha != 255 ? qUnpremultiply(row[x]) : row[x];
+
+                // Grid coordinates in 8.8 fixed point: v * 32 / 255.
+                const int fr = qRed(px)   * (Last * 256) / 255;
+                const int fg = qGreen(px) * (Last * 256) / 255;
+                const int fb = qBlue(px)  * (Last * 256) / 255;
+
+                const int ir = std::min(fr >> 8, Last - 1);
+                const int ig = std::min(fg >> 8, Last - 1);
+                const int ib = std::min(fb >> 8, Last - 1);
+                const int tr = fr - (ir << 8);
+                const int tg = fg - (ig << 8);
+                const int tb = fb - (ib << 8);
+
+                const quint16* c000 = table + ib * strideB + ig * strideG + ir * 3;
+                const quint16* c100 = c000 + 3;
+                const quint16* c010 = c000 + strideG;
+                const quint16* c110 = c010 + 3;
+                const quint16* c001 = c000 + strideB;
+                const quint16* c101 = c001 + 3;
+                const quint16* c011 = c001 + strideG;
+                const quint16* c111 = c011 + 3;
+
+                int out[3];
+                for (int c = 0; c < 3; ++c) {
+                    const int x00 = lerp8(c000[c], c100[c], tr);
+                    const int x10 = lerp8(c010[c], c110[c], tr);
+                    const int x01 = lerp8(c001[c], c101[c], tr);
+                    const int x11 = lerp8(c011[c], c111[c], tr);
+                    const int y0  = lerp8(x00, x10, tg);
+                    const int y1  = lerp8(x01, x11, tg);
+                    out[c] = std::clamp((lerp8(y0, y1, tb) + 128) >> 8, 0, 255);
+                }
+
+                const QRgb mapped = qRgba(out[0], out[1], out[2], alpha);
+                row[x] = premultiplied && alpha != 255 ? qPremultiply(mapped) : mapped;
+            }
+        }
+    }, 16);
+}
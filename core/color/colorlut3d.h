@@ -0,0 +1,29 @@
+#ifndef COLORLUT3D_H
+#define COLORLUT3D_H
+
+#include <QColorSpace>
+#include <QImage>
+#include <QRect>
+#include <vector>
+
+// A profile-to-profile conversion baked into a 33^3 RGB grid, applied with
+// fixed-point trilinear interpolation. Building is the expensive part, so
+// callers keep one per profile pair and rebuild only when a profile changes.
+class ColorLut3D
+{
+public:
+    static constexpr int GridSize = 33;
+
+    ColorLut3D() = default;
+    ColorLut3D(const QColorSpace& source, const QColorSpace& target);
+
+    bool isIdentity() const;
+
+    void apply(QImage& image, const QRect& rect = QRect()) const;
+
+private:
+    // RGB triplets in 8.8 fixed point, red varying fastest.
+    std::vector<quint16> m_table;
+};
+
+#endif // COLORLUT3D_H
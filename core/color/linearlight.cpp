@@ -0,0 +1,243 @@
+#include "linearlight.h"
+#include "image/imagepool.h"
+
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr int EncodeTableSize = 4096;
+
+const std::array<float, 256>& decodeTable()
+{
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t {};
+        for (int i = 0; i < 256; ++i) {
+            const double c = i / 255.0;
+            t[i] = static_cast<float>(c <= 0.04045 ? c / 12.92
+                                                   : std::pow((c + 0.055) / 1.055, 2.4));
+        }
+        return t;
+    }();
+    return table;
+}
+
+const std::array<float, EncodeTableSize + 1>& encodeTable()
+{
+    static const std::array<float, EncodeTableSize + 1> table = [] {
+        std::array<float, EncodeTableSize + 1> t {};
+        for (int i = 0; i <= EncodeTableSize; ++i) {
+            const double l = static_cast<double>(i) / EncodeTableSize;
+            t[i] = static_cast<float>(l <= 0.0031308 ? l * 12.92
+                                                     : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055);
+        }
+        return t;
+    }();
+    return table;
+}
+
+constexpr int Bayer8[8][8] = {
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+// log2 and exp2 without calls or branches, so that loops over them
+// vectorise. Relative error stays below 1e-5 over the float range.
+inline float log2Approx(float x)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof bits);
+    const float e = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof m);
+
+    // log2(m) = 2 / ln 2 * atanh(t) for t = (m - 1) / (m + 1) in [0, 1/3).
+    const float t = (m - 1.0f) / (m + 1.0f);
+    const float t2 = t * t;
+    const float series = t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9 + t2 * (1.0f / 11))))));
+    return e + 2.88539008f * series;
+}
+
+inline float exp2Approx(float y)
+{
+    y = std::min(std::max(y, -126.0f), 127.0f);
+    // Truncating a positive value floors it.
+    const int whole = static_cast<int>(y + 128.0f) - 128;
+    const float f = (y - static_cast<float>(whole)) * 0.693147181f;
+
+    // Taylor series of e^f for f in [0, ln 2).
+    const float p = 1.0f + f * (1.0f + f * (1.0f / 2 + f * (1.0f / 6 + f * (1.0f / 24 + f * (1.0f / 120
+                    + f * (1.0f / 720 + f * (1.0f / 5040 + f * (1.0f / 40320))))))));
+    const std::uint32_t bits = static_cast<std::uint32_t>(whole + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof scale);
+    return p * scale;
+}
+
+// pivot * (v / pivot)^exponent, zero for v <= 0, without a branch.
+inline float powerOf(float v, float inverse, float exponent, float pivot)
+{
+    const float x = std::max(v * inverse, 0.0f);
+    const float raised = pivot * exp2Approx(exponent * log2Approx(std::max(x, 1e-30f)));
+    return raised * static_cast<float>(x > 1e-30f);
+}
+
+inline int quantize(float encoded, float dither)
+{
+    const int v = static_cast<int>(encoded * 255.0f + dither);
+    return std::clamp(v, 0, 255);
+}
+
+}
+
+float LinearLight::decode(int srgb)
+{
+    return decodeTable()[std::clamp(srgb, 0, 255)];
+}
+
+float LinearLight::encode(float linear)
+{
+    if (!(linear > 0.0f))
+        return 0.0f;
+    if (linear >= 1.0f)
+        return 1.0f;
+
+    const auto& table = encodeTable();
+    const float pos = linear * EncodeTableSize;
+    const int i = static_cast<int>(pos);
+    const float t = pos - i;
+    return table[i] + (table[i + 1] - table[i]) * t;
+}
+
+QImage LinearLight::toLinear(const QImage& image)
+{
+    const QImage src = image.format() == QImage::Format_ARGB32_Premultiplied
+        ? image
+        : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QImage linear = ImagePool::instance().acquire(src.size(), Format);
+    if (linear.isNull())
+        return linear;
+
+    const auto& table = decodeTable();
+    const int width = src.width();
+
+    ParallelFor::run(src.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const QRgb* in = reinterpret_cast<const QRgb*>(src.constScanLine(y));
+            float* out = reinterpret_cast<float*>(linear.scanLine(y));
+
+            for (int x = 0; x < width; ++x) {
+                const QRgb p = qUnpremultiply(in[x]);
+                out[4 * x + 0] = table[qRed(p)];
+                out[4 * x + 1] = table[qGreen(p)];
+                out[4 * x + 2] = table[qBlue(p)];
+                out[4 * x + 3] = qAlpha(p) / 255.0f;
+            }
+        }
+    }, 16);
+
+    return linear;
+}
+
+QImage LinearLight::fromLinear(const QImage& linear)
+{
+    QImage result = ImagePool::instance().acquire(linear.size(), QImage::Format_ARGB32_Premultiplied);
+    if (result.isNull())
+        return result;
+
+    const int width = linear.width();
+
+    ParallelFor::run(linear.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const float* in = reinterpret_cast<const float*>(linear.constScanLine(y));
+            QRgb* out = reinterpret_cast<QRgb*>(result.scanLine(y));
+            const int* bayerRow = Bayer8[y & 7];
+
+            for (int x = 0; x < width; ++x) {
+                const float dither = 0.05f + 0.9f * (bayerRow[x & 7] + 0.5f) / 64.0f;
+
+                const int r = quantize(encode(in[4 * x + 0]), dither);
+                const int g = quantize(encode(in[4 * x + 1]), dither);
+                const int b = quantize(encode(in[4 * x + 2]), dither);
+                const int a = quantize(std::clamp(in[4 * x + 3], 0.0f, 1.0f), 0.5f);
+
+                out[x] = qPremultiply(qRgba(r, g, b, a));
+            }
+        }
+    }, 16);
+
+    return result;
+}
+
+void LinearLight::forEachRow(QImage& linear, const RowFunction& fn)
+{
+    const int width = linear.width();
+
+    ParallelFor::run(linear.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y)
+            fn(reinterpret_cast<float*>(linear.scanLine(y)), width);
+    }, 16);
+}
+
+void LinearLight::scaleAndOffset(QImage& linear, const float scale[3], const float offset[3])
+{
+    const float s[4] = {scale[0], scale[1], scale[2], 1.0f};
+    const float o[4] = {offset[0], offset[1], offset[2], 0.0f};
+
+    forEachRow(linear, [&](float* px, int width) {
+        const int n = width * 4;
+        for (int i = 0; i < n; ++i)
+            px[i] = std::max(0.0f, px[i] * s[i & 3] + o[i & 3]);
+    });
+}
+
+void LinearLight::power(QImage& linear, float exponent, float pivot)
+{
+    const float inverse = 1.0f / pivot;
+
+    forEachRow(linear, [&](float* px, int width) {
+        for (int x = 0; x < width; ++x) {
+            px[4 * x + 0] = powerOf(px[4 * x + 0], inverse, exponent, pivot);
+            px[4 * x + 1] = powerOf(px[4 * x + 1], inverse, exponent, pivot);
+            px[4 * x + 2] = powerOf(px[4 * x + 2], inverse, exponent, pivot);
+        }
+    });
+}
+
+void LinearLight::premultiply(QImage& linear)
+{
+    forEachRow(linear, [](float* px, int width) {
+        for (int x = 0; x < width; ++x) {
+            const float a = px[4 * x + 3];
+            px[4 * x + 0] *= a;
+            px[4 * x + 1] *= a;
+            px[4 * x + 2] *= a;
+        }
+    });
+}
+
+void LinearLight::unpremultiply(QImage& linear)
+{
+    forEachRow(linear, [](float* px, int width) {
+        for (int x = 0; x < width; ++x) {
+            const float a = px[4 * x + 3];
+            const float inv = a > 0.0f ? 1.0f / a : 0.0f;
+            px[4 * x + 0] *= inv;
+            px[4 * x + 1] *= inv;
+            px[4 * x + 2] *= inv;
+        }
+    });
+}
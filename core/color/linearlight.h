@@ -0,0 +1,36 @@
+#ifndef LINEARLIGHT_H
+#define LINEARLIGHT_H
+
+#include <QImage>
+#include <functional>
+
+enum class WorkingSpace {
+    Display8Bit,
+    LinearFloat
+};
+
+// Linear-light images use QImage::Format_RGBA32FPx4 with straight alpha.
+class LinearLight
+{
+public:
+    using RowFunction = std::function<void(float* rgba, int width)>;
+
+    static constexpr QImage::Format Format = QImage::Format_RGBA32FPx4;
+
+    static QImage toLinear(const QImage& image);
+    static QImage fromLinear(const QImage& linear);
+
+    static float decode(int srgb);
+    static float encode(float linear);
+
+    static void forEachRow(QImage& linear, const RowFunction& fn);
+    static void scaleAndOffset(QImage& linear, const float scale[3], const float offset[3]);
+    // Colour channels become pivot * (v / pivot)^exponent, with negative
+    // values clamped to zero. Uses a polynomial pow that vectorises.
+    static void power(QImage& linear, float exponent, float pivot = 1.0f);
+
+    static void premultiply(QImage& linear);
+    static void unpremultiply(QImage& linear);
+};
+
+#endif // LINEARLIGHT_H
@@ -16,23 +16,18 @@ void BWFilter::setEnabled() {
     m_enabled = !m_enabled;
 }
 
-QImage BWFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-    int height {result.height()};
-    int width {result.width()};
+void BWFilter::applyInPlace(QImage& image) const {
+    int height {image.height()};
+    int width {image.width()};
 
     for (int y {0}; y < height; y++) {
-        QRgb *row = reinterpret_cast<QRgb*>(result.scanLine(y));
+        QRgb *row = reinterpret_cast<QRgb*>(image.scanLine(y));
 
         for (int x {0}; x < width; x++) {
             int gray {qGray(row[x])};
             row[x] = qRgb(gray, gray, gray);
         }
     }
-
-    return result;
 }
 
 
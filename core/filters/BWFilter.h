@@ -1,16 +1,16 @@
 #ifndef BLACKWHITE_H
 #define BLACKWHITE_H
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
-class BWFilter: public ImageFilter
+class BWFilter: public PointFilter
 {
 public:
 
     BWFilter(bool enabled);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -16,17 +16,14 @@ void BrightnessFilter::setBrightness(int brightness) {
     m_brightness = brightness;
 }
 
-QImage BrightnessFilter::apply(const QImage& input) const  {
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-    int height {result.height()};
-    int width {result.width()};
+void BrightnessFilter::applyInPlace(QImage& image) const {
+    int height {image.height()};
+    int width {image.width()};
 
     int brightness {getBrightness()};
 
     for (int y {0}; y < height; y++) {
-        QRgb *row = reinterpret_cast<QRgb*>(result.scanLine(y));
+        QRgb *row = reinterpret_cast<QRgb*>(image.scanLine(y));
         for (int x {0}; x < width; x++) {
             QRgb px = row[x];
 
@@ -37,8 +34,6 @@ QImage BrightnessFilter::apply(const QImage& input) const  {
             row [x] = qRgb(r, g, b);
         }
     }
-
-    return result;
 }
 
 
@@ -2,16 +2,16 @@
 #define BRIGHTNESSFILTER_H
 
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
 
-class BrightnessFilter: public ImageFilter
+class BrightnessFilter: public PointFilter
 {
 public:
     BrightnessFilter(int brightness);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
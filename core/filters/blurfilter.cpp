@@ -28,6 +28,16 @@ QImage BlurFilter::apply(const QImage& input) const {
 
 
 
+bool BlurFilter::supportsLinear() const {
+    return true;
+}
+
+void BlurFilter::applyLinear(QImage& linear) const {
+    double sigma {getBlur() * 0.4};
+
+    GaussianBlurUtil::applyLinear(linear, sigma);
+}
+
 std::unique_ptr<ImageFilter> BlurFilter::clone() const {
     return std::make_unique<BlurFilter>(*this);
 }
@@ -20,6 +20,8 @@ public:
     void setBlur(int blur);
 
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
 
 private:
 
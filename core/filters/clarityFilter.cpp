@@ -1,6 +1,14 @@
 #include "clarityFilter.h"
-#include "gaussianblurutil.h"
-#include "fastblur.h"
+
+#include <vector>
+
+namespace {
+
+constexpr int BaseRadius = 15;
+// Luminance steps with a local spread of about 0.1 or more count as edges.
+constexpr float EdgeVariance = 0.01f;
+
+}
 
 ClarityFilter::ClarityFilter(int clarity)
     : m_clarity{clarity} {}
@@ -17,58 +25,26 @@ void ClarityFilter::setClarity(int clarity) {
     m_clarity = clarity;
 }
 
-QImage ClarityFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    QImage blurred {FastBlur::apply(input, 15)};
-    QImage result {input.copy()};
-
-    double clarity {getClarity() / 100.0};
-
-    int height {result.height()};
-    int width {result.width()};
-
-    for (int y = 0; y < height; y++) {
-        QRgb* row  { reinterpret_cast<QRgb*>(result.scanLine(y))};
-        const QRgb* blurRow { reinterpret_cast<const QRgb*>(blurred.constScanLine(y))};
-
-        for (int x = 0; x < width; x++) {
-
-            double rOrig = qRed(row[x]) / 255.0;
-            double gOrig = qGreen(row[x]) / 255.0;
-            double bOrig = qBlue(row[x]) / 255.0;
-
-            double rBlur = qRed(blurRow[x]) / 255.0;
-            double gBlur = qGreen(blurRow[x]) / 255.0;
-            double bBlur = qBlue(blurRow[x]) / 255.0;
+void ClarityFilter::prepare(BlurPyramid& pyramid) const {
+    pyramid.requestGuided(BaseRadius, EdgeVariance);
+}
 
-            double rDetail = rOrig - rBlur;
-            double gDetail = gOrig - gBlur;
-            double bDetail = bOrig - bBlur;
+void ClarityFilter::addDetail(const BlurPyramid& pyramid, int y, const QRgb* source, int width,
+                              float* r, float* g, float* b) const {
+    thread_local std::vector<float> base;
+    base.resize(static_cast<size_t>(width));
+    pyramid.guided(BaseRadius, EdgeVariance).baseRow(y, source, base.data());
 
-            double r = rOrig + rDetail * clarity;
-            double g = gOrig + gDetail * clarity;
-            double b = bOrig + bDetail * clarity;
+    const float clarity {getClarity() / 100.0f * 255.0f};
 
-            row[x] = qRgb(
-                std::clamp(int(r * 255), 0, 255),
-                std::clamp(int(g * 255), 0, 255),
-                std::clamp(int(b * 255), 0, 255)
-                );
-        }
+    for (int x = 0; x < width; x++) {
+        const float detail {(GuidedFilter::luma(source[x]) - base[x]) * clarity};
+        r[x] += detail;
+        g[x] += detail;
+        b[x] += detail;
     }
-
-    return result;
 }
 
 std::unique_ptr<ImageFilter> ClarityFilter::clone() const {
     return std::make_unique<ClarityFilter>(*this);
 }
-
-
-
-
-
-
-
-
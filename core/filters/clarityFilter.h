@@ -1,19 +1,24 @@
 #ifndef CLARITYFILTER_H
 #define CLARITYFILTER_H
 
-#include "ImageFilter.h"
+#include "detailfilter.h"
 #include <QImage>
 
 
-class ClarityFilter: public ImageFilter
+// Boosts local contrast in luminance against an edge-preserving base, so
+// strong edges do not grow halos.
+class ClarityFilter: public DetailFilter
 {
 public:
     ClarityFilter(int clarity);
-    QImage apply(const QImage& input) const override;
     bool isActive() const override;
     int getClarity() const;
     void setClarity(int clarity);
     std::unique_ptr<ImageFilter> clone() const override;
+
+    void prepare(BlurPyramid& pyramid) const override;
+    void addDetail(const BlurPyramid& pyramid, int y, const QRgb* source, int width,
+                   float* r, float* g, float* b) const override;
 private:
     int m_clarity {};
 };
@@ -1,8 +1,11 @@
 #include "contrastfilter.h"
+#include "color/linearlight.h"
 
 
 ContrastFilter::ContrastFilter(int contrast)
-    : m_contrast{contrast} {}
+    : m_contrast{contrast} {
+    rebuildCurve();
+}
 
 bool ContrastFilter::isActive() const {
     return m_contrast != 0;
@@ -14,41 +17,39 @@ int ContrastFilter::getContrast() const {
 
 void ContrastFilter::setContrast(int contrast) {
     m_contrast = contrast;
+    rebuildCurve();
 }
 
-QImage ContrastFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    int contrast {getContrast()};
+void ContrastFilter::rebuildCurve() {
+    const int contrast {getContrast()};
+    const double factor {(259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast))};
 
-    double factor {(259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast))};
-    QImage result {input.copy()};
-    int height {result.height()};
-    int width {result.width()};
-
-    for (int y {0}; y < height; ++y) {
-        QRgb *row {reinterpret_cast<QRgb*>(result.scanLine(y))};
+    m_curve = ToneCurve::fromFunction([factor](int v) {
+        return (v - 128) * factor + 128;
+    });
+}
 
-        for (int x {0}; x < width; ++x) {
+void ContrastFilter::applyInPlace(QImage& image) const {
+    m_curve.applyInPlace(image);
+}
 
-            QRgb px {row[x]};
+const ToneCurve* ContrastFilter::toneCurve() const {
+    return &m_curve;
+}
 
-            int r {qRed(px)};
-            int g {qGreen(px)};
-            int b {qBlue(px)};
 
-            r = std::clamp(static_cast<int>((r - 128) * factor + 128), 0, 255);
-            g = std::clamp(static_cast<int>((g - 128) * factor + 128), 0, 255);
-            b = std::clamp(static_cast<int>((b - 128) * factor + 128), 0, 255);
+bool ContrastFilter::supportsLinear() const {
+    return true;
+}
 
-            row[x] = qRgb(r, g, b);
-        }
-    }
+void ContrastFilter::applyLinear(QImage& linear) const {
+    const int contrast {getContrast()};
+    const float factor {static_cast<float>((259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast)))};
+    const float pivot {LinearLight::decode(128)};
 
-    return result;
+    LinearLight::power(linear, factor, pivot);
 }
 
-
 std::unique_ptr<ImageFilter> ContrastFilter::clone() const {
     return std::make_unique<ContrastFilter>(*this);
 }
@@ -2,21 +2,28 @@
 #define CONTRASTFILTER_H
 
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
+#include "tonecurve.h"
 #include <QImage>
 
 
-class ContrastFilter: public ImageFilter
+class ContrastFilter: public PointFilter
 {
 public:
     ContrastFilter(int contrast);
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
     bool isActive() const override;
     int getContrast() const;
     void setContrast(int contrast);
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
+    const ToneCurve* toneCurve() const override;
 private:
+    void rebuildCurve();
+
     int m_contrast {};
+    ToneCurve m_curve;
 };
 
 
@@ -0,0 +1,132 @@
+#include "curvesfilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+CurvesFilter::CurvesFilter() {
+    m_points.fill(defaultPoints());
+}
+
+CurvesFilter::Points CurvesFilter::defaultPoints() {
+    return {QPoint(0, 0), QPoint(255, 255)};
+}
+
+void CurvesFilter::applyInPlace(QImage& image) const {
+    m_curve.applyInPlace(image);
+}
+
+bool CurvesFilter::isActive() const {
+    return !m_curve.isIdentity();
+}
+
+const CurvesFilter::Points& CurvesFilter::getPoints(Channel channel) const {
+    return m_points[static_cast<size_t>(channel)];
+}
+
+void CurvesFilter::setPoints(Channel channel, Points points) {
+    for (auto& p : points) {
+        p.setX(std::clamp(p.x(), 0, 255));
+        p.setY(std::clamp(p.y(), 0, 255));
+    }
+
+    std::sort(points.begin(), points.end(), [](const QPoint& a, const QPoint& b) {
+        return a.x() < b.x();
+    });
+    points.erase(std::unique(points.begin(), points.end(), [](const QPoint& a, const QPoint& b) {
+        return a.x() == b.x();
+    }), points.end());
+
+    if (points.empty())
+        points = defaultPoints();
+
+    m_points[static_cast<size_t>(channel)] = std::move(points);
+    rebuildCurve();
+}
+
+const ToneCurve* CurvesFilter::toneCurve() const {
+    return &m_curve;
+}
+
+// Fritsch-Carlson monotone cubic interpolation; flat outside the first and
+// last control point.
+ToneCurve::Table CurvesFilter::evaluate(const Points& points) {
+    ToneCurve::Table table {};
+
+    if (points.size() == 1) {
+        table.fill(static_cast<quint8>(points.front().y()));
+        return table;
+    }
+
+    const size_t n {points.size()};
+    std::vector<double> slope(n - 1);
+    std::vector<double> tangent(n);
+
+    for (size_t k {0}; k + 1 < n; ++k) {
+        slope[k] = double(points[k + 1].y() - points[k].y()) / (points[k + 1].x() - points[k].x());
+    }
+
+    tangent[0] = slope[0];
+    tangent[n - 1] = slope[n - 2];
+    for (size_t k {1}; k + 1 < n; ++k) {
+        tangent[k] = slope[k - 1] * slope[k] <= 0.0 ? 0.0 : (slope[k - 1] + slope[k]) / 2.0;
+    }
+
+    for (size_t k {0}; k + 1 < n; ++k) {
+        if (slope[k] == 0.0) {
+            tangent[k] = 0.0;
+            tangent[k + 1] = 0.0;
+            continue;
+        }
+
+        const double a {tangent[k] / slope[k]};
+        const double b {tangent[k + 1] / slope[k]};
+        const double s {a * a + b * b};
+        if (s > 9.0) {
+            const double t {3.0 / std::sqrt(s)};
+            tangent[k] = t * a * slope[k];
+            tangent[k + 1] = t * b * slope[k];
+        }
+    }
+
+    size_t k {0};
+    for (int v {0}; v < 256; ++v) {
+        double y;
+
+        if (v <= points.front().x()) {
+            y = points.front().y();
+        } else if (v >= points.back().x()) {
+            y = points.back().y();
+        } else {
+            while (points[k + 1].x() < v)
+                ++k;
+
+            const double h {double(points[k + 1].x() - points[k].x())};
+            const double t {(v - points[k].x()) / h};
+            const double t2 {t * t};
+            const double t3 {t2 * t};
+
+            y = (2 * t3 - 3 * t2 + 1) * points[k].y()
+                + (t3 - 2 * t2 + t) * h * tangent[k]
+                + (-2 * t3 + 3 * t2) * points[k + 1].y()
+                + (t3 - t2) * h * tangent[k + 1];
+        }
+
+        table[v] = static_cast<quint8>(std::clamp(static_cast<int>(std::lround(y)), 0, 255));
+    }
+
+    return table;
+}
+
+void CurvesFilter::rebuildCurve() {
+    const ToneCurve::Table master {evaluate(m_points[0])};
+    const ToneCurve masterCurve {ToneCurve::fromTables(master, master, master)};
+
+    const ToneCurve channels {ToneCurve::fromTables(
+        evaluate(m_points[1]), evaluate(m_points[2]), evaluate(m_points[3]))};
+
+    m_curve = masterCurve.then(channels);
+}
+
+std::unique_ptr<ImageFilter> CurvesFilter::clone() const {
+    return std::make_unique<CurvesFilter>(*this);
+}
@@ -0,0 +1,47 @@
+#ifndef CURVESFILTER_H
+#define CURVESFILTER_H
+
+#include "pointfilter.h"
+#include "tonecurve.h"
+#include <QImage>
+#include <QPoint>
+#include <array>
+#include <vector>
+
+// User-drawn tone curves: a master curve applied to all channels, followed
+// by one curve per channel. Control points are in 0..255 on both axes and
+// are joined by a monotone cubic, so the curve never overshoots them.
+class CurvesFilter : public PointFilter
+{
+public:
+    enum class Channel {
+        Rgb,
+        Red,
+        Green,
+        Blue
+    };
+
+    using Points = std::vector<QPoint>;
+
+    CurvesFilter();
+
+    void applyInPlace(QImage& image) const override;
+    bool isActive() const override;
+
+    const Points& getPoints(Channel channel) const;
+    void setPoints(Channel channel, Points points);
+
+    std::unique_ptr<ImageFilter> clone() const override;
+    const ToneCurve* toneCurve() const override;
+
+    static Points defaultPoints();
+    static ToneCurve::Table evaluate(const Points& points);
+
+private:
+    void rebuildCurve();
+
+    std::array<Points, 4> m_points;
+    ToneCurve m_curve;
+};
+
+#endif // CURVESFILTER_H
@@ -0,0 +1,92 @@
+#include "detailfilter.h"
+#include "fastblur.h"
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+
+BlurPyramid::BlurPyramid(const QImage& input)
+    : m_input(input) {}
+
+void BlurPyramid::requestBox(int radius) {
+    if (m_boxes.find(radius) == m_boxes.end())
+        m_boxes.emplace(radius, FastBlur::apply(m_input, radius));
+}
+
+const QImage& BlurPyramid::box(int radius) const {
+    Q_ASSERT(m_boxes.count(radius));
+    return m_boxes.at(radius);
+}
+
+void BlurPyramid::requestGuided(int radius, float epsilon) {
+    const auto key {std::make_pair(radius, epsilon)};
+    if (m_guided.find(key) == m_guided.end())
+        m_guided.emplace(key, std::make_unique<GuidedFilter>(m_input, radius, epsilon));
+}
+
+const GuidedFilter& BlurPyramid::guided(int radius, float epsilon) const {
+    const auto key {std::make_pair(radius, epsilon)};
+    Q_ASSERT(m_guided.count(key));
+    return *m_guided.at(key);
+}
+
+QImage DetailFilter::apply(const QImage& input) const {
+    if (!isActive()) return input;
+
+    return applyAll(input, {this});
+}
+
+void DetailFilter::applyInto(const QImage& src, QImage& dst) const {
+    if (!isActive()) {
+        copyInto(src, dst);
+        return;
+    }
+
+    applyAll(src, {this}, dst);
+}
+
+QImage DetailFilter::applyAll(const QImage& input, const std::vector<const DetailFilter*>& filters) {
+    if (filters.empty())
+        return input;
+
+    QImage result;
+    applyAll(input, filters, result);
+    return result;
+}
+
+void DetailFilter::applyAll(const QImage& input, const std::vector<const DetailFilter*>& filters, QImage& result) {
+    BlurPyramid pyramid(input);
+    for (const DetailFilter* filter : filters)
+        filter->prepare(pyramid);
+
+    reuseFor(input, result);
+    const int width {input.width()};
+
+    ParallelFor::run(input.height(), [&](int begin, int end) {
+        std::vector<float> planes(static_cast<size_t>(width) * 3);
+        float* r {planes.data()};
+        float* g {r + width};
+        float* b {g + width};
+
+        for (int y {begin}; y < end; ++y) {
+            const QRgb* src {reinterpret_cast<const QRgb*>(input.constScanLine(y))};
+
+            for (int x {0}; x < width; ++x) {
+                r[x] = qRed(src[x]);
+                g[x] = qGreen(src[x]);
+                b[x] = qBlue(src[x]);
+            }
+
+            for (const DetailFilter* filter : filters)
+                filter->addDetail(pyramid, y, src, width, r, g, b);
+
+            QRgb* dst {reinterpret_cast<QRgb*>(result.scanLine(y))};
+            for (int x {0}; x < width; ++x) {
+                dst[x] = qRgb(
+                    std::min(std::max(static_cast<int>(r[x]), 0), 255),
+                    std::min(std::max(static_cast<int>(g[x]), 0), 255),
+                    std::min(std::max(static_cast<int>(b[x]), 0), 255)
+                    );
+            }
+        }
+    }, 16);
+}
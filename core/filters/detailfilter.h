@@ -0,0 +1,58 @@
+#ifndef DETAILFILTER_H
+#define DETAILFILTER_H
+
+#include "imagefilter.h"
+#include "guidedfilter.h"
+#include <QImage>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Smoothed versions of one input, built on request and shared by every
+// detail filter that reads the same one. Requests build eagerly and are
+// not thread-safe; the lookups are const and may run in parallel.
+class BlurPyramid
+{
+public:
+    explicit BlurPyramid(const QImage& input);
+
+    const QImage& input() const { return m_input; }
+
+    void requestBox(int radius);
+    const QImage& box(int radius) const;
+
+    void requestGuided(int radius, float epsilon);
+    const GuidedFilter& guided(int radius, float epsilon) const;
+
+private:
+    QImage m_input;
+    std::map<int, QImage> m_boxes;
+    std::map<std::pair<int, float>, std::unique_ptr<GuidedFilter>> m_guided;
+};
+
+// Local-contrast filters that add back the difference between the input and
+// a smoothed base. Consecutive ones in a pipeline run as a single stage: the
+// bases are shared through a BlurPyramid and all contributions are summed in
+// one pass over the input, so the stage writes one output instead of one
+// per filter.
+class DetailFilter : public ImageFilter
+{
+public:
+    QImage apply(const QImage& input) const override;
+    void applyInto(const QImage& src, QImage& dst) const override;
+
+    // Requests the bases addDetail will read.
+    virtual void prepare(BlurPyramid& pyramid) const = 0;
+
+    // Adds this filter's contribution for row y to the float accumulators,
+    // which start out holding the source channels in 0..255.
+    virtual void addDetail(const BlurPyramid& pyramid, int y, const QRgb* source, int width,
+                           float* r, float* g, float* b) const = 0;
+
+    static QImage applyAll(const QImage& input, const std::vector<const DetailFilter*>& filters);
+    // Writes into result, reusing its buffer as applyInto() does.
+    static void applyAll(const QImage& input, const std::vector<const DetailFilter*>& filters, QImage& result);
+};
+
+#endif // DETAILFILTER_H
@@ -1,42 +1,25 @@
 #include "exposurefilter.h"
+#include "color/linearlight.h"
 
 ExposureFilter::ExposureFilter(int exposure)
-    : m_exposure {exposure} {}
-
-
-
-
-QImage ExposureFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-
-
-    double exposure { 1.0 + getExposure() / 100.0};
-    int height {result.height()};
-    int width {result.width()};
-
-
-    for (int y{0}; y < height; y++) {
-        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
-
-        for (int x{0}; x < width; x++) {
-            QRgb px {row[x]};
+    : m_exposure {exposure} {
+    rebuildCurve();
+}
 
-            int r {static_cast<int>(qRed(px) * exposure)};
-            int g {static_cast<int>(qGreen(px) * exposure)};
-            int b {static_cast<int>(qBlue(px) * exposure)};
+void ExposureFilter::rebuildCurve() {
+    const double exposure { 1.0 + getExposure() / 100.0};
 
-            row[x] = qRgb(
-                std::clamp(r, 0, 255),
-                std::clamp(g, 0, 255),
-                std::clamp(b, 0, 255)
+    m_curve = ToneCurve::fromFunction([exposure](int v) {
+        return v * exposure;
+    });
+}
 
-                );
-        }
-    }
+void ExposureFilter::applyInPlace(QImage& image) const {
+    m_curve.applyInPlace(image);
+}
 
-    return result;
+const ToneCurve* ExposureFilter::toneCurve() const {
+    return &m_curve;
 }
 
 bool ExposureFilter::isActive() const {
@@ -49,9 +32,22 @@ int ExposureFilter::getExposure() const {
 
 void ExposureFilter::setExposure(int exposure) {
     m_exposure = exposure;
+    rebuildCurve();
 }
 
 
+bool ExposureFilter::supportsLinear() const {
+    return true;
+}
+
+void ExposureFilter::applyLinear(QImage& linear) const {
+    const float gain {static_cast<float>(std::pow(std::max(0.0, 1.0 + getExposure() / 100.0), 2.2))};
+    const float scale[3] {gain, gain, gain};
+    const float offset[3] {0.0f, 0.0f, 0.0f};
+
+    LinearLight::scaleAndOffset(linear, scale, offset);
+}
+
 std::unique_ptr<ImageFilter> ExposureFilter::clone() const {
     return std::make_unique<ExposureFilter>(*this);
 }
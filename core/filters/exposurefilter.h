@@ -1,16 +1,17 @@
 #ifndef EXPOSUREFILTER_H
 #define EXPOSUREFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
+#include "tonecurve.h"
 #include <QImage>
 
 
-class ExposureFilter: public ImageFilter
+class ExposureFilter: public PointFilter
 {
 public:
     ExposureFilter(int exposure);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -18,9 +19,14 @@ public:
 
     void setExposure(int exposure);
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
+    const ToneCurve* toneCurve() const override;
 private:
+    void rebuildCurve();
 
     int m_exposure{};
+    ToneCurve m_curve;
 
 };
 
@@ -1,4 +1,5 @@
 #include "fadefilter.h"
+#include "color/linearlight.h"
 
 FadeFilter::FadeFilter(int fade)
     : m_fade{fade} {}
@@ -15,17 +16,14 @@ void FadeFilter::setFade(int fade) {
     m_fade = fade;
 }
 
-QImage FadeFilter::apply(const QImage &input) const {
-    if (!isActive()) return input;
-
-    QImage result = input.copy();
+void FadeFilter::applyInPlace(QImage& image) const {
     const double factor = std::clamp(getFade(), 0, 100) / 100.0;
 
-    const int width = result.width();
-    const int height = result.height();
+    const int width = image.width();
+    const int height = image.height();
 
     for (int y = 0; y < height; ++y) {
-        QRgb *row = reinterpret_cast<QRgb *>(result.scanLine(y));
+        QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(y));
 
         for (int x = 0; x < width; ++x) {
             const QRgb pix = row[x];
@@ -37,10 +35,20 @@ QImage FadeFilter::apply(const QImage &input) const {
             row[x] = qRgb(std::clamp(r, 0, 255), std::clamp(g, 0, 255), std::clamp(b, 0, 255));
         }
     }
+}
+
 
-    return result;
+bool FadeFilter::supportsLinear() const {
+    return true;
 }
 
+void FadeFilter::applyLinear(QImage& linear) const {
+    const float factor = std::clamp(getFade(), 0, 100) / 100.0f;
+    const float scale[3] = {1.0f - factor, 1.0f - factor, 1.0f - factor};
+    const float offset[3] = {factor, factor, factor};
+
+    LinearLight::scaleAndOffset(linear, scale, offset);
+}
 
 std::unique_ptr<ImageFilter> FadeFilter::clone() const {
     return std::make_unique<FadeFilter>(*this);
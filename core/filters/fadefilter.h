@@ -1,20 +1,22 @@
 #ifndef FADEFILTER_H
 #define FADEFILTER_H
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
-class FadeFilter : public ImageFilter
+class FadeFilter : public PointFilter
 {
 public:
     FadeFilter(int fade);
 
-    QImage apply(const QImage &input) const override;
+    void applyInPlace(QImage& image) const override;
     bool isActive() const override;
 
     int getFade() const;
     void setFade(int fade);
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
 private:
     int m_fade {};
 };
@@ -1,5 +1,9 @@
 #include "fastblur.h"
+#include "color/linearlight.h"
+#include "image/imagepool.h"
+#include "parallel/parallelfor.h"
 #include <algorithm>
+#include <vector>
 
 static inline int clamp(int v, int lo, int hi) {
     return std::min(std::max(v, lo), hi);
@@ -11,14 +15,20 @@ QImage FastBlur::apply(const QImage& input, int radius)
     if (radius <= 0)
         return input;
 
-    QImage img = input.copy();
+    QImage img = ImagePool::instance().copy(input);
+    applyInPlace(img, radius);
+    return img;
+}
+
+void FastBlur::applyInPlace(QImage& img, int radius)
+{
+    if (radius <= 0)
+        return;
 
     for (int i = 0; i < 3; ++i) {
         boxBlurHorizontal(img, radius);
         boxBlurVertical(img, radius);
     }
-
-    return img;
 }
 
 
@@ -103,3 +113,86 @@ void FastBlur::boxBlurVertical(QImage& img, int r)
         }
     }
 }
+
+void FastBlur::applyLinear(QImage& linear, int radius)
+{
+    Q_ASSERT(linear.format() == LinearLight::Format);
+    if (radius <= 0)
+        return;
+
+    LinearLight::premultiply(linear);
+
+    for (int i = 0; i < 3; ++i) {
+        boxBlurHorizontalLinear(linear, radius);
+        boxBlurVerticalLinear(linear, radius);
+    }
+
+    LinearLight::unpremultiply(linear);
+}
+
+void FastBlur::boxBlurHorizontalLinear(QImage& img, int r)
+{
+    int w = img.width();
+    float inv = 1.0f / (r * 2 + 1);
+
+    ParallelFor::run(img.height(), [&](int begin, int end) {
+        std::vector<float> src(w * 4);
+
+        for (int y = begin; y < end; ++y) {
+            float* line = reinterpret_cast<float*>(img.scanLine(y));
+            std::copy(line, line + w * 4, src.begin());
+
+            float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+            for (int i = -r; i <= r; ++i) {
+                const float* p = &src[clamp(i, 0, w - 1) * 4];
+                for (int c = 0; c < 4; ++c)
+                    sum[c] += p[c];
+            }
+
+            for (int x = 0; x < w; ++x) {
+                const float* pAdd = &src[clamp(x + r + 1, 0, w - 1) * 4];
+                const float* pSub = &src[clamp(x - r,     0, w - 1) * 4];
+
+                for (int c = 0; c < 4; ++c) {
+                    line[x * 4 + c] = sum[c] * inv;
+                    sum[c] += pAdd[c] - pSub[c];
+                }
+            }
+        }
+    }, 8);
+}
+
+void FastBlur::boxBlurVerticalLinear(QImage& img, int r)
+{
+    int w = img.width();
+    int h = img.height();
+    float inv = 1.0f / (r * 2 + 1);
+    const QImage src = ImagePool::instance().copy(img);
+
+    ParallelFor::run(w, [&](int begin, int end) {
+        const int n = (end - begin) * 4;
+        std::vector<float> sum(n, 0.0f);
+
+        auto row = [&](int y) {
+            return reinterpret_cast<const float*>(src.constScanLine(clamp(y, 0, h - 1))) + begin * 4;
+        };
+
+        for (int i = -r; i <= r; ++i) {
+            const float* p = row(i);
+            for (int k = 0; k < n; ++k)
+                sum[k] += p[k];
+        }
+
+        for (int y = 0; y < h; ++y) {
+            float* out = reinterpret_cast<float*>(img.scanLine(y)) + begin * 4;
+            const float* pAdd = row(y + r + 1);
+            const float* pSub = row(y - r);
+
+            for (int k = 0; k < n; ++k) {
+                out[k] = sum[k] * inv;
+                sum[k] += pAdd[k] - pSub[k];
+            }
+        }
+    }, 64);
+}
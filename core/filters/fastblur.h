@@ -6,10 +6,14 @@
 class FastBlur {
 public:
     static QImage apply(const QImage& input, int radius);
+    static void applyInPlace(QImage& img, int radius);
+    static void applyLinear(QImage& linear, int radius);
 
 private:
     static void boxBlurHorizontal(QImage& img, int radius);
     static void boxBlurVertical(QImage& img, int radius);
+    static void boxBlurHorizontalLinear(QImage& img, int radius);
+    static void boxBlurVerticalLinear(QImage& img, int radius);
 };
 
 #endif // FASTBLUR_H
@@ -26,7 +26,23 @@ QImage FastBlurFilter::apply(const QImage& input) const {
     return FastBlur::apply(input, sigma);
 }
 
+void FastBlurFilter::applyInto(const QImage& src, QImage& dst) const {
+    copyInto(src, dst);
+    if (isActive())
+        FastBlur::applyInPlace(dst, getBlur() * 0.4);
+}
+
+
+
+bool FastBlurFilter::supportsLinear() const {
+    return true;
+}
+
+void FastBlurFilter::applyLinear(QImage& linear) const {
+    double sigma {getBlur() * 0.4};
 
+    FastBlur::applyLinear(linear, sigma);
+}
 
 std::unique_ptr<ImageFilter> FastBlurFilter::clone() const {
     return std::make_unique<FastBlurFilter>(*this);
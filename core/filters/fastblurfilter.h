@@ -10,6 +10,7 @@ public:
     FastBlurFilter(int blur);
 
     QImage apply(const QImage& input) const override;
+    void applyInto(const QImage& src, QImage& dst) const override;
 
     bool isActive() const override;
 
@@ -18,6 +19,8 @@ public:
     void setBlur(int blur);
 
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
 
 private:
 
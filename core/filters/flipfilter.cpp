@@ -1,5 +1,7 @@
 #include "FlipFilter.h"
 
+#include <algorithm>
+
 FlipFilter::FlipFilter(Direction direction, bool enabled)
     : m_direction{direction}, m_enabled{enabled} {}
 
@@ -31,6 +33,28 @@ QImage FlipFilter::apply(const QImage& input) const {
     return input.mirrored(m_direction == Direction::Horizontal, m_direction == Direction::Vertical);
 }
 
+void FlipFilter::applyInto(const QImage& src, QImage& dst) const {
+    if (!isActive() || src.depth() != 32) {
+        dst = apply(src);
+        return;
+    }
+
+    reuseFor(src, dst);
+    const int width {src.width()};
+    const int height {src.height()};
+
+    for (int y {0}; y < height; y++) {
+        if (m_direction == Direction::Vertical) {
+            std::memcpy(dst.scanLine(y), src.constScanLine(height - 1 - y), static_cast<size_t>(width) * 4);
+            continue;
+        }
+
+        const QRgb* in {reinterpret_cast<const QRgb*>(src.constScanLine(y))};
+        QRgb* out {reinterpret_cast<QRgb*>(dst.scanLine(y))};
+        std::reverse_copy(in, in + width, out);
+    }
+}
+
 
 std::unique_ptr<ImageFilter> FlipFilter::clone() const {
     return std::make_unique<FlipFilter>(*this);
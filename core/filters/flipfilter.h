@@ -17,6 +17,7 @@ public:
     FlipFilter(Direction direction, bool enabled);
 
     QImage apply(const QImage& input) const override;
+    void applyInto(const QImage& src, QImage& dst) const override;
 
     bool isActive() const override;
 
@@ -1,44 +1,25 @@
 #include "gammafilter.h"
+#include "color/linearlight.h"
 
 GammaFilter::GammaFilter(int gamma)
-    : m_gamma{gamma} {}
-
-
-
-
-
-QImage GammaFilter::apply(const QImage& input) const {
-
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-
-
-    double gamma { 1.0 + getGamma() / 100.0};
-    int height {result.height()};
-    int width {result.width()};
-
-
-    for (int y{0}; y < height; y++) {
-        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
-
-        for (int x{0}; x < width; x++) {
-            QRgb px {row[x]};
+    : m_gamma{gamma} {
+    rebuildCurve();
+}
 
-            int r {static_cast<int>(255.0 * std::pow(qRed(px) / 255.0, gamma))};
-            int g {static_cast<int>(255.0 * std::pow(qGreen(px) / 255.0, gamma))};
-            int b {static_cast<int>(255.0 * std::pow(qBlue(px) / 255.0, gamma))};
+void GammaFilter::rebuildCurve() {
+    const double gamma { 1.0 + getGamma() / 100.0};
 
-            row[x] = qRgb(
-                std::clamp(r, 0, 255),
-                std::clamp(g, 0, 255),
-                std::clamp(b, 0, 255)
+    m_curve = ToneCurve::fromFunction([gamma](int v) {
+        return 255.0 * std::pow(v / 255.0, gamma);
+    });
+}
 
-                );
-        }
-    }
+void GammaFilter::applyInPlace(QImage& image) const {
+    m_curve.applyInPlace(image);
+}
 
-    return result;
+const ToneCurve* GammaFilter::toneCurve() const {
+    return &m_curve;
 }
 
 bool GammaFilter::isActive() const {
@@ -51,6 +32,17 @@ int GammaFilter::getGamma() const {
 
 void GammaFilter::setGamma(int gamma) {
     m_gamma = gamma;
+    rebuildCurve();
+}
+
+bool GammaFilter::supportsLinear() const {
+    return true;
+}
+
+void GammaFilter::applyLinear(QImage& linear) const {
+    const float gamma {static_cast<float>(1.0 + getGamma() / 100.0)};
+
+    LinearLight::power(linear, gamma);
 }
 
 std::unique_ptr<ImageFilter> GammaFilter::clone() const {
@@ -1,16 +1,17 @@
 #ifndef GAMMAFILTER_H
 #define GAMMAFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
+#include "tonecurve.h"
 #include <QImage>
 
 
-class GammaFilter: public ImageFilter
+class GammaFilter: public PointFilter
 {
 public:
     GammaFilter(int gamma);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -18,9 +19,14 @@ public:
 
     void setGamma(int gamma);
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
+    const ToneCurve* toneCurve() const override;
 private:
+    void rebuildCurve();
 
     int m_gamma{};
+    ToneCurve m_curve;
 
 };
 
@@ -1,4 +1,7 @@
 #include "gaussianblurutil.h"
+#include "color/linearlight.h"
+#include "image/imagepool.h"
+#include "parallel/parallelfor.h"
 
 std::vector<double> GaussianBlurUtil::createKernel(double sigma) {
     int radius {std::ceil(3 * sigma)};
@@ -22,7 +25,7 @@ std::vector<double> GaussianBlurUtil::createKernel(double sigma) {
 
 
 QImage GaussianBlurUtil::applyHorizontal(const QImage& input, const std::vector<double>& kernel, int radius) {
-    QImage result {input.copy()};
+    QImage result {ImagePool::instance().acquire(input.size(), input.format())};
     int height {result.height()};
     int width {result.width()};
 
@@ -58,7 +61,7 @@ QImage GaussianBlurUtil::applyHorizontal(const QImage& input, const std::vector<
 
 QImage GaussianBlurUtil::applyVertical(const QImage& input, const std::vector<double>& kernel, int radius) {
 
-    QImage result {input.copy()};
+    QImage result {ImagePool::instance().acquire(input.size(), input.format())};
     int height {result.height()};
     int width {result.width()};
 
@@ -100,3 +103,71 @@ QImage GaussianBlurUtil::apply(const QImage& input, double sigma) {
 
     return applyVertical(temp, kernel, radius);
 }
+
+
+
+void GaussianBlurUtil::applyHorizontalLinear(QImage& linear, const std::vector<float>& kernel, int radius) {
+    int width {linear.width()};
+
+    ParallelFor::run(linear.height(), [&](int begin, int end) {
+        std::vector<float> src(width * 4);
+
+        for (int y {begin}; y < end; y++) {
+            float* dst {reinterpret_cast<float*>(linear.scanLine(y))};
+            std::copy(dst, dst + width * 4, src.begin());
+
+            for (int x {0}; x < width; x++) {
+                float sum[4] {0.0f, 0.0f, 0.0f, 0.0f};
+
+                for (int i {-radius}; i <= radius; i++) {
+                    const float* p {&src[std::clamp(x + i, 0, width - 1) * 4]};
+                    const float k {kernel[i + radius]};
+
+                    for (int c {0}; c < 4; c++)
+                        sum[c] += p[c] * k;
+                }
+
+                for (int c {0}; c < 4; c++)
+                    dst[x * 4 + c] = sum[c];
+            }
+        }
+    }, 8);
+}
+
+
+void GaussianBlurUtil::applyVerticalLinear(QImage& linear, const std::vector<float>& kernel, int radius) {
+    int height {linear.height()};
+    const QImage src {ImagePool::instance().copy(linear)};
+
+    ParallelFor::run(linear.width(), [&](int begin, int end) {
+        const int n {(end - begin) * 4};
+
+        for (int y {0}; y < height; y++) {
+            float* dst {reinterpret_cast<float*>(linear.scanLine(y)) + begin * 4};
+            std::fill(dst, dst + n, 0.0f);
+
+            for (int j {-radius}; j <= radius; j++) {
+                const int py {std::clamp(y + j, 0, height - 1)};
+                const float* p {reinterpret_cast<const float*>(src.constScanLine(py)) + begin * 4};
+                const float k {kernel[j + radius]};
+
+                for (int i {0}; i < n; i++)
+                    dst[i] += p[i] * k;
+            }
+        }
+    }, 64);
+}
+
+void GaussianBlurUtil::applyLinear(QImage& linear, double sigma) {
+    Q_ASSERT(linear.format() == LinearLight::Format);
+    if (sigma < 0.001) return;
+
+    auto kernel {createKernel(sigma)};
+    int radius {static_cast<int>((kernel.size() - 1) / 2)};
+    std::vector<float> kernelF(kernel.begin(), kernel.end());
+
+    LinearLight::premultiply(linear);
+    applyHorizontalLinear(linear, kernelF, radius);
+    applyVerticalLinear(linear, kernelF, radius);
+    LinearLight::unpremultiply(linear);
+}
@@ -12,6 +12,8 @@ public:
 
     static QImage apply (const QImage& input, double sigma);
 
+    static void applyLinear(QImage& linear, double sigma);
+
 private:
 
     static std::vector<double> createKernel(double sigma);
@@ -20,6 +22,10 @@ private:
 
     static QImage applyVertical(const QImage& input, const std::vector<double>& kernel, int radius);
 
+    static void applyHorizontalLinear(QImage& linear, const std::vector<float>& kernel, int radius);
+
+    static void applyVerticalLinear(QImage& linear, const std::vector<float>& kernel, int radius);
+
 };
 
 #endif // GAUSSIANBLURUTIL_H
@@ -1,9 +1,30 @@
 #include "grainfilter.h"
+#include "parallel/parallelfor.h"
 
-#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
-GrainFilter::GrainFilter(int grain)
-    : m_grain{grain} {}
+namespace {
+
+// Integer finaliser with full avalanche; every output bit depends on every
+// input bit, so neighbouring coordinates give unrelated values.
+inline quint32 hash32(quint32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+constexpr int MaxRadius = 4;
+
+}
+
+GrainFilter::GrainFilter(int grain, int size, int roughness, quint32 seed)
+    : m_grain{grain}, m_size{size}, m_roughness{roughness}, m_seed{seed} {}
 
 bool GrainFilter::isActive() const {
     return m_grain != 0;
@@ -17,31 +38,105 @@ void GrainFilter::setGrain(int grain) {
     m_grain = grain;
 }
 
-QImage GrainFilter::apply(const QImage &input) const {
-    if (!isActive()) return input;
+int GrainFilter::getSize() const {
+    return m_size;
+}
 
-    QImage result = input.copy();
-    const int width = result.width();
-    const int height = result.height();
+void GrainFilter::setSize(int size) {
+    m_size = size;
+}
 
-    const int grain = std::clamp(getGrain(), -100, 100);
+int GrainFilter::getRoughness() const {
+    return m_roughness;
+}
 
-    for (int y = 0; y < height; ++y) {
-        QRgb *row = reinterpret_cast<QRgb *>(result.scanLine(y));
+void GrainFilter::setRoughness(int roughness) {
+    m_roughness = roughness;
+}
 
-        for (int x = 0; x < width; ++x) {
-            QRgb pix = row[x];
-            int offset = QRandomGenerator::global()->bounded(-grain, grain + 1);
+quint32 GrainFilter::getSeed() const {
+    return m_seed;
+}
 
-            int r = std::clamp(qRed(pix) + offset, 0, 255);
-            int g = std::clamp(qGreen(pix) + offset, 0, 255);
-            int b = std::clamp(qBlue(pix) + offset, 0, 255);
+void GrainFilter::setSeed(quint32 seed) {
+    m_seed = seed;
+}
 
-            row[x] = qRgb(r, g, b);
-        }
+int GrainFilter::blurRadius() const {
+    return (std::clamp(m_size, 0, 100) * MaxRadius + 50) / 100;
+}
+
+// The sum of two 16-bit halves of one hash gives a triangular distribution,
+// which reads more like film grain than flat uniform noise.
+void GrainFilter::noiseRow(quint32 seed, int y, int x0, int count, float* out) {
+    const quint32 rowKey = hash32(hash32(static_cast<quint32>(y) + 0x27d4eb2fU) ^ seed * 0x85ebca6bU);
+
+    for (int i = 0; i < count; ++i) {
+        const quint32 n = hash32(rowKey ^ static_cast<quint32>(x0 + i) * 0x9e3779b9U);
+        out[i] = static_cast<float>((n & 0xffffU) + (n >> 16)) * (1.0f / 65535.0f) - 1.0f;
     }
+}
+
+void GrainFilter::applyInPlace(QImage& image) const {
+    const int width = image.width();
+
+    const float amount = static_cast<float>(std::clamp(getGrain(), -100, 100));
+    const int radius = blurRadius();
+    const int taps = 2 * radius + 1;
+    const float roughness = std::clamp(getRoughness(), 0, 100) / 100.0f;
 
-    return result;
+    // Box-blurring n independent samples divides their spread by sqrt(n);
+    // dividing the 2D sum by taps instead of taps^2 restores it. The mix is
+    // normalised the same way so roughness does not change the strength.
+    const float mix = radius > 0 ? 1.0f / std::sqrt((1.0f - roughness) * (1.0f - roughness) + roughness * roughness) : 0.0f;
+    const float blurredWeight = mix * (1.0f - roughness) / taps;
+    const float rawWeight = radius > 0 ? mix * roughness : 1.0f;
+
+    // Each chunk rebuilds the noise rows it needs, including the blur
+    // margin above and below, so chunks share no state.
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        const int rows = end - begin + 2 * radius;
+        std::vector<float> raw(static_cast<size_t>(width + 2 * radius));
+        std::vector<float> horizontal(radius > 0 ? static_cast<size_t>(rows) * width : 0);
+        std::vector<float> field(static_cast<size_t>(width));
+
+        for (int i = 0; radius > 0 && i < rows; ++i) {
+            noiseRow(m_seed, begin - radius + i, -radius, width + 2 * radius, raw.data());
+
+            float* out = horizontal.data() + static_cast<size_t>(i) * width;
+            std::fill(out, out + width, 0.0f);
+            for (int k = 0; k < taps; ++k) {
+                for (int x = 0; x < width; ++x)
+                    out[x] += raw[x + k];
+            }
+        }
+
+        for (int y = begin; y < end; ++y) {
+            noiseRow(m_seed, y, 0, width, raw.data());
+
+            for (int x = 0; x < width; ++x)
+                field[x] = raw[x] * rawWeight;
+
+            for (int k = 0; radius > 0 && k < taps; ++k) {
+                const float* in = horizontal.data() + static_cast<size_t>(y - begin + k) * width;
+                for (int x = 0; x < width; ++x)
+                    field[x] += in[x] * blurredWeight;
+            }
+
+            QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(y));
+            for (int x = 0; x < width; ++x) {
+                // Biased so the truncation rounds to nearest for either sign.
+                const int offset = static_cast<int>(field[x] * amount + 1024.5f) - 1024;
+                const QRgb pix = row[x];
+
+                const int r = std::min(std::max(qRed(pix) + offset, 0), 255);
+                const int g = std::min(std::max(qGreen(pix) + offset, 0), 255);
+                const int b = std::min(std::max(qBlue(pix) + offset, 0), 255);
+
+                row[x] = qRgb(r, g, b);
+            }
+        }
+    }, 16);
 }
 
 std::unique_ptr<ImageFilter> GrainFilter::clone() const {
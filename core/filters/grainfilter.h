@@ -1,22 +1,44 @@
 #ifndef GRAINFILTER_H
 #define GRAINFILTER_H
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
-class GrainFilter : public ImageFilter
+// Film grain from a stateless hash of (x, y, seed), so a render is the same
+// on every pass, in any tile and on any number of threads. Size blurs the
+// noise field into larger clumps; roughness mixes the unblurred noise back
+// in so large grain keeps some fine texture.
+class GrainFilter : public PointFilter
 {
 public:
-    explicit GrainFilter(int grain);
+    explicit GrainFilter(int grain, int size = 0, int roughness = 50, quint32 seed = 0);
 
-    QImage apply(const QImage &input) const override;
+    void applyInPlace(QImage& image) const override;
+    // The noise is tied to pixel coordinates.
+    bool isPointwise() const override { return false; }
     bool isActive() const override;
 
     int getGrain() const;
     void setGrain(int grain);
+    int getSize() const;
+    void setSize(int size);
+    int getRoughness() const;
+    void setRoughness(int roughness);
+    quint32 getSeed() const;
+    void setSeed(quint32 seed);
     std::unique_ptr<ImageFilter> clone() const override;
+
+    // Noise for one row, roughly triangular in [-1, 1], at columns
+    // x0 .. x0 + count - 1. Coordinates outside the image are valid.
+    static void noiseRow(quint32 seed, int y, int x0, int count, float* out);
+
 private :
+    int blurRadius() const;
+
     int m_grain {};
+    int m_size {};
+    int m_roughness {50};
+    quint32 m_seed {};
 };
 
 #endif // GRAINFILTER_H
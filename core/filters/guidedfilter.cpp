@@ -0,0 +1,167 @@
+#include "guidedfilter.h"
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Same weights as the luminance-keyed tone curves.
+constexpr float LumaR = 19595.0f / (65536.0f * 255.0f);
+constexpr float LumaG = 38470.0f / (65536.0f * 255.0f);
+constexpr float LumaB = 7471.0f / (65536.0f * 255.0f);
+
+}
+
+GuidedFilter::Tap GuidedFilter::tapFor(int coordinate, int scale, int lowSize) {
+    const float position {std::max((coordinate + 0.5f) / scale - 0.5f, 0.0f)};
+    const int low {std::min(static_cast<int>(position), lowSize - 1)};
+    return {low, std::min(low + 1, lowSize - 1), position - low};
+}
+
+float GuidedFilter::luma(QRgb pixel) {
+    return qRed(pixel) * LumaR + qGreen(pixel) * LumaG + qBlue(pixel) * LumaB;
+}
+
+GuidedFilter::GuidedFilter(const QImage& input, int radius, float epsilon)
+    : m_width {input.width()},
+      m_height {input.height()},
+      m_scale {std::max(1, radius / 4)} {
+    m_lowWidth = (m_width + m_scale - 1) / m_scale;
+    m_lowHeight = (m_height + m_scale - 1) / m_scale;
+    const int lowRadius {std::max(1, (radius + m_scale / 2) / m_scale)};
+    const size_t lowCount {static_cast<size_t>(m_lowWidth) * m_lowHeight};
+
+    std::vector<float> guide(lowCount);
+    std::vector<float> guideSquared(lowCount);
+
+    ParallelFor::run(m_lowHeight, [&](int begin, int end) {
+        for (int ly {begin}; ly < end; ++ly) {
+            const int y0 {ly * m_scale};
+            const int y1 {std::min(y0 + m_scale, m_height)};
+            float* out {guide.data() + static_cast<size_t>(ly) * m_lowWidth};
+            std::fill(out, out + m_lowWidth, 0.0f);
+
+            for (int y {y0}; y < y1; ++y) {
+                const QRgb* row {reinterpret_cast<const QRgb*>(input.constScanLine(y))};
+                for (int lx {0}, x {0}; lx < m_lowWidth; ++lx) {
+                    const int x1 {std::min(x + m_scale, m_width)};
+                    for (; x < x1; ++x)
+                        out[lx] += luma(row[x]);
+                }
+            }
+
+            for (int lx {0}; lx < m_lowWidth; ++lx) {
+                const int columns {std::min(m_scale, m_width - lx * m_scale)};
+                out[lx] /= static_cast<float>(columns * (y1 - y0));
+                guideSquared[static_cast<size_t>(ly) * m_lowWidth + lx] = out[lx] * out[lx];
+            }
+        }
+    }, 4);
+
+    std::vector<float> mean(lowCount);
+    std::vector<float> meanSquared(lowCount);
+    boxMean(guide, mean, m_lowWidth, m_lowHeight, lowRadius);
+    boxMean(guideSquared, meanSquared, m_lowWidth, m_lowHeight, lowRadius);
+
+    // The per-window coefficients overwrite the inputs they came from.
+    std::vector<float>& a {guide};
+    std::vector<float>& b {guideSquared};
+    for (size_t i {0}; i < lowCount; ++i) {
+        const float variance {std::max(meanSquared[i] - mean[i] * mean[i], 0.0f)};
+        a[i] = variance / (variance + epsilon);
+        b[i] = mean[i] - a[i] * mean[i];
+    }
+
+    m_columns.reserve(static_cast<size_t>(m_width));
+    for (int x {0}; x < m_width; ++x)
+        m_columns.push_back(tapFor(x, m_scale, m_lowWidth));
+
+    m_a.resize(lowCount);
+    m_b.resize(lowCount);
+    boxMean(a, m_a, m_lowWidth, m_lowHeight, lowRadius);
+    boxMean(b, m_b, m_lowWidth, m_lowHeight, lowRadius);
+}
+
+void GuidedFilter::baseRow(int y, const QRgb* source, float* out) const {
+    const Tap ty {tapFor(y, m_scale, m_lowHeight)};
+    const float* a0 {m_a.data() + static_cast<size_t>(ty.low) * m_lowWidth};
+    const float* a1 {m_a.data() + static_cast<size_t>(ty.high) * m_lowWidth};
+    const float* b0 {m_b.data() + static_cast<size_t>(ty.low) * m_lowWidth};
+    const float* b1 {m_b.data() + static_cast<size_t>(ty.high) * m_lowWidth};
+
+    for (int x {0}; x < m_width; ++x) {
+        const Tap& tx {m_columns[static_cast<size_t>(x)]};
+
+        const float aTop {a0[tx.low] + (a0[tx.high] - a0[tx.low]) * tx.weight};
+        const float aBottom {a1[tx.low] + (a1[tx.high] - a1[tx.low]) * tx.weight};
+        const float bTop {b0[tx.low] + (b0[tx.high] - b0[tx.low]) * tx.weight};
+        const float bBottom {b1[tx.low] + (b1[tx.high] - b1[tx.low]) * tx.weight};
+
+        const float a {aTop + (aBottom - aTop) * ty.weight};
+        const float b {bTop + (bBottom - bTop) * ty.weight};
+        out[x] = a * luma(source[x]) + b;
+    }
+}
+
+// Separable running sums. The vertical pass keeps one running sum per
+// column for each band of rows, so it walks memory row by row. Bands have a
+// fixed height, whatever the worker count, so the sums round the same way
+// however the rows are split.
+void GuidedFilter::boxMean(const std::vector<float>& input, std::vector<float>& output,
+                           int width, int height, int radius) {
+    if (width <= 0 || height <= 0)
+        return;
+
+    constexpr int BandRows {16};
+    const int bands {(height + BandRows - 1) / BandRows};
+
+    std::vector<float> horizontal(input.size());
+    const float scale {1.0f / (2 * radius + 1)};
+
+    ParallelFor::run(height, [&](int begin, int end) {
+        for (int y {begin}; y < end; ++y) {
+            const float* in {input.data() + static_cast<size_t>(y) * width};
+            float* out {horizontal.data() + static_cast<size_t>(y) * width};
+
+            float sum {0.0f};
+            for (int i {-radius}; i <= radius; ++i)
+                sum += in[std::clamp(i, 0, width - 1)];
+
+            for (int x {0}; x < width; ++x) {
+                out[x] = sum * scale;
+                sum += in[std::min(x + radius + 1, width - 1)] - in[std::max(x - radius, 0)];
+            }
+        }
+    }, 16);
+
+    ParallelFor::run(bands, [&](int firstBand, int lastBand) {
+        std::vector<float> sums(static_cast<size_t>(width));
+        auto row = [&](int y) {
+            return horizontal.data() + static_cast<size_t>(std::clamp(y, 0, height - 1)) * width;
+        };
+
+        for (int band {firstBand}; band < lastBand; ++band) {
+            const int begin {band * BandRows};
+            const int end {std::min(begin + BandRows, height)};
+
+            std::fill(sums.begin(), sums.end(), 0.0f);
+            for (int i {begin - radius}; i <= begin + radius; ++i) {
+                const float* in {row(i)};
+                for (int x {0}; x < width; ++x)
+                    sums[x] += in[x];
+            }
+
+            for (int y {begin}; y < end; ++y) {
+                float* out {output.data() + static_cast<size_t>(y) * width};
+                const float* add {row(y + radius + 1)};
+                const float* sub {row(y - radius)};
+
+                for (int x {0}; x < width; ++x) {
+                    out[x] = sums[x] * scale;
+                    sums[x] += add[x] - sub[x];
+                }
+            }
+        }
+    });
+}
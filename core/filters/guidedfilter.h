@@ -0,0 +1,52 @@
+#ifndef GUIDEDFILTER_H
+#define GUIDEDFILTER_H
+
+#include <QImage>
+#include <vector>
+
+// Edge-preserving smoothing of luminance with the self-guided filter of He
+// et al.: inside each window the output is a*I + b, where a falls towards
+// zero in flat areas and towards one across edges whose variance exceeds
+// epsilon. Every window statistic is a box mean, so the cost per pixel does
+// not depend on the radius. The coefficients are smooth, so they are solved
+// on a subsampled copy and interpolated back ("fast guided filter"), which
+// keeps a 50 MP image to a few full-resolution passes.
+class GuidedFilter
+{
+public:
+    // radius is in full-resolution pixels; epsilon is a variance on 0..1
+    // luminance.
+    GuidedFilter(const QImage& input, int radius, float epsilon);
+
+    // Smoothed luminance, 0..1, for row y of the image it was built from.
+    void baseRow(int y, const QRgb* source, float* out) const;
+
+    static float luma(QRgb pixel);
+
+    // Mean over a (2 * radius + 1)^2 window with edges clamped, in parallel.
+    static void boxMean(const std::vector<float>& input, std::vector<float>& output,
+                        int width, int height, int radius);
+
+private:
+    // Interpolation position in the subsampled grid for a full-resolution
+    // coordinate, as the lower sample and the weight of the upper one.
+    struct Tap
+    {
+        int low {};
+        int high {};
+        float weight {};
+    };
+
+    static Tap tapFor(int coordinate, int scale, int lowSize);
+
+    int m_width {};
+    int m_height {};
+    int m_scale {1};
+    int m_lowWidth {};
+    int m_lowHeight {};
+    std::vector<Tap> m_columns;
+    std::vector<float> m_a;
+    std::vector<float> m_b;
+};
+
+#endif // GUIDEDFILTER_H
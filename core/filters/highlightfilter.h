@@ -1,16 +1,17 @@
 #ifndef HIGHLIGHTFILTER_H
 #define HIGHLIGHTFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
+#include "tonecurve.h"
 #include <QImage>
 
 
-class HighlightFilter: public ImageFilter
+class HighlightFilter: public PointFilter
 {
 public:
     HighlightFilter(int highlight);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -19,8 +20,10 @@ public:
     void setHighlight(int highlight);
     std::unique_ptr<ImageFilter> clone() const override;
 private:
+    void rebuildCurve();
 
     int m_highlight{};
+    LumaToneCurve m_curve;
 
 };
 
@@ -0,0 +1,83 @@
+#include "hslfilter.h"
+#include "color/colorconvert.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr float BandCentres[] = {0.0f, 30.0f, 60.0f, 120.0f, 180.0f, 240.0f, 270.0f, 300.0f};
+
+}
+
+bool HslFilter::Adjustment::operator==(const Adjustment& other) const {
+    return hue == other.hue && saturation == other.saturation && luminance == other.luminance;
+}
+
+HslFilter::HslFilter() {
+    rebuildTables();
+}
+
+bool HslFilter::isActive() const {
+    return std::any_of(m_adjustments.begin(), m_adjustments.end(), [](const Adjustment& a) {
+        return a != Adjustment();
+    });
+}
+
+HslFilter::Adjustment HslFilter::getAdjustment(Band band) const {
+    return m_adjustments[static_cast<size_t>(band)];
+}
+
+void HslFilter::setAdjustment(Band band, Adjustment adjustment) {
+    adjustment.hue = std::clamp(adjustment.hue, -100, 100);
+    adjustment.saturation = std::clamp(adjustment.saturation, -100, 100);
+    adjustment.luminance = std::clamp(adjustment.luminance, -100, 100);
+
+    m_adjustments[static_cast<size_t>(band)] = adjustment;
+    rebuildTables();
+}
+
+// One entry per degree: the two bands whose centres enclose the hue are
+// blended by distance, wrapping from Magenta back to Red.
+void HslFilter::rebuildTables() {
+    for (int h = 0; h < HueSteps; ++h) {
+        int lower = BandCount - 1;
+        while (BandCentres[lower] > h)
+            --lower;
+
+        const int upper = (lower + 1) % BandCount;
+        const float start = BandCentres[lower];
+        const float end = upper == 0 ? 360.0f : BandCentres[upper];
+        const float t = (h - start) / (end - start);
+
+        const Adjustment& a = m_adjustments[static_cast<size_t>(lower)];
+        const Adjustment& b = m_adjustments[static_cast<size_t>(upper)];
+        auto blend = [t](int from, int to) {
+            return (from + (to - from) * t) / 100.0f;
+        };
+
+        m_hueShift[h] = blend(a.hue, b.hue) * 30.0f;
+        m_saturationScale[h] = 1.0f + blend(a.saturation, b.saturation);
+        m_luminanceShift[h] = blend(a.luminance, b.luminance) * 0.5f;
+    }
+}
+
+void HslFilter::applyInPlace(QImage& image) const {
+    ColorConvert::forEachRowHsl(image, [this](float* h, float* s, float* l, int width) {
+        for (int x = 0; x < width; ++x) {
+            const int index = std::min(static_cast<int>(h[x]), HueSteps - 1);
+
+            // Scaled by the original saturation so greys, whose hue is
+            // meaningless, keep their luminance.
+            l[x] = std::min(std::max(l[x] + m_luminanceShift[index] * s[x], 0.0f), 1.0f);
+            s[x] = std::min(std::max(s[x] * m_saturationScale[index], 0.0f), 1.0f);
+
+            const float hue = h[x] + m_hueShift[index];
+            const float wrapped = hue < 0.0f ? hue + 360.0f : hue - 360.0f;
+            h[x] = hue < 0.0f || hue >= 360.0f ? wrapped : hue;
+        }
+    });
+}
+
+std::unique_ptr<ImageFilter> HslFilter::clone() const {
+    return std::make_unique<HslFilter>(*this);
+}
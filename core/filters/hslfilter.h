@@ -0,0 +1,60 @@
+#ifndef HSLFILTER_H
+#define HSLFILTER_H
+
+#include "pointfilter.h"
+#include <QImage>
+#include <array>
+
+// Per-colour hue, saturation and luminance adjustments. Each band is centred
+// on a hue and blends linearly into its neighbours, so neighbouring bands
+// always sum to one and adjusting one band never leaves a seam.
+class HslFilter : public PointFilter
+{
+public:
+    enum class Band {
+        Red,
+        Orange,
+        Yellow,
+        Green,
+        Aqua,
+        Blue,
+        Purple,
+        Magenta,
+        Count
+    };
+
+    // Each in -100..100: hue shifts by up to 30 degrees, saturation scales
+    // by up to 2x, luminance moves by up to half the range.
+    struct Adjustment
+    {
+        int hue {0};
+        int saturation {0};
+        int luminance {0};
+
+        bool operator==(const Adjustment& other) const;
+        bool operator!=(const Adjustment& other) const { return !(*this == other); }
+    };
+
+    HslFilter();
+
+    void applyInPlace(QImage& image) const override;
+    bool isActive() const override;
+
+    Adjustment getAdjustment(Band band) const;
+    void setAdjustment(Band band, Adjustment adjustment);
+
+    std::unique_ptr<ImageFilter> clone() const override;
+
+private:
+    static constexpr int BandCount = static_cast<int>(Band::Count);
+    static constexpr int HueSteps = 360;
+
+    void rebuildTables();
+
+    std::array<Adjustment, BandCount> m_adjustments {};
+    std::array<float, HueSteps> m_hueShift {};
+    std::array<float, HueSteps> m_saturationScale {};
+    std::array<float, HueSteps> m_luminanceShift {};
+};
+
+#endif // HSLFILTER_H
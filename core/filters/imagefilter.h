@@ -1,14 +1,55 @@
 #ifndef IMAGEFILTER_H
 #define IMAGEFILTER_H
 
+#include "image/imagepool.h"
 #include <QImage>
+#include <cstring>
+#include <memory>
+
+class ToneCurve;
 
 class ImageFilter {
 public:
     virtual ~ImageFilter() = default;
     virtual QImage apply(const QImage& input) const = 0;
     virtual bool isActive() const = 0;
+
+    // Writes the result for src into dst, reusing dst's pixels when it has
+    // src's size and format and is not shared, so callers alternating two
+    // buffers allocate nothing per filter. dst must not be src.
+    virtual void applyInto(const QImage& src, QImage& dst) const { dst = apply(src); }
+
+    // Each output pixel depends only on the input pixel in the same place,
+    // so any part of an image can be filtered on its own.
+    virtual bool isPointwise() const { return false; }
+
     virtual std::unique_ptr<ImageFilter> clone() const = 0;
+
+    // Filters that can run on a linear-light float image (see LinearLight)
+    // override both; the pipeline keeps runs of them in float.
+    virtual bool supportsLinear() const { return false; }
+    virtual void applyLinear(QImage& linear) const { Q_UNUSED(linear); }
+
+    // Filters equivalent to a per-channel table return it, so the pipeline
+    // can merge adjacent ones into a single pass.
+    virtual const ToneCurve* toneCurve() const { return nullptr; }
+
+protected:
+    // Makes dst an unshared image of src's size and format, keeping its
+    // buffer when it already is one.
+    static void reuseFor(const QImage& src, QImage& dst)
+    {
+        if (dst.size() != src.size() || dst.format() != src.format() || !dst.isDetached())
+            dst = ImagePool::instance().acquire(src.size(), src.format());
+    }
+
+    static void copyInto(const QImage& src, QImage& dst)
+    {
+        reuseFor(src, dst);
+        const size_t bytes {static_cast<size_t>(src.width()) * (src.depth() / 8)};
+        for (int y {0}; y < src.height(); ++y)
+            std::memcpy(dst.scanLine(y), src.constScanLine(y), bytes);
+    }
 };
 
 #endif // IMAGEFILTER_H
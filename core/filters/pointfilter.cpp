@@ -0,0 +1,16 @@
+#include "pointfilter.h"
+#include "image/imagepool.h"
+
+QImage PointFilter::apply(const QImage& input) const {
+    if (!isActive()) return input;
+
+    QImage result {ImagePool::instance().copy(input)};
+    applyInPlace(result);
+    return result;
+}
+
+void PointFilter::applyInto(const QImage& src, QImage& dst) const {
+    copyInto(src, dst);
+    if (isActive())
+        applyInPlace(dst);
+}
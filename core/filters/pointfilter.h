@@ -0,0 +1,24 @@
+#ifndef POINTFILTER_H
+#define POINTFILTER_H
+
+#include "imagefilter.h"
+#include <QImage>
+
+// A filter that rewrites every pixel from the pixel itself, so it can work
+// on an image in place. apply() and applyInto() copy the input once and
+// run applyInPlace() on the copy.
+class PointFilter : public ImageFilter
+{
+public:
+    QImage apply(const QImage& input) const override;
+    void applyInto(const QImage& src, QImage& dst) const override;
+
+    // image is ARGB32 premultiplied and must not be shared.
+    virtual void applyInPlace(QImage& image) const = 0;
+
+    // Filters that also read the pixel's position or the image size work
+    // in place but are not pointwise.
+    bool isPointwise() const override { return true; }
+};
+
+#endif // POINTFILTER_H
@@ -1,5 +1,6 @@
 #include "saturationfilter.h"
-#include "rgbhsvutil.h"
+#include "color/colorconvert.h"
+#include <algorithm>
 
 SaturationFilter::SaturationFilter(int saturation)
     : m_saturation{saturation} {}
@@ -16,35 +17,12 @@ void SaturationFilter::setSaturation(int saturation) {
     m_saturation = saturation;
 }
 
-QImage SaturationFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    double factor = static_cast<double>(getSaturation()) / 100.0 + 1.0;
-    QImage result = input.copy();
-
-    int width = result.width();
-    int height = result.height();
-
-    for (int y = 0; y < height; ++y) {
-        QRgb* row = reinterpret_cast<QRgb*>(result.scanLine(y));
-
-        for (int x = 0; x < width; ++x) {
-            QRgb pix = row[x];
-
-            double r = qRed(pix)   / 255.0;
-            double g = qGreen(pix) / 255.0;
-            double b = qBlue(pix)  / 255.0;
-
-            double h, s, v;
-            RgbHsvUtil::rgb2hsv(r, g, b, h, s, v);
-
-            s = std::clamp(s * factor, 0.0, 1.0);
-
-            row[x] = RgbHsvUtil::hsv2rgb(h, s, v);
-        }
-    }
-
-    return result;
+void SaturationFilter::applyInPlace(QImage& image) const {
+    const float factor = static_cast<float>(getSaturation()) / 100.0f + 1.0f;
+    ColorConvert::forEachRowHsv(image, [factor](float*, float* s, float*, int width) {
+        for (int x = 0; x < width; ++x)
+            s[x] = std::min(std::max(s[x] * factor, 0.0f), 1.0f);
+    });
 }
 
 
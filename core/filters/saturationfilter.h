@@ -2,15 +2,15 @@
 #define SATURATIONFILTER_H
 
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
 
-class SaturationFilter: public ImageFilter
+class SaturationFilter: public PointFilter
 {
 public:
     SaturationFilter(int saturation);
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
     bool isActive() const override;
     int getSaturation() const;
     void setSaturation(int saturation);
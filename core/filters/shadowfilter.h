@@ -1,16 +1,17 @@
 #ifndef SHADOWFILTER_H
 #define SHADOWFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
+#include "tonecurve.h"
 #include <QImage>
 
 
-class ShadowFilter: public ImageFilter
+class ShadowFilter: public PointFilter
 {
 public:
     ShadowFilter(int shadow);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -19,8 +20,10 @@ public:
     void setShadow(int shadow);
     std::unique_ptr<ImageFilter> clone() const override;
 private:
+    void rebuildCurve();
 
     int m_shadow{};
+    LumaToneCurve m_curve;
 
 };
 
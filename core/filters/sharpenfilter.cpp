@@ -1,9 +1,10 @@
 #include "sharpenfilter.h"
-#include "gaussianblurutil.h"
-#include "fastblur.h"
 
-SharpenFilter::SharpenFilter(int sharpness)
-    : m_sharpness {sharpness} {}
+#include <algorithm>
+#include <cmath>
+
+SharpenFilter::SharpenFilter(int sharpness, int radius, int threshold)
+    : m_sharpness {sharpness}, m_radius {radius}, m_threshold {threshold} {}
 
 int SharpenFilter::getSharpness() const {
     return m_sharpness;
@@ -13,47 +14,52 @@ void SharpenFilter::setSharpness(int sharpness) {
     m_sharpness = sharpness;
 }
 
-bool SharpenFilter::isActive() const {
-    return m_sharpness > 0;
+int SharpenFilter::getRadius() const {
+    return m_radius;
 }
 
-QImage SharpenFilter::apply(const QImage& input) const {
-
-    if (!isActive()) return input;
-
-
-    int sharpness {getSharpness()};
-
-    QImage result {input.copy()};
-    QImage blurred {FastBlur::apply(input, 1.0)};
-
-    int height {result.height()};
-    int width {result.width()};
+void SharpenFilter::setRadius(int radius) {
+    m_radius = radius;
+}
 
-    for (int y {0}; y < height; y++) {
+int SharpenFilter::getThreshold() const {
+    return m_threshold;
+}
 
-        const QRgb* src {reinterpret_cast<const QRgb*>(input.scanLine(y))};
-        QRgb* blr {reinterpret_cast<QRgb*>(blurred.scanLine(y))};
-        QRgb* dst {reinterpret_cast<QRgb*>(result.scanLine(y))};
+void SharpenFilter::setThreshold(int threshold) {
+    m_threshold = threshold;
+}
 
-        for (int x{0}; x < width; x++) {
-            int r { (1 + sharpness) * qRed(src[x]) - sharpness * qRed(blr[x]) };
-            int g { (1 + sharpness) * qGreen(src[x]) - sharpness * qGreen(blr[x]) };
-            int b { (1 + sharpness) * qBlue(src[x]) - sharpness * qBlue(blr[x]) };
+bool SharpenFilter::isActive() const {
+    return m_sharpness > 0;
+}
 
-            dst[x] = qRgb(
-                std::clamp(r, 0, 255),
-                std::clamp(g, 0, 255),
-                std::clamp(b, 0, 255)
-                );
-        }
+int SharpenFilter::blurRadius() const {
+    return std::clamp(m_radius, 1, 10);
+}
 
+void SharpenFilter::prepare(BlurPyramid& pyramid) const {
+    pyramid.requestBox(blurRadius());
+}
 
+void SharpenFilter::addDetail(const BlurPyramid& pyramid, int y, const QRgb* source, int width,
+                              float* r, float* g, float* b) const {
+    const QRgb* blurred {reinterpret_cast<const QRgb*>(pyramid.box(blurRadius()).constScanLine(y))};
+    const float amount {static_cast<float>(getSharpness())};
+    const float threshold {static_cast<float>(std::clamp(m_threshold, 0, 255))};
+
+    auto detail = [threshold](int src, int blr) {
+        const float d {static_cast<float>(src - blr)};
+        return std::abs(d) > threshold ? d : 0.0f;
+    };
+
+    for (int x {0}; x < width; x++) {
+        r[x] += amount * detail(qRed(source[x]), qRed(blurred[x]));
+        g[x] += amount * detail(qGreen(source[x]), qGreen(blurred[x]));
+        b[x] += amount * detail(qBlue(source[x]), qBlue(blurred[x]));
     }
-    return result;
 }
 
 std::unique_ptr<ImageFilter> SharpenFilter::clone() const {
     return std::make_unique<SharpenFilter>(*this);
 }
-
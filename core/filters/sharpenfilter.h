@@ -2,28 +2,38 @@
 #define SHARPENFILTER_H
 
 
-#include "imagefilter.h"
+#include "detailfilter.h"
 #include <QImage>
 
 
-class SharpenFilter: public ImageFilter
+// Unsharp mask. Differences from the blur at or below the threshold (in
+// levels) are left alone, so flat areas and noise are not sharpened.
+class SharpenFilter: public DetailFilter
 {
 public:
-    SharpenFilter(int sharpness);
-
-    QImage apply(const QImage& input) const override;
+    SharpenFilter(int sharpness, int radius = 1, int threshold = 0);
 
     bool isActive() const override;
 
     int getSharpness() const;
 
     void setSharpness(int sharpness);
+    int getRadius() const;
+    void setRadius(int radius);
+    int getThreshold() const;
+    void setThreshold(int threshold);
     std::unique_ptr<ImageFilter> clone() const override;
+
+    void prepare(BlurPyramid& pyramid) const override;
+    void addDetail(const BlurPyramid& pyramid, int y, const QRgb* source, int width,
+                   float* r, float* g, float* b) const override;
 private:
+    int blurRadius() const;
 
     int m_sharpness{};
+    int m_radius{1};
+    int m_threshold{};
 
 };
 
 #endif // SHARPENFILTER_H
-
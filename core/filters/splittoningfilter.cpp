@@ -16,20 +16,16 @@ void SplitToningFilter::setSplitToning(int splitToning) {
     m_splitToning = splitToning;
 }
 
-QImage SplitToningFilter::apply(const QImage &input) const {
-    if (!isActive()) return input;
-
-    QImage result = input.copy();
-
+void SplitToningFilter::applyInPlace(QImage& image) const {
     const double factor = std::clamp(getSplitToning(), 0, 100) / 100.0;
     const QColor shadowTint{64, 160, 170};
     const QColor highlightTint{255, 199, 145};
 
-    const int width = result.width();
-    const int height = result.height();
+    const int width = image.width();
+    const int height = image.height();
 
     for (int y = 0; y < height; ++y) {
-        QRgb *row = reinterpret_cast<QRgb *>(result.scanLine(y));
+        QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(y));
 
         for (int x = 0; x < width; ++x) {
             const QRgb pix = row[x];
@@ -49,8 +45,6 @@ QImage SplitToningFilter::apply(const QImage &input) const {
             row[x] = qRgb(std::clamp(r, 0, 255), std::clamp(g, 0, 255), std::clamp(b, 0, 255));
         }
     }
-
-    return result;
 }
 
 
@@ -1,15 +1,15 @@
 #ifndef SPLITTONINGFILTER_H
 #define SPLITTONINGFILTER_H
 
-#include "ImageFilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
-class SplitToningFilter : public ImageFilter
+class SplitToningFilter : public PointFilter
 {
 public:
     explicit SplitToningFilter(int splitToning);
 
-    QImage apply(const QImage &input) const override;
+    void applyInPlace(QImage& image) const override;
     bool isActive() const override;
 
     int getSplitToning() const;
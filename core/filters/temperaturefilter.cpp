@@ -1,4 +1,5 @@
 #include "temperaturefilter.h"
+#include "color/linearlight.h"
 
 
 
@@ -6,15 +7,10 @@ TemperatureFilter::TemperatureFilter(int temperature)
     : m_temperature{temperature} {}
 
 
-QImage TemperatureFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-
-
+void TemperatureFilter::applyInPlace(QImage& image) const {
     int temperature {getTemperature()};
-    int height {result.height()};
-    int width {result.width()};
+    int height {image.height()};
+    int width {image.width()};
 
 
     int deltaR {static_cast<int>(temperature * 0.6)};
@@ -22,7 +18,7 @@ QImage TemperatureFilter::apply(const QImage& input) const {
     int deltaB {static_cast<int>(-temperature * 0.6)};
 
     for (int y{0}; y < height; y++) {
-        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
+        QRgb* row {reinterpret_cast<QRgb*>(image.scanLine(y))};
 
         for (int x{0}; x < width; x++) {
 
@@ -34,8 +30,6 @@ QImage TemperatureFilter::apply(const QImage& input) const {
             );
         }
     }
-
-    return result;
 }
 
 bool TemperatureFilter::isActive() const {
@@ -51,6 +45,23 @@ void TemperatureFilter::setTemperature(int temperature) {
 }
 
 
+bool TemperatureFilter::supportsLinear() const {
+    return true;
+}
+
+void TemperatureFilter::applyLinear(QImage& linear) const {
+    const double temperature {static_cast<double>(getTemperature())};
+
+    const float scale[3] {
+        static_cast<float>(std::pow(std::max(0.0, 1.0 + temperature * 0.6 / 128.0), 2.2)),
+        static_cast<float>(std::pow(std::max(0.0, 1.0 + temperature * 0.2 / 128.0), 2.2)),
+        static_cast<float>(std::pow(std::max(0.0, 1.0 - temperature * 0.6 / 128.0), 2.2))
+    };
+    const float offset[3] {0.0f, 0.0f, 0.0f};
+
+    LinearLight::scaleAndOffset(linear, scale, offset);
+}
+
 std::unique_ptr<ImageFilter> TemperatureFilter::clone() const {
     return std::make_unique<TemperatureFilter>(*this);
 }
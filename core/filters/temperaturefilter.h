@@ -1,16 +1,16 @@
 #ifndef TEMPERATUREFILTER_H
 #define TEMPERATUREFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
 
-class TemperatureFilter: public ImageFilter
+class TemperatureFilter: public PointFilter
 {
 public:
     TemperatureFilter(int temperature);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -18,6 +18,8 @@ public:
 
     void setTemperature(int temperature);
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
 private:
 
     int m_temperature{};
@@ -1,25 +1,22 @@
 #include "tintfilter.h"
+#include "color/linearlight.h"
 
 TintFilter::TintFilter(int tint)
     : m_tint{tint} {}
 
 
-QImage TintFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-
+void TintFilter::applyInPlace(QImage& image) const {
 
     double tint {static_cast<double>(getTint()) / 100.0};
-    int height {result.height()};
-    int width {result.width()};
+    int height {image.height()};
+    int width {image.width()};
 
     int deltaR {static_cast<int>(tint * 35.0)};
     int deltaG {static_cast<int>(tint * 15.0)};
     int deltaB {static_cast<int>(tint * 35.0)};
 
     for (int y{0}; y < height; y++) {
-        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
+        QRgb* row {reinterpret_cast<QRgb*>(image.scanLine(y))};
 
         for (int x{0}; x < width; x++) {
 
@@ -31,8 +28,6 @@ QImage TintFilter::apply(const QImage& input) const {
                 );
         }
     }
-
-    return result;
 }
 
 bool TintFilter::isActive() const {
@@ -47,6 +42,23 @@ void TintFilter::setTint(int tint) {
     m_tint = tint;
 }
 
+bool TintFilter::supportsLinear() const {
+    return true;
+}
+
+void TintFilter::applyLinear(QImage& linear) const {
+    const double tint {static_cast<double>(getTint()) / 100.0};
+
+    const float scale[3] {
+        static_cast<float>(std::pow(std::max(0.0, 1.0 + tint * 35.0 / 128.0), 2.2)),
+        static_cast<float>(std::pow(std::max(0.0, 1.0 - tint * 15.0 / 128.0), 2.2)),
+        static_cast<float>(std::pow(std::max(0.0, 1.0 + tint * 35.0 / 128.0), 2.2))
+    };
+    const float offset[3] {0.0f, 0.0f, 0.0f};
+
+    LinearLight::scaleAndOffset(linear, scale, offset);
+}
+
 std::unique_ptr<ImageFilter> TintFilter::clone() const {
     return std::make_unique<TintFilter>(*this);
 }
@@ -3,16 +3,16 @@
 
 
 
-#include "imagefilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
 
-class TintFilter: public ImageFilter
+class TintFilter: public PointFilter
 {
 public:
     TintFilter(int tint);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -20,6 +20,8 @@ public:
 
     void setTint(int tint);
     std::unique_ptr<ImageFilter> clone() const override;
+    bool supportsLinear() const override;
+    void applyLinear(QImage& linear) const override;
 private:
 
     int m_tint{};
@@ -0,0 +1,101 @@
+#include "tonecurve.h"
+#include "image/imagepool.h"
+
+#include "parallel/parallelfor.h"
+
+ToneCurve::ToneCurve()
+{
+    for (auto& table : m_tables) {
+        for (int v {0}; v < 256; ++v)
+            table[v] = static_cast<quint8>(v);
+    }
+}
+
+ToneCurve ToneCurve::fromTables(const Table& red, const Table& green, const Table& blue)
+{
+    ToneCurve curve;
+    curve.m_tables = {red, green, blue};
+    curve.updateIdentity();
+    return curve;
+}
+
+ToneCurve ToneCurve::then(const ToneCurve& next) const
+{
+    ToneCurve curve;
+    for (int c {0}; c < 3; ++c) {
+        for (int v {0}; v < 256; ++v)
+            curve.m_tables[c][v] = next.m_tables[c][m_tables[c][v]];
+    }
+    curve.updateIdentity();
+    return curve;
+}
+
+void ToneCurve::updateIdentity()
+{
+    m_identity = true;
+    for (const auto& table : m_tables) {
+        for (int v {0}; v < 256 && m_identity; ++v)
+            m_identity = table[v] == v;
+    }
+}
+
+QImage ToneCurve::apply(const QImage& input) const
+{
+    QImage result {ImagePool::instance().copy(input)};
+    applyInPlace(result);
+    return result;
+}
+
+void ToneCurve::applyInPlace(QImage& image) const
+{
+    const int width {image.width()};
+    const quint8* red {m_tables[0].data()};
+    const quint8* green {m_tables[1].data()};
+    const quint8* blue {m_tables[2].data()};
+
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        for (int y {begin}; y < end; ++y) {
+            QRgb* row {reinterpret_cast<QRgb*>(image.scanLine(y))};
+
+            for (int x {0}; x < width; ++x) {
+                const QRgb px {row[x]};
+                row[x] = 0xff000000u
+                         | (uint(red[qRed(px)]) << 16)
+                         | (uint(green[qGreen(px)]) << 8)
+                         | uint(blue[qBlue(px)]);
+            }
+        }
+    }, 16);
+}
+
+QImage LumaToneCurve::apply(const QImage& input) const
+{
+    QImage result {ImagePool::instance().copy(input)};
+    applyInPlace(result);
+    return result;
+}
+
+void LumaToneCurve::applyInPlace(QImage& image) const
+{
+    const int width {image.width()};
+    const quint8* table {m_table.data()};
+
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        for (int y {begin}; y < end; ++y) {
+            QRgb* row {reinterpret_cast<QRgb*>(image.scanLine(y))};
+
+            for (int x {0}; x < width; ++x) {
+                const QRgb px {row[x]};
+                const int r {qRed(px)};
+                const int g {qGreen(px)};
+                const int b {qBlue(px)};
+                const quint8* lut {table + luma(r, g, b) * 256};
+
+                row[x] = 0xff000000u
+                         | (uint(lut[r]) << 16)
+                         | (uint(lut[g]) << 8)
+                         | uint(lut[b]);
+            }
+        }
+    }, 16);
+}
@@ -0,0 +1,83 @@
+#ifndef TONECURVE_H
+#define TONECURVE_H
+
+#include <QImage>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Per-channel 8-bit transfer tables. Filters whose output depends only on
+// each channel value build one when their parameter changes, and applying
+// it is a single table lookup per channel.
+class ToneCurve
+{
+public:
+    using Table = std::array<quint8, 256>;
+
+    ToneCurve();
+
+    template<class Fn>
+    static ToneCurve fromFunction(Fn fn)
+    {
+        ToneCurve curve;
+        for (int v {0}; v < 256; ++v) {
+            const quint8 out {static_cast<quint8>(std::clamp(static_cast<int>(fn(v)), 0, 255))};
+            curve.m_tables[0][v] = out;
+            curve.m_tables[1][v] = out;
+            curve.m_tables[2][v] = out;
+        }
+        curve.updateIdentity();
+        return curve;
+    }
+
+    static ToneCurve fromTables(const Table& red, const Table& green, const Table& blue);
+
+    const Table& table(int channel) const { return m_tables[channel]; }
+    bool isIdentity() const { return m_identity; }
+
+    // The curve that applies this one and then next.
+    ToneCurve then(const ToneCurve& next) const;
+
+    // Like the filters these replace, the result is opaque.
+    QImage apply(const QImage& input) const;
+    void applyInPlace(QImage& image) const;
+
+private:
+    void updateIdentity();
+
+    std::array<Table, 3> m_tables;
+    bool m_identity {true};
+};
+
+// A table indexed by Rec.601 luma and channel value, for adjustments whose
+// gain depends on pixel brightness. 64 KB, so it stays cache resident.
+class LumaToneCurve
+{
+public:
+    template<class Fn>
+    static LumaToneCurve fromFunction(Fn fn)
+    {
+        LumaToneCurve curve;
+        curve.m_table.resize(256 * 256);
+        for (int luma {0}; luma < 256; ++luma) {
+            for (int v {0}; v < 256; ++v) {
+                curve.m_table[luma * 256 + v] =
+                    static_cast<quint8>(std::clamp(static_cast<int>(fn(v, luma)), 0, 255));
+            }
+        }
+        return curve;
+    }
+
+    static int luma(int r, int g, int b)
+    {
+        return (19595 * r + 38470 * g + 7471 * b + 32768) >> 16;
+    }
+
+    QImage apply(const QImage& input) const;
+    void applyInPlace(QImage& image) const;
+
+private:
+    std::vector<quint8> m_table;
+};
+
+#endif // TONECURVE_H
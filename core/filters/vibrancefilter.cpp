@@ -1,69 +1,61 @@
 #include "vibrancefilter.h"
-#include "rgbhsvutil.h"
+#include "color/colorconvert.h"
+#include "parallel/parallelfor.h"
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 VibranceFilter::VibranceFilter(int vibrance)
     : m_vibrance{vibrance} {}
 
-QImage VibranceFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
-
-    QImage result {input.copy()};
-    double vibrance {getVibrance() / 100.0};
-    int height {result.height()};
-    int width {result.width()};
-
-    for (int y{0}; y < height; y++) {
-        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
-        for (int x{0}; x < width; x++) {
-            int red = qRed(row[x]);
-            int green = qGreen(row[x]);
-            int blue = qBlue(row[x]);
-
-            double r = red / 255.0;
-            double g = green / 255.0;
-            double b = blue / 255.0;
-
-            int maxChannel = std::max({red, green, blue});
-            int minChannel = std::min({red, green, blue});
-            int diff = maxChannel - minChannel;
-
-            if (diff < 20) {
-                continue;
+void VibranceFilter::applyInPlace(QImage& image) const {
+    const float vibrance {getVibrance() / 100.0f};
+    const int width {image.width()};
+
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        std::vector<float> planes(static_cast<size_t>(width) * 4);
+        float* h {planes.data()};
+        float* s {h + width};
+        float* v {s + width};
+        float* boosted {v + width};
+        std::vector<QRgb> converted(static_cast<size_t>(width));
+
+        for (int y{begin}; y < end; y++) {
+            QRgb* row {reinterpret_cast<QRgb*>(image.scanLine(y))};
+            ColorConvert::rgbToHsv(row, width, h, s, v);
+
+            for (int x{0}; x < width; x++) {
+                const int maxChannel {std::max({qRed(row[x]), qGreen(row[x]), qBlue(row[x])})};
+                const int minChannel {std::min({qRed(row[x]), qGreen(row[x]), qBlue(row[x])})};
+
+                const int diff {maxChannel - minChannel};
+
+                // Near-greys, very pale colours and bright pastels are left
+                // alone. Tested on the integer channels so pixels sitting on
+                // a threshold do not flip with float rounding.
+                const bool skip {diff < 20
+                                 || diff * 100 < maxChannel * 8
+                                 || (maxChannel * 100 > 255 * 88 && diff * 5 < maxChannel)};
+
+                // Skin and warm hues get a gentler boost.
+                const float hue {h[x]};
+                const float hueWeight {
+                    (hue >= 5.0f && hue <= 45.0f) ? 0.4f
+                    : (hue <= 5.0f || hue >= 345.0f || (hue >= 45.0f && hue <= 65.0f)) ? 0.5f
+                    : 1.0f};
+
+                const float boost {skip ? 0.0f : vibrance * (1.0f - s[x]) * 0.6f * hueWeight};
+                boosted[x] = std::clamp(s[x] + boost, 0.0f, 1.0f);
             }
 
-            double h{}, s{}, v{};
-            RgbHsvUtil::rgb2hsv(r, g, b, h, s, v);
-
-            if (s < 0.08) {
-                continue;
-            }
+            ColorConvert::hsvToRgb(h, boosted, v, width, converted.data());
 
-            if (v > 0.88 && s < 0.2) {
-                continue;
+            for (int x{0}; x < width; x++) {
+                if (boosted[x] != s[x])
+                    row[x] = converted[x];
             }
-
-            double saturationWeight = 1.0 - s;
-            double boost = vibrance * saturationWeight * 0.6;
-
-            if (h >= 5 && h <= 45) {
-                boost *= 0.4;
-            }
-            else if ((h >= 0 && h <= 5) || (h >= 345 && h <= 360)) {
-                boost *= 0.5;
-            }
-            else if (h >= 45 && h <= 65) {
-                boost *= 0.5;
-            }
-
-            s += boost;
-            s = std::clamp(s, 0.0, 1.0);
-
-            row[x] = RgbHsvUtil::hsv2rgb(h, s, v);
         }
-    }
-
-    return result;
+    }, 16);
 }
 
 bool VibranceFilter::isActive() const {
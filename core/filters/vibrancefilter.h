@@ -1,16 +1,16 @@
 #ifndef VIBRANCEFILTER_H
 #define VIBRANCEFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
 #include <QImage>
 
 
-class VibranceFilter: public ImageFilter
+class VibranceFilter: public PointFilter
 {
 public:
     VibranceFilter(int vibrance);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
 
     bool isActive() const override;
 
@@ -1,47 +1,104 @@
 #include "vignettefilter.h"
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+// Entries across u^2 + v^2 in [0, 1]; everything beyond the frame corner
+// uses the last one.
+constexpr int TableSteps = 16384;
+constexpr int FactorShift = 15;
+
+// Squared normalised distance of each coordinate, in table steps.
+std::vector<int> axisTerms(int count, double center, double halfExtent)
+{
+    std::vector<int> terms(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        const double u = (i - center) / halfExtent;
+        terms[static_cast<size_t>(i)] = static_cast<int>(std::min(u * u, 1.0) * TableSteps + 0.5);
+    }
+    return terms;
+}
 
-VignetteFilter::VignetteFilter(int vignette)
-    : m_vignette{vignette} {}
+}
 
-QImage VignetteFilter::apply(const QImage& input) const {
-    if (!isActive()) return input;
+VignetteFilter::VignetteFilter(int vignette, int centerX, int centerY, int roundness, int feather)
+    : m_vignette{vignette}, m_centerX{centerX}, m_centerY{centerY},
+      m_roundness{roundness}, m_feather{feather} {}
 
-    QImage result {input.copy()};
+std::shared_ptr<const VignetteFilter::Falloff> VignetteFilter::falloffFor(const QSize& size) const {
+    auto cached = std::atomic_load(&m_falloff);
+    if (cached && cached->size == size && cached->vignette == m_vignette
+        && cached->centerX == m_centerX && cached->centerY == m_centerY
+        && cached->roundness == m_roundness && cached->feather == m_feather)
+        return cached;
 
-    const double vignette {std::clamp(m_vignette / 100.0, 0.0, 2.0)};
+    auto falloff = std::make_shared<Falloff>();
+    falloff->size = size;
+    falloff->vignette = m_vignette;
+    falloff->centerX = m_centerX;
+    falloff->centerY = m_centerY;
+    falloff->roundness = m_roundness;
+    falloff->feather = m_feather;
 
-    const int width {result.width()};
-    const int height {result.height()};
+    const double halfWidth {size.width() / 2.0};
+    const double halfHeight {size.height() / 2.0};
+    const double maxDistance {std::hypot(halfWidth, halfHeight)};
 
-    const double centerX {width / 2.0};
-    const double centerY {height / 2.0};
-    const double maxDistance {std::hypot(centerX, centerY)};
+    // At roundness 0 the ellipse passes through the frame corners.
+    const double round {std::clamp(m_roundness, 0, 100) / 100.0};
+    const double radiusX {std::max(halfWidth * M_SQRT2 + (maxDistance - halfWidth * M_SQRT2) * round, 1e-6)};
+    const double radiusY {std::max(halfHeight * M_SQRT2 + (maxDistance - halfHeight * M_SQRT2) * round, 1e-6)};
 
-    for (int y {0}; y < height; ++y) {
-        QRgb* row {reinterpret_cast<QRgb*>(result.scanLine(y))};
+    const double centerX {halfWidth * (1.0 + std::clamp(m_centerX, -100, 100) / 100.0)};
+    const double centerY {halfHeight * (1.0 + std::clamp(m_centerY, -100, 100) / 100.0)};
 
-        for (int x {0}; x < width; ++x) {
-            const double dx {x - centerX};
-            const double dy {y - centerY};
-            const double distanceRatio {std::hypot(dx, dy) / maxDistance};
+    falloff->columns = axisTerms(size.width(), centerX, radiusX);
+    falloff->rows = axisTerms(size.height(), centerY, radiusY);
 
-            double factor {1.0 - vignette * distanceRatio * distanceRatio};
-            factor = std::clamp(factor, 0.0, 1.0);
+    const double vignette {std::clamp(m_vignette / 100.0, 0.0, 2.0)};
+    const double inner {(1.0 - std::clamp(m_feather, 0, 100) / 100.0) * 0.95};
+    const double innerSquared {inner * inner};
+
+    falloff->table.resize(TableSteps + 1);
+    for (int i = 0; i <= TableSteps; ++i) {
+        const double t {static_cast<double>(i) / TableSteps};
+        const double ramp {std::clamp((t - innerSquared) / (1.0 - innerSquared), 0.0, 1.0)};
+        const double factor {std::clamp(1.0 - vignette * ramp, 0.0, 1.0)};
+        falloff->table[static_cast<size_t>(i)] = static_cast<quint16>(std::lround(factor * (1 << FactorShift)));
+    }
 
-            const QRgb px {row[x]};
-            const int r {static_cast<int>(qRed(px) * factor)};
-            const int g {static_cast<int>(qGreen(px) * factor)};
-            const int b {static_cast<int>(qBlue(px) * factor)};
+    std::shared_ptr<const Falloff> built {std::move(falloff)};
+    std::atomic_store(&m_falloff, built);
+    return built;
+}
 
-            row[x] = qRgb(
-                std::clamp(r, 0, 255),
-                std::clamp(g, 0, 255),
-                std::clamp(b, 0, 255)
-                );
-        }
-    }
+void VignetteFilter::applyInPlace(QImage& image) const {
+    const std::shared_ptr<const Falloff> falloff {falloffFor(image.size())};
+    const int width {image.width()};
+    const int* columns {falloff->columns.data()};
+    const quint16* table {falloff->table.data()};
+
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        for (int y {begin}; y < end; ++y) {
+            QRgb* row {reinterpret_cast<QRgb*>(image.scanLine(y))};
+            const int rowTerm {falloff->rows[static_cast<size_t>(y)]};
+
+            for (int x {0}; x < width; ++x) {
+                const int factor {table[std::min(columns[x] + rowTerm, TableSteps)]};
+
+                const QRgb px {row[x]};
+                const int r {(qRed(px) * factor) >> FactorShift};
+                const int g {(qGreen(px) * factor) >> FactorShift};
+                const int b {(qBlue(px) * factor) >> FactorShift};
 
-    return result;
+                row[x] = qRgb(r, g, b);
+            }
+        }
+    }, 16);
 }
 
 bool VignetteFilter::isActive() const {
@@ -56,6 +113,38 @@ void VignetteFilter::setVignette(int vignette) {
     m_vignette = vignette;
 }
 
+int VignetteFilter::getCenterX() const {
+    return m_centerX;
+}
+
+void VignetteFilter::setCenterX(int centerX) {
+    m_centerX = centerX;
+}
+
+int VignetteFilter::getCenterY() const {
+    return m_centerY;
+}
+
+void VignetteFilter::setCenterY(int centerY) {
+    m_centerY = centerY;
+}
+
+int VignetteFilter::getRoundness() const {
+    return m_roundness;
+}
+
+void VignetteFilter::setRoundness(int roundness) {
+    m_roundness = roundness;
+}
+
+int VignetteFilter::getFeather() const {
+    return m_feather;
+}
+
+void VignetteFilter::setFeather(int feather) {
+    m_feather = feather;
+}
+
 std::unique_ptr<ImageFilter> VignetteFilter::clone() const {
     return std::make_unique<VignetteFilter>(*this);
 }
@@ -1,24 +1,66 @@
 #ifndef VIGNETTEFILTER_H
 #define VIGNETTEFILTER_H
 
-#include "imagefilter.h"
+#include "pointfilter.h"
 #include <QImage>
+#include <memory>
+#include <vector>
 
-class VignetteFilter : public ImageFilter
+class VignetteFilter : public PointFilter
 {
 public:
-    explicit VignetteFilter(int vignette);
+    // centre is an offset in -100..100 of half the frame; roundness runs
+    // from an ellipse fitted to the frame (0) to a circle (100); feather
+    // 100 darkens from the very centre, lower values keep a clear middle
+    // and tighten the edge.
+    explicit VignetteFilter(int vignette, int centerX = 0, int centerY = 0,
+                            int roundness = 100, int feather = 100);
 
-    QImage apply(const QImage& input) const override;
+    void applyInPlace(QImage& image) const override;
+    // The falloff depends on the image size.
+    bool isPointwise() const override { return false; }
 
     bool isActive() const override;
 
     int getVignette() const;
 
     void setVignette(int vignette);
+    int getCenterX() const;
+    void setCenterX(int centerX);
+    int getCenterY() const;
+    void setCenterY(int centerY);
+    int getRoundness() const;
+    void setRoundness(int roundness);
+    int getFeather() const;
+    void setFeather(int feather);
     std::unique_ptr<ImageFilter> clone() const override;
 private:
+    // The factor depends on u^2 + v^2, which splits into a per-column and
+    // a per-row term; both are kept as indices into a radial table of
+    // Q15 factors.
+    struct Falloff
+    {
+        QSize size;
+        int vignette {};
+        int centerX {};
+        int centerY {};
+        int roundness {};
+        int feather {};
+        std::vector<int> columns;
+        std::vector<int> rows;
+        std::vector<quint16> table;
+    };
+
+    std::shared_ptr<const Falloff> falloffFor(const QSize& size) const;
+
     int m_vignette{};
+    int m_centerX{};
+    int m_centerY{};
+    int m_roundness{100};
+    int m_feather{100};
+
+    // Shared by clones; rebuilt when the size or a parameter changes.
+    mutable std::shared_ptr<const Falloff> m_falloff;
 };
 
 #endif // VIGNETTEFILTER_H
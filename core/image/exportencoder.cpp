@@ -0,0 +1,616 @@
+#include "exportencoder.h"
+#include "parallel/parallelfor.h"
+#include "color/colorlut3d.h"
+#include "resampler.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <atomic>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <zlib.h>
+#include <jpeglib.h>
+
+namespace {
+
+constexpr int kDeflateWindow   = 32768;
+constexpr int kMinBandBytes    = 256 * 1024;
+constexpr int kJpegMcuRows     = 16;
+
+QImage prepareSource(const QImage& image)
+{
+    switch (image.format()) {
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB32:
+        return image;
+    default:
+        return image.convertToFormat(QImage::Format_ARGB32);
+    }
+}
+
+void unpackRow(const QImage& image, int y, int channels, uchar* dst)
+{
+    const QRgb* src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+    const bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    const int width = image.width();
+
+    for (int x = 0; x < width; ++x) {
+        const QRgb px = premultiplied ? qUnpremultiply(src[x]) : src[x];
+        dst[0] = static_cast<uchar>(qRed(px));
+        dst[1] = static_cast<uchar>(qGreen(px));
+        dst[2] = static_cast<uchar>(qBlue(px));
+        if (channels == 4)
+            dst[3] = static_cast<uchar>(qAlpha(px));
+        dst += channels;
+    }
+}
+
+bool isOpaque(const QImage& image)
+{
+    if (image.format() == QImage::Format_RGB32)
+        return true;
+
+    std::vector<char> opaqueBands(static_cast<size_t>(image.height()), 1);
+
+    ParallelFor::run(image.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const QRgb* row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for (int x = 0; x < image.width(); ++x) {
+                if (qAlpha(row[x]) != 255) {
+                    opaqueBands[static_cast<size_t>(y)] = 0;
+                    break;
+                }
+            }
+        }
+    }, 64);
+
+    return std::all_of(opaqueBands.begin(), opaqueBands.end(), [](char v) { return v != 0; });
+}
+
+inline uchar paeth(int a, int b, int c)
+{
+    const int p  = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uchar>(a);
+    if (pb <= pc) return static_cast<uchar>(b);
+    return static_cast<uchar>(c);
+}
+
+void filterRow(int type, const uchar* cur, const uchar* prev, int bytes, int bpp, uchar* out)
+{
+    out[0] = static_cast<uchar>(type);
+    uchar* dst = out + 1;
+
+    for (int i = 0; i < bytes; ++i) {
+        const int left  = i >= bpp ? cur[i - bpp] : 0;
+        const int up    = prev[i];
+        const int upper = i >= bpp ? prev[i - bpp] : 0;
+
+        switch (type) {
+        case 0: dst[i] = cur[i]; break;
+        case 1: dst[i] = static_cast<uchar>(cur[i] - left); break;
+        case 2: dst[i] = static_cast<uchar>(cur[i] - up); break;
+        case 3: dst[i] = static_cast<uchar>(cur[i] - ((left + up) >> 1)); break;
+        default: dst[i] = static_cast<uchar>(cur[i] - paeth(left, up, upper)); break;
+        }
+    }
+}
+
+int filterCost(const uchar* filtered, int bytes)
+{
+    int sum = 0;
+    for (int i = 1; i <= bytes; ++i)
+        sum += std::abs(static_cast<int>(static_cast<signed char>(filtered[i])));
+    return sum;
+}
+
+// Writes the PNG-filtered form of rows [y0, y1) to out. The row above y0 is
+// unpacked again so every band can be filtered independently.
+void filterRows(const QImage& image, int y0, int y1, int channels, bool adaptive, uchar* out)
+{
+    const int bytes = image.width() * channels;
+    std::vector<uchar> prev(static_cast<size_t>(bytes), 0);
+    std::vector<uchar> cur(static_cast<size_t>(bytes));
+    std::vector<uchar> trial(adaptive ? static_cast<size_t>(bytes) + 1 : 0);
+
+    if (y0 > 0)
+        unpackRow(image, y0 - 1, channels, prev.data());
+
+    for (int y = y0; y < y1; ++y) {
+        unpackRow(image, y, channels, cur.data());
+        uchar* dst = out + static_cast<size_t>(y - y0) * (bytes + 1);
+
+        if (!adaptive) {
+            filterRow(2, cur.data(), prev.data(), bytes, channels, dst);
+        } else {
+            filterRow(0, cur.data(), prev.data(), bytes, channels, dst);
+            int best = filterCost(dst, bytes);
+
+            for (int type = 1; type <= 4; ++type) {
+                filterRow(type, cur.data(), prev.data(), bytes, channels, trial.data());
+                const int cost = filterCost(trial.data(), bytes);
+                if (cost < best) {
+                    best = cost;
+                    std::copy(trial.begin(), trial.end(), dst);
+                }
+            }
+        }
+
+        std::swap(prev, cur);
+    }
+}
+
+struct DeflateBand
+{
+    QByteArray data;
+    uLong adler {1};
+    size_t rawBytes {0};
+    bool ok {false};
+};
+
+DeflateBand deflateBand(const QImage& image, int y0, int y1, int channels,
+                        const ExportOptions& options, bool last)
+{
+    DeflateBand band;
+
+    const int rowBytes = image.width() * channels + 1;
+    std::vector<uchar> filtered(static_cast<size_t>(y1 - y0) * rowBytes);
+    filterRows(image, y0, y1, channels, options.adaptiveFilter, filtered.data());
+
+    band.rawBytes = filtered.size();
+    band.adler = adler32(adler32(0L, Z_NULL, 0), filtered.data(), static_cast<uInt>(filtered.size()));
+
+    z_stream zs {};
+    const int level = std::clamp(options.compressionLevel, 0, 9);
+    const int strategy = options.adaptiveFilter ? Z_FILTERED : Z_DEFAULT_STRATEGY;
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+        return band;
+
+    if (y0 > 0) {
+        const int dictRows = std::min(y0, (kDeflateWindow + rowBytes - 1) / rowBytes);
+        std::vector<uchar> dict(static_cast<size_t>(dictRows) * rowBytes);
+        filterRows(image, y0 - dictRows, y0, channels, options.adaptiveFilter, dict.data());
+
+        const size_t dictBytes = std::min<size_t>(dict.size(), kDeflateWindow);
+        deflateSetDictionary(&zs, dict.data() + dict.size() - dictBytes, static_cast<uInt>(dictBytes));
+    }
+
+    band.data.resize(static_cast<qsizetype>(deflateBound(&zs, static_cast<uLong>(filtered.size())) + 64));
+
+    zs.next_in   = filtered.data();
+    zs.avail_in  = static_cast<uInt>(filtered.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(band.data.data());
+    zs.avail_out = static_cast<uInt>(band.data.size());
+
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int status = Z_OK;
+    for (;;) {
+        status = deflate(&zs, flush);
+        if (status == Z_STREAM_END || (status == Z_OK && zs.avail_out > 0 && zs.avail_in == 0))
+            break;
+        if (status != Z_OK && status != Z_BUF_ERROR)
+            break;
+
+        const qsizetype used = band.data.size() - zs.avail_out;
+        band.data.resize(band.data.size() * 2);
+        zs.next_out  = reinterpret_cast<Bytef*>(band.data.data()) + used;
+        zs.avail_out = static_cast<uInt>(band.data.size() - used);
+    }
+
+    band.ok = last ? status == Z_STREAM_END : status == Z_OK;
+    band.data.resize(band.data.size() - zs.avail_out);
+    deflateEnd(&zs);
+    return band;
+}
+
+void appendUInt32(QByteArray& out, quint32 v)
+{
+    out.append(static_cast<char>((v >> 24) & 0xff));
+    out.append(static_cast<char>((v >> 16) & 0xff));
+    out.append(static_cast<char>((v >> 8) & 0xff));
+    out.append(static_cast<char>(v & 0xff));
+}
+
+void appendChunk(QByteArray& out, const char* type, const char* data, qsizetype size)
+{
+    appendUInt32(out, static_cast<quint32>(size));
+    out.append(type, 4);
+    out.append(data, size);
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    if (size > 0)
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+    appendUInt32(out, static_cast<quint32>(crc));
+}
+
+quint8 zlibHeaderFlags(int level)
+{
+    if (level <= 1) return 0x01;
+    if (level <= 5) return 0x5e;
+    if (level == 6) return 0x9c;
+    return 0xda;
+}
+
+struct JpegErrorManager
+{
+    jpeg_error_mgr base;
+    std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr cinfo)
+{
+    std::longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump, 1);
+}
+
+QByteArray encodeJpegBand(const QImage& image, int y0, int y1, int quality)
+{
+    jpeg_compress_struct cinfo;
+    JpegErrorManager err;
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    std::vector<uchar> row(static_cast<size_t>(image.width()) * 3);
+
+    cinfo.err = jpeg_std_error(&err.base);
+    err.base.error_exit = jpegErrorExit;
+
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        std::free(buffer);
+        return {};
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &buffer, &size);
+
+    cinfo.image_width      = static_cast<JDIMENSION>(image.width());
+    cinfo.image_height     = static_cast<JDIMENSION>(y1 - y0);
+    cinfo.input_components = 3;
+    cinfo.in_color_space   = JCS_RGB;
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, std::clamp(quality, 1, 100), TRUE);
+    cinfo.optimize_coding = FALSE;
+    cinfo.restart_in_rows = 1;
+
+    jpeg_start_compress(&cinfo, TRUE);
+    for (int y = y0; y < y1; ++y) {
+        unpackRow(image, y, 3, row.data());
+        JSAMPROW rowPtr = row.data();
+        jpeg_write_scanlines(&cinfo, &rowPtr, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+
+    QByteArray out(reinterpret_cast<const char*>(buffer), static_cast<qsizetype>(size));
+    jpeg_destroy_compress(&cinfo);
+    std::free(buffer);
+    return out;
+}
+
+QByteArray iccProfileOf(const QImage& image)
+{
+    const QColorSpace space = image.colorSpace();
+    if (!space.isValid() || space == QColorSpace(QColorSpace::SRgb))
+        return {};
+    return space.iccProfile();
+}
+
+QByteArray pngIccChunk(const QByteArray& icc)
+{
+    uLongf size = compressBound(static_cast<uLong>(icc.size()));
+    QByteArray compressed(static_cast<qsizetype>(size), Qt::Uninitialized);
+    if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &size,
+                  reinterpret_cast<const Bytef*>(icc.constData()),
+                  static_cast<uLong>(icc.size()), Z_BEST_COMPRESSION) != Z_OK)
+        return {};
+    compressed.resize(static_cast<qsizetype>(size));
+
+    QByteArray chunk("ICC Profile");
+    chunk.append('\0');
+    chunk.append('\0');
+    chunk.append(compressed);
+    return chunk;
+}
+
+// ICC profiles are carried in APP2 segments of at most 65519 payload bytes,
+// inserted after the JFIF APP0 segment.
+void insertJpegIcc(QByteArray& header, const QByteArray& icc)
+{
+    constexpr qsizetype kMaxPayload = 65519;
+    const auto* d = reinterpret_cast<const uchar*>(header.constData());
+
+    qsizetype pos = 2;
+    if (header.size() > 6 && d[2] == 0xff && d[3] == 0xe0)
+        pos += 2 + ((d[4] << 8) | d[5]);
+
+    const int count = static_cast<int>((icc.size() + kMaxPayload - 1) / kMaxPayload);
+    QByteArray segments;
+
+    for (int i = 0; i < count; ++i) {
+        const QByteArray part = icc.mid(i * kMaxPayload, kMaxPayload);
+        const int length = 2 + 12 + 2 + static_cast<int>(part.size());
+
+        segments.append(static_cast<char>(0xff));
+        segments.append(static_cast<char>(0xe2));
+        segments.append(static_cast<char>((length >> 8) & 0xff));
+        segments.append(static_cast<char>(length & 0xff));
+        segments.append("ICC_PROFILE", 11);
+        segments.append('\0');
+        segments.append(static_cast<char>(i + 1));
+        segments.append(static_cast<char>(count));
+        segments.append(part);
+    }
+
+    header.insert(pos, segments);
+}
+
+// Returns the offset just past the SOS header and the offset of the SOF0
+// height field, or -1 when the stream does not look like baseline JPEG.
+qsizetype findScanStart(const QByteArray& jpeg, qsizetype& sofHeightPos)
+{
+    const auto* d = reinterpret_cast<const uchar*>(jpeg.constData());
+    qsizetype pos = 2;
+    sofHeightPos = -1;
+
+    while (pos + 4 <= jpeg.size()) {
+        if (d[pos] != 0xff)
+            return -1;
+
+        const uchar marker = d[pos + 1];
+        const int length = (d[pos + 2] << 8) | d[pos + 3];
+
+        if (marker == 0xc0)
+            sofHeightPos = pos + 5;
+        if (marker == 0xda)
+            return pos + 2 + length;
+
+        pos += 2 + length;
+    }
+    return -1;
+}
+
+}
+
+ExportOptions ExportOptions::fromPreset(Preset preset)
+{
+    ExportOptions options;
+    switch (preset) {
+    case Preset::Fastest:
+        options.compressionLevel = 1;
+        options.adaptiveFilter = false;
+        options.jpegQuality = 85;
+        break;
+    case Preset::Smallest:
+        options.compressionLevel = 9;
+        options.adaptiveFilter = true;
+        options.jpegQuality = 80;
+        break;
+    case Preset::Balanced:
+    default:
+        break;
+    }
+    return options;
+}
+
+double ExportStats::megabytesPerSecond() const
+{
+    if (seconds <= 0.0)
+        return 0.0;
+    return bytesIn / (1024.0 * 1024.0) / seconds;
+}
+
+QByteArray ExportEncoder::encodePng(const QImage& input, const ExportOptions& options)
+{
+    if (input.isNull())
+        return {};
+
+    const QImage image = prepareSource(input);
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = isOpaque(image) ? 3 : 4;
+    const int rowBytes = width * channels + 1;
+
+    const int threads = ParallelFor::threadCount();
+    const int minRows = std::max(1, kMinBandBytes / rowBytes);
+    const int rowsPerBand = std::max(minRows, (height + threads * 4 - 1) / (threads * 4));
+    const int bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+
+    std::vector<DeflateBand> bands(static_cast<size_t>(bandCount));
+
+    ParallelFor::run(bandCount, [&](int begin, int end) {
+        for (int b = begin; b < end; ++b) {
+            const int y0 = b * rowsPerBand;
+            const int y1 = std::min(height, y0 + rowsPerBand);
+            bands[static_cast<size_t>(b)] = deflateBand(image, y0, y1, channels, options, b == bandCount - 1);
+        }
+    });
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (const auto& band : bands) {
+        if (!band.ok)
+            return {};
+        adler = adler32_combine(adler, band.adler, static_cast<z_off_t>(band.rawBytes));
+    }
+
+    QByteArray out;
+    out.append("\x89PNG\r\n\x1a\n", 8);
+
+    QByteArray ihdr;
+    appendUInt32(ihdr, static_cast<quint32>(width));
+    appendUInt32(ihdr, static_cast<quint32>(height));
+    ihdr.append(static_cast<char>(8));
+    ihdr.append(static_cast<char>(channels == 4 ? 6 : 2));
+    ihdr.append(static_cast<char>(0));
+    ihdr.append(static_cast<char>(0));
+    ihdr.append(static_cast<char>(0));
+    appendChunk(out, "IHDR", ihdr.constData(), ihdr.size());
+
+    const QByteArray icc = iccProfileOf(input);
+    if (!icc.isEmpty()) {
+        const QByteArray iccp = pngIccChunk(icc);
+        if (!iccp.isEmpty())
+            appendChunk(out, "iCCP", iccp.constData(), iccp.size());
+    }
+
+    bands.front().data.prepend(static_cast<char>(zlibHeaderFlags(options.compressionLevel)));
+    bands.front().data.prepend(static_cast<char>(0x78));
+    appendUInt32(bands.back().data, static_cast<quint32>(adler));
+
+    for (const auto& band : bands)
+        appendChunk(out, "IDAT", band.data.constData(), band.data.size());
+
+    appendChunk(out, "IEND", nullptr, 0);
+    return out;
+}
+
+QByteArray ExportEncoder::encodeJpeg(const QImage& input, const ExportOptions& options)
+{
+    if (input.isNull())
+        return {};
+
+    const QImage image = prepareSource(input);
+    const int height = image.height();
+
+    const int threads = ParallelFor::threadCount();
+    const int mcuRowsTotal = (height + kJpegMcuRows - 1) / kJpegMcuRows;
+    const int mcuRowsPerBand = std::max(4, (mcuRowsTotal + threads * 2 - 1) / (threads * 2));
+    const int rowsPerBand = mcuRowsPerBand * kJpegMcuRows;
+    const int bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+
+    std::vector<QByteArray> scans(static_cast<size_t>(bandCount));
+    QByteArray header;
+    std::atomic<bool> failed {false};
+
+    ParallelFor::run(bandCount, [&](int begin, int end) {
+        for (int b = begin; b < end; ++b) {
+            const int y0 = b * rowsPerBand;
+            const int y1 = std::min(height, y0 + rowsPerBand);
+
+            const QByteArray encoded = encodeJpegBand(image, y0, y1, options.jpegQuality);
+            qsizetype sofHeightPos = -1;
+            const qsizetype scanStart = encoded.isEmpty() ? -1 : findScanStart(encoded, sofHeightPos);
+            if (scanStart < 0 || sofHeightPos < 0 || encoded.size() < scanStart + 2) {
+                failed = true;
+                continue;
+            }
+
+            if (b == 0)
+                header = encoded.left(scanStart);
+
+            // Every band restarts its DC predictors on an MCU row boundary, so the
+            // entropy-coded segments can be stitched together once the restart
+            // markers are renumbered into one global RST0..RST7 sequence.
+            const auto* src = reinterpret_cast<const uchar*>(encoded.constData());
+            const qsizetype scanEnd = encoded.size() - 2;
+            int marker = b * mcuRowsPerBand;
+
+            QByteArray& scan = scans[static_cast<size_t>(b)];
+            scan.reserve(scanEnd - scanStart + 2);
+            if (b > 0) {
+                scan.append(static_cast<char>(0xff));
+                scan.append(static_cast<char>(0xd0 + ((marker - 1) & 7)));
+            }
+
+            for (qsizetype i = scanStart; i < scanEnd; ++i) {
+                if (src[i] == 0xff && i + 1 < scanEnd && src[i + 1] >= 0xd0 && src[i + 1] <= 0xd7) {
+                    scan.append(static_cast<char>(0xff));
+                    scan.append(static_cast<char>(0xd0 + (marker & 7)));
+                    ++marker;
+                    ++i;
+                    continue;
+                }
+                scan.append(static_cast<char>(src[i]));
+            }
+        }
+    });
+
+    if (failed || header.isEmpty())
+        return {};
+
+    qsizetype sofHeightPos = -1;
+    findScanStart(header, sofHeightPos);
+    header[sofHeightPos]     = static_cast<char>((height >> 8) & 0xff);
+    header[sofHeightPos + 1] = static_cast<char>(height & 0xff);
+
+    const QByteArray icc = iccProfileOf(input);
+    if (!icc.isEmpty())
+        insertJpegIcc(header, icc);
+
+    QByteArray out = header;
+    for (const auto& scan : scans)
+        out.append(scan);
+    out.append(static_cast<char>(0xff));
+    out.append(static_cast<char>(0xd9));
+    return out;
+}
+
+QImage ExportEncoder::convertToProfile(const QImage& image, const QColorSpace& profile)
+{
+    if (!profile.isValid() || image.isNull())
+        return image;
+
+    const QColorSpace source = image.colorSpace().isValid()
+        ? image.colorSpace()
+        : QColorSpace(QColorSpace::SRgb);
+
+    QImage result = image;
+    if (source != profile) {
+        result.detach();
+        ColorLut3D(source, profile).apply(result);
+    }
+    result.setColorSpace(profile);
+    return result;
+}
+
+bool ExportEncoder::save(const QImage& input,
+                         const QString& path,
+                         const ExportOptions& options,
+                         ExportStats* stats)
+{
+    if (input.isNull())
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QSize size = Resampler::fitted(input.size(), options.maxLongEdge);
+    const QImage resized = size == input.size()
+                               ? input
+                               : Resampler::resize(input, size, Resampler::Kernel::Lanczos3);
+    const QImage image = convertToProfile(resized, options.outputProfile);
+
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    QByteArray encoded;
+    bool ok = false;
+
+    if (suffix == "png")
+        encoded = encodePng(image, options);
+    else if (suffix == "jpg" || suffix == "jpeg")
+        encoded = encodeJpeg(image, options);
+
+    if (!encoded.isEmpty()) {
+        QSaveFile file(path);
+        ok = file.open(QIODevice::WriteOnly)
+             && file.write(encoded) == encoded.size()
+             && file.commit();
+    } else {
+        ok = image.save(path);
+    }
+
+    if (stats) {
+        stats->bytesIn  = static_cast<qint64>(image.width()) * image.height() * 4;
+        stats->bytesOut = encoded.size();
+        stats->seconds  = timer.nsecsElapsed() / 1e9;
+        stats->threads  = encoded.isEmpty() ? 1 : ParallelFor::threadCount();
+    }
+
+    return ok;
+}
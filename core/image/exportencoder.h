@@ -0,0 +1,53 @@
+#ifndef EXPORTENCODER_H
+#define EXPORTENCODER_H
+
+#include <QByteArray>
+#include <QColorSpace>
+#include <QImage>
+#include <QString>
+
+struct ExportOptions
+{
+    enum class Preset {
+        Fastest,
+        Balanced,
+        Smallest
+    };
+
+    int  compressionLevel {6};
+    bool adaptiveFilter {true};
+    int  jpegQuality {90};
+    // Longer side of the exported image; 0 keeps the full size.
+    int  maxLongEdge {0};
+
+    // Invalid means keep the image's own colour space.
+    QColorSpace outputProfile {};
+
+    static ExportOptions fromPreset(Preset preset);
+};
+
+struct ExportStats
+{
+    qint64 bytesIn {0};
+    qint64 bytesOut {0};
+    double seconds {0.0};
+    int    threads {1};
+
+    double megabytesPerSecond() const;
+};
+
+class ExportEncoder
+{
+public:
+    static bool save(const QImage& image,
+                     const QString& path,
+                     const ExportOptions& options = {},
+                     ExportStats* stats = nullptr);
+
+    static QByteArray encodePng(const QImage& image, const ExportOptions& options);
+    static QByteArray encodeJpeg(const QImage& image, const ExportOptions& options);
+
+    static QImage convertToProfile(const QImage& image, const QColorSpace& profile);
+};
+
+#endif // EXPORTENCODER_H
@@ -1,5 +1,6 @@
 #include "imageio.h"
 
+#include <QFile>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QWidget>
@@ -25,9 +26,36 @@ std::optional<QImage> ImageIO::openImage(QWidget* parent)
     return img;
 }
 
+std::optional<QColorSpace> ImageIO::openColorProfile(QWidget* parent)
+{
+    const QString fileName = QFileDialog::getOpenFileName(
+        parent,
+        QObject::tr("Open Colour Profile"),
+        QString(),
+        QObject::tr("ICC Profiles (*.icc *.icm)")
+        );
+
+    if (fileName.isEmpty())
+        return std::nullopt;
+
+    QFile file(fileName);
+    const QColorSpace space = file.open(QIODevice::ReadOnly)
+        ? QColorSpace::fromIccProfile(file.readAll())
+        : QColorSpace();
+
+    if (!space.isValid()) {
+        QMessageBox::warning(parent, "Error", "Failed to load colour profile");
+        return std::nullopt;
+    }
+
+    return space;
+}
+
 bool ImageIO::saveImage(QWidget* parent,
                         const QImage& image,
-                        QString& inOutPath)
+                        QString& inOutPath,
+                        const ExportOptions& options,
+                        ExportStats* stats)
 {
     if (image.isNull()) {
         QMessageBox::warning(parent, "Error", "No image to save");
@@ -35,9 +63,9 @@ bool ImageIO::saveImage(QWidget* parent,
     }
 
     if (inOutPath.isEmpty())
-        return saveImageAs(parent, image, inOutPath);
+        return saveImageAs(parent, image, inOutPath, options, stats);
 
-    if (!image.save(inOutPath)) {
+    if (!ExportEncoder::save(image, inOutPath, options, stats)) {
         QMessageBox::warning(parent, "Error", "Failed to save image");
         return false;
     }
@@ -47,7 +75,9 @@ bool ImageIO::saveImage(QWidget* parent,
 
 bool ImageIO::saveImageAs(QWidget* parent,
                           const QImage& image,
-                          QString& outPath)
+                          QString& outPath,
+                          const ExportOptions& options,
+                          ExportStats* stats)
 {
     const QString fileName = QFileDialog::getSaveFileName(
         parent,
@@ -59,7 +89,7 @@ bool ImageIO::saveImageAs(QWidget* parent,
     if (fileName.isEmpty())
         return false;
 
-    if (!image.save(fileName)) {
+    if (!ExportEncoder::save(image, fileName, options, stats)) {
         QMessageBox::warning(parent, "Error", "Failed to save image");
         return false;
     }
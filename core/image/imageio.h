@@ -1,18 +1,24 @@
 #ifndef IMAGEIO_H
 #define IMAGEIO_H
 
+#include <QColorSpace>
 #include <QImage>
 #include <QString>
 #include <optional>
 
+#include "exportencoder.h"
+
 class QWidget;
 
 class ImageIO
 {
 public:
     static std::optional<QImage> openImage(QWidget* parent);
-    static bool saveImage(QWidget* parent, const QImage& image, QString& inOutPath);
-    static bool saveImageAs(QWidget* parent, const QImage& image, QString& outPath);
+    static std::optional<QColorSpace> openColorProfile(QWidget* parent);
+    static bool saveImage(QWidget* parent, const QImage& image, QString& inOutPath,
+                          const ExportOptions& options = {}, ExportStats* stats = nullptr);
+    static bool saveImageAs(QWidget* parent, const QImage& image, QString& outPath,
+                            const ExportOptions& options = {}, ExportStats* stats = nullptr);
 };
 
 #endif // IMAGEIO_H
@@ -0,0 +1,166 @@
+#include "imagepool.h"
+#include "profiling/profiler.h"
+
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+// Never destroyed: images may still return their buffers while static
+// objects are torn down.
+ImagePool& ImagePool::instance()
+{
+    static ImagePool* pool = new ImagePool;
+    return *pool;
+}
+
+QImage ImagePool::acquire(const QSize& size, QImage::Format format)
+{
+    if (size.isEmpty() || format == QImage::Format_Invalid)
+        return QImage(size, format);
+
+    QImage image = take(size, format);
+    if (Profiler::isEnabled())
+        Profiler::addAllocation(image.sizeInBytes());
+    return image;
+}
+
+QImage ImagePool::take(const QSize& size, QImage::Format format)
+{
+    const qsizetype rowBytes = (static_cast<qsizetype>(size.width()) * QImage::toPixelFormat(format).bitsPerPixel() + 7) / 8;
+    const qsizetype stride = (rowBytes + static_cast<qsizetype>(Alignment) - 1) / static_cast<qsizetype>(Alignment)
+                             * static_cast<qsizetype>(Alignment);
+    const size_t pixelBytes = static_cast<size_t>(stride) * static_cast<size_t>(size.height());
+    if (pixelBytes < static_cast<size_t>(MinBytes))
+        return QImage(size, format);
+
+    const size_t bytes = bucketSize(pixelBytes + Alignment);
+    void* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_idle.find(bytes);
+        if (it != m_idle.end() && !it->second.empty()) {
+            block = it->second.back();
+            it->second.pop_back();
+            m_stats.idleBytes -= static_cast<qint64>(bytes);
+            ++m_stats.hits;
+        } else {
+            ++m_stats.misses;
+        }
+        m_stats.liveBytes += static_cast<qint64>(bytes);
+    }
+
+    if (!block) {
+        block = qMallocAligned(bytes, Alignment);
+        if (!block) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.liveBytes -= static_cast<qint64>(bytes);
+            return QImage(size, format);
+        }
+        new (block) Header{this, bytes};
+    }
+
+    uchar* pixels = static_cast<uchar*>(block) + Alignment;
+    return QImage(pixels, size.width(), size.height(), stride, format, &ImagePool::release, block);
+}
+
+QImage ImagePool::copy(const QImage& image)
+{
+    if (image.isNull())
+        return image;
+
+    QImage result = acquire(image.size(), image.format());
+    const size_t rowBytes = static_cast<size_t>(std::min(image.bytesPerLine(), result.bytesPerLine()));
+    for (int y = 0; y < image.height(); ++y)
+        std::memcpy(result.scanLine(y), image.constScanLine(y), rowBytes);
+    result.setColorSpace(image.colorSpace());
+    return result;
+}
+
+void ImagePool::setCapacity(qint64 bytes)
+{
+    std::vector<void*> freed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = std::max<qint64>(0, bytes);
+
+        // Largest buckets first: they are the fewest buffers to give back.
+        for (auto it = m_idle.rbegin(); it != m_idle.rend() && m_stats.idleBytes > m_capacity; ++it) {
+            while (!it->second.empty() && m_stats.idleBytes > m_capacity) {
+                freed.push_back(it->second.back());
+                it->second.pop_back();
+                m_stats.idleBytes -= static_cast<qint64>(it->first);
+            }
+        }
+    }
+
+    for (void* block : freed)
+        qFreeAligned(block);
+}
+
+qint64 ImagePool::capacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+}
+
+ImagePool::Stats ImagePool::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ImagePool::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+}
+
+void ImagePool::trim()
+{
+    std::map<size_t, std::vector<void*>> idle;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        idle.swap(m_idle);
+        m_stats.idleBytes = 0;
+    }
+
+    for (auto& [bytes, blocks] : idle) {
+        for (void* block : blocks)
+            qFreeAligned(block);
+    }
+}
+
+// Four buckets per power of two, so a buffer serves any request at most a
+// quarter smaller than itself.
+size_t ImagePool::bucketSize(size_t bytes)
+{
+    size_t top = 1;
+    while (top <= bytes / 2)
+        top *= 2;
+
+    const size_t step = std::max(top / 4, Alignment);
+    return (bytes + step - 1) / step * step;
+}
+
+void ImagePool::release(void* block)
+{
+    const Header* header = static_cast<const Header*>(block);
+    header->pool->recycle(block, header->bytes);
+}
+
+void ImagePool::recycle(void* block, size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.liveBytes -= static_cast<qint64>(bytes);
+        if (m_stats.idleBytes + static_cast<qint64>(bytes) <= m_capacity) {
+            m_idle[bytes].push_back(block);
+            m_stats.idleBytes += static_cast<qint64>(bytes);
+            return;
+        }
+    }
+
+    qFreeAligned(block);
+}
@@ -0,0 +1,76 @@
+#ifndef IMAGEPOOL_H
+#define IMAGEPOOL_H
+
+#include <QImage>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Recycles the pixel buffers of large, short-lived images. acquire() wraps
+// a 64-byte aligned buffer in a QImage whose last copy hands the buffer
+// back instead of freeing it, so steady-state rendering reuses pages that
+// are already mapped rather than faulting in fresh ones every frame.
+// Buffers are bucketed by size, four buckets per power of two, and idle
+// ones are kept up to capacity(). Thread-safe; images may be released on
+// any thread. Every image handed out, pooled or not, is counted as an
+// allocation of the open profiler scope.
+class ImagePool
+{
+public:
+    struct Stats
+    {
+        qint64 hits {0};
+        qint64 misses {0};
+        // Handed out and not yet returned.
+        qint64 liveBytes {0};
+        // Returned and kept for reuse.
+        qint64 idleBytes {0};
+
+        double hitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+        qint64 residentBytes() const { return liveBytes + idleBytes; }
+    };
+
+    // Smaller images come from the allocator directly, which already
+    // recycles them cheaply.
+    static constexpr qint64 MinBytes = 64 * 1024;
+    static constexpr size_t Alignment = 64;
+    static constexpr qint64 DefaultCapacity = 512ll * 1024 * 1024;
+
+    static ImagePool& instance();
+
+    // An image of size and format with undefined contents. Rows start on
+    // Alignment boundaries, so bytesPerLine() may exceed the pixel width.
+    QImage acquire(const QSize& size, QImage::Format format);
+    QImage copy(const QImage& image);
+
+    void setCapacity(qint64 bytes);
+    qint64 capacity() const;
+
+    Stats stats() const;
+    void resetStats();
+    // Frees every idle buffer.
+    void trim();
+
+private:
+    ImagePool() = default;
+
+    // Lives in the first Alignment bytes of every pooled block; the pixels
+    // follow it.
+    struct Header
+    {
+        ImagePool* pool;
+        size_t bytes;
+    };
+
+    QImage take(const QSize& size, QImage::Format format);
+    static size_t bucketSize(size_t bytes);
+    static void release(void* block);
+    void recycle(void* block, size_t bytes);
+
+    mutable std::mutex m_mutex;
+    std::map<size_t, std::vector<void*>> m_idle;
+    qint64 m_capacity {DefaultCapacity};
+    Stats m_stats;
+};
+
+#endif // IMAGEPOOL_H
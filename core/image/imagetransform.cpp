@@ -0,0 +1,224 @@
+#include "imagetransform.h"
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr int kTile = 64;
+
+bool isUnit(double v)
+{
+    return std::abs(std::abs(v) - 1.0) < 1e-9;
+}
+
+bool isZero(double v)
+{
+    return std::abs(v) < 1e-9;
+}
+
+// Blends two premultiplied pixels, two channels per multiply; t is 0..256.
+inline QRgb lerpPixel(QRgb a, QRgb b, int t)
+{
+    const quint32 rb = (((a & 0xff00ff) * (256 - t) + (b & 0xff00ff) * t) >> 8) & 0xff00ff;
+    const quint32 ag = (((a >> 8) & 0xff00ff) * (256 - t) + ((b >> 8) & 0xff00ff) * t) & 0xff00ff00;
+    return rb | ag;
+}
+
+QTransform linearPart(const QTransform& t)
+{
+    return QTransform(t.m11(), t.m12(), t.m21(), t.m22(), 0.0, 0.0);
+}
+
+// Inverse of the 2x3 affine matrix, in QTransform's row-vector layout.
+QTransform invertAffine(const QTransform& t)
+{
+    const double det = t.m11() * t.m22() - t.m12() * t.m21();
+    const double a = t.m22() / det;
+    const double b = -t.m12() / det;
+    const double c = -t.m21() / det;
+    const double d = t.m11() / det;
+    return QTransform(a, b, c, d,
+                      -(t.dx() * a + t.dy() * c),
+                      -(t.dx() * b + t.dy() * d));
+}
+
+}
+
+QTransform ImageTransform::normalized(const QTransform& transform, const QSize& size)
+{
+    const QTransform linear = linearPart(transform);
+
+    const double xs[4] {0.0, double(size.width()), 0.0, double(size.width())};
+    const double ys[4] {0.0, 0.0, double(size.height()), double(size.height())};
+    double left = 0.0;
+    double top = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        const double x = linear.m11() * xs[i] + linear.m21() * ys[i];
+        const double y = linear.m12() * xs[i] + linear.m22() * ys[i];
+        left = i == 0 ? x : std::min(left, x);
+        top = i == 0 ? y : std::min(top, y);
+    }
+
+    return QTransform(linear.m11(), linear.m12(), linear.m21(), linear.m22(), -left, -top);
+}
+
+QSize ImageTransform::mappedSize(const QTransform& transform, const QSize& size)
+{
+    const double w = size.width();
+    const double h = size.height();
+    const double width = std::abs(transform.m11()) * w + std::abs(transform.m21()) * h;
+    const double height = std::abs(transform.m12()) * w + std::abs(transform.m22()) * h;
+
+    // Shave rounding noise so that a quarter turn does not grow a column.
+    return QSize(std::max(1, static_cast<int>(std::ceil(width - 1e-6))),
+                 std::max(1, static_cast<int>(std::ceil(height - 1e-6))));
+}
+
+bool ImageTransform::isRightAngle(const QTransform& transform)
+{
+    const double a = transform.m11();
+    const double b = transform.m12();
+    const double c = transform.m21();
+    const double d = transform.m22();
+
+    return (isUnit(a) && isZero(b) && isZero(c) && isUnit(d))
+        || (isZero(a) && isUnit(b) && isUnit(c) && isZero(d));
+}
+
+QImage ImageTransform::apply(const QImage& image, const QTransform& transform)
+{
+    if (image.isNull())
+        return image;
+
+    const QTransform linear = linearPart(transform);
+    if (linear.isIdentity())
+        return image;
+
+    const double det = linear.m11() * linear.m22() - linear.m12() * linear.m21();
+    if (isZero(det))
+        return QImage();
+
+    const QImage source = image.format() == QImage::Format_ARGB32_Premultiplied
+                              ? image
+                              : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QImage result(mappedSize(linear, source.size()), QImage::Format_ARGB32_Premultiplied);
+    const QTransform inverse = invertAffine(normalized(linear, source.size()));
+
+    if (isRightAngle(linear))
+        applyRightAngle(source, result, inverse);
+    else
+        applyBilinear(source, result, inverse);
+
+    return result;
+}
+
+// Every destination pixel centre lands on a source pixel centre, so the
+// mapping is integral: sx = x0 + ax * dx + bx * dy, and likewise for sy.
+// Mirrors keep rows as rows and copy them forwards or backwards. Quarter
+// turns read source columns, so they walk the destination in tiles small
+// enough that the source rows of one tile stay in cache.
+void ImageTransform::applyRightAngle(const QImage& image, QImage& result, const QTransform& inverse)
+{
+    const QPointF origin = inverse.map(QPointF(0.5, 0.5));
+    const int x0 = static_cast<int>(std::floor(origin.x()));
+    const int y0 = static_cast<int>(std::floor(origin.y()));
+    const int ax = qRound(inverse.m11());
+    const int bx = qRound(inverse.m21());
+    const int ay = qRound(inverse.m12());
+    const int by = qRound(inverse.m22());
+
+    const int width = result.width();
+    const int height = result.height();
+
+    if (bx == 0 && ay == 0) {
+        ParallelFor::run(height, [&](int begin, int end) {
+            for (int dy = begin; dy < end; ++dy) {
+                const QRgb* src = reinterpret_cast<const QRgb*>(image.constScanLine(y0 + by * dy));
+                QRgb* dst = reinterpret_cast<QRgb*>(result.scanLine(dy));
+                if (ax > 0)
+                    std::memcpy(dst, src + x0, static_cast<size_t>(width) * sizeof(QRgb));
+                else
+                    std::reverse_copy(src + x0 - width + 1, src + x0 + 1, dst);
+            }
+        }, 16);
+        return;
+    }
+
+    const int tilesX = (width + kTile - 1) / kTile;
+    const int tilesY = (height + kTile - 1) / kTile;
+    const qsizetype stride = image.bytesPerLine() / static_cast<qsizetype>(sizeof(QRgb));
+    const QRgb* bits = reinterpret_cast<const QRgb*>(image.constBits());
+
+    ParallelFor::run(tilesY, [&](int begin, int end) {
+        for (int ty = begin; ty < end; ++ty) {
+            const int rowEnd = std::min(height, (ty + 1) * kTile);
+            for (int tx = 0; tx < tilesX; ++tx) {
+                const int colBegin = tx * kTile;
+                const int colEnd = std::min(width, colBegin + kTile);
+                for (int dy = ty * kTile; dy < rowEnd; ++dy) {
+                    QRgb* dst = reinterpret_cast<QRgb*>(result.scanLine(dy));
+                    const int sx = x0 + bx * dy;
+                    for (int dx = colBegin; dx < colEnd; ++dx)
+                        dst[dx] = bits[(y0 + ay * dx) * stride + sx];
+                }
+            }
+        }
+    }, 1);
+}
+
+// Premultiplied bilinear sampling; texels outside the image count as
+// transparent so the edges stay antialiased.
+void ImageTransform::applyBilinear(const QImage& image, QImage& result, const QTransform& inverse)
+{
+    const int srcWidth = image.width();
+    const int srcHeight = image.height();
+    const int width = result.width();
+    const qsizetype stride = image.bytesPerLine() / static_cast<qsizetype>(sizeof(QRgb));
+    const QRgb* bits = reinterpret_cast<const QRgb*>(image.constBits());
+
+    auto texel = [&](int x, int y) -> QRgb {
+        if (x < 0 || y < 0 || x >= srcWidth || y >= srcHeight)
+            return 0;
+        return bits[y * stride + x];
+    };
+
+    ParallelFor::run(result.height(), [&](int begin, int end) {
+        for (int dy = begin; dy < end; ++dy) {
+            QRgb* dst = reinterpret_cast<QRgb*>(result.scanLine(dy));
+            const QPointF start = inverse.map(QPointF(0.5, dy + 0.5));
+            double u = start.x() - 0.5;
+            double v = start.y() - 0.5;
+
+            for (int dx = 0; dx < width; ++dx, u += inverse.m11(), v += inverse.m12()) {
+                const int x = static_cast<int>(std::floor(u));
+                const int y = static_cast<int>(std::floor(v));
+                if (x < -1 || y < -1 || x >= srcWidth || y >= srcHeight) {
+                    dst[dx] = 0;
+                    continue;
+                }
+
+                const int fx = static_cast<int>((u - x) * 256.0);
+                const int fy = static_cast<int>((v - y) * 256.0);
+                QRgb p00, p10, p01, p11;
+                if (x >= 0 && y >= 0 && x + 1 < srcWidth && y + 1 < srcHeight) {
+                    const QRgb* top = bits + y * stride + x;
+                    p00 = top[0];
+                    p10 = top[1];
+                    p01 = top[stride];
+                    p11 = top[stride + 1];
+                } else {
+                    p00 = texel(x, y);
+                    p10 = texel(x + 1, y);
+                    p01 = texel(x, y + 1);
+                    p11 = texel(x + 1, y + 1);
+                }
+
+                dst[dx] = lerpPixel(lerpPixel(p00, p10, fx), lerpPixel(p01, p11, fx), fy);
+            }
+        }
+    }, 16);
+}
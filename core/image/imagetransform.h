@@ -0,0 +1,27 @@
+#ifndef IMAGETRANSFORM_H
+#define IMAGETRANSFORM_H
+
+#include <QImage>
+#include <QTransform>
+
+// Resamples an image through the linear part of a transform. Translation is
+// ignored: the result is placed so that its bounding box starts at the
+// origin, which is what a layer's orientation needs. Right angles and
+// mirrors only move pixels; anything else is sampled bilinearly.
+class ImageTransform
+{
+public:
+    static QImage apply(const QImage& image, const QTransform& transform);
+
+    // The linear part of transform followed by the translation that apply()
+    // uses for an image of the given size.
+    static QTransform normalized(const QTransform& transform, const QSize& size);
+    static QSize mappedSize(const QTransform& transform, const QSize& size);
+    static bool isRightAngle(const QTransform& transform);
+
+private:
+    static void applyRightAngle(const QImage& image, QImage& result, const QTransform& inverse);
+    static void applyBilinear(const QImage& image, QImage& result, const QTransform& inverse);
+};
+
+#endif // IMAGETRANSFORM_H
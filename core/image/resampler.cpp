@@ -0,0 +1,236 @@
+#include "resampler.h"
+#include "parallel/parallelfor.h"
+#include "profiling/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+double support(Resampler::Kernel kernel)
+{
+    switch (kernel) {
+    case Resampler::Kernel::Box:      return 0.5;
+    case Resampler::Kernel::Mitchell: return 2.0;
+    case Resampler::Kernel::Lanczos3:
+    default:                          return 3.0;
+    }
+}
+
+double sinc(double x)
+{
+    if (x == 0.0)
+        return 1.0;
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+double evaluate(Resampler::Kernel kernel, double x)
+{
+    x = std::abs(x);
+
+    switch (kernel) {
+    case Resampler::Kernel::Box:
+        return x < 0.5 ? 1.0 : 0.0;
+    case Resampler::Kernel::Mitchell: {
+        constexpr double B = 1.0 / 3.0;
+        constexpr double C = 1.0 / 3.0;
+        if (x < 1.0)
+            return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0;
+        if (x < 2.0)
+            return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0;
+        return 0.0;
+    }
+    case Resampler::Kernel::Lanczos3:
+    default:
+        return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+}
+
+// Negative lobes can push a channel past its alpha; premultiplied data must
+// not hold such a pixel.
+inline QRgb packPremultiplied(float r, float g, float b, float a)
+{
+    const int alpha = static_cast<int>(std::min(std::max(a + 0.5f, 0.0f), 255.0f));
+    const float limit = static_cast<float>(alpha);
+    const int red = static_cast<int>(std::min(std::max(r + 0.5f, 0.0f), limit));
+    const int green = static_cast<int>(std::min(std::max(g + 0.5f, 0.0f), limit));
+    const int blue = static_cast<int>(std::min(std::max(b + 0.5f, 0.0f), limit));
+    return qRgba(red, green, blue, alpha);
+}
+
+}
+
+QSize Resampler::fitted(const QSize& size, int longSide)
+{
+    const int longest = std::max(size.width(), size.height());
+    if (longSide <= 0 || longest <= longSide)
+        return size;
+
+    const double factor = static_cast<double>(longSide) / longest;
+    return QSize(std::max(1, qRound(size.width() * factor)),
+                 std::max(1, qRound(size.height() * factor)));
+}
+
+Resampler::Kernel Resampler::defaultKernel(const QSize& from, const QSize& to)
+{
+    const bool enlarging = to.width() > from.width() || to.height() > from.height();
+    return enlarging ? Kernel::Mitchell : Kernel::Lanczos3;
+}
+
+// When shrinking, the kernel is stretched by the scale factor so it averages
+// everything that falls into one output pixel instead of skipping samples.
+Resampler::Weights Resampler::computeWeights(int inSize, int outSize, Kernel kernel)
+{
+    const double scale = static_cast<double>(outSize) / inSize;
+    const double stretch = std::max(1.0, 1.0 / scale);
+    const double radius = support(kernel) * stretch;
+
+    Weights weights;
+    weights.taps = static_cast<int>(std::ceil(radius)) * 2 + 1;
+    weights.first.resize(static_cast<size_t>(outSize));
+    weights.values.assign(static_cast<size_t>(outSize) * weights.taps, 0.0f);
+
+    for (int i = 0; i < outSize; ++i) {
+        const double center = (i + 0.5) / scale;
+        const int begin = std::max(0, static_cast<int>(std::floor(center - radius)));
+        const int end = std::min(inSize, static_cast<int>(std::ceil(center + radius)));
+        const int count = std::min(weights.taps, end - begin);
+
+        // The padded taps of the last samples must still lie inside the
+        // image, so their window starts earlier and the weights move along.
+        const int first = std::min(begin, std::max(0, inSize - weights.taps));
+        float* w = weights.values.data() + static_cast<size_t>(i) * weights.taps + (begin - first);
+        double total = 0.0;
+        for (int k = 0; k < count; ++k) {
+            w[k] = static_cast<float>(evaluate(kernel, (begin + k + 0.5 - center) / stretch));
+            total += w[k];
+        }
+
+        // A box narrower than the pixel pitch can miss every tap; fall back
+        // to the nearest sample.
+        if (total == 0.0) {
+            w[std::clamp(static_cast<int>(center) - begin, 0, std::max(0, count - 1))] = 1.0f;
+            total = 1.0;
+        }
+
+        for (int k = 0; k < count; ++k)
+            w[k] = static_cast<float>(w[k] / total);
+
+        weights.first[static_cast<size_t>(i)] = first;
+    }
+
+    return weights;
+}
+
+void Resampler::resizeHorizontal(const QImage& in, QImage& out, const Weights& weights)
+{
+    const int width = out.width();
+    const int taps = std::min(weights.taps, in.width());
+
+    ParallelFor::run(out.height(), [&](int begin, int end) {
+        // Widening the row to float once keeps the tap loop to one
+        // four-lane multiply-add per tap.
+        std::vector<float> row(static_cast<size_t>(in.width()) * 4);
+
+        for (int y = begin; y < end; ++y) {
+            const uchar* src = in.constScanLine(y);
+            for (size_t i = 0; i < row.size(); ++i)
+                row[i] = src[i];
+
+            QRgb* dst = reinterpret_cast<QRgb*>(out.scanLine(y));
+
+            for (int x = 0; x < width; ++x) {
+                const float* p = row.data() + weights.first[static_cast<size_t>(x)] * 4;
+                const float* w = weights.values.data() + static_cast<size_t>(x) * weights.taps;
+
+                // Byte order of QRgb in memory is B, G, R, A on little endian.
+                float b = 0.0f, g = 0.0f, r = 0.0f, a = 0.0f;
+                for (int k = 0; k < taps; ++k) {
+                    b += w[k] * p[k * 4];
+                    g += w[k] * p[k * 4 + 1];
+                    r += w[k] * p[k * 4 + 2];
+                    a += w[k] * p[k * 4 + 3];
+                }
+                dst[x] = packPremultiplied(r, g, b, a);
+            }
+        }
+    }, 8);
+}
+
+void Resampler::resizeVertical(const QImage& in, QImage& out, const Weights& weights)
+{
+    const int channels = out.width() * 4;
+    const int taps = std::min(weights.taps, in.height());
+
+    ParallelFor::run(out.height(), [&](int begin, int end) {
+        std::vector<float> acc(static_cast<size_t>(channels));
+
+        for (int y = begin; y < end; ++y) {
+            const int first = weights.first[static_cast<size_t>(y)];
+            const float* w = weights.values.data() + static_cast<size_t>(y) * weights.taps;
+
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int k = 0; k < taps; ++k) {
+                if (w[k] == 0.0f)
+                    continue;
+                const uchar* src = in.constScanLine(first + k);
+                const float weight = w[k];
+                for (int i = 0; i < channels; ++i)
+                    acc[static_cast<size_t>(i)] += weight * src[i];
+            }
+
+            QRgb* dst = reinterpret_cast<QRgb*>(out.scanLine(y));
+            for (int x = 0; x < out.width(); ++x) {
+                const float* a = acc.data() + x * 4;
+                dst[x] = packPremultiplied(a[2], a[1], a[0], a[3]);
+            }
+        }
+    }, 8);
+}
+
+QImage Resampler::resize(const QImage& image, const QSize& size, Kernel kernel)
+{
+    if (image.isNull() || size.isEmpty())
+        return QImage();
+    if (image.size() == size)
+        return image;
+
+    ProfileScope scope("image", "Resampler::resize",
+                       static_cast<qint64>(size.width()) * size.height());
+
+    const QImage source = image.format() == QImage::Format_ARGB32_Premultiplied
+                              ? image
+                              : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    const Weights horizontal = computeWeights(source.width(), size.width(), kernel);
+    const Weights vertical = computeWeights(source.height(), size.height(), kernel);
+
+    // Each pass costs its output pixels times its taps; run the order that
+    // leaves the smaller intermediate.
+    const double horizontalFirst = double(source.height()) * size.width() * horizontal.taps
+                                 + double(size.height()) * size.width() * vertical.taps;
+    const double verticalFirst = double(size.height()) * source.width() * vertical.taps
+                               + double(size.height()) * size.width() * horizontal.taps;
+
+    QImage result(size, QImage::Format_ARGB32_Premultiplied);
+
+    if (source.width() == size.width()) {
+        resizeVertical(source, result, vertical);
+    } else if (source.height() == size.height()) {
+        resizeHorizontal(source, result, horizontal);
+    } else if (horizontalFirst <= verticalFirst) {
+        QImage temp(size.width(), source.height(), QImage::Format_ARGB32_Premultiplied);
+        resizeHorizontal(source, temp, horizontal);
+        resizeVertical(temp, result, vertical);
+    } else {
+        QImage temp(source.width(), size.height(), QImage::Format_ARGB32_Premultiplied);
+        resizeVertical(source, temp, vertical);
+        resizeHorizontal(temp, result, horizontal);
+    }
+
+    scope.addAllocation(result.sizeInBytes());
+    return result;
+}
@@ -0,0 +1,117 @@
+#include "smartsource.h"
+#include "resampler.h"
+#include "profiling/profiler.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <algorithm>
+
+std::shared_ptr<SmartSource> SmartSource::link(const QString& path)
+{
+    auto source = std::shared_ptr<SmartSource>(new SmartSource(path, QByteArray()));
+    return source->isValid() ? source : nullptr;
+}
+
+std::shared_ptr<SmartSource> SmartSource::embed(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    auto source = std::shared_ptr<SmartSource>(new SmartSource(path, file.readAll()));
+    return source->isValid() ? source : nullptr;
+}
+
+SmartSource::SmartSource(QString path, QByteArray data)
+    : m_path(std::move(path)),
+    m_data(std::move(data))
+{
+    QBuffer buffer(&m_data);
+    QImageReader reader;
+    if (isEmbedded())
+        reader.setDevice(&buffer);
+    else
+        reader.setFileName(m_path);
+
+    reader.setAutoTransform(true);
+    const QSize stored = reader.size();
+    if (!stored.isValid())
+        return;
+
+    m_transposed = reader.transformation().testFlag(QImageIOHandler::TransformationRotate90);
+    m_size = m_transposed ? stored.transposed() : stored;
+}
+
+QSize SmartSource::levelSize(const QSize& size, int level)
+{
+    const int d = 1 << level;
+    return QSize(std::max(1, (size.width() + d - 1) / d),
+                 std::max(1, (size.height() + d - 1) / d));
+}
+
+QImage SmartSource::decode(const QSize& size) const
+{
+    if (!isValid())
+        return QImage();
+
+    int level = 0;
+    while (level < 16) {
+        const QSize next = levelSize(m_size, level + 1);
+        if (next.width() < size.width() || next.height() < size.height()
+            || next == levelSize(m_size, level))
+            break;
+        ++level;
+    }
+
+    if (level == m_levelIndex)
+        return m_level;
+
+    const QSize target = levelSize(m_size, level);
+    ProfileScope scope("image", "SmartSource::decode",
+                       static_cast<qint64>(target.width()) * target.height());
+
+    // A finer level already in memory is cheaper to reduce than the file is
+    // to decode again.
+    QImage decoded = (m_levelIndex >= 0 && m_levelIndex < level)
+                     ? Resampler::resize(m_level, target, Resampler::Kernel::Box)
+                     : read(level == 0 ? QSize() : target);
+    if (decoded.isNull())
+        return QImage();
+
+    if (decoded.size() != target)
+        decoded = Resampler::resize(decoded, target, Resampler::Kernel::Box);
+
+    scope.addAllocation(decoded.sizeInBytes());
+    m_level = decoded;
+    m_levelIndex = level;
+    return m_level;
+}
+
+QImage SmartSource::full() const
+{
+    if (m_levelIndex == 0)
+        return m_level;
+    return read(QSize());
+}
+
+QImage SmartSource::read(const QSize& scaledSize) const
+{
+    QByteArray data = m_data;
+    QBuffer buffer(&data);
+    QImageReader reader;
+    if (isEmbedded())
+        reader.setDevice(&buffer);
+    else
+        reader.setFileName(m_path);
+
+    reader.setAutoTransform(true);
+    // The reader scales before it applies the file's orientation.
+    if (scaledSize.isValid())
+        reader.setScaledSize(m_transposed ? scaledSize.transposed() : scaledSize);
+
+    const QImage image = reader.read();
+    if (image.isNull())
+        return image;
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
@@ -0,0 +1,51 @@
+#ifndef SMARTSOURCE_H
+#define SMARTSOURCE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <memory>
+
+// The image behind a smart layer: a linked file, or the file's encoded bytes
+// embedded in the document. Pixels are decoded at the resolution asked for
+// and only one pyramid level is kept, so a photo placed as a thumbnail costs
+// a thumbnail's worth of memory.
+class SmartSource
+{
+public:
+    static std::shared_ptr<SmartSource> link(const QString& path);
+    static std::shared_ptr<SmartSource> embed(const QString& path);
+
+    const QString& path() const { return m_path; }
+    bool isEmbedded() const { return !m_data.isEmpty(); }
+    bool isValid() const { return m_size.isValid(); }
+
+    // Full-resolution size after the file's own orientation is applied.
+    QSize size() const { return m_size; }
+
+    // The smallest power-of-two reduction of the image that still covers
+    // size in both directions. JPEG sources decode such levels directly
+    // from reduced DCT blocks.
+    QImage decode(const QSize& size) const;
+
+    // Decodes the whole image; not cached.
+    QImage full() const;
+
+    static QSize levelSize(const QSize& size, int level);
+
+private:
+    SmartSource(QString path, QByteArray data);
+
+    QImage read(const QSize& scaledSize) const;
+
+    QString m_path;
+    QByteArray m_data;
+    QSize m_size;
+    bool m_transposed {false};
+
+    mutable QImage m_level;
+    mutable int m_levelIndex {-1};
+};
+
+#endif // SMARTSOURCE_H
@@ -1,7 +1,10 @@
 #include "layer.h"
+#include "image/imagetransform.h"
+#include "image/resampler.h"
 
 #include <QtGlobal>
 #include <algorithm>
+#include <atomic>
 
 
 Layer::Layer(QString name, bool visible, float opacity)
@@ -14,22 +17,92 @@ const QString& Layer::name() const { return m_name; }
 void Layer::setName(const QString& name) { m_name = name; }
 
 bool Layer::isVisible() const { return m_visible; }
-void Layer::setVisible(bool visible) { m_visible = visible; }
+void Layer::setVisible(bool visible) { m_visible = visible; touch(); }
 
 float Layer::opacity() const { return m_opacity; }
 void Layer::setOpacity(float opacity) {
     m_opacity = qBound(0.0f, opacity, 1.0f);
+    touch();
 }
 
 BlendMode Layer::blendMode() const { return m_blendMode; }
-void Layer::setBlendMode(BlendMode mode) { m_blendMode = mode; }
+void Layer::setBlendMode(BlendMode mode) { m_blendMode = mode; touch(); }
+
+quint64 Layer::contentKey() const {
+    quint64 key = combineKeys(reinterpret_cast<quintptr>(this), m_revision);
+    key = combineKeys(key, reinterpret_cast<quintptr>(m_mask.get()));
+    return combineKeys(key, m_mask ? static_cast<quint64>(m_mask->revision()) : 0);
+}
+
+quint64 Layer::nextRevision() {
+    static std::atomic<quint64> counter {0};
+    return ++counter;
+}
+
+quint64 Layer::combineKeys(quint64 key, quint64 value) {
+    value *= 0x9e3779b97f4a7c15ull;
+    value ^= value >> 32;
+    return (key ^ value) * 0xbf58476d1ce4e5b9ull + 1;
+}
+
+
+QPointF PlacedLayer::offset() const {
+    return m_offset;
+}
+
+void PlacedLayer::setOffset(const QPointF& p) {
+    m_offset = p;
+    touch();
+}
+
+float PlacedLayer::scale() const {
+    return m_scale;
+}
+
+void PlacedLayer::setScale(float s) {
+    m_scale = std::max(0.01f, s);
+    touch();
+}
+
+const QTransform& PlacedLayer::transform() const {
+    return m_transform;
+}
+
+void PlacedLayer::setTransform(const QTransform& transform) {
+    m_transform = QTransform(transform.m11(), transform.m12(), transform.m21(), transform.m22(), 0.0, 0.0);
+    touch();
+}
+
+QTransform PlacedLayer::imageToLayer() const {
+    return ImageTransform::normalized(m_transform, sourceSize());
+}
+
+QSize PlacedLayer::transformedSize() const {
+    const QSize size = sourceSize();
+    if (m_transform.isIdentity() || size.isEmpty())
+        return size;
+    return ImageTransform::mappedSize(m_transform, size);
+}
+
+QSize PlacedLayer::scaledSize(double factor) const {
+    const QSize size = transformedSize();
+    const double s = m_scale * factor;
+    return QSize(std::max(1, qRound(size.width() * s)),
+                 std::max(1, qRound(size.height() * s)));
+}
+
+QRectF PlacedLayer::bounds() const {
+    QSizeF size = transformedSize();
+    size *= m_scale;
+    return QRectF(m_offset, size);
+}
 
 
 PixelLayer::PixelLayer(QString name,
                        const QImage& image,
                        bool visible,
                        float opacity)
-    : Layer(std::move(name), visible, opacity),
+    : PlacedLayer(std::move(name), visible, opacity),
     m_image(image)
 {}
 
@@ -45,26 +118,97 @@ void PixelLayer::setImage(const QImage& image) {
         m_image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
 }
 
-QPointF PixelLayer::offset() const {
-    return m_offset;
+// Painting detaches the image, which gives it a new cache key.
+quint64 PixelLayer::contentKey() const {
+    return combineKeys(PlacedLayer::contentKey(), static_cast<quint64>(m_image.cacheKey()));
 }
 
-void PixelLayer::setOffset(const QPointF& p) {
-    m_offset = p;
+const QImage& PixelLayer::proxy(const QSize& size) const {
+    if (m_image.isNull())
+        return m_image;
+    if (m_proxyKey == m_image.cacheKey() && m_proxy.size() == size)
+        return m_proxy;
+
+    const QImage proxy = Resampler::resize(m_image, size, Resampler::Kernel::Box);
+    m_proxy = proxy;
+    m_proxyKey = m_image.cacheKey();
+    return m_proxy;
 }
 
-float PixelLayer::scale() const {
-    return m_scale;
+// Reduced canvases draw from the area-averaged proxy, which is cheap to
+// build and good enough for previews and statistics.
+QImage PixelLayer::rendered(double factor) const {
+    if (factor >= 1.0 || m_image.isNull())
+        return scaledImage();
+
+    const double s = factor * scale();
+    const QSize size(std::max(1, qRound(m_image.width() * s)),
+                     std::max(1, qRound(m_image.height() * s)));
+    return ImageTransform::apply(proxy(size), transform());
 }
 
-void PixelLayer::setScale(float s) {
-    m_scale = std::max(0.01f, s);
+const QImage& PixelLayer::transformedImage() const {
+    if (transform().isIdentity())
+        return m_image;
+
+    if (m_transformedKey != m_image.cacheKey() || m_transformedFor != transform()) {
+        m_transformed = ImageTransform::apply(m_image, transform());
+        m_transformedKey = m_image.cacheKey();
+        m_transformedFor = transform();
+    }
+    return m_transformed;
 }
 
-QRectF PixelLayer::bounds() const {
-    QSizeF size = m_image.size();
-    size *= m_scale;
-    return QRectF(m_offset, size);
+const QImage& PixelLayer::scaledImage() const {
+    const QImage& source = transformedImage();
+    const QSize size = scaledSize();
+    if (source.isNull() || size == source.size())
+        return source;
+
+    if (m_scaledKey != source.cacheKey() || m_scaled.size() != size) {
+        m_scaled = Resampler::resize(source, size, Resampler::defaultKernel(source.size(), size));
+        m_scaledKey = source.cacheKey();
+    }
+    return m_scaled;
+}
+
+
+SmartLayer::SmartLayer(QString name,
+                       std::shared_ptr<SmartSource> source,
+                       bool visible,
+                       float opacity)
+    : PlacedLayer(std::move(name), visible, opacity),
+    m_source(std::move(source))
+{}
+
+QSize SmartLayer::sourceSize() const {
+    return m_source ? m_source->size() : QSize();
+}
+
+// Resamples in source orientation so that the pyramid level can be picked
+// against the unrotated size, then orients the small result.
+QImage SmartLayer::rendered(double factor) const {
+    if (!m_source || sourceSize().isEmpty())
+        return QImage();
+
+    const double s = factor * scale();
+    const QSize size(std::max(1, qRound(sourceSize().width() * s)),
+                     std::max(1, qRound(sourceSize().height() * s)));
+
+    if (!m_rendered.isNull() && m_renderedSize == size && m_renderedFor == transform())
+        return m_rendered;
+
+    const QImage level = m_source->decode(size);
+    if (level.isNull())
+        return QImage();
+
+    const QImage resized = level.size() == size
+                           ? level
+                           : Resampler::resize(level, size, Resampler::defaultKernel(level.size(), size));
+    m_rendered = ImageTransform::apply(resized, transform());
+    m_renderedSize = size;
+    m_renderedFor = transform();
+    return m_rendered;
 }
 
 
@@ -82,6 +226,7 @@ LayerType AdjustmentLayer::type() const
 
 FilterPipeline& AdjustmentLayer::pipeline()
 {
+    touch();
     return m_pipeline;
 }
 
@@ -109,4 +254,46 @@ QRectF AdjustmentLayer::bounds() const
 }
 
 
+GroupLayer::GroupLayer(QString name,
+                       std::vector<std::shared_ptr<Layer>> layers,
+                       bool visible,
+                       float opacity)
+    : Layer(std::move(name), visible, opacity),
+    m_layers(std::move(layers))
+{
+}
 
+void GroupLayer::setLayers(std::vector<std::shared_ptr<Layer>> layers)
+{
+    m_layers = std::move(layers);
+    touch();
+}
+
+void GroupLayer::setPassThrough(bool passThrough)
+{
+    m_passThrough = passThrough;
+    touch();
+}
+
+quint64 GroupLayer::childrenKey() const
+{
+    quint64 key = m_layers.size();
+    for (const auto& layer : m_layers)
+        key = combineKeys(key, layer ? layer->contentKey() : 0);
+    return key;
+}
+
+quint64 GroupLayer::contentKey() const
+{
+    return combineKeys(Layer::contentKey(), childrenKey());
+}
+
+QRectF GroupLayer::bounds() const
+{
+    QRectF united;
+    for (const auto& layer : m_layers) {
+        if (layer && layer->isVisible())
+            united = united.united(layer->bounds());
+    }
+    return united;
+}
@@ -5,7 +5,12 @@
 #include <QString>
 #include <QPointF>
 #include <QRectF>
+#include <QTransform>
 #include "pipeline/filterpipeline.h"
+#include "image/smartsource.h"
+#include "layers/layermask.h"
+#include <memory>
+#include <vector>
 
 enum class BlendMode {
     Normal,
@@ -16,7 +21,9 @@ enum class BlendMode {
 
 enum class LayerType {
     Pixel,
-    Adjustment
+    Adjustment,
+    Smart,
+    Group
 };
 
 class Layer
@@ -38,22 +45,80 @@ public:
     void setBlendMode(BlendMode mode);
 
     bool isClipped() const { return m_clipped; }
-    void setClipped(bool v) { m_clipped = v; }
+    void setClipped(bool v) { m_clipped = v; touch(); }
+
+    // Optional mask in document coordinates; layers do not carry it along
+    // when they move.
+    const std::shared_ptr<LayerMask>& mask() const { return m_mask; }
+    void setMask(std::shared_ptr<LayerMask> mask) { m_mask = std::move(mask); touch(); }
 
     virtual QRectF bounds() const = 0;
 
     virtual LayerType type() const = 0;
 
+    // Changes whenever anything that affects how the layer draws changes,
+    // so that cached group renders know when to redraw.
+    virtual quint64 contentKey() const;
+
+    static quint64 combineKeys(quint64 key, quint64 value);
+
+protected:
+    void touch() { m_revision = nextRevision(); }
+
 private:
     QString   m_name;
     bool      m_visible;
     float     m_opacity;
     bool      m_clipped = false;
     BlendMode m_blendMode { BlendMode::Normal };
+    std::shared_ptr<LayerMask> m_mask;
+    // Drawn from one counter for all layers, so a layer allocated where a
+    // deleted one lived cannot repeat that layer's contentKey().
+    quint64   m_revision {nextRevision()};
+
+    static quint64 nextRevision();
+};
+
+
+// A layer that draws a block of pixels onto the canvas at an offset, with a
+// uniform scale and an orientation. Subclasses only provide the pixels.
+class PlacedLayer : public Layer
+{
+public:
+    using Layer::Layer;
+
+    // Unoriented size of the pixels at scale 1.
+    virtual QSize sourceSize() const = 0;
+
+    // The pixels oriented by transform() and resampled to their size on a
+    // canvas drawn at factor times document resolution.
+    virtual QImage rendered(double factor = 1.0) const = 0;
+
+    QPointF offset() const;
+    void setOffset(const QPointF& p);
+
+    float scale() const;
+    void setScale(float s);
+
+    // Orientation of the pixels inside the layer: rotation, mirroring or any
+    // other linear map. Only the linear part counts; the transformed image
+    // always starts at the layer's offset.
+    const QTransform& transform() const;
+    void setTransform(const QTransform& transform);
+    QTransform imageToLayer() const;
+    QSize transformedSize() const;
+    QSize scaledSize(double factor = 1.0) const;
+
+    QRectF bounds() const override;
+
+private:
+    QTransform m_transform;
+    QPointF m_offset { 0.0, 0.0 };
+    float   m_scale  { 1.0f };
 };
 
 
-class PixelLayer final : public Layer
+class PixelLayer final : public PlacedLayer
 {
 public:
     PixelLayer(QString name,
@@ -67,19 +132,54 @@ public:
     QImage& image();
     void setImage(const QImage& image);
 
-    QPointF offset() const;
-    void setOffset(const QPointF& p);
+    // Area-averaged copy of image() at the given size, kept until the image
+    // is next modified.
+    const QImage& proxy(const QSize& size) const;
 
-    float scale() const;
-    void setScale(float s);
+    QSize sourceSize() const override { return m_image.size(); }
+    QImage rendered(double factor = 1.0) const override;
 
-    QRectF bounds() const;
+    quint64 contentKey() const override;
+
+    // image() resampled through transform(), kept until either changes.
+    const QImage& transformedImage() const;
+    // transformedImage() resampled to the size it covers on the canvas.
+    const QImage& scaledImage() const;
 
 private:
     QImage  m_image;
+    mutable QImage m_proxy;
+    mutable qint64 m_proxyKey {0};
+    mutable QImage m_transformed;
+    mutable qint64 m_transformedKey {0};
+    mutable QTransform m_transformedFor;
+    mutable QImage m_scaled;
+    mutable qint64 m_scaledKey {0};
+};
 
-    QPointF m_offset { 0.0, 0.0 };
-    float   m_scale  { 1.0f };
+
+// Places an image that is decoded on demand instead of held at full
+// resolution, so a layer shown small costs only the pixels it shows.
+class SmartLayer final : public PlacedLayer
+{
+public:
+    SmartLayer(QString name,
+               std::shared_ptr<SmartSource> source,
+               bool visible = true,
+               float opacity = 1.0f);
+
+    LayerType type() const override { return LayerType::Smart; }
+
+    const std::shared_ptr<SmartSource>& source() const { return m_source; }
+
+    QSize sourceSize() const override;
+    QImage rendered(double factor = 1.0) const override;
+
+private:
+    std::shared_ptr<SmartSource> m_source;
+    mutable QImage m_rendered;
+    mutable QSize m_renderedSize;
+    mutable QTransform m_renderedFor;
 };
 
 
@@ -91,6 +191,7 @@ public:
 
     LayerType type() const override;
 
+    // Non-const access counts as a change to the pipeline.
     FilterPipeline& pipeline();
     const FilterPipeline& pipeline() const;
     const QImage& cachedProcess(const QImage& input) const;
@@ -107,5 +208,40 @@ private:
 };
 
 
+// A stack of layers composited as one. An isolated group flattens its
+// children onto a surface of its own, cached until one of them changes, and
+// draws that with its opacity, blend mode and mask. A pass-through group
+// draws its children straight onto what lies below, with its opacity
+// folded into theirs.
+class GroupLayer final : public Layer
+{
+public:
+    explicit GroupLayer(QString name,
+                        std::vector<std::shared_ptr<Layer>> layers = {},
+                        bool visible = true,
+                        float opacity = 1.0f);
+
+    LayerType type() const override { return LayerType::Group; }
+
+    // Bottom to top, like LayerManager::layers().
+    const std::vector<std::shared_ptr<Layer>>& layers() const { return m_layers; }
+    void setLayers(std::vector<std::shared_ptr<Layer>> layers);
+
+    bool isPassThrough() const { return m_passThrough; }
+    void setPassThrough(bool passThrough);
+
+    // Covers the children only: the group's own opacity, blend mode and
+    // mask apply on top of the cached render.
+    quint64 childrenKey() const;
+    quint64 contentKey() const override;
+
+    QRectF bounds() const override;
+
+private:
+    std::vector<std::shared_ptr<Layer>> m_layers;
+    bool m_passThrough {false};
+};
+
+
 
 #endif // LAYER_H
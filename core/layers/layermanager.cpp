@@ -1,19 +1,20 @@
 #include "layermanager.h"
+#include "render/layernodes.h"
+#include "profiling/profiler.h"
 
 #include <QPainter>
 #include <QPoint>
 #include <QDebug>
 #include <algorithm>
+#include <utility>
 
 namespace {
-QPainter::CompositionMode toQtMode(BlendMode mode)
+QSize scaledCanvas(const QSize& size, double factor)
 {
-    switch (mode) {
-    case BlendMode::Multiply: return QPainter::CompositionMode_Multiply;
-    case BlendMode::Screen:   return QPainter::CompositionMode_Screen;
-    case BlendMode::Overlay:  return QPainter::CompositionMode_Overlay;
-    default:                  return QPainter::CompositionMode_SourceOver;
-    }
+    if (factor >= 1.0)
+        return size;
+    return QSize(std::max(1, qRound(size.width() * factor)),
+                 std::max(1, qRound(size.height() * factor)));
 }
 }
 
@@ -69,6 +70,16 @@ std::shared_ptr<Layer> LayerManager::removeLayer(int index)
     return removed;
 }
 
+std::shared_ptr<Layer> LayerManager::replaceLayer(int index, const std::shared_ptr<Layer>& layer)
+{
+    if (!layer || index < 0 || index >= layerCount())
+        return nullptr;
+
+    auto replaced = std::exchange(m_layers[static_cast<size_t>(index)], layer);
+    notifyChanged();
+    return replaced;
+}
+
 bool LayerManager::moveLayer(int from, int to)
 {
     if (from < 0 || from >= layerCount() || to < 0 || to >= layerCount() || from == to)
@@ -85,6 +96,64 @@ bool LayerManager::moveLayer(int from, int to)
     return true;
 }
 
+int LayerManager::groupLayers(int first, int count, const std::shared_ptr<GroupLayer>& group)
+{
+    if (!group || first < 0 || count < 1 || first + count > layerCount())
+        return -1;
+
+    const auto begin = m_layers.begin() + first;
+    group->setLayers(std::vector<std::shared_ptr<Layer>>(begin, begin + count));
+    m_layers.erase(begin + 1, begin + count);
+    m_layers[static_cast<size_t>(first)] = group;
+
+    if (m_activeLayerIndex >= first + count)
+        m_activeLayerIndex -= count - 1;
+    else if (m_activeLayerIndex >= first)
+        m_activeLayerIndex = first;
+
+    notifyChanged();
+    return first;
+}
+
+std::shared_ptr<GroupLayer> LayerManager::ungroupLayer(int index)
+{
+    auto group = std::dynamic_pointer_cast<GroupLayer>(layerAt(index));
+    if (!group)
+        return nullptr;
+
+    const std::vector<std::shared_ptr<Layer>> children = group->layers();
+    group->setLayers({});
+    m_layers.erase(m_layers.begin() + index);
+    m_layers.insert(m_layers.begin() + index, children.begin(), children.end());
+
+    const int count = static_cast<int>(children.size());
+    if (m_activeLayerIndex > index)
+        m_activeLayerIndex += count - 1;
+    else if (m_activeLayerIndex == index)
+        m_activeLayerIndex = index + std::max(0, count - 1);
+    clampActiveIndex();
+
+    notifyChanged();
+    return group;
+}
+
+std::vector<std::shared_ptr<Layer>> LayerManager::allLayers() const
+{
+    std::vector<std::shared_ptr<Layer>> all;
+    std::function<void(const std::vector<std::shared_ptr<Layer>>&)> collect =
+        [&](const std::vector<std::shared_ptr<Layer>>& layers) {
+            for (const auto& layer : layers) {
+                if (!layer)
+                    continue;
+                if (auto group = std::dynamic_pointer_cast<GroupLayer>(layer))
+                    collect(group->layers());
+                all.push_back(layer);
+            }
+        };
+    collect(m_layers);
+    return all;
+}
+
 void LayerManager::setCanvasSize(const QSize& size)
 {
     m_canvasSize = size;
@@ -96,6 +165,18 @@ QSize LayerManager::canvasSize() const
     return m_canvasSize;
 }
 
+void LayerManager::setCanvasRect(const QRect& rect)
+{
+    m_canvasOrigin = rect.topLeft();
+    m_canvasSize = rect.size();
+    notifyChanged();
+}
+
+QRect LayerManager::canvasRect() const
+{
+    return QRect(m_canvasOrigin, m_canvasSize);
+}
+
 int LayerManager::activeLayerIndex() const
 {
     return m_activeLayerIndex;
@@ -144,59 +225,12 @@ bool LayerManager::isPainting() const
     return m_isPainting;
 }
 
-static QColor applyBlendMode(const QColor& base, const QColor& blend, BlendMode mode)
-{
-    auto f = [](float v) { return std::clamp(v, 0.0f, 1.0f); };
-
-    float bR = base.redF(),   bG = base.greenF(), bB = base.blueF();
-    float aR = blend.redF(),  aG = blend.greenF(), aB = blend.blueF();
-
-    float r, g, b;
-
-    switch (mode) {
-    case BlendMode::Multiply:
-        r = bR * aR; g = bG * aG; b = bB * aB;
-        break;
-    case BlendMode::Screen:
-        r = 1.0f - (1.0f - bR) * (1.0f - aR);
-        g = 1.0f - (1.0f - bG) * (1.0f - aG);
-        b = 1.0f - (1.0f - bB) * (1.0f - aB);
-        break;
-    case BlendMode::Overlay:
-        r = (bR < 0.5f) ? (2.0f * bR * aR) : (1.0f - 2.0f * (1.0f - bR) * (1.0f - aR));
-        g = (bG < 0.5f) ? (2.0f * bG * aG) : (1.0f - 2.0f * (1.0f - bG) * (1.0f - aG));
-        b = (bB < 0.5f) ? (2.0f * bB * aB) : (1.0f - 2.0f * (1.0f - bB) * (1.0f - aB));
-        break;
-    default:
-        r = aR; g = aG; b = aB;
-        break;
-    }
-
-    return QColor::fromRgbF(f(r), f(g), f(b), base.alphaF());
-}
-
-static float lerp(float a, float b, float t) { return a + (b - a) * t; }
-
-static QRgb blendPixel(QRgb base, QRgb adj, float opacity, BlendMode mode)
+QImage LayerManager::composite() const
 {
-    float a = qAlpha(base) / 255.0f;
-    if (a == 0.0f)
-        return base;
-
-    QColor cb(base);
-    QColor ca(adj);
-    QColor blended = applyBlendMode(cb, ca, mode);
-
-    QColor out;
-    out.setRedF(   lerp(cb.redF(),   blended.redF(),   opacity) );
-    out.setGreenF( lerp(cb.greenF(), blended.greenF(), opacity) );
-    out.setBlueF(  lerp(cb.blueF(),  blended.blueF(),  opacity) );
-    out.setAlphaF(a);
-
-    return out.rgba();
+    return compositeUpTo(layerCount());
 }
 
-QImage LayerManager::composite() const
+QImage LayerManager::compositeUpTo(int end, int longSide) const
 {
     if (m_layers.empty())
         return QImage();
@@ -204,123 +238,111 @@ QImage LayerManager::composite() const
     if (!m_canvasSize.isValid())
         return QImage();
 
+    const auto last = m_layers.begin() + std::clamp(end, 0, layerCount());
 
-    QImage result(m_canvasSize, m_format);
-    result.fill(Qt::transparent);
-    m_compositeOffset = QPointF(0, 0);
+    double factor = 1.0;
+    const int canvasLongSide = std::max(m_canvasSize.width(), m_canvasSize.height());
+    if (longSide > 0 && canvasLongSide > longSide)
+        factor = static_cast<double>(longSide) / canvasLongSide;
+    const QRect canvas(QPoint(0, 0), scaledCanvas(m_canvasSize, factor));
 
-    QPainter painter(&result);
-    painter.setClipRect(QRect(0, 0, m_canvasSize.width(), m_canvasSize.height()));
+    ProfileScope scope("layers", "LayerManager::composite",
+                       static_cast<qint64>(canvas.width()) * canvas.height());
 
-    bool hasPending = false;
-    QImage pendingImg;
-    float pendingOpacity = 1.0f;
-    BlendMode pendingBlend = BlendMode::Normal;
-    QPointF pendingOffset;
-    float pendingScale = 1.0f;
+    m_compositeOffset = QPointF(m_canvasOrigin);
 
-    auto flushPending = [&]() {
-        if (!hasPending) return;
+    const RenderNode::Ptr output = buildGraph(m_layers.begin(), last, std::make_shared<EmptyNode>(),
+                                              1.0f, factor, canvas, false);
+    RenderGraph graph(factor < 1.0 ? m_proxyCache : m_renderCache);
+    QImage result = graph.render(output, canvas);
+    if (result.format() != m_format)
+        result = result.convertToFormat(m_format);
 
-        painter.save();
-        painter.setOpacity(pendingOpacity);
-        painter.setCompositionMode(toQtMode(pendingBlend));
-        painter.translate(pendingOffset);
-        painter.scale(pendingScale, pendingScale);
-        painter.drawImage(QPoint(0, 0), pendingImg);
-        painter.restore();
+    return result;
+}
 
-        hasPending = false;
-    };
+// Mirrors the stack: every drawn layer blends onto what lies below it, after
+// its mask and any adjustments clipped to it. Isolated groups are cached
+// stages of their own, and so is the composite below the active layer,
+// which stays valid while that layer is edited. Layers are drawn one after
+// another; the graph renders the output tiles in parallel.
+RenderNode::Ptr LayerManager::buildGraph(LayerIterator first, LayerIterator last, RenderNode::Ptr base,
+                                         float opacity, double factor, const QRect& canvas, bool isolated) const
+{
+    const Layer* active = layerAt(m_activeLayerIndex).get();
+
+    RenderNode::Ptr pending;
+    const Layer* pendingLayer = nullptr;
 
-    const bool painting = m_isPainting;
+    auto flushPending = [&]() {
+        if (!pending) return;
+        if (const LayerMask* mask = pendingLayer->mask().get())
+            pending = std::make_shared<MaskNode>(pending, *mask, factor, m_canvasOrigin);
+        base = std::make_shared<BlendNode>(base, pending, pendingLayer->opacity() * opacity,
+                                           pendingLayer->blendMode());
+        pending.reset();
+    };
 
-    for (auto it = m_layers.begin(); it != m_layers.end(); ++it)
+    for (auto it = first; it != last; ++it)
     {
         const auto& layer = *it;
         if (!layer || !layer->isVisible())
             continue;
 
-        if (layer->type() == LayerType::Pixel)
+        if (layer->type() == LayerType::Adjustment)
         {
-            flushPending();
-
-            auto pixel = std::static_pointer_cast<PixelLayer>(layer);
-
-
-
-            bool willBeClipped = false;
-            for (auto it2 = std::next(it); it2 != m_layers.end(); ++it2) {
-                const auto& next = *it2;
-                if (!next || !next->isVisible())
-                    continue;
-                if (next->type() == LayerType::Pixel)
-                    break;
-                if (next->type() == LayerType::Adjustment &&
-                    std::static_pointer_cast<AdjustmentLayer>(next)->isClipped())
-                    willBeClipped = true;
-            }
-
-            pendingImg     = (!painting && willBeClipped)
-                             ? pixel->image().copy()
-                             : pixel->image();
-            pendingOpacity = pixel->opacity();
-            pendingBlend   = pixel->blendMode();
-            pendingOffset  = pixel->offset();
-            pendingScale   = pixel->scale();
-            hasPending = true;
-        }
-        else if (layer->type() == LayerType::Adjustment)
-        {
-            if (painting) {
+            if (m_isPainting) {
                 flushPending();
                 continue;
             }
 
-            auto adj = std::static_pointer_cast<AdjustmentLayer>(layer);
-
-            if (adj->isClipped())
-            {
-                if (!hasPending) continue;
+            const auto& adj = static_cast<const AdjustmentLayer&>(*layer);
+            const LayerMask* mask = adj.mask().get();
 
-                QPointF savedOffset = pendingOffset;
-                float savedScale = pendingScale;
-
-                QImage adjusted = adj->pipeline().process(pendingImg);
-
-                for (int y = 0; y < pendingImg.height(); ++y) {
-                    const QRgb* src = reinterpret_cast<const QRgb*>(pendingImg.constScanLine(y));
-                    QRgb* dst = reinterpret_cast<QRgb*>(adjusted.scanLine(y));
-                    for (int x = 0; x < pendingImg.width(); ++x)
-                        dst[x] = qRgba(qRed(dst[x]), qGreen(dst[x]), qBlue(dst[x]), qAlpha(src[x]));
-                }
-
-                pendingImg = std::move(adjusted);
-                pendingOffset = savedOffset;
-                pendingScale = savedScale;
-            }
-            else
-            {
+            if (adj.isClipped()) {
+                if (!pending) continue;
+                auto adjusted = std::make_shared<AdjustNode>(std::make_shared<OpaqueNode>(pending), adj,
+                                                             m_workingSpace);
+                pending = std::make_shared<ClipNode>(pending, adjusted, mask, factor, m_canvasOrigin);
+            } else {
                 flushPending();
+                auto adjusted = std::make_shared<AdjustNode>(base, adj, m_workingSpace,
+                                                             isolated ? QRect() : canvas);
+                base = std::make_shared<AdjustBlendNode>(base, adjusted, adj.opacity() * opacity,
+                                                         adj.blendMode(), mask, factor, m_canvasOrigin);
+            }
+            continue;
+        }
 
-                QImage adjusted = adj->pipeline().process(result);
+        flushPending();
+        if (layer.get() == active)
+            base->setCached(true);
 
-                for (int y = 0; y < result.height(); ++y) {
-                    QRgb* b = reinterpret_cast<QRgb*>(result.scanLine(y));
-                    const QRgb* a = reinterpret_cast<const QRgb*>(adjusted.constScanLine(y));
-                    for (int x = 0; x < result.width(); ++x) {
-                        if (qAlpha(b[x]) == 0) continue;
-                        b[x] = blendPixel(b[x], a[x], adj->opacity(), adj->blendMode());
-                    }
-                }
+        if (layer->type() == LayerType::Group) {
+            const auto& group = static_cast<const GroupLayer&>(*layer);
+            if (group.isPassThrough() && !group.mask()) {
+                base = buildGraph(group.layers().begin(), group.layers().end(), base,
+                                  opacity * group.opacity(), factor, canvas, isolated);
+                continue;
             }
+            pending = buildGraph(group.layers().begin(), group.layers().end(), std::make_shared<EmptyNode>(),
+                                 1.0f, factor, canvas, true);
+            pending->setCached(true);
+        } else {
+            pending = std::make_shared<LayerNode>(static_cast<const PlacedLayer&>(*layer), factor,
+                                                  m_canvasOrigin, canvas);
         }
+        pendingLayer = layer.get();
     }
 
     flushPending();
+    return base;
+}
 
-
-    return result;
+void LayerManager::clearRenderCache()
+{
+    m_renderCache.clear();
+    m_proxyCache.clear();
 }
 
 void LayerManager::markDirty()
@@ -328,6 +350,20 @@ void LayerManager::markDirty()
     m_dirty = true;
 }
 
+void LayerManager::setWorkingSpace(WorkingSpace space)
+{
+    if (m_workingSpace == space)
+        return;
+
+    m_workingSpace = space;
+    m_dirty = true;
+}
+
+WorkingSpace LayerManager::workingSpace() const
+{
+    return m_workingSpace;
+}
+
 void LayerManager::notifyChanged()
 {
     m_dirty = true;
@@ -9,6 +9,8 @@
 #include <QPainter>
 
 #include "layer.h"
+#include "color/linearlight.h"
+#include "render/rendergraph.h"
 
 class LayerManager
 {
@@ -23,11 +25,29 @@ public:
 
     int addLayer(const std::shared_ptr<Layer> &layer, int index = -1);
     std::shared_ptr<Layer> removeLayer(int index);
+    // Puts layer in place of the one at index and returns the old one.
+    std::shared_ptr<Layer> replaceLayer(int index, const std::shared_ptr<Layer> &layer);
     bool moveLayer(int from, int to);
 
+    // Moves layers [first, first + count) into group, which takes their
+    // place, and returns the group's index.
+    int groupLayers(int first, int count, const std::shared_ptr<GroupLayer> &group);
+    // Puts the children of the group at index in its place and returns the
+    // emptied group.
+    std::shared_ptr<GroupLayer> ungroupLayer(int index);
+    // Every layer, including those inside groups, bottom to top.
+    std::vector<std::shared_ptr<Layer>> allLayers() const;
+
     void setCanvasSize(const QSize &size);
     QSize canvasSize() const;
 
+    // The window of document space that the canvas shows; layer offsets are
+    // in document space. Cropping only moves this window, so layers keep
+    // their pixels outside it until they are trimmed.
+    void setCanvasRect(const QRect &rect);
+    QRect canvasRect() const;
+    QPoint canvasOrigin() const { return m_canvasOrigin; }
+
     std::shared_ptr<Layer> activeLayer();
     std::shared_ptr<const Layer> activeLayer() const;
 
@@ -40,14 +60,37 @@ public:
     void setOnChanged(ChangeCallback callback);
 
     QImage composite() const;
+    // Composite of the layers below index end. With longSide > 0 the canvas
+    // is scaled down to fit it and pixel layers are drawn from their proxies,
+    // which is enough for statistics and costs little at any canvas size.
+    QImage compositeUpTo(int end, int longSide = 0) const;
 
     void markDirty();
+    // Drops every cached tile; renders normally only redo what changed.
+    void clearRenderCache();
     void notifyChanged();
     void setPainting(bool painting);
     bool isPainting() const;
     QPointF compositeOffset() const { return m_compositeOffset; }
 
+    void setWorkingSpace(WorkingSpace space);
+    WorkingSpace workingSpace() const;
+
 private:
+    using LayerIterator = std::vector<std::shared_ptr<Layer>>::const_iterator;
+
+    // Adds [first, last) on top of base, with every layer's opacity scaled
+    // by opacity, and returns the node for the result. Unclipped
+    // adjustments run over the canvas, or over what lies below them inside
+    // an isolated group.
+    RenderNode::Ptr buildGraph(LayerIterator first, LayerIterator last, RenderNode::Ptr base,
+                               float opacity, double factor, const QRect &canvas, bool isolated) const;
+
+    // Full-size and reduced composites keep separate caches, so that
+    // statistics renders do not evict the canvas tiles.
+    mutable RenderCache m_renderCache;
+    mutable RenderCache m_proxyCache;
+
     mutable bool m_dirty = true;
     mutable QImage m_cachedComposite;
     bool m_isPainting = false;
@@ -55,9 +98,11 @@ private:
     void clampActiveIndex();
     std::vector<std::shared_ptr<Layer>> m_layers;
     QSize m_canvasSize;
+    QPoint m_canvasOrigin;
     QImage::Format m_format;
     int m_activeLayerIndex {-1};
     ChangeCallback m_onChanged {};
+    WorkingSpace m_workingSpace {WorkingSpace::Display8Bit};
 
     mutable QPointF m_compositeOffset;
 };
@@ -0,0 +1,181 @@
+#include "layermask.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+LayerMask::LayerMask(const QRect& rect, uchar fill)
+    : m_rect(rect),
+    m_outside(fill)
+{
+    Tile tile;
+    tile.value = fill;
+    m_tiles.assign(static_cast<size_t>(tilesX()) * tilesY(), tile);
+}
+
+QRect LayerMask::tileRect(int tx, int ty) const
+{
+    return QRect(m_rect.left() + tx * TileSize, m_rect.top() + ty * TileSize, TileSize, TileSize)
+        .intersected(m_rect);
+}
+
+void LayerMask::translate(const QPoint& delta)
+{
+    m_rect.translate(delta);
+    ++m_revision;
+}
+
+uchar LayerMask::value(const QPoint& p) const
+{
+    if (!m_rect.contains(p))
+        return m_outside;
+
+    const int x = p.x() - m_rect.left();
+    const int y = p.y() - m_rect.top();
+    const Tile& tile = m_tiles[static_cast<size_t>((y / TileSize) * tilesX() + x / TileSize)];
+    if (tile.data.empty())
+        return tile.value;
+    return tile.data[static_cast<size_t>((y % TileSize) * TileSize + x % TileSize)];
+}
+
+QImage LayerMask::toImage(const QRect& area) const
+{
+    QImage image(area.size(), QImage::Format_Grayscale8);
+    if (image.isNull())
+        return image;
+
+    forEachBlock(area, [&](const Block& b) {
+        for (int y = b.rect.top(); y <= b.rect.bottom(); ++y) {
+            uchar* dst = image.scanLine(y - area.top()) + (b.rect.left() - area.left());
+            if (b.data)
+                std::memcpy(dst, b.data + (y - b.rect.top()) * b.stride, static_cast<size_t>(b.rect.width()));
+            else
+                std::memset(dst, b.value, static_cast<size_t>(b.rect.width()));
+        }
+    });
+    return image;
+}
+
+QImage LayerMask::surface(const QRect& area) const
+{
+    const QImage gray = toImage(area);
+    QImage image(area.size(), QImage::Format_ARGB32_Premultiplied);
+
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar* src = gray.constScanLine(y);
+        QRgb* dst = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < gray.width(); ++x)
+            dst[x] = qRgb(src[x], src[x], src[x]);
+    }
+    return image;
+}
+
+// Read as composited over black, so that the soft edge of an eraser stroke,
+// which lowers alpha, fades the mask as well.
+QImage LayerMask::paintedValues(const QImage& surface)
+{
+    QImage gray(surface.size(), QImage::Format_Grayscale8);
+
+    for (int y = 0; y < surface.height(); ++y) {
+        const QRgb* src = reinterpret_cast<const QRgb*>(surface.constScanLine(y));
+        uchar* dst = gray.scanLine(y);
+        for (int x = 0; x < surface.width(); ++x)
+            dst[x] = static_cast<uchar>(qGray(src[x]));
+    }
+    return gray;
+}
+
+QImage LayerMask::sampled(const QPointF& topLeft, double step, const QSize& size) const
+{
+    QImage image(size, QImage::Format_Grayscale8);
+    if (image.isNull())
+        return image;
+
+    std::vector<int> xs(static_cast<size_t>(size.width()));
+    for (int x = 0; x < size.width(); ++x)
+        xs[static_cast<size_t>(x)] = static_cast<int>(std::floor(topLeft.x() + (x + 0.5) * step));
+
+    for (int y = 0; y < size.height(); ++y) {
+        const int docY = static_cast<int>(std::floor(topLeft.y() + (y + 0.5) * step));
+        uchar* dst = image.scanLine(y);
+        for (int x = 0; x < size.width(); ++x)
+            dst[x] = value(QPoint(xs[static_cast<size_t>(x)], docY));
+    }
+    return image;
+}
+
+// Edge tiles are allocated whole; only the part inside the mask counts.
+void LayerMask::collapse(Tile& tile, const QSize& used)
+{
+    if (tile.data.empty())
+        return;
+
+    const uchar first = tile.data.front();
+    for (int y = 0; y < used.height(); ++y) {
+        const uchar* row = tile.data.data() + y * TileSize;
+        if (std::any_of(row, row + used.width(), [first](uchar v) { return v != first; }))
+            return;
+    }
+
+    tile.data.clear();
+    tile.data.shrink_to_fit();
+    tile.value = first;
+}
+
+bool LayerMask::write(const QPoint& topLeft, const QImage& gray, const QImage& where)
+{
+    const QRect area = QRect(topLeft, gray.size()).intersected(m_rect);
+    if (area.isEmpty())
+        return false;
+
+    const int tx0 = (area.left() - m_rect.left()) / TileSize;
+    const int tx1 = (area.right() - m_rect.left()) / TileSize;
+    const int ty0 = (area.top() - m_rect.top()) / TileSize;
+    const int ty1 = (area.bottom() - m_rect.top()) / TileSize;
+
+    bool changed = false;
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const QRect tr = tileRect(tx, ty);
+            const QRect r = tr.intersected(area);
+            Tile& tile = m_tiles[static_cast<size_t>(ty * tilesX() + tx)];
+
+            for (int y = r.top(); y <= r.bottom(); ++y) {
+                const uchar* src = gray.constScanLine(y - topLeft.y()) + (r.left() - topLeft.x());
+                const uchar* sel = where.isNull()
+                                   ? nullptr
+                                   : where.constScanLine(y - topLeft.y()) + (r.left() - topLeft.x());
+
+                for (int i = 0; i < r.width(); ++i) {
+                    if (sel && !sel[i])
+                        continue;
+
+                    const size_t at = static_cast<size_t>((y - tr.top()) * TileSize + (r.left() - tr.left()) + i);
+                    const uchar current = tile.data.empty() ? tile.value : tile.data[at];
+                    if (current == src[i])
+                        continue;
+
+                    if (tile.data.empty())
+                        tile.data.assign(static_cast<size_t>(TileSize) * TileSize, tile.value);
+                    tile.data[at] = src[i];
+                    changed = true;
+                }
+            }
+
+            collapse(tile, tr.size());
+        }
+    }
+
+    if (changed)
+        ++m_revision;
+    return changed;
+}
+
+qint64 LayerMask::bytesUsed() const
+{
+    qint64 bytes = static_cast<qint64>(m_tiles.size() * sizeof(Tile));
+    for (const Tile& tile : m_tiles)
+        bytes += static_cast<qint64>(tile.data.capacity());
+    return bytes;
+}
@@ -0,0 +1,128 @@
+#ifndef LAYERMASK_H
+#define LAYERMASK_H
+
+#include <QImage>
+#include <QRect>
+#include <QtGlobal>
+#include <vector>
+
+// 8-bit layer mask in document coordinates, stored as square tiles. A tile
+// whose pixels are all equal keeps only that value, so a fresh mask, or
+// one painted in a few places, costs little more than its tile table.
+// Everything outside rect() reads as outside().
+class LayerMask
+{
+public:
+    static constexpr int TileSize = 64;
+
+    // A run of pixels with one row stride: data is null when every pixel
+    // in rect has the same value.
+    struct Block
+    {
+        QRect rect;
+        const uchar* data {nullptr};
+        int stride {0};
+        uchar value {0};
+    };
+
+    explicit LayerMask(const QRect& rect, uchar fill = 255);
+
+    QRect rect() const { return m_rect; }
+    uchar outside() const { return m_outside; }
+    int revision() const { return m_revision; }
+
+    uchar value(const QPoint& p) const;
+
+    // Moves the mask within the document, e.g. when the document origin
+    // moves.
+    void translate(const QPoint& delta);
+
+    // Calls fn(const Block&) for the parts of area, in document
+    // coordinates, covered by one tile or by the uniform outside.
+    template <typename Fn>
+    void forEachBlock(const QRect& area, Fn fn) const;
+
+    // Grayscale8 copy of area.
+    QImage toImage(const QRect& area) const;
+    // Opaque grey ARGB32 premultiplied copy of area for the brush tools to
+    // paint on, and the mask values read back from such a surface.
+    QImage surface(const QRect& area) const;
+    static QImage paintedValues(const QImage& surface);
+
+    // Nearest samples at top-left + (x, y) * step, for reduced canvases.
+    QImage sampled(const QPointF& topLeft, double step, const QSize& size) const;
+
+    // Writes a Grayscale8 image with its top-left at topLeft. When where is
+    // given, only pixels where it is non-zero are written. Tiles that end
+    // up uniform are collapsed; returns false if nothing changed.
+    bool write(const QPoint& topLeft, const QImage& gray, const QImage& where = QImage());
+
+    qint64 bytesUsed() const;
+
+private:
+    struct Tile
+    {
+        std::vector<uchar> data;
+        uchar value {0};
+    };
+
+    int tilesX() const { return (m_rect.width() + TileSize - 1) / TileSize; }
+    int tilesY() const { return (m_rect.height() + TileSize - 1) / TileSize; }
+    QRect tileRect(int tx, int ty) const;
+    static void collapse(Tile& tile, const QSize& used);
+
+    QRect m_rect;
+    uchar m_outside;
+    std::vector<Tile> m_tiles;
+    int m_revision {0};
+};
+
+template <typename Fn>
+void LayerMask::forEachBlock(const QRect& area, Fn fn) const
+{
+    const QRect inside = area.intersected(m_rect);
+
+    // The parts of area outside the mask, as up to four bands.
+    if (inside != area) {
+        if (inside.isEmpty()) {
+            fn(Block{area, nullptr, 0, m_outside});
+            return;
+        }
+        const QRect bands[] = {
+            QRect(area.left(), area.top(), area.width(), inside.top() - area.top()),
+            QRect(area.left(), inside.bottom() + 1, area.width(), area.bottom() - inside.bottom()),
+            QRect(area.left(), inside.top(), inside.left() - area.left(), inside.height()),
+            QRect(inside.right() + 1, inside.top(), area.right() - inside.right(), inside.height())
+        };
+        for (const QRect& band : bands) {
+            if (!band.isEmpty())
+                fn(Block{band, nullptr, 0, m_outside});
+        }
+    }
+
+    if (inside.isEmpty())
+        return;
+
+    const int tx0 = (inside.left() - m_rect.left()) / TileSize;
+    const int tx1 = (inside.right() - m_rect.left()) / TileSize;
+    const int ty0 = (inside.top() - m_rect.top()) / TileSize;
+    const int ty1 = (inside.bottom() - m_rect.top()) / TileSize;
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const QRect tr = tileRect(tx, ty);
+            const QRect r = tr.intersected(inside);
+            const Tile& tile = m_tiles[static_cast<size_t>(ty * tilesX() + tx)];
+
+            if (tile.data.empty()) {
+                fn(Block{r, nullptr, 0, tile.value});
+            } else {
+                const uchar* first = tile.data.data()
+                                     + (r.top() - tr.top()) * TileSize + (r.left() - tr.left());
+                fn(Block{r, first, TileSize, 0});
+            }
+        }
+    }
+}
+
+#endif // LAYERMASK_H
@@ -0,0 +1,193 @@
+#include "parallelfor.h"
+#include "profiling/profiler.h"
+
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+thread_local bool t_insideWorker = false;
+std::atomic<int> g_maxThreads {0};
+
+qint64 elapsedNs(Clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+class WorkerPool
+{
+public:
+    static WorkerPool& instance()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    int size() const { return static_cast<int>(m_threads.size()) + 1; }
+
+    void run(int chunks, const std::function<void(int)>& job)
+    {
+        std::lock_guard<std::mutex> runLock(m_runMutex);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_chunkCount = chunks;
+            m_nextChunk.store(0);
+            m_remaining = chunks;
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        t_insideWorker = true;
+        work();
+        t_insideWorker = false;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_remaining == 0 && m_busyWorkers == 0; });
+        m_job = nullptr;
+    }
+
+private:
+    WorkerPool()
+    {
+        const int workers = std::max(0, QThread::idealThreadCount() - 1);
+        for (int i = 0; i < workers; ++i)
+            m_threads.emplace_back([this] { workerLoop(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& t : m_threads)
+            t.join();
+    }
+
+    void workerLoop()
+    {
+        t_insideWorker = true;
+        quint64 seen = 0;
+
+        for (;;) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+
+            seen = m_generation;
+            if (!m_job)
+                continue;
+
+            ++m_busyWorkers;
+            lock.unlock();
+
+            work();
+
+            lock.lock();
+            if (--m_busyWorkers == 0)
+                m_done.notify_all();
+        }
+    }
+
+    void work()
+    {
+        for (;;) {
+            const int chunk = m_nextChunk.fetch_add(1);
+            if (chunk >= m_chunkCount)
+                return;
+
+            (*m_job)(chunk);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_remaining == 0)
+                m_done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_runMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(int)>* m_job {nullptr};
+    std::atomic<int> m_nextChunk {0};
+    int m_chunkCount {0};
+    int m_remaining {0};
+    int m_busyWorkers {0};
+    quint64 m_generation {0};
+    bool m_stop {false};
+};
+
+}
+
+int ParallelFor::threadCount()
+{
+    const int poolSize = WorkerPool::instance().size();
+    const int limit = g_maxThreads.load();
+    return limit > 0 ? std::min(limit, poolSize) : poolSize;
+}
+
+void ParallelFor::setMaxThreads(int threads)
+{
+    g_maxThreads.store(std::max(0, threads));
+}
+
+void ParallelFor::run(int count, const RangeFunction& fn, int minChunk)
+{
+    if (count <= 0)
+        return;
+
+    minChunk = std::max(1, minChunk);
+    const int threads = t_insideWorker ? 1 : threadCount();
+    const int maxChunks = (count + minChunk - 1) / minChunk;
+    const int chunks = std::min(maxChunks, threads * 4);
+
+    const bool profiling = Profiler::isEnabled() && !t_insideWorker;
+    const auto wallStart = profiling ? Clock::now() : Clock::time_point{};
+    ProfileScope* const scope = profiling ? Profiler::currentScope() : nullptr;
+    std::atomic<qint64> busyNs {0};
+
+    if (threads <= 1 || chunks <= 1) {
+        fn(0, count);
+    } else {
+        const int chunkSize = (count + chunks - 1) / chunks;
+        const int chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        WorkerPool::instance().run(chunkCount, [&](int chunk) {
+            const int begin = chunk * chunkSize;
+            const int end = std::min(count, begin + chunkSize);
+
+            if (!profiling) {
+                fn(begin, end);
+                return;
+            }
+
+            // Workers act for the caller's scope while they run its chunks.
+            ProfileScope* const previous = Profiler::currentScope();
+            Profiler::setCurrentScope(scope);
+            const auto chunkStart = Clock::now();
+            fn(begin, end);
+            busyNs.fetch_add(elapsedNs(chunkStart), std::memory_order_relaxed);
+            Profiler::setCurrentScope(previous);
+        });
+    }
+
+    if (profiling) {
+        const qint64 wall = elapsedNs(wallStart);
+        const qint64 busy = threads <= 1 || chunks <= 1 ? wall : busyNs.load();
+        Profiler::addParallelTime(busy, wall);
+    }
+}
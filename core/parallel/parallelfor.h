@@ -0,0 +1,20 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <functional>
+
+class ParallelFor
+{
+public:
+    using RangeFunction = std::function<void(int begin, int end)>;
+
+    // Splits [0, count) into chunks of at least minChunk items and runs them
+    // on the shared worker pool. The calling thread takes part in the work and
+    // nested calls from inside a worker run serially.
+    static void run(int count, const RangeFunction& fn, int minChunk = 1);
+
+    static int threadCount();
+    static void setMaxThreads(int threads);
+};
+
+#endif // PARALLELFOR_H
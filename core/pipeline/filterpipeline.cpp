@@ -1,4 +1,10 @@
 #include "filterpipeline.h"
+#include "profiling/profiler.h"
+#include "filters/tonecurve.h"
+#include "filters/detailfilter.h"
+#include "filters/pointfilter.h"
+#include "image/imagepool.h"
+#include <optional>
 #include <QDebug>
 FilterPipeline::FilterPipeline() {}
 
@@ -37,20 +43,105 @@ void FilterPipeline::clear() {
     filters.clear();
 }
 
-QImage FilterPipeline::process(const QImage& src) const
+bool FilterPipeline::isPointwise() const
+{
+    return std::all_of(filters.begin(), filters.end(), [](const std::unique_ptr<ImageFilter>& f) {
+        return !f->isActive() || f->isPointwise();
+    });
+}
+
+// A run works on two buffers: the working image, a copy of src, and a spare
+// that filters which cannot work in place write into before the two swap.
+// Both are locals, as render-graph tiles call process() concurrently on one
+// pipeline. In the 8-bit space point filters and fused tone curves rewrite
+// the working image, so a run allocates at most twice the image whatever the
+// number of filters. The linear space adds a float copy, four times the size
+// of the 8-bit image, while linear filters run.
+QImage FilterPipeline::process(const QImage& src, WorkingSpace space) const
 {
     Q_ASSERT(src.format() == QImage::Format_ARGB32_Premultiplied);
 
-    QImage img = src.copy();
+    const qint64 pixels = static_cast<qint64>(src.width()) * src.height();
+    ProfileScope scope("pipeline", "FilterPipeline::process", pixels);
+
+    QImage img = ImagePool::instance().copy(src);
+    QImage spare;
+    QImage linear;
+
+    auto intoSpare = [&](auto&& write) {
+        write(spare);
+        std::swap(img, spare);
+    };
+
+    // Consecutive table-driven filters are composed and applied in one pass.
+    std::optional<ToneCurve> curve;
+    auto flushCurve = [&]() {
+        if (!curve)
+            return;
+        ProfileScope curveScope("filter", "ToneCurve (fused)", pixels);
+        curve->applyInPlace(img);
+        curve.reset();
+    };
+
+    // Consecutive detail filters read blurs of the same input and are
+    // summed in one pass.
+    std::vector<const DetailFilter*> details;
+    auto flushDetails = [&]() {
+        if (details.empty())
+            return;
+        ProfileScope detailScope("filter", "DetailStage", pixels);
+        intoSpare([&](QImage& dst) { DetailFilter::applyAll(img, details, dst); });
+        details.clear();
+    };
+    auto flush = [&]() {
+        flushCurve();
+        flushDetails();
+    };
 
     for (auto& filter : filters) {
-        img = filter->apply(img);
+        if (!filter->isActive())
+            continue;
+
+        if (space == WorkingSpace::LinearFloat && filter->supportsLinear()) {
+            flush();
+            ProfileScope filterScope("filter", typeid(*filter), pixels);
+            if (linear.isNull())
+                linear = LinearLight::toLinear(img);
+            filter->applyLinear(linear);
+            continue;
+        }
+
+        if (!linear.isNull()) {
+            ProfileScope convertScope("pipeline", "LinearLight::fromLinear", pixels);
+            img = LinearLight::fromLinear(linear);
+            linear = QImage();
+        }
+
+        if (const ToneCurve* filterCurve = filter->toneCurve()) {
+            flushDetails();
+            curve = curve ? curve->then(*filterCurve) : *filterCurve;
+            continue;
+        }
+
+        if (const auto* detail = dynamic_cast<const DetailFilter*>(filter.get())) {
+            flushCurve();
+            details.push_back(detail);
+            continue;
+        }
+
+        flush();
+
+        ProfileScope filterScope("filter", typeid(*filter), pixels);
+        if (const auto* point = dynamic_cast<const PointFilter*>(filter.get()))
+            point->applyInPlace(img);
+        else
+            intoSpare([&](QImage& dst) { filter->applyInto(img, dst); });
         Q_ASSERT(img.format() == QImage::Format_ARGB32_Premultiplied);
     }
 
+    if (!linear.isNull())
+        img = LinearLight::fromLinear(linear);
+    flush();
 
     return img;
 }
-
-
-
@@ -6,6 +6,7 @@
 #include <memory>
 #include <utility>
 #include "filters/imagefilter.h"
+#include "color/linearlight.h"
 #include <algorithm>
 #include <type_traits>
 
@@ -23,7 +24,11 @@ public:
     void addFilter(std::unique_ptr<ImageFilter> filter);
     void removeFilter(size_t index);
     void clear();
-    QImage process(const QImage& input) const;
+    QImage process(const QImage& input, WorkingSpace space = WorkingSpace::Display8Bit) const;
+
+    // True when every active filter maps each pixel on its own, so any part
+    // of an image can be processed apart from the rest.
+    bool isPointwise() const;
 
     template<class T>
     T* find()
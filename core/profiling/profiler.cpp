@@ -0,0 +1,260 @@
+#include "profiler.h"
+
+#include "parallel/parallelfor.h"
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+#include <cctype>
+
+std::atomic<bool> Profiler::s_enabled {false};
+
+namespace {
+thread_local int t_depth = 0;
+thread_local ProfileScope* t_scope = nullptr;
+}
+
+Profiler::Profiler()
+{
+    m_clock.start();
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    instance();
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 Profiler::nowNs() const
+{
+    return m_clock.nsecsElapsed();
+}
+
+void Profiler::record(ProfileEvent event)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_events.size() >= MaxEvents)
+        m_events.erase(m_events.begin(), m_events.begin() + MaxEvents / 2);
+
+    m_events.push_back(std::move(event));
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.clear();
+}
+
+std::vector<ProfileEvent> Profiler::events() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events;
+}
+
+int Profiler::eventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<int>(m_events.size());
+}
+
+std::vector<ProfileSummary> Profiler::summary() const
+{
+    const std::vector<ProfileEvent> snapshot = events();
+
+    QHash<QByteArray, int> indexByName;
+    std::vector<ProfileSummary> rows;
+
+    for (const auto& e : snapshot) {
+        int index = indexByName.value(e.name, -1);
+        if (index < 0) {
+            index = static_cast<int>(rows.size());
+            indexByName.insert(e.name, index);
+            rows.push_back(ProfileSummary{});
+            rows.back().name = e.name;
+        }
+
+        ProfileSummary& row = rows[static_cast<size_t>(index)];
+        const double ms = e.durationNs / 1e6;
+        row.calls += 1;
+        row.totalMs += ms;
+        row.maxMs = std::max(row.maxMs, ms);
+        row.pixels += e.pixels;
+        row.bytesAllocated += e.bytesAllocated;
+        row.threadUtilisation += e.threadUtilisation * ms;
+    }
+
+    for (auto& row : rows) {
+        if (row.totalMs > 0.0)
+            row.threadUtilisation /= row.totalMs;
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const ProfileSummary& a, const ProfileSummary& b) {
+        return a.totalMs > b.totalMs;
+    });
+    return rows;
+}
+
+bool Profiler::exportChromeTrace(const QString& path) const
+{
+    const std::vector<ProfileEvent> snapshot = events();
+
+    QHash<quintptr, int> threadIds;
+    QJsonArray traceEvents;
+
+    for (const auto& e : snapshot) {
+        int tid = threadIds.value(e.threadId, 0);
+        if (tid == 0) {
+            tid = threadIds.size() + 1;
+            threadIds.insert(e.threadId, tid);
+        }
+
+        QJsonObject args;
+        args["pixels"] = static_cast<double>(e.pixels);
+        args["bytesAllocated"] = static_cast<double>(e.bytesAllocated);
+        args["threadUtilisation"] = e.threadUtilisation;
+
+        QJsonObject event;
+        event["name"] = QString::fromUtf8(e.name);
+        event["cat"] = QString::fromUtf8(e.category);
+        event["ph"] = "X";
+        event["ts"] = e.startNs / 1000.0;
+        event["dur"] = e.durationNs / 1000.0;
+        event["pid"] = 1;
+        event["tid"] = tid;
+        event["args"] = args;
+        traceEvents.append(event);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    return file.write(json) == json.size();
+}
+
+void Profiler::addParallelTime(qint64 busyNs, qint64 wallNs)
+{
+    for (ProfileScope* scope = t_scope; scope; scope = scope->m_parent) {
+        scope->m_busyNs.fetch_add(busyNs, std::memory_order_relaxed);
+        scope->m_parallelWallNs.fetch_add(wallNs, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::addAllocation(qint64 bytes)
+{
+    for (ProfileScope* scope = t_scope; scope; scope = scope->m_parent)
+        scope->m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+ProfileScope* Profiler::currentScope()
+{
+    return t_scope;
+}
+
+void Profiler::setCurrentScope(ProfileScope* scope)
+{
+    t_scope = scope;
+}
+
+// GCC and Clang mangle plain class names as "<length><name>", MSVC prefixes
+// them with "class ".
+QByteArray Profiler::typeName(const std::type_info& type)
+{
+    QByteArray name(type.name());
+
+    if (name.startsWith("class "))
+        return name.mid(6);
+
+    int digits = 0;
+    while (digits < name.size() && std::isdigit(static_cast<unsigned char>(name[digits])))
+        ++digits;
+    return name.mid(digits);
+}
+
+ProfileScope::ProfileScope(const char* category, const char* name, qint64 pixels)
+    : m_name(name)
+{
+    if (Profiler::isEnabled())
+        begin(category, pixels);
+}
+
+ProfileScope::ProfileScope(const char* category, const std::type_info& type, qint64 pixels)
+    : m_type(&type)
+{
+    if (Profiler::isEnabled())
+        begin(category, pixels);
+}
+
+void ProfileScope::begin(const char* category, qint64 pixels)
+{
+    m_active = true;
+    m_category = category;
+    m_pixels = pixels;
+    m_depth = t_depth++;
+    m_parent = t_scope;
+    t_scope = this;
+    m_start = Profiler::instance().nowNs();
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (!m_active)
+        return;
+
+    Profiler& profiler = Profiler::instance();
+    const qint64 end = profiler.nowNs();
+    --t_depth;
+    t_scope = m_parent;
+
+    ProfileEvent event;
+    event.name = m_type ? Profiler::typeName(*m_type) : QByteArray(m_name);
+    event.category = m_category;
+    event.startNs = m_start;
+    event.durationNs = end - m_start;
+    event.pixels = m_pixels;
+    event.bytesAllocated = m_bytes.load(std::memory_order_relaxed);
+    event.threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    event.depth = m_depth;
+
+    // Time outside parallel regions counts as one busy thread.
+    if (event.durationNs > 0) {
+        const qint64 parallelWall = m_parallelWallNs.load(std::memory_order_relaxed);
+        const qint64 busy = m_busyNs.load(std::memory_order_relaxed)
+                            + std::max<qint64>(0, event.durationNs - parallelWall);
+        event.threadUtilisation = std::clamp(
+            static_cast<double>(busy) / (static_cast<double>(event.durationNs) * ParallelFor::threadCount()),
+            0.0, 1.0);
+    }
+
+    profiler.record(std::move(event));
+}
+
+void ProfileScope::setPixels(qint64 pixels)
+{
+    m_pixels = pixels;
+}
+
+// Nested scopes are inclusive, so the bytes reach every scope up the chain.
+void ProfileScope::addAllocation(qint64 bytes)
+{
+    if (!m_active)
+        return;
+    for (ProfileScope* scope = this; scope; scope = scope->m_parent)
+        scope->m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
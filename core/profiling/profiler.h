@@ -0,0 +1,121 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+struct ProfileEvent
+{
+    QByteArray name;
+    QByteArray category;
+    qint64 startNs {0};
+    qint64 durationNs {0};
+    qint64 pixels {0};
+    qint64 bytesAllocated {0};
+    double threadUtilisation {0.0};
+    quintptr threadId {0};
+    int depth {0};
+};
+
+struct ProfileSummary
+{
+    QByteArray name;
+    int calls {0};
+    double totalMs {0.0};
+    double maxMs {0.0};
+    qint64 pixels {0};
+    qint64 bytesAllocated {0};
+    double threadUtilisation {0.0};
+
+    double averageMs() const { return calls > 0 ? totalMs / calls : 0.0; }
+    double megapixelsPerSecond() const { return totalMs > 0.0 ? pixels / (totalMs * 1000.0) : 0.0; }
+};
+
+// Collects timed scopes from the render path. When disabled a scope costs
+// one relaxed atomic load, so instrumentation stays compiled in.
+class ProfileScope;
+
+class Profiler
+{
+public:
+    static Profiler& instance();
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    qint64 nowNs() const;
+    void record(ProfileEvent event);
+    void clear();
+
+    std::vector<ProfileEvent> events() const;
+    int eventCount() const;
+    std::vector<ProfileSummary> summary() const;
+    bool exportChromeTrace(const QString& path) const;
+
+    // Fed by ParallelFor on the calling thread: summed busy time of all
+    // threads and the wall time of one parallel region, charged to the
+    // scopes open on that thread.
+    static void addParallelTime(qint64 busyNs, qint64 wallNs);
+    // Fed by ImagePool: charged to the scopes open on this thread, or on the
+    // thread whose parallel region this thread is working for.
+    static void addAllocation(qint64 bytes);
+
+    // The innermost open scope of this thread. ParallelFor hands it to its
+    // workers so that their allocations reach the caller's scopes.
+    static ProfileScope* currentScope();
+    static void setCurrentScope(ProfileScope* scope);
+
+    static QByteArray typeName(const std::type_info& type);
+
+private:
+    Profiler();
+
+    static constexpr size_t MaxEvents = 200000;
+
+    static std::atomic<bool> s_enabled;
+
+    QElapsedTimer m_clock;
+    mutable std::mutex m_mutex;
+    std::vector<ProfileEvent> m_events;
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char* category, const char* name, qint64 pixels = 0);
+    ProfileScope(const char* category, const std::type_info& type, qint64 pixels = 0);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    void setPixels(qint64 pixels);
+    // For buffers that do not come from ImagePool, which counts its own.
+    void addAllocation(qint64 bytes);
+
+private:
+    friend class Profiler;
+
+    void begin(const char* category, qint64 pixels);
+
+    bool m_active {false};
+    const char* m_category {nullptr};
+    const char* m_name {nullptr};
+    const std::type_info* m_type {nullptr};
+    ProfileScope* m_parent {nullptr};
+    qint64 m_start {0};
+    qint64 m_pixels {0};
+    // Inclusive of nested scopes; workers add to them concurrently.
+    std::atomic<qint64> m_busyNs {0};
+    std::atomic<qint64> m_parallelWallNs {0};
+    std::atomic<qint64> m_bytes {0};
+    int m_depth {0};
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,456 @@
+#include "layernodes.h"
+#include "image/imagepool.h"
+
+#include <QColor>
+#include <QPainter>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+
+QPainter::CompositionMode toQtMode(BlendMode mode)
+{
+    switch (mode) {
+    case BlendMode::Multiply: return QPainter::CompositionMode_Multiply;
+    case BlendMode::Screen:   return QPainter::CompositionMode_Screen;
+    case BlendMode::Overlay:  return QPainter::CompositionMode_Overlay;
+    default:                  return QPainter::CompositionMode_SourceOver;
+    }
+}
+
+quint64 bitsOf(double v)
+{
+    quint64 bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+quint64 placementKey(quint64 key, double factor, const QPoint& origin)
+{
+    key = Layer::combineKeys(key, bitsOf(factor));
+    return Layer::combineKeys(key, static_cast<quint64>(static_cast<quint32>(origin.x())) << 32
+                                       | static_cast<quint32>(origin.y()));
+}
+
+quint64 maskKey(quint64 key, const LayerMask* mask)
+{
+    key = Layer::combineKeys(key, reinterpret_cast<quintptr>(mask));
+    return Layer::combineKeys(key, mask ? static_cast<quint64>(mask->revision()) : 0);
+}
+
+QImage transparent(const QSize& size)
+{
+    QImage image = ImagePool::instance().acquire(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    return image;
+}
+
+// The pixels of every view still alive. A view is the only reference to
+// its data, so it counts as detached, but its data is read-only and Qt
+// would copy it outside the pool on the first write.
+std::mutex viewMutex;
+std::unordered_multiset<const uchar*> viewPixels;
+
+struct ViewOwner
+{
+    QImage image;
+    const uchar* pixels;
+};
+
+// A read-only window into image that keeps its pixels alive, so a tile of
+// a layer costs no copy unless something draws on it.
+QImage view(const QImage& image, const QRect& rect)
+{
+    const uchar* pixels = image.constScanLine(rect.top()) + rect.left() * 4;
+    {
+        std::lock_guard<std::mutex> lock(viewMutex);
+        viewPixels.insert(pixels);
+    }
+
+    auto* owner = new ViewOwner{image, pixels};
+    return QImage(pixels, rect.width(), rect.height(), image.bytesPerLine(), image.format(),
+                  [](void* info) {
+                      auto* owner = static_cast<ViewOwner*>(info);
+                      {
+                          std::lock_guard<std::mutex> lock(viewMutex);
+                          viewPixels.erase(viewPixels.find(owner->pixels));
+                      }
+                      delete owner;
+                  }, owner);
+}
+
+bool isView(const QImage& image)
+{
+    std::lock_guard<std::mutex> lock(viewMutex);
+    return viewPixels.count(image.constBits()) > 0;
+}
+
+// Nodes draw on their inputs; one that is still shared, e.g. with the
+// render cache, or that is a view of a layer is copied into a pooled buffer
+// first rather than left to QImage's own detach.
+QImage writable(QImage image)
+{
+    if (image.isNull() || (image.isDetached() && !isView(image)))
+        return image;
+    return ImagePool::instance().copy(image);
+}
+
+// Premultiplied pixel times m / 255, two channels per multiply.
+inline QRgb scalePixel(QRgb p, uint m)
+{
+    uint rb = (p & 0x00ff00ffu) * m;
+    uint ag = ((p >> 8) & 0x00ff00ffu) * m;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ffu) + 0x00800080u) >> 8) & 0x00ff00ffu;
+    ag = (ag + ((ag >> 8) & 0x00ff00ffu) + 0x00800080u) & 0xff00ff00u;
+    return rb | ag;
+}
+
+// Calls fn(const LayerMask::Block&) over area, in canvas pixels. At full
+// resolution the blocks come straight from the mask tiles, so uniform tiles
+// stay uniform; reduced canvases get one block of nearest samples.
+template <typename Fn>
+void forEachMaskBlock(const LayerMask& mask, const QRect& area, const QPoint& origin, double factor, Fn fn)
+{
+    if (area.isEmpty())
+        return;
+
+    if (factor >= 1.0) {
+        mask.forEachBlock(area.translated(origin), [&](LayerMask::Block block) {
+            block.rect.translate(-origin);
+            fn(block);
+        });
+        return;
+    }
+
+    const QImage samples = mask.sampled(QPointF(origin) + QPointF(area.topLeft()) / factor, 1.0 / factor, area.size());
+    fn(LayerMask::Block{area, samples.constBits(), static_cast<int>(samples.bytesPerLine()), 0});
+}
+
+QColor applyBlendMode(const QColor& base, const QColor& blend, BlendMode mode)
+{
+    auto f = [](float v) { return std::clamp(v, 0.0f, 1.0f); };
+
+    float bR = base.redF(),   bG = base.greenF(), bB = base.blueF();
+    float aR = blend.redF(),  aG = blend.greenF(), aB = blend.blueF();
+
+    float r, g, b;
+
+    switch (mode) {
+    case BlendMode::Multiply:
+        r = bR * aR; g = bG * aG; b = bB * aB;
+        break;
+    case BlendMode::Screen:
+        r = 1.0f - (1.0f - bR) * (1.0f - aR);
+        g = 1.0f - (1.0f - bG) * (1.0f - aG);
+        b = 1.0f - (1.0f - bB) * (1.0f - aB);
+        break;
+    case BlendMode::Overlay:
+        r = (bR < 0.5f) ? (2.0f * bR * aR) : (1.0f - 2.0f * (1.0f - bR) * (1.0f - aR));
+        g = (bG < 0.5f) ? (2.0f * bG * aG) : (1.0f - 2.0f * (1.0f - bG) * (1.0f - aG));
+        b = (bB < 0.5f) ? (2.0f * bB * aB) : (1.0f - 2.0f * (1.0f - bB) * (1.0f - aB));
+        break;
+    default:
+        r = aR; g = aG; b = aB;
+        break;
+    }
+
+    return QColor::fromRgbF(f(r), f(g), f(b), base.alphaF());
+}
+
+float lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+QRgb blendPixel(QRgb base, QRgb adj, float opacity, BlendMode mode)
+{
+    float a = qAlpha(base) / 255.0f;
+    if (a == 0.0f)
+        return base;
+
+    QColor cb(base);
+    QColor ca(adj);
+    QColor blended = applyBlendMode(cb, ca, mode);
+
+    QColor out;
+    out.setRedF(   lerp(cb.redF(),   blended.redF(),   opacity) );
+    out.setGreenF( lerp(cb.greenF(), blended.greenF(), opacity) );
+    out.setBlueF(  lerp(cb.blueF(),  blended.blueF(),  opacity) );
+    out.setAlphaF(a);
+
+    return out.rgba();
+}
+
+
+}
+
+
+EmptyNode::EmptyNode()
+{
+    setKey(0);
+}
+
+QImage EmptyNode::render(const QRect&, std::vector<QImage>) const
+{
+    return QImage();
+}
+
+
+// Layers arrive already resampled to their size on the canvas, so they are
+// only placed, at whole pixels.
+LayerNode::LayerNode(const PlacedLayer& layer, double factor, const QPoint& origin, const QRect& canvas)
+    : m_image(layer.rendered(factor)),
+    m_canvas(canvas)
+{
+    if (m_image.format() != QImage::Format_ARGB32_Premultiplied)
+        m_image = m_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    m_rect = QRect(((layer.offset() - QPointF(origin)) * factor).toPoint(), m_image.size());
+
+    quint64 key = placementKey(layer.contentKey(), factor, origin);
+    key = Layer::combineKeys(key, static_cast<quint64>(canvas.width()) << 32 | static_cast<quint32>(canvas.height()));
+    setKey(key);
+}
+
+QImage LayerNode::render(const QRect& roi, std::vector<QImage>) const
+{
+    const QRect r = roi.intersected(m_rect);
+    if (r.isEmpty() || m_image.isNull())
+        return QImage();
+
+    if (r == roi)
+        return view(m_image, roi.translated(-m_rect.topLeft()));
+
+    QImage out = transparent(roi.size());
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        std::memcpy(out.scanLine(y - roi.top()) + (r.left() - roi.left()) * 4,
+                    m_image.constScanLine(y - m_rect.top()) + (r.left() - m_rect.left()) * 4,
+                    static_cast<size_t>(r.width()) * 4);
+    }
+    return out;
+}
+
+
+MaskNode::MaskNode(Ptr input, const LayerMask& mask, double factor, const QPoint& origin)
+    : RenderNode({std::move(input)}),
+    m_mask(mask),
+    m_factor(factor),
+    m_origin(origin)
+{
+    setKey(placementKey(maskKey(1, &mask), factor, origin));
+}
+
+// Fully hidden tiles come out transparent and fully visible ones pass the
+// input through untouched; only partly masked blocks are scaled.
+QImage MaskNode::render(const QRect& roi, std::vector<QImage> inputs) const
+{
+    QImage image = std::move(inputs[0]);
+    if (image.isNull())
+        return image;
+
+    bool visible = false;
+    bool partial = false;
+    forEachMaskBlock(m_mask, roi, m_origin, m_factor, [&](const LayerMask::Block& b) {
+        if (!b.data && b.value == 0)
+            partial = true;
+        else if (!b.data && b.value == 255)
+            visible = true;
+        else
+            partial = visible = true;
+    });
+    if (!visible)
+        return QImage();
+    if (!partial)
+        return image;
+
+    image = writable(std::move(image));
+
+    forEachMaskBlock(m_mask, roi, m_origin, m_factor, [&](const LayerMask::Block& b) {
+        if (!b.data && b.value == 255)
+            return;
+        for (int y = 0; y < b.rect.height(); ++y) {
+            QRgb* p = reinterpret_cast<QRgb*>(image.scanLine(b.rect.top() + y - roi.top())) + (b.rect.left() - roi.left());
+            const uchar* m = b.data ? b.data + y * b.stride : nullptr;
+            for (int x = 0; x < b.rect.width(); ++x)
+                p[x] = scalePixel(p[x], m ? m[x] : b.value);
+        }
+    });
+    return image;
+}
+
+
+BlendNode::BlendNode(Ptr base, Ptr top, float opacity, BlendMode mode)
+    : RenderNode({std::move(base), std::move(top)}),
+    m_opacity(opacity),
+    m_mode(mode)
+{
+    quint64 key = Layer::combineKeys(2, bitsOf(opacity));
+    setKey(Layer::combineKeys(key, static_cast<quint64>(mode)));
+}
+
+QRect BlendNode::bounds() const
+{
+    return inputs()[0]->bounds().united(inputs()[1]->bounds());
+}
+
+QImage BlendNode::render(const QRect& roi, std::vector<QImage> inputs) const
+{
+    QImage base = std::move(inputs[0]);
+    const QImage& top = inputs[1];
+    if (top.isNull() || m_opacity <= 0.0f)
+        return base;
+    if (base.isNull()) {
+        if (m_opacity >= 1.0f && m_mode == BlendMode::Normal)
+            return top;
+        base = transparent(roi.size());
+    }
+
+    base = writable(std::move(base));
+    QPainter painter(&base);
+    painter.setOpacity(m_opacity);
+    painter.setCompositionMode(toQtMode(m_mode));
+    painter.drawImage(QPoint(0, 0), top);
+    return base;
+}
+
+
+AdjustNode::AdjustNode(Ptr input, const AdjustmentLayer& layer, WorkingSpace space, const QRect& area)
+    : RenderNode({std::move(input)}),
+    m_pipeline(layer.pipeline()),
+    m_space(space),
+    m_area(m_pipeline.isPointwise() ? QRect() : area),
+    m_tiled(m_pipeline.isPointwise())
+{
+    quint64 key = Layer::combineKeys(layer.contentKey(), static_cast<quint64>(space));
+    key = Layer::combineKeys(key, static_cast<quint64>(static_cast<quint32>(m_area.x())) << 32
+                                      | static_cast<quint32>(m_area.y()));
+    key = Layer::combineKeys(key, static_cast<quint64>(m_area.width()) << 32 | static_cast<quint32>(m_area.height()));
+    setKey(key);
+}
+
+QRect AdjustNode::bounds() const
+{
+    return m_area.isEmpty() ? inputs()[0]->bounds() : m_area;
+}
+
+QImage AdjustNode::render(const QRect&, std::vector<QImage> inputs) const
+{
+    if (inputs[0].isNull())
+        return QImage();
+    return m_pipeline.process(inputs[0], m_space);
+}
+
+
+OpaqueNode::OpaqueNode(Ptr input)
+    : RenderNode({std::move(input)})
+{
+    setKey(5);
+}
+
+QImage OpaqueNode::render(const QRect& roi, std::vector<QImage> inputs) const
+{
+    QImage image = std::move(inputs[0]);
+    if (image.isNull())
+        return image;
+
+    image = writable(std::move(image));
+    for (int y = 0; y < roi.height(); ++y) {
+        QRgb* p = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < roi.width(); ++x)
+            p[x] = qUnpremultiply(p[x]) | 0xff000000u;
+    }
+    return image;
+}
+
+
+ClipNode::ClipNode(Ptr original, Ptr adjusted, const LayerMask* mask, double factor, const QPoint& origin)
+    : RenderNode({std::move(original), std::move(adjusted)}),
+    m_mask(mask),
+    m_factor(factor),
+    m_origin(origin)
+{
+    setKey(placementKey(maskKey(3, mask), factor, origin));
+}
+
+QImage ClipNode::render(const QRect& roi, std::vector<QImage> inputs) const
+{
+    const QImage& original = inputs[0];
+    QImage adjusted = std::move(inputs[1]);
+    if (original.isNull() || adjusted.isNull())
+        return original;
+
+    adjusted = writable(std::move(adjusted));
+
+    for (int y = 0; y < roi.height(); ++y) {
+        const QRgb* src = reinterpret_cast<const QRgb*>(original.constScanLine(y));
+        QRgb* dst = reinterpret_cast<QRgb*>(adjusted.scanLine(y));
+        for (int x = 0; x < roi.width(); ++x)
+            dst[x] = qPremultiply((dst[x] & 0x00ffffffu) | (src[x] & 0xff000000u));
+    }
+
+    // Masked-out parts keep the layer as it was; partly masked ones mix the
+    // two.
+    if (m_mask) {
+        forEachMaskBlock(*m_mask, roi, m_origin, m_factor, [&](const LayerMask::Block& b) {
+            if (!b.data && b.value == 255)
+                return;
+            for (int y = 0; y < b.rect.height(); ++y) {
+                const int row = b.rect.top() + y - roi.top();
+                const QRgb* src = reinterpret_cast<const QRgb*>(original.constScanLine(row)) + (b.rect.left() - roi.left());
+                QRgb* dst = reinterpret_cast<QRgb*>(adjusted.scanLine(row)) + (b.rect.left() - roi.left());
+                const uchar* m = b.data ? b.data + y * b.stride : nullptr;
+                for (int x = 0; x < b.rect.width(); ++x) {
+                    const uint v = m ? m[x] : b.value;
+                    dst[x] = scalePixel(dst[x], v) + scalePixel(src[x], 255 - v);
+                }
+            }
+        });
+    }
+
+    return adjusted;
+}
+
+
+AdjustBlendNode::AdjustBlendNode(Ptr base, Ptr adjusted, float opacity, BlendMode mode,
+                                 const LayerMask* mask, double factor, const QPoint& origin)
+    : RenderNode({std::move(base), std::move(adjusted)}),
+    m_opacity(opacity),
+    m_mode(mode),
+    m_mask(mask),
+    m_factor(factor),
+    m_origin(origin)
+{
+    quint64 key = placementKey(maskKey(4, mask), factor, origin);
+    key = Layer::combineKeys(key, bitsOf(opacity));
+    setKey(Layer::combineKeys(key, static_cast<quint64>(mode)));
+}
+
+QImage AdjustBlendNode::render(const QRect& roi, std::vector<QImage> inputs) const
+{
+    QImage base = std::move(inputs[0]);
+    const QImage& adjusted = inputs[1];
+    if (base.isNull() || adjusted.isNull())
+        return base;
+
+    base = writable(std::move(base));
+
+    auto blendBlock = [&](const LayerMask::Block& block) {
+        if (!block.data && block.value == 0)
+            return;
+        const QRect r = block.rect.translated(-roi.topLeft());
+        for (int y = 0; y < r.height(); ++y) {
+            QRgb* b = reinterpret_cast<QRgb*>(base.scanLine(r.top() + y)) + r.left();
+            const QRgb* a = reinterpret_cast<const QRgb*>(adjusted.constScanLine(r.top() + y)) + r.left();
+            const uchar* m = block.data ? block.data + y * block.stride : nullptr;
+            for (int x = 0; x < r.width(); ++x) {
+                if (qAlpha(b[x]) == 0) continue;
+                const float o = m_opacity * ((m ? m[x] : block.value) / 255.0f);
+                b[x] = blendPixel(b[x], a[x], o, m_mode);
+            }
+        }
+    };
+
+    if (m_mask)
+        forEachMaskBlock(*m_mask, roi, m_origin, m_factor, blendBlock);
+    else
+        blendBlock(LayerMask::Block{roi, nullptr, 0, 255});
+    return base;
+}
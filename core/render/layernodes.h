@@ -0,0 +1,133 @@
+#ifndef LAYERNODES_H
+#define LAYERNODES_H
+
+#include "render/rendergraph.h"
+#include "layers/layer.h"
+
+// Render graph nodes for the layer stack. Coordinates are canvas pixels at
+// the render's scale factor; origin is the document position of the
+// canvas's top-left corner.
+
+// The transparent start of a stack.
+class EmptyNode final : public RenderNode
+{
+public:
+    EmptyNode();
+
+    QRect bounds() const override { return QRect(); }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+};
+
+// A placed layer's pixels where the layer sits on the canvas.
+class LayerNode final : public RenderNode
+{
+public:
+    LayerNode(const PlacedLayer& layer, double factor, const QPoint& origin, const QRect& canvas);
+
+    QRect bounds() const override { return m_rect.intersected(m_canvas); }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+
+private:
+    QImage m_image;
+    QRect m_rect;
+    QRect m_canvas;
+};
+
+// The input scaled by a layer mask.
+class MaskNode final : public RenderNode
+{
+public:
+    MaskNode(Ptr input, const LayerMask& mask, double factor, const QPoint& origin);
+
+    QRect bounds() const override { return inputs()[0]->bounds(); }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+
+private:
+    const LayerMask& m_mask;
+    double m_factor;
+    QPoint m_origin;
+};
+
+// Draws the second input over the first with a QPainter composition mode.
+class BlendNode final : public RenderNode
+{
+public:
+    BlendNode(Ptr base, Ptr top, float opacity, BlendMode mode);
+
+    QRect bounds() const override;
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+
+private:
+    float m_opacity;
+    BlendMode m_mode;
+};
+
+// An adjustment layer's filters applied to the input. Tiled only when every
+// filter works pixel by pixel; otherwise the filters run once over area, or
+// over the input's bounds when area is empty, as their output may depend on
+// the image size (vignette, grain, blur edges).
+class AdjustNode final : public RenderNode
+{
+public:
+    AdjustNode(Ptr input, const AdjustmentLayer& layer, WorkingSpace space, const QRect& area = QRect());
+
+    QRect bounds() const override;
+    bool isTiled() const override { return m_tiled; }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+
+private:
+    const FilterPipeline& m_pipeline;
+    WorkingSpace m_space;
+    QRect m_area;
+    bool m_tiled;
+};
+
+// The input's colours unpremultiplied and made opaque. Clipped adjustments
+// filter these, so a translucent layer is adjusted by its own colours
+// rather than by colours already scaled by its alpha.
+class OpaqueNode final : public RenderNode
+{
+public:
+    explicit OpaqueNode(Ptr input);
+
+    QRect bounds() const override { return inputs()[0]->bounds(); }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+};
+
+// A clipped adjustment: the adjusted colours, taken from an OpaqueNode,
+// premultiplied by the original alpha and mixed back towards the original
+// where the adjustment's mask hides it.
+class ClipNode final : public RenderNode
+{
+public:
+    ClipNode(Ptr original, Ptr adjusted, const LayerMask* mask, double factor, const QPoint& origin);
+
+    QRect bounds() const override { return inputs()[0]->bounds(); }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+
+private:
+    const LayerMask* m_mask;
+    double m_factor;
+    QPoint m_origin;
+};
+
+// An unclipped adjustment: the adjusted image blended over the first input
+// with the layer's opacity, blend mode and mask.
+class AdjustBlendNode final : public RenderNode
+{
+public:
+    AdjustBlendNode(Ptr base, Ptr adjusted, float opacity, BlendMode mode,
+                    const LayerMask* mask, double factor, const QPoint& origin);
+
+    QRect bounds() const override { return inputs()[0]->bounds(); }
+    QImage render(const QRect& roi, std::vector<QImage> inputs) const override;
+
+private:
+    float m_opacity;
+    BlendMode m_mode;
+    const LayerMask* m_mask;
+    double m_factor;
+    QPoint m_origin;
+};
+
+#endif // LAYERNODES_H
@@ -0,0 +1,349 @@
+#include "rendergraph.h"
+#include "image/imagepool.h"
+#include "parallel/parallelfor.h"
+#include "profiling/profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <set>
+
+namespace {
+
+quint64 combine(quint64 key, quint64 value)
+{
+    value *= 0x9e3779b97f4a7c15ull;
+    value ^= value >> 32;
+    return (key ^ value) * 0xbf58476d1ce4e5b9ull + 1;
+}
+
+int floorTo(int v, int step)
+{
+    return (v >= 0 ? v / step : -((-v + step - 1) / step)) * step;
+}
+
+// Copies the part of src, placed at srcRect on the canvas, that overlaps
+// dstRect into the ARGB32 rows at dst.
+void blit(uchar* dst, qsizetype stride, const QRect& dstRect, const QImage& src, const QRect& srcRect)
+{
+    const QRect r = dstRect.intersected(srcRect);
+    if (r.isEmpty())
+        return;
+
+    const size_t bytes = static_cast<size_t>(r.width()) * 4;
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        std::memcpy(dst + (y - dstRect.top()) * stride + (r.left() - dstRect.left()) * 4,
+                    src.constScanLine(y - srcRect.top()) + (r.left() - srcRect.left()) * 4,
+                    bytes);
+    }
+}
+
+}
+
+RenderNode::RenderNode(std::vector<Ptr> inputs)
+    : m_inputs(std::move(inputs))
+{
+}
+
+QRect RenderNode::footprint(int input, const QRect& roi) const
+{
+    Q_UNUSED(input);
+    return roi;
+}
+
+void RenderNode::setKey(quint64 ownKey)
+{
+    quint64 key = combine(ownKey, m_inputs.size());
+    for (const auto& input : m_inputs)
+        key = combine(key, input ? input->key() : 0);
+    m_key = key;
+}
+
+
+RenderCache::Key RenderCache::makeKey(quint64 key, const QRect& rect)
+{
+    return Key(key, rect.x(), rect.y(), rect.width(), rect.height());
+}
+
+bool RenderCache::find(quint64 key, const QRect& rect, QImage& image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(makeKey(key, rect));
+    if (it == m_entries.end())
+        return false;
+
+    it->second.used = true;
+    image = it->second.image;
+    return true;
+}
+
+void RenderCache::insert(quint64 key, const QRect& rect, const QImage& image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[makeKey(key, rect)] = Entry{image, true};
+}
+
+void RenderCache::endFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!it->second.used) {
+            it = m_entries.erase(it);
+        } else {
+            it->second.used = false;
+            ++it;
+        }
+    }
+}
+
+void RenderCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+qint64 RenderCache::bytesUsed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    qint64 bytes = 0;
+    for (const auto& [key, entry] : m_entries)
+        bytes += entry.image.sizeInBytes();
+    return bytes;
+}
+
+
+RenderGraph::RenderGraph(RenderCache& cache)
+    : m_cache(cache)
+{
+}
+
+QImage RenderGraph::render(const RenderNode::Ptr& output, const QRect& rect)
+{
+    ProfileScope scope("render", "RenderGraph::render", static_cast<qint64>(rect.width()) * rect.height());
+
+    plan(output, rect);
+
+    int levels = 0;
+    for (const auto& [node, stage] : m_stages)
+        levels = std::max(levels, stage.level + 1);
+
+    for (int level = 0; level < levels; ++level) {
+        std::vector<std::pair<const RenderNode*, QRect>> tiled;
+        std::vector<std::pair<const RenderNode*, QRect>> whole;
+
+        for (const auto& [node, stage] : m_stages) {
+            if (stage.level != level)
+                continue;
+            for (const QRect& tile : tiles(stage)) {
+                QImage cached;
+                if (cacheFor(*node).find(node->key(), tile, cached))
+                    continue;
+                (node->isTiled() ? tiled : whole).emplace_back(node, tile);
+            }
+        }
+
+        // Untiled nodes are whole-image filters that parallelise inside, so
+        // they run one at a time rather than as one task each.
+        for (const auto& [node, r] : whole) {
+            ProfileScope nodeScope("render", typeid(*node), static_cast<qint64>(r.width()) * r.height());
+            std::vector<QImage> inputs;
+            for (int i = 0; i < static_cast<int>(node->inputs().size()); ++i)
+                inputs.push_back(node->inputs()[i] ? pull(*node->inputs()[i], node->footprint(i, r)) : QImage());
+            cacheFor(*node).insert(node->key(), r, node->render(r, std::move(inputs)));
+        }
+
+        if (tiled.empty())
+            continue;
+
+        ProfileScope levelScope("render", "RenderGraph::level",
+                                static_cast<qint64>(tiled.size()) * TileSize * TileSize);
+        ParallelFor::run(static_cast<int>(tiled.size()), [&](int begin, int end) {
+            for (int j = begin; j < end; ++j) {
+                const RenderNode& node = *tiled[static_cast<size_t>(j)].first;
+                const QRect& r = tiled[static_cast<size_t>(j)].second;
+                std::vector<QImage> inputs;
+                for (int i = 0; i < static_cast<int>(node.inputs().size()); ++i)
+                    inputs.push_back(node.inputs()[i] ? pull(*node.inputs()[i], node.footprint(i, r)) : QImage());
+                cacheFor(node).insert(node.key(), r, node.render(r, std::move(inputs)));
+            }
+        });
+    }
+
+    QImage result = assemble(*output, rect);
+    if (result.isNull()) {
+        result = ImagePool::instance().acquire(rect.size(), QImage::Format_ARGB32_Premultiplied);
+        result.fill(Qt::transparent);
+    }
+
+    m_cache.endFrame();
+    m_frame.clear();
+    m_stages.clear();
+    return result;
+}
+
+// Stages are the output, cached nodes, untiled nodes and whatever untiled
+// nodes read. The region of every node is the union of what its readers
+// need; a stage's level is one more than that of the deepest stage it
+// depends on, so stages of one level never depend on each other.
+void RenderGraph::plan(const RenderNode::Ptr& output, const QRect& rect)
+{
+    m_stages.clear();
+
+    std::vector<const RenderNode*> order;
+    std::set<const RenderNode*> seen;
+    std::function<void(const RenderNode*)> visit = [&](const RenderNode* node) {
+        if (!seen.insert(node).second)
+            return;
+        for (const auto& input : node->inputs()) {
+            if (input)
+                visit(input.get());
+        }
+        order.push_back(node);
+    };
+    visit(output.get());
+
+    std::set<const RenderNode*> stages {output.get()};
+    for (const RenderNode* node : order) {
+        if (node->isCached() || !node->isTiled())
+            stages.insert(node);
+        if (!node->isTiled()) {
+            for (const auto& input : node->inputs()) {
+                if (input)
+                    stages.insert(input.get());
+            }
+        }
+    }
+
+    std::map<const RenderNode*, QRect> regions {{output.get(), rect}};
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const RenderNode* node = *it;
+        QRect r = regions[node].intersected(node->bounds());
+        if (r.isEmpty())
+            continue;
+
+        if (!node->isTiled()) {
+            r = node->bounds();
+        } else if (stages.count(node)) {
+            const int left = floorTo(r.left(), TileSize);
+            const int top = floorTo(r.top(), TileSize);
+            r = QRect(left, top,
+                      floorTo(r.right(), TileSize) + TileSize - left,
+                      floorTo(r.bottom(), TileSize) + TileSize - top);
+        }
+        regions[node] = r;
+
+        // Nothing upstream of a cached node is needed while its tiles
+        // are still held.
+        if (node->isCached() && isCachedOver(*node, r))
+            continue;
+
+        for (int i = 0; i < static_cast<int>(node->inputs().size()); ++i) {
+            if (const RenderNode* input = node->inputs()[static_cast<size_t>(i)].get())
+                regions[input] = regions[input].united(node->footprint(i, r));
+        }
+    }
+
+    std::map<const RenderNode*, int> depth;
+    for (const RenderNode* node : order) {
+        int below = -1;
+        for (const auto& input : node->inputs()) {
+            if (input)
+                below = std::max(below, depth[input.get()]);
+        }
+
+        const QRect region = regions[node].intersected(node->bounds());
+        if (stages.count(node) && !region.isEmpty()) {
+            m_stages[node] = Stage{node, regions[node], below + 1};
+            depth[node] = below + 1;
+        } else {
+            depth[node] = below;
+        }
+    }
+}
+
+std::vector<QRect> RenderGraph::tiles(const Stage& stage) const
+{
+    if (!stage.node->isTiled())
+        return {stage.node->bounds()};
+
+    std::vector<QRect> result;
+    const QRect bounds = stage.node->bounds();
+    for (int y = stage.region.top(); y <= stage.region.bottom(); y += TileSize) {
+        for (int x = stage.region.left(); x <= stage.region.right(); x += TileSize) {
+            const QRect tile(x, y, TileSize, TileSize);
+            if (tile.intersects(bounds))
+                result.push_back(tile);
+        }
+    }
+    return result;
+}
+
+RenderCache& RenderGraph::cacheFor(const RenderNode& node) const
+{
+    return node.isCached() ? m_cache : m_frame;
+}
+
+bool RenderGraph::isCachedOver(const RenderNode& node, const QRect& region) const
+{
+    QImage image;
+    for (const QRect& tile : tiles(Stage{&node, region, 0})) {
+        if (!m_cache.find(node.key(), tile, image))
+            return false;
+    }
+    return true;
+}
+
+// Everything between stages is evaluated here, on the thread that needs
+// it, for exactly the rectangle asked for.
+QImage RenderGraph::pull(const RenderNode& node, const QRect& rect) const
+{
+    if (!rect.intersects(node.bounds()))
+        return QImage();
+
+    if (m_stages.count(&node))
+        return assemble(node, rect);
+
+    std::vector<QImage> inputs;
+    for (int i = 0; i < static_cast<int>(node.inputs().size()); ++i)
+        inputs.push_back(node.inputs()[i] ? pull(*node.inputs()[i], node.footprint(i, rect)) : QImage());
+    return node.render(rect, std::move(inputs));
+}
+
+// A stage's result for rect, from its cached tiles. A rect that is one
+// whole tile is handed out without a copy.
+QImage RenderGraph::assemble(const RenderNode& node, const QRect& rect) const
+{
+    const auto stage = m_stages.find(&node);
+    if (stage == m_stages.end())
+        return QImage();
+
+    std::vector<std::pair<QRect, QImage>> parts;
+    for (const QRect& tile : tiles(stage->second)) {
+        if (!tile.intersects(rect))
+            continue;
+        QImage image;
+        if (!cacheFor(node).find(node.key(), tile, image)) {
+            std::vector<QImage> inputs;
+            for (int i = 0; i < static_cast<int>(node.inputs().size()); ++i)
+                inputs.push_back(node.inputs()[i] ? pull(*node.inputs()[i], node.footprint(i, tile)) : QImage());
+            image = node.render(tile, std::move(inputs));
+        }
+        if (!image.isNull())
+            parts.emplace_back(tile, std::move(image));
+    }
+
+    if (parts.empty())
+        return QImage();
+    if (parts.size() == 1 && parts.front().first == rect)
+        return parts.front().second;
+
+    QImage result = ImagePool::instance().acquire(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    result.fill(Qt::transparent);
+    uchar* bits = result.bits();
+    const qsizetype stride = result.bytesPerLine();
+    ParallelFor::run(static_cast<int>(parts.size()), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            blit(bits, stride, rect, parts[static_cast<size_t>(i)].second, parts[static_cast<size_t>(i)].first);
+    });
+    return result;
+}
@@ -0,0 +1,132 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <QImage>
+#include <QRect>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// One step of a render. A node produces premultiplied ARGB pixels for any
+// rectangle of the canvas from the pixels of its inputs, and says which
+// part of each input it reads, so a render only evaluates what the
+// requested area depends on.
+class RenderNode
+{
+public:
+    using Ptr = std::shared_ptr<RenderNode>;
+
+    explicit RenderNode(std::vector<Ptr> inputs = {});
+    virtual ~RenderNode() = default;
+
+    const std::vector<Ptr>& inputs() const { return m_inputs; }
+
+    // Outside this rectangle the output is transparent.
+    virtual QRect bounds() const = 0;
+
+    // The part of input i that render() reads to produce roi.
+    virtual QRect footprint(int input, const QRect& roi) const;
+
+    // A node that is not tiled reads the whole of its inputs, e.g. a filter
+    // whose result depends on the image size, and is rendered once over
+    // its bounds.
+    virtual bool isTiled() const { return true; }
+
+    // Cached nodes keep their tiles between renders while key() stays the
+    // same. Other stages keep theirs only until the render ends.
+    bool isCached() const { return m_cached; }
+    void setCached(bool cached) { m_cached = cached; }
+
+    // Equal keys mean equal output. The key covers the inputs' keys, so a
+    // change anywhere reaches every node downstream of it and no other.
+    quint64 key() const { return m_key; }
+
+    // inputs[i] covers footprint(i, roi) and is null where that is fully
+    // transparent. Returns an image of roi's size, or null if transparent.
+    // Runs on worker threads, so it must only read shared state.
+    virtual QImage render(const QRect& roi, std::vector<QImage> inputs) const = 0;
+
+protected:
+    // Called by subclasses once their own state is set; ownKey identifies
+    // that state and is combined with the inputs' keys.
+    void setKey(quint64 ownKey);
+
+private:
+    std::vector<Ptr> m_inputs;
+    quint64 m_key {0};
+    bool m_cached {false};
+};
+
+
+// Results of stages, per node key and tile. Entries not used by a render
+// are dropped when it ends, so the cache holds one frame's worth.
+class RenderCache
+{
+public:
+    RenderCache() = default;
+    // Tiles are never shared between owners; a copy starts out empty.
+    RenderCache(const RenderCache&) {}
+    RenderCache& operator=(const RenderCache&) { clear(); return *this; }
+
+    bool find(quint64 key, const QRect& rect, QImage& image);
+    void insert(quint64 key, const QRect& rect, const QImage& image);
+    void endFrame();
+    void clear();
+
+    qint64 bytesUsed() const;
+
+private:
+    using Key = std::tuple<quint64, int, int, int, int>;
+
+    struct Entry
+    {
+        QImage image;
+        bool used {true};
+    };
+
+    static Key makeKey(quint64 key, const QRect& rect);
+
+    mutable std::mutex m_mutex;
+    std::map<Key, Entry> m_entries;
+};
+
+
+// Evaluates a node graph over a rectangle. Nodes whose results are kept
+// (cached nodes, untiled nodes, their inputs and the output) are stages;
+// everything between two stages is evaluated tile by tile in one pass
+// without intermediate storage. Stages run in dependency levels, and all
+// missing tiles of one level run in parallel. Only cached nodes go to the
+// shared cache; the other stages live in a frame cache that is emptied
+// once the result is assembled.
+class RenderGraph
+{
+public:
+    static constexpr int TileSize = 256;
+
+    explicit RenderGraph(RenderCache& cache);
+
+    QImage render(const RenderNode::Ptr& output, const QRect& rect);
+
+private:
+    struct Stage
+    {
+        const RenderNode* node {nullptr};
+        QRect region;
+        int level {0};
+    };
+
+    void plan(const RenderNode::Ptr& output, const QRect& rect);
+    std::vector<QRect> tiles(const Stage& stage) const;
+    QImage pull(const RenderNode& node, const QRect& rect) const;
+    QImage assemble(const RenderNode& node, const QRect& rect) const;
+    RenderCache& cacheFor(const RenderNode& node) const;
+    bool isCachedOver(const RenderNode& node, const QRect& region) const;
+
+    RenderCache& m_cache;
+    mutable RenderCache m_frame;
+    std::map<const RenderNode*, Stage> m_stages;
+};
+
+#endif // RENDERGRAPH_H
@@ -0,0 +1,190 @@
+#include "autotone.h"
+
+#include "filters/contrastfilter.h"
+#include "filters/exposurefilter.h"
+#include "filters/highlightfilter.h"
+#include "filters/shadowfilter.h"
+#include "filters/temperaturefilter.h"
+#include "parallel/parallelfor.h"
+#include "pipeline/filterpipeline.h"
+#include "profiling/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace {
+
+constexpr double kMidGrey = 118.0;
+constexpr double kWhite = 250.0;
+constexpr double kTargetRange = 240.0;
+constexpr double kShadowTarget = 40.0;
+constexpr double kHighlightTarget = 225.0;
+
+constexpr int kMidLow = 32;
+constexpr int kMidHigh = 224;
+
+struct Sums
+{
+    std::array<int, 256> luma {};
+    int samples {0};
+    qint64 red {0};
+    qint64 green {0};
+    qint64 blue {0};
+    int mid {0};
+};
+
+// Inverse of ContrastFilter's factor, so a wanted slope maps to a slider value.
+int contrastFor(double factor)
+{
+    return qRound(259.0 * 255.0 * (factor - 1.0) / (259.0 + 255.0 * factor));
+}
+
+double contrastFactor(int contrast)
+{
+    return (259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast));
+}
+
+template<class T>
+void setOrRemove(FilterPipeline& pipeline, int value)
+{
+    if (value != 0)
+        pipeline.setOrReplace<T>(value);
+    else
+        pipeline.remove<T>();
+}
+
+}
+
+int AutoTone::Statistics::percentile(double fraction) const
+{
+    const qint64 target = static_cast<qint64>(std::ceil(fraction * samples));
+    qint64 seen = 0;
+    for (int v = 0; v < 256; ++v) {
+        seen += luma[v];
+        if (seen >= std::max<qint64>(1, target))
+            return v;
+    }
+    return 255;
+}
+
+AutoTone::Statistics AutoTone::analyse(const QImage& image)
+{
+    Statistics statistics;
+    if (image.isNull())
+        return statistics;
+
+    ProfileScope scope("analysis", "AutoTone::analyse",
+                       static_cast<qint64>(image.width()) * image.height());
+
+    const QImage source = image.format() == QImage::Format_ARGB32_Premultiplied
+                              ? image
+                              : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    Sums total;
+    std::mutex mutex;
+
+    ParallelFor::run(source.height(), [&](int begin, int end) {
+        Sums local;
+        for (int y = begin; y < end; ++y) {
+            const QRgb* row = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+            for (int x = 0; x < source.width(); ++x) {
+                if (qAlpha(row[x]) == 0)
+                    continue;
+
+                const QRgb px = qUnpremultiply(row[x]);
+                const int r = qRed(px);
+                const int g = qGreen(px);
+                const int b = qBlue(px);
+                const int l = (77 * r + 150 * g + 29 * b) >> 8;
+
+                ++local.luma[l];
+                ++local.samples;
+                if (l >= kMidLow && l <= kMidHigh) {
+                    local.red += r;
+                    local.green += g;
+                    local.blue += b;
+                    ++local.mid;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int v = 0; v < 256; ++v)
+            total.luma[v] += local.luma[v];
+        total.samples += local.samples;
+        total.red += local.red;
+        total.green += local.green;
+        total.blue += local.blue;
+        total.mid += local.mid;
+    }, 16);
+
+    statistics.luma = total.luma;
+    statistics.samples = total.samples;
+    if (total.mid > 0) {
+        statistics.midRed = static_cast<double>(total.red) / total.mid;
+        statistics.midGreen = static_cast<double>(total.green) / total.mid;
+        statistics.midBlue = static_cast<double>(total.blue) / total.mid;
+    }
+
+    return statistics;
+}
+
+AutoTone::Settings AutoTone::suggest(const Statistics& statistics)
+{
+    Settings settings;
+    if (statistics.samples == 0)
+        return settings;
+
+    const double low = statistics.percentile(0.005);
+    const double shadow = statistics.percentile(0.05);
+    const double median = statistics.percentile(0.5);
+    const double highlight = statistics.percentile(0.95);
+    const double high = statistics.percentile(0.995);
+
+    double gain = std::min(kMidGrey / std::max(median, 1.0), kWhite / std::max(high, 1.0));
+    settings.exposure = std::clamp(qRound((gain - 1.0) * 100.0), -50, 100);
+    gain = 1.0 + settings.exposure / 100.0;
+
+    // Half of the stretch that would fill the range; the tone sliders below
+    // deal with the tails.
+    const double spread = std::max(1.0, (high - low) * gain);
+    const double slope = std::clamp(1.0 + 0.5 * (kTargetRange / spread - 1.0), 0.8, 1.4);
+    settings.contrast = std::clamp(contrastFor(slope), -100, 100);
+
+    const double factor = contrastFactor(settings.contrast);
+    auto toned = [gain, factor](double v) {
+        return std::clamp((v * gain - 128.0) * factor + 128.0, 0.0, 255.0);
+    };
+
+    const double shadowLuma = toned(shadow);
+    if (shadowLuma < kShadowTarget) {
+        const double boost = (kShadowTarget / std::max(shadowLuma, 4.0) - 1.0) / (1.0 - shadowLuma / 255.0);
+        settings.shadows = qRound(std::min(boost, 0.5) * 100.0);
+    }
+
+    const double highlightLuma = toned(highlight);
+    if (highlightLuma > kHighlightTarget) {
+        const double cut = (1.0 - kHighlightTarget / highlightLuma) / (highlightLuma / 255.0);
+        settings.highlights = qRound(std::min(cut, 0.5) * 100.0);
+    }
+
+    // TemperatureFilter moves red and blue apart by 1.2 per step. Only half
+    // of the grey-world correction is taken, since plenty of scenes are not
+    // grey on average.
+    if (statistics.midRed > 0.0 || statistics.midBlue > 0.0) {
+        const double cast = (statistics.midBlue - statistics.midRed) * gain;
+        settings.temperature = std::clamp(qRound(0.5 * cast / 1.2), -40, 40);
+    }
+
+    return settings;
+}
+
+void AutoTone::apply(const Settings& settings, FilterPipeline& pipeline)
+{
+    setOrRemove<ExposureFilter>(pipeline, settings.exposure);
+    setOrRemove<ContrastFilter>(pipeline, settings.contrast);
+    setOrRemove<ShadowFilter>(pipeline, settings.shadows);
+    setOrRemove<HighlightFilter>(pipeline, settings.highlights);
+    setOrRemove<TemperatureFilter>(pipeline, settings.temperature);
+}
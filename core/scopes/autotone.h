@@ -0,0 +1,49 @@
+#ifndef AUTOTONE_H
+#define AUTOTONE_H
+
+#include <QImage>
+#include <array>
+
+class FilterPipeline;
+
+// One-click tone settings from image statistics. Exposure puts the median
+// luma on middle grey without pushing the bright end past white, contrast
+// stretches the range that is left, shadows and highlights pull in the
+// tails, and temperature neutralises the average midtone. analyse() only
+// looks at the pixels it is given, so callers pass a small proxy.
+class AutoTone
+{
+public:
+    static constexpr int ProxyLongSide = 1024;
+
+    struct Statistics
+    {
+        std::array<int, 256> luma {};
+        int samples {0};
+        // Mean of pixels with mid luma, where a colour cast is not yet
+        // hidden by clipping.
+        double midRed {0.0};
+        double midGreen {0.0};
+        double midBlue {0.0};
+
+        // Luma below which the given fraction of samples falls.
+        int percentile(double fraction) const;
+    };
+
+    struct Settings
+    {
+        int exposure {0};
+        int contrast {0};
+        int shadows {0};
+        int highlights {0};
+        int temperature {0};
+    };
+
+    static Statistics analyse(const QImage& image);
+    static Settings suggest(const Statistics& statistics);
+    // Replaces the five filters in the pipeline; a zero setting removes its
+    // filter.
+    static void apply(const Settings& settings, FilterPipeline& pipeline);
+};
+
+#endif // AUTOTONE_H
@@ -0,0 +1,153 @@
+#include "scopes.h"
+#include "parallel/parallelfor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+// Bins local to one chunk of tiles, merged into the totals once the chunk
+// is done so threads never share a counter.
+struct Scopes::Bins
+{
+    explicit Bins(int width)
+        : histogram(static_cast<size_t>(ChannelCount) * Levels),
+          waveform(static_cast<size_t>(width) * Levels),
+          vectorscope(static_cast<size_t>(VectorscopeSize) * VectorscopeSize) {}
+
+    std::vector<int> histogram;
+    std::vector<int> waveform;
+    std::vector<int> vectorscope;
+    int samples {0};
+};
+
+namespace {
+
+bool tileDiffers(const QImage& a, const QImage& b, const QRect& rect)
+{
+    const size_t bytes = static_cast<size_t>(rect.width()) * 4;
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        if (std::memcmp(a.constScanLine(y) + rect.left() * 4, b.constScanLine(y) + rect.left() * 4, bytes) != 0)
+            return true;
+    }
+    return false;
+}
+
+void addTo(std::vector<int>& total, const std::vector<int>& part, int weight)
+{
+    for (size_t i = 0; i < total.size(); ++i)
+        total[i] += part[i] * weight;
+}
+
+}
+
+QImage Scopes::sample(const QImage& frame, int longSide)
+{
+    if (frame.isNull())
+        return QImage();
+
+    const int step = std::max(1, (std::max(frame.width(), frame.height()) + longSide - 1) / longSide);
+    const int width = std::max(1, frame.width() / step);
+    const int height = std::max(1, frame.height() / step);
+
+    QImage proxy(width, height, QImage::Format_ARGB32);
+    for (int y = 0; y < height; ++y) {
+        const QRgb* in = reinterpret_cast<const QRgb*>(frame.constScanLine(std::min(y * step + step / 2, frame.height() - 1)));
+        QRgb* out = reinterpret_cast<QRgb*>(proxy.scanLine(y));
+        for (int x = 0; x < width; ++x)
+            out[x] = qUnpremultiply(in[std::min(x * step + step / 2, frame.width() - 1)]);
+    }
+
+    return proxy;
+}
+
+Scopes::Scopes()
+{
+    clear();
+}
+
+void Scopes::clear()
+{
+    m_proxy = QImage();
+    m_histogram.assign(static_cast<size_t>(ChannelCount) * Levels, 0);
+    m_waveform.clear();
+    m_vectorscope.assign(static_cast<size_t>(VectorscopeSize) * VectorscopeSize, 0);
+    m_samples = 0;
+}
+
+int Scopes::update(const QImage& frame)
+{
+    const QImage proxy = sample(frame, ProxyLongSide);
+
+    std::vector<QRect> all;
+    for (int y = 0; y < proxy.height(); y += TileSize) {
+        for (int x = 0; x < proxy.width(); x += TileSize)
+            all.push_back(QRect(x, y, TileSize, TileSize).intersected(proxy.rect()));
+    }
+
+    if (proxy.size() != m_proxy.size() || m_proxy.isNull()) {
+        clear();
+        m_waveform.assign(static_cast<size_t>(proxy.width()) * Levels, 0);
+        m_proxy = proxy;
+        accumulate(all, proxy, 1);
+        return static_cast<int>(all.size());
+    }
+
+    std::vector<QRect> dirty;
+    for (const QRect& rect : all) {
+        if (tileDiffers(m_proxy, proxy, rect))
+            dirty.push_back(rect);
+    }
+
+    accumulate(dirty, m_proxy, -1);
+    accumulate(dirty, proxy, 1);
+    m_proxy = proxy;
+    return static_cast<int>(dirty.size());
+}
+
+void Scopes::accumulate(const std::vector<QRect>& tiles, const QImage& proxy, int weight)
+{
+    if (tiles.empty() || proxy.isNull())
+        return;
+
+    std::mutex mergeMutex;
+
+    ParallelFor::run(static_cast<int>(tiles.size()), [&](int begin, int end) {
+        Bins bins(proxy.width());
+
+        for (int t = begin; t < end; ++t) {
+            const QRect& rect = tiles[static_cast<size_t>(t)];
+
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                const QRgb* row = reinterpret_cast<const QRgb*>(proxy.constScanLine(y));
+
+                for (int x = rect.left(); x <= rect.right(); ++x) {
+                    const QRgb px = row[x];
+                    if (qAlpha(px) == 0)
+                        continue;
+
+                    const int r = qRed(px);
+                    const int g = qGreen(px);
+                    const int b = qBlue(px);
+                    const int luma = (19595 * r + 38470 * g + 7471 * b + 32768) >> 16;
+                    const int cb = std::clamp(((-11059 * r - 21709 * g + 32768 * b + 32768) >> 16) + 128, 0, 255);
+                    const int cr = std::clamp(((32768 * r - 27439 * g - 5329 * b + 32768) >> 16) + 128, 0, 255);
+
+                    ++bins.histogram[static_cast<size_t>(Red * Levels + r)];
+                    ++bins.histogram[static_cast<size_t>(Green * Levels + g)];
+                    ++bins.histogram[static_cast<size_t>(Blue * Levels + b)];
+                    ++bins.histogram[static_cast<size_t>(Luma * Levels + luma)];
+                    ++bins.waveform[static_cast<size_t>(luma) * proxy.width() + x];
+                    ++bins.vectorscope[static_cast<size_t>(cr * VectorscopeSize / Levels) * VectorscopeSize
+                                       + cb * VectorscopeSize / Levels];
+                    ++bins.samples;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        addTo(m_histogram, bins.histogram, weight);
+        addTo(m_waveform, bins.waveform, weight);
+        addTo(m_vectorscope, bins.vectorscope, weight);
+        m_samples += bins.samples * weight;
+    }, 8);
+}
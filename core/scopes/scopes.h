@@ -0,0 +1,57 @@
+#ifndef SCOPES_H
+#define SCOPES_H
+
+#include <QImage>
+#include <vector>
+
+// Histogram, luma waveform and Cb/Cr vectorscope of a downsampled proxy of
+// the rendered frame. All three are plain bin counts, so update() only
+// recomputes proxy tiles that changed since the previous frame: it removes
+// each dirty tile's old contribution and adds its new one.
+class Scopes
+{
+public:
+    enum Channel {
+        Red,
+        Green,
+        Blue,
+        Luma,
+        ChannelCount
+    };
+
+    static constexpr int Levels = 256;
+    static constexpr int VectorscopeSize = 128;
+    static constexpr int ProxyLongSide = 512;
+    static constexpr int TileSize = 32;
+
+    Scopes();
+
+    // Returns how many proxy tiles were recomputed.
+    int update(const QImage& frame);
+    void clear();
+
+    const int* histogram(Channel channel) const { return m_histogram.data() + channel * Levels; }
+    // waveformWidth() columns by Levels rows, row 0 holding luma 0.
+    int waveformWidth() const { return m_proxy.width(); }
+    const std::vector<int>& waveform() const { return m_waveform; }
+    // VectorscopeSize^2 bins; x is Cb and y is Cr, both increasing.
+    const std::vector<int>& vectorscope() const { return m_vectorscope; }
+    int sampleCount() const { return m_samples; }
+
+    // Nearest-neighbour sample with the longer side at most longSide,
+    // unpremultiplied.
+    static QImage sample(const QImage& frame, int longSide);
+
+private:
+    struct Bins;
+
+    void accumulate(const std::vector<QRect>& tiles, const QImage& proxy, int weight);
+
+    QImage m_proxy;
+    std::vector<int> m_histogram;
+    std::vector<int> m_waveform;
+    std::vector<int> m_vectorscope;
+    int m_samples {0};
+};
+
+#endif // SCOPES_H
@@ -3,7 +3,7 @@
 #include <QScrollBar>
 #include <QPainter>
 #include <algorithm>
-#include <QGraphicsDropShadowEffect>
+#include <cmath>
 #include "tool.h"
 #include "layercommands.h"
 #include "cropcommand.h"
@@ -23,51 +23,58 @@ MyGraphicsView::MyGraphicsView(QGraphicsScene* scene, QWidget* parent)
     setTransformationAnchor(QGraphicsView::AnchorViewCenter);
     setResizeAnchor(QGraphicsView::AnchorUnderMouse);
     setDragMode(QGraphicsView::NoDrag);
-
+    setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+    setCacheMode(QGraphicsView::CacheBackground);
+    setOptimizationFlag(QGraphicsView::DontSavePainterState);
 }
 
 
-void MyGraphicsView::setPixmap(const QPixmap& pixmap)
+void MyGraphicsView::setImage(const QImage& image)
 {
-
-
-    if (!pixmapItem) {
-        pixmapItem = m_scene->addPixmap(pixmap);
-
-        auto* shadow = new QGraphicsDropShadowEffect;
-        shadow->setBlurRadius(40);
-        shadow->setOffset(0, 8);
-        shadow->setColor(QColor(0, 0, 0, 120));
-        pixmapItem->setGraphicsEffect(shadow);
-    } else {
-        pixmapItem->setPixmap(pixmap);
+    if (!m_canvasItem) {
+        m_canvasItem = new CanvasItem;
+        m_canvasItem->setDisplayLut(m_displayLut);
+        m_scene->addItem(m_canvasItem);
     }
 
+    m_canvasItem->setImage(image);
+
     if (m_layerManager) {
 
-        pixmapItem->setPos(m_layerManager->compositeOffset());
+        m_canvasItem->setPos(m_layerManager->compositeOffset());
     } else {
 
-        pixmapItem->setPos(0, 0);
+        m_canvasItem->setPos(0, 0);
     }
 
+    m_scene->setSceneRect(canvasSceneRect());
+}
 
-
-    m_scene->setSceneRect(pixmapItem->sceneBoundingRect());
-
-
+QRectF MyGraphicsView::canvasSceneRect() const
+{
+    if (!m_canvasItem)
+        return QRectF();
+    return m_canvasItem->mapRectToScene(m_canvasItem->imageRect());
 }
 
 void MyGraphicsView::clearPixmap()
 {
-    if (pixmapItem) {
-        m_scene->removeItem(pixmapItem);
-        delete pixmapItem;
-        pixmapItem = nullptr;
+    if (m_canvasItem) {
+        m_scene->removeItem(m_canvasItem);
+        delete m_canvasItem;
+        m_canvasItem = nullptr;
     }
     m_scene->setSceneRect(QRectF());
 }
 
+void MyGraphicsView::setDisplayProfiles(const QColorSpace& document, const QColorSpace& monitor)
+{
+    m_displayLut = ColorLut3D(document, monitor);
+
+    if (m_canvasItem)
+        m_canvasItem->setDisplayLut(m_displayLut);
+}
+
 
 void MyGraphicsView::wheelEvent(QWheelEvent* event)
 {
@@ -114,6 +121,8 @@ void MyGraphicsView::mousePressEvent(QMouseEvent* event)
         if (m_layerManager)
             m_layerManager->setPainting(true);
 
+        emit strokeAboutToBegin();
+
         QPoint imgPos = mapToActiveLayerImage(scenePos);
         m_activeTool->onMousePress(imgPos, event->button());
         event->accept();
@@ -123,15 +132,15 @@ void MyGraphicsView::mousePressEvent(QMouseEvent* event)
 
     if (event->button() == Qt::LeftButton && m_layerManager) {
         int hitIndex = -1;
-        auto pixelLayer = hitTestLayers(scenePos, hitIndex);
-        if (pixelLayer) {
+        auto placedLayer = hitTestLayers(scenePos, hitIndex);
+        if (placedLayer) {
             m_layerManager->setActiveLayerIndex(hitIndex);
 
             m_dragStartScene = scenePos;
-            m_initialOffset  = pixelLayer->offset();
-            m_initialScale   = pixelLayer->scale();
+            m_initialOffset  = placedLayer->offset();
+            m_initialScale   = placedLayer->scale();
 
-            QSizeF imgSize = pixelLayer->image().size();
+            QSizeF imgSize = placedLayer->transformedSize();
             m_initialCenter = m_initialOffset +
                               QPointF(imgSize.width() * m_initialScale / 2.0,
                                       imgSize.height() * m_initialScale / 2.0);
@@ -140,13 +149,13 @@ void MyGraphicsView::mousePressEvent(QMouseEvent* event)
             if (handle >= 0) {
                 m_dragContext = DragContext::ScaleLayer;
                 m_dragLayerIndex = hitIndex;
-                m_scaleStartOffset = pixelLayer->offset();
-                m_scaleStartScale = pixelLayer->scale();
+                m_scaleStartOffset = placedLayer->offset();
+                m_scaleStartScale = placedLayer->scale();
                 event->accept();
                 return;
             }
 
-            if (pixelLayer->bounds().contains(scenePos)) {
+            if (placedLayer->bounds().contains(scenePos)) {
                 m_dragContext = DragContext::MoveLayer;
                 m_dragLayerIndex = hitIndex;
                 event->accept();
@@ -192,7 +201,7 @@ void MyGraphicsView::mouseMoveEvent(QMouseEvent* event)
 
 
     case DragContext::MoveLayer: {
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(
+        auto layer = std::dynamic_pointer_cast<PlacedLayer>(
             m_layerManager->layerAt(m_dragLayerIndex));
         if (!layer) return;
 
@@ -205,7 +214,7 @@ void MyGraphicsView::mouseMoveEvent(QMouseEvent* event)
     }
 
     case DragContext::ScaleLayer: {
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(
+        auto layer = std::dynamic_pointer_cast<PlacedLayer>(
             m_layerManager->layerAt(m_dragLayerIndex));
         if (!layer) return;
 
@@ -216,7 +225,7 @@ void MyGraphicsView::mouseMoveEvent(QMouseEvent* event)
         qreal factor = v1.manhattanLength() / v0.manhattanLength();
         float newScale = std::max(0.01f, float(m_initialScale * factor));
 
-        QSizeF imgSize = layer->image().size();
+        QSizeF imgSize = layer->transformedSize();
         QPointF newOffset = m_initialCenter -
                             QPointF(imgSize.width() * newScale / 2.0,
                                     imgSize.height() * newScale / 2.0);
@@ -249,35 +258,15 @@ void MyGraphicsView::mouseReleaseEvent(QMouseEvent* event)
         QRect viewRect = QRect(getCropStart(), event->pos()).normalized();
         QRectF sceneRect = mapToScene(viewRect).boundingRect();
 
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(
-            m_layerManager->activeLayer());
+        const QRect cropRect = sceneRect.toAlignedRect().intersected(m_layerManager->canvasRect());
 
-        if (layer) {
-            QRectF layerRect = layer->bounds();
-            QRectF cropScene = sceneRect.intersected(layerRect);
+        if (!cropRect.isEmpty()) {
+            auto cmd = std::make_unique<CropCommand>(
+                *m_layerManager,
+                cropRect
+                );
 
-            if (!cropScene.isEmpty()) {
-
-                QRect cropImg(
-                    int((cropScene.left() - layerRect.left()) / layer->scale()),
-                    int((cropScene.top()  - layerRect.top())  / layer->scale()),
-                    int(cropScene.width()  / layer->scale()),
-                    int(cropScene.height() / layer->scale())
-                    );
-
-                cropImg = cropImg.intersected(layer->image().rect());
-
-                if (!cropImg.isEmpty()) {
-
-                    auto cmd = std::make_unique<CropCommand>(
-                        *m_layerManager,
-                        cropImg
-                        );
-
-                    emit commandReady(cmd.release());
-
-                }
-            }
+            emit commandReady(cmd.release());
         }
 
         setCropMode(false);
@@ -289,7 +278,7 @@ void MyGraphicsView::mouseReleaseEvent(QMouseEvent* event)
 
     if (m_dragContext == DragContext::MoveLayer)
     {
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(
+        auto layer = std::dynamic_pointer_cast<PlacedLayer>(
             m_layerManager->layerAt(m_dragLayerIndex));
 
         if (layer) {
@@ -309,7 +298,7 @@ void MyGraphicsView::mouseReleaseEvent(QMouseEvent* event)
 
     if (m_dragContext == DragContext::ScaleLayer)
     {
-        auto layer = std::dynamic_pointer_cast<PixelLayer>(
+        auto layer = std::dynamic_pointer_cast<PlacedLayer>(
             m_layerManager->layerAt(m_dragLayerIndex));
 
         if (layer) {
@@ -353,6 +342,16 @@ QPoint MyGraphicsView::mapToActiveLayerImage(const QPointF& scenePos) const
     if (!m_layerManager)
         return {};
 
+    if (m_maskEditing) {
+        auto layer = m_layerManager->activeLayer();
+        if (!layer || !layer->mask() || m_maskSurfaceRect.isEmpty())
+            return {};
+
+        const QRect& rect = m_maskSurfaceRect;
+        return QPoint(qBound(0, int(std::floor(scenePos.x())) - rect.left(), rect.width() - 1),
+                      qBound(0, int(std::floor(scenePos.y())) - rect.top(), rect.height() - 1));
+    }
+
     auto layer = std::dynamic_pointer_cast<PixelLayer>(
         m_layerManager->activeLayer());
 
@@ -360,6 +359,7 @@ QPoint MyGraphicsView::mapToActiveLayerImage(const QPointF& scenePos) const
         return {};
 
     QPointF local = (scenePos - layer->offset()) / layer->scale();
+    local = layer->imageToLayer().inverted().map(local);
 
     int x = qBound(0, int(local.x()), layer->image().width()  - 1);
     int y = qBound(0, int(local.y()), layer->image().height() - 1);
@@ -367,12 +367,17 @@ QPoint MyGraphicsView::mapToActiveLayerImage(const QPointF& scenePos) const
     return QPoint(x, y);
 }
 
+QRectF MyGraphicsView::visibleSceneRect() const
+{
+    return mapToScene(viewport()->rect()).boundingRect();
+}
+
 QRectF MyGraphicsView::activeLayerBounds() const
 {
     if (!m_layerManager)
         return {};
 
-    auto layer = std::dynamic_pointer_cast<PixelLayer>(
+    auto layer = std::dynamic_pointer_cast<PlacedLayer>(
         m_layerManager->activeLayer());
 
     return layer ? layer->bounds() : QRectF{};
@@ -411,7 +416,7 @@ int MyGraphicsView::hitHandle(const QPointF& scenePos) const
     return -1;
 }
 
-std::shared_ptr<PixelLayer>
+std::shared_ptr<PlacedLayer>
 MyGraphicsView::hitTestLayers(const QPointF& scenePos, int& outIndex) const
 {
     outIndex = -1;
@@ -419,14 +424,14 @@ MyGraphicsView::hitTestLayers(const QPointF& scenePos, int& outIndex) const
         return nullptr;
 
     for (int i = m_layerManager->layerCount() - 1; i >= 0; --i) {
-        auto pixel = std::dynamic_pointer_cast<PixelLayer>(
+        auto placed = std::dynamic_pointer_cast<PlacedLayer>(
             m_layerManager->layerAt(i));
 
-        if (pixel && pixel->isVisible() &&
-            pixel->bounds().contains(scenePos))
+        if (placed && placed->isVisible() &&
+            placed->bounds().contains(scenePos))
         {
             outIndex = i;
-            return pixel;
+            return placed;
         }
     }
     return nullptr;
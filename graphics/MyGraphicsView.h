@@ -8,13 +8,15 @@
 #include <QRubberBand>
 #include <QPixmap>
 #include <QRect>
-#include <QGraphicsPixmapItem>
 #include <QtGlobal>
 #include <QPainter>
 #include <QVector>
+#include <QColorSpace>
 #include <memory>
 #include "command.h"
 #include "layers/layermanager.h"
+#include "color/colorlut3d.h"
+#include "canvasitem.h"
 
 
 enum class DragContext {
@@ -39,18 +41,15 @@ public:
 
 
 
-    QPixmap getPixmap() const {
-        return m_pixmap;
+    CanvasItem* getCanvasItem() {
+        return m_canvasItem;
     }
-
-
-
-    QGraphicsPixmapItem* getPixmapItem() {
-        return pixmapItem;
-    }
-    void setPixmap(const QPixmap &pixmap);
+    QRectF canvasSceneRect() const;
     void clearPixmap();
 
+    void setImage(const QImage& image);
+    void setDisplayProfiles(const QColorSpace& document, const QColorSpace& monitor);
+
     QPoint getCropStart() const {
         return m_cropStart;
     }
@@ -76,6 +75,15 @@ public:
 
     void setActiveTool(Tool* tool) { m_activeTool = tool; }
 
+    // Tools then paint on the active layer's mask, in document space.
+    void setMaskEditing(bool enabled) { m_maskEditing = enabled; }
+    // Document rect of the surface that stands in for the mask while it is
+    // edited; tool positions are relative to its top-left.
+    void setMaskSurfaceRect(const QRect& rect) { m_maskSurfaceRect = rect; }
+
+    // Part of the scene the viewport shows.
+    QRectF visibleSceneRect() const;
+
     void setLayerManager(LayerManager* manager) { m_layerManager = manager; }
 
 
@@ -91,6 +99,9 @@ signals:
     void zoomChanged(double scale);
     void cropFinished(QRect rect);
     void commandReady(Command* cmd);
+    // Sent before the active tool sees the press that starts a stroke, so
+    // its target can be brought up to date.
+    void strokeAboutToBegin();
 
 protected:
     void wheelEvent(QWheelEvent *event) override;
@@ -108,9 +119,9 @@ private:
     QRectF activeLayerBounds() const;
     QVector<QRectF> handleRects(const QRectF& bounds) const;
     int hitHandle(const QPointF& scenePos) const;
-    std::shared_ptr<PixelLayer> hitTestLayers(const QPointF& scenePos, int& outIndex) const;
+    std::shared_ptr<PlacedLayer> hitTestLayers(const QPointF& scenePos, int& outIndex) const;
 
-    QPixmap m_pixmap{};
+    ColorLut3D m_displayLut{};
     QPointF m_scaleStartOffset;
     float m_scaleStartScale {1.0f};
     bool m_cropMode {false};
@@ -121,9 +132,11 @@ private:
     QRubberBand *rubberBand{nullptr};
 
     Tool* m_activeTool {nullptr};
+    bool m_maskEditing {false};
+    QRect m_maskSurfaceRect;
     qreal getHandleSize() const;
     QGraphicsScene* m_scene {nullptr};
-    QGraphicsPixmapItem *pixmapItem{};
+    CanvasItem* m_canvasItem {nullptr};
     DragContext m_dragContext = DragContext::None;
     DragMode m_dragMode {DragMode::None};
     LayerManager* m_layerManager {nullptr};
@@ -0,0 +1,195 @@
+#include "canvasitem.h"
+
+#include "filters/fastblur.h"
+#include "parallel/parallelfor.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr int kShadowRadius = 40;
+constexpr int kShadowOffset = 8;
+const QColor kShadowColor(0, 0, 0, 120);
+
+bool tileDiffers(const QImage& a, const QImage& b, const QRect& rect)
+{
+    const size_t bytes = static_cast<size_t>(rect.width()) * 4;
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar* pa = a.constScanLine(y) + rect.left() * 4;
+        const uchar* pb = b.constScanLine(y) + rect.left() * 4;
+        if (std::memcmp(pa, pb, bytes) != 0)
+            return true;
+    }
+    return false;
+}
+}
+
+CanvasItem::CanvasItem(QGraphicsItem* parent)
+    : QGraphicsItem(parent)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF CanvasItem::imageRect() const
+{
+    return QRectF(QPointF(0, 0), QSizeF(m_image.size()));
+}
+
+QRectF CanvasItem::boundingRect() const
+{
+    if (m_image.isNull())
+        return QRectF();
+
+    const QRectF shadow = imageRect()
+                              .translated(0, kShadowOffset)
+                              .adjusted(-kShadowRadius, -kShadowRadius, kShadowRadius, kShadowRadius);
+    return shadow.united(imageRect());
+}
+
+QRect CanvasItem::tileRect(int column, int row) const
+{
+    return QRect(column * TileSize, row * TileSize, TileSize, TileSize).intersected(m_image.rect());
+}
+
+void CanvasItem::resetTiles()
+{
+    m_columns = (m_image.width() + TileSize - 1) / TileSize;
+    m_rows = (m_image.height() + TileSize - 1) / TileSize;
+    m_tiles.assign(static_cast<size_t>(m_columns) * m_rows, Tile{});
+}
+
+void CanvasItem::setImage(const QImage& input)
+{
+    const QImage image = input.format() == QImage::Format_ARGB32_Premultiplied
+        ? input
+        : input.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    if (image.cacheKey() == m_image.cacheKey())
+        return;
+
+    if (image.size() != m_image.size()) {
+        prepareGeometryChange();
+        m_image = image;
+        resetTiles();
+        update();
+        return;
+    }
+
+    std::vector<char> changed(m_tiles.size(), 0);
+
+    ParallelFor::run(static_cast<int>(m_tiles.size()), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            if (m_tiles[static_cast<size_t>(i)].stale)
+                continue;
+            changed[static_cast<size_t>(i)] = tileDiffers(m_image, image, tileRect(i % m_columns, i / m_columns));
+        }
+    });
+
+    m_image = image;
+
+    for (size_t i = 0; i < m_tiles.size(); ++i) {
+        if (!changed[i])
+            continue;
+
+        m_tiles[i].stale = true;
+        update(tileRect(static_cast<int>(i) % m_columns, static_cast<int>(i) / m_columns));
+    }
+}
+
+void CanvasItem::setDisplayLut(const ColorLut3D& lut)
+{
+    m_displayLut = lut;
+
+    for (auto& tile : m_tiles)
+        tile.stale = true;
+    update();
+}
+
+void CanvasItem::uploadTile(Tile& tile, const QRect& rect)
+{
+    QImage part = m_image.copy(rect);
+    m_displayLut.apply(part);
+
+    tile.pixmap = QPixmap::fromImage(part);
+    tile.stale = false;
+}
+
+void CanvasItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    if (m_image.isNull())
+        return;
+
+    const QRectF exposed = option->exposedRect;
+    paintShadow(painter, exposed);
+
+    const QRect area = exposed.toAlignedRect().intersected(m_image.rect());
+    if (area.isEmpty())
+        return;
+
+    const int c0 = area.left() / TileSize;
+    const int c1 = area.right() / TileSize;
+    const int r0 = area.top() / TileSize;
+    const int r1 = area.bottom() / TileSize;
+
+    for (int row = r0; row <= r1; ++row) {
+        for (int column = c0; column <= c1; ++column) {
+            Tile& tile = m_tiles[static_cast<size_t>(row) * m_columns + column];
+            const QRect rect = tileRect(column, row);
+
+            if (tile.stale)
+                uploadTile(tile, rect);
+
+            painter->drawPixmap(rect.topLeft(), tile.pixmap);
+        }
+    }
+}
+
+QImage CanvasItem::createShadow()
+{
+    const int size = kShadowRadius * 4;
+
+    QImage shadow(size, size, QImage::Format_ARGB32_Premultiplied);
+    shadow.fill(Qt::transparent);
+
+    QPainter painter(&shadow);
+    painter.fillRect(QRect(kShadowRadius, kShadowRadius, kShadowRadius * 2, kShadowRadius * 2), kShadowColor);
+    painter.end();
+
+    return FastBlur::apply(shadow, kShadowRadius / 3);
+}
+
+// The blurred shadow of a rectangle is drawn as a nine-slice border around the
+// image: corners are copied from a small pre-blurred sample, edges stretch its
+// middle row or column. The interior is hidden by the image and never drawn.
+void CanvasItem::paintShadow(QPainter* painter, const QRectF& exposed)
+{
+    const QRectF target = imageRect()
+                              .translated(0, kShadowOffset)
+                              .adjusted(-kShadowRadius, -kShadowRadius, kShadowRadius, kShadowRadius);
+    if (!exposed.intersects(target))
+        return;
+
+    if (m_shadow.isNull())
+        m_shadow = createShadow();
+
+    const int size = m_shadow.width();
+    const int mid = size / 2;
+    const qreal cw = std::min<qreal>(mid, target.width() / 2);
+    const qreal ch = std::min<qreal>(mid, target.height() / 2);
+    const qreal l = target.left();
+    const qreal t = target.top();
+    const qreal r = target.right();
+    const qreal b = target.bottom();
+
+    painter->drawImage(QRectF(l, t, cw, ch), m_shadow, QRectF(0, 0, cw, ch));
+    painter->drawImage(QRectF(r - cw, t, cw, ch), m_shadow, QRectF(size - cw, 0, cw, ch));
+    painter->drawImage(QRectF(l, b - ch, cw, ch), m_shadow, QRectF(0, size - ch, cw, ch));
+    painter->drawImage(QRectF(r - cw, b - ch, cw, ch), m_shadow, QRectF(size - cw, size - ch, cw, ch));
+
+    painter->drawImage(QRectF(l + cw, t, target.width() - 2 * cw, ch), m_shadow, QRectF(mid, 0, 1, ch));
+    painter->drawImage(QRectF(l + cw, b - ch, target.width() - 2 * cw, ch), m_shadow, QRectF(mid, size - ch, 1, ch));
+    painter->drawImage(QRectF(l, t + ch, cw, target.height() - 2 * ch), m_shadow, QRectF(0, mid, cw, 1));
+    painter->drawImage(QRectF(r - cw, t + ch, cw, target.height() - 2 * ch), m_shadow, QRectF(size - cw, mid, cw, 1));
+}
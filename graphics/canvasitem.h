@@ -0,0 +1,51 @@
+#ifndef CANVASITEM_H
+#define CANVASITEM_H
+
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPixmap>
+#include <vector>
+
+#include "color/colorlut3d.h"
+
+// Displays the composite as a grid of pixmap tiles. Only tiles whose pixels
+// changed are marked stale, and stale tiles are converted and uploaded lazily
+// the first time they are exposed, so off-screen parts of the canvas cost
+// nothing until the user scrolls to them.
+class CanvasItem : public QGraphicsItem
+{
+public:
+    static constexpr int TileSize = 256;
+
+    explicit CanvasItem(QGraphicsItem* parent = nullptr);
+
+    void setImage(const QImage& image);
+    const QImage& image() const { return m_image; }
+
+    void setDisplayLut(const ColorLut3D& lut);
+
+    QRectF imageRect() const;
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    struct Tile {
+        QPixmap pixmap;
+        bool stale {true};
+    };
+
+    QRect tileRect(int column, int row) const;
+    void resetTiles();
+    void uploadTile(Tile& tile, const QRect& rect);
+    void paintShadow(QPainter* painter, const QRectF& exposed);
+    static QImage createShadow();
+
+    QImage m_image;
+    ColorLut3D m_displayLut;
+    std::vector<Tile> m_tiles;
+    int m_columns {0};
+    int m_rows {0};
+    QImage m_shadow;
+};
+
+#endif // CANVASITEM_H
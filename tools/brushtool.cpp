@@ -127,6 +127,9 @@ std::unique_ptr<Command> BrushTool::endStroke()
     *targetImage() = m_previewBuffer;
     requestUpdate();
 
+    if (strokeCommandFactory())
+        return strokeCommandFactory()(rect, before, after, mask);
+
     return std::make_unique<StrokeCommand>(
         targetImage(),
         rect,
@@ -142,6 +145,14 @@ std::unique_ptr<Command> BrushTool::endStroke()
 }
 
 
+QRect BrushTool::strokeRect() const
+{
+    if (!m_drawing || !targetImage())
+        return {};
+    return m_boundingRect.intersected(targetImage()->rect());
+}
+
+
 QRect BrushTool::expandedRect(const QPoint& a, const QPoint& b) const
 {
     QRect base = QRect(a, b).normalized();
@@ -13,6 +13,7 @@ public:
     void onMousePress(const QPoint& imagePos, Qt::MouseButton button) override;
     void onMouseMove(const QPoint& imagePos, Qt::MouseButtons buttons) override;
     std::unique_ptr<Command> onMouseRelease(const QPoint& imagePos, Qt::MouseButton button) override;
+    QRect strokeRect() const override;
 
 protected:
     virtual void paintStroke(QPainter& painter, const QPoint& from, const QPoint& to);
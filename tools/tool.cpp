@@ -27,3 +27,7 @@ void Tool::requestUpdate() const
 void Tool::setTargetImage(QImage* image) {
     m_targetImage = image;
 }
+
+void Tool::setStrokeCommandFactory(StrokeCommandFactory factory) {
+    m_strokeCommandFactory = std::move(factory);
+}
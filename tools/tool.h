@@ -6,6 +6,7 @@
 #include <QPoint>
 #include <QImage>
 #include <functional>
+#include <memory>
 #include "MyGraphicsView.h"
 
 class Command;
@@ -13,6 +14,11 @@ class Command;
 class Tool
 {
 public:
+    // Builds the undo command for a finished stroke from the changed rect of
+    // the target, its pixels before and after, and the Alpha8 coverage.
+    using StrokeCommandFactory = std::function<std::unique_ptr<Command>(
+        const QRect& rect, const QImage& before, const QImage& after, const QImage& coverage)>;
+
     explicit Tool(QImage* targetImage, std::function<void()> updateCallback, MyGraphicsView* view);
     virtual ~Tool() = default;
 
@@ -28,6 +34,13 @@ public:
 
     void setTargetImage(QImage* image);
 
+    // Replaces the StrokeCommand that targets the image directly, for targets
+    // that are a working copy of some other storage.
+    void setStrokeCommandFactory(StrokeCommandFactory factory);
+
+    // Part of the target touched by the stroke in progress.
+    virtual QRect strokeRect() const { return {}; }
+
     virtual bool hasPreview() const { return false; }
     virtual const QImage& previewImage() const
     {
@@ -37,6 +50,7 @@ public:
 
 protected:
     QImage* targetImage() const { return m_targetImage; }
+    const StrokeCommandFactory& strokeCommandFactory() const { return m_strokeCommandFactory; }
     MyGraphicsView* m_view{};
     void requestUpdate() const;
 
@@ -46,6 +60,7 @@ private:
     QColor m_color {Qt::white};
     QImage* m_targetImage {nullptr};
     std::function<void()> m_updateCallback {};
+    StrokeCommandFactory m_strokeCommandFactory {};
 };
 
 #endif // TOOL_H
@@ -24,6 +24,7 @@
 #include <QMessageBox>
 #include <QActionGroup>
 #include <QPixmap>
+#include <QThread>
 #include <memory>
 
 #include <QSvgRenderer>
@@ -31,7 +32,11 @@
 #include "rotatelayercommand.h"
 #include "fliplayercommand.h"
 #include "image/imageio.h"
+#include "profiling/profiler.h"
+#include "scopes/autotone.h"
 #include "cropcommand.h"
+#include "trimcommand.h"
+#include "maskstrokecommand.h"
 #include "layercommands.h"
 #include <QPainter>
 #include <QPixmap>
@@ -45,6 +50,8 @@ MainWindow::MainWindow(QWidget *parent)
     createTopBar();
     createFilterDock();
     createLayersDock();
+    createProfilerDock();
+    createScopesDock();
     setupShortcuts();
 
     updateUndoRedoButtons();
@@ -59,7 +66,13 @@ MainWindow::MainWindow(QWidget *parent)
     resize(1400, 900);
 }
 
-MainWindow::~MainWindow() = default;
+// Trim workers are children of the window and must stop before they are
+// destroyed with it.
+MainWindow::~MainWindow()
+{
+    for (QThread* worker : findChildren<QThread*>(Qt::FindDirectChildrenOnly))
+        worker->wait();
+}
 
 
 
@@ -95,6 +108,11 @@ void MainWindow::createCentralCanvas()
             });
 
 
+    // The mask surface only covers what was in view; bring it up to date
+    // with any pan or zoom before the stroke reads it.
+    connect(m_graphicsView, &MyGraphicsView::strokeAboutToBegin,
+            this, [this]() { activeLayerImage(); });
+
     connect(m_graphicsView, &MyGraphicsView::zoomChanged,
             this, [this](double scale) {
                 if (!m_scaleSlider) return;
@@ -212,6 +230,72 @@ QToolBar::separator {
     fileMenu->addAction(m_openAction);
     fileMenu->addAction(m_saveAction);
     fileMenu->addAction(m_saveAsAction);
+
+    QMenu* exportMenu{fileMenu->addMenu(tr("Export Quality"))};
+    auto* exportGroup = new QActionGroup(this);
+
+    auto addExportPreset = [&](const QString& text, ExportOptions::Preset preset) {
+        QAction* action = exportMenu->addAction(text);
+        action->setCheckable(true);
+        action->setChecked(preset == ExportOptions::Preset::Balanced);
+        exportGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, preset]() {
+            ExportOptions options = ExportOptions::fromPreset(preset);
+            options.outputProfile = m_exportOptions.outputProfile;
+            options.maxLongEdge = m_exportOptions.maxLongEdge;
+            m_exportOptions = options;
+        });
+    };
+
+    addExportPreset(tr("Fastest"), ExportOptions::Preset::Fastest);
+    addExportPreset(tr("Balanced"), ExportOptions::Preset::Balanced);
+    addExportPreset(tr("Smallest File"), ExportOptions::Preset::Smallest);
+
+    QMenu* sizeMenu{fileMenu->addMenu(tr("Export Size"))};
+    auto* sizeGroup = new QActionGroup(this);
+
+    auto addExportSize = [&](const QString& text, int longEdge) {
+        QAction* action = sizeMenu->addAction(text);
+        action->setCheckable(true);
+        action->setChecked(longEdge == 0);
+        sizeGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, longEdge]() {
+            m_exportOptions.maxLongEdge = longEdge;
+        });
+    };
+
+    addExportSize(tr("Original"), 0);
+    addExportSize(tr("Long Edge 4096 px"), 4096);
+    addExportSize(tr("Long Edge 2048 px"), 2048);
+    addExportSize(tr("Long Edge 1080 px"), 1080);
+
+    QMenu* profileMenu{fileMenu->addMenu(tr("Output Profile"))};
+    auto* profileGroup = new QActionGroup(this);
+
+    auto addOutputProfile = [&](const QString& text, const QColorSpace& profile) {
+        QAction* action = profileMenu->addAction(text);
+        action->setCheckable(true);
+        action->setChecked(!profile.isValid());
+        profileGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, profile]() {
+            m_exportOptions.outputProfile = profile;
+        });
+        return action;
+    };
+
+    addOutputProfile(tr("Document Profile"), QColorSpace());
+    addOutputProfile(tr("sRGB"), QColorSpace(QColorSpace::SRgb));
+    addOutputProfile(tr("Display P3"), QColorSpace(QColorSpace::DisplayP3));
+    addOutputProfile(tr("Adobe RGB"), QColorSpace(QColorSpace::AdobeRgb));
+
+    QAction* customProfileAction = profileMenu->addAction(tr("Custom ICC..."));
+    customProfileAction->setCheckable(true);
+    profileGroup->addAction(customProfileAction);
+    connect(customProfileAction, &QAction::triggered, this, [this]() {
+        if (auto profile = ImageIO::openColorProfile(this))
+            m_exportOptions.outputProfile = *profile;
+    });
+
     fileMenu->addSeparator();
     fileMenu->addAction(m_exitAction);
     fileBtn->setMenu(fileMenu);
@@ -235,7 +319,46 @@ QToolBar::separator {
 
     QMenu* imgMenu{new QMenu(this)};
     imgMenu->addAction(m_cropAction);
+    QAction* trimAction = imgMenu->addAction(tr("Trim to Canvas"));
+    connect(trimAction, &QAction::triggered, this, &MainWindow::handleTrimToCanvas);
+    imgMenu->addSeparator();
+    QAction* linkedAction = imgMenu->addAction(tr("Add Linked Image Layer..."));
+    connect(linkedAction, &QAction::triggered, this, &MainWindow::handleAddLinkedImageLayer);
+    QAction* rasterizeAction = imgMenu->addAction(tr("Rasterize Layer"));
+    connect(rasterizeAction, &QAction::triggered, this, &MainWindow::handleRasterizeLayer);
+    imgMenu->addSeparator();
+    QAction* groupAction = imgMenu->addAction(tr("Group with Layer Below"));
+    connect(groupAction, &QAction::triggered, this, &MainWindow::handleGroupLayers);
+    QAction* ungroupAction = imgMenu->addAction(tr("Ungroup"));
+    connect(ungroupAction, &QAction::triggered, this, &MainWindow::handleUngroupLayer);
+    QAction* passThroughAction = imgMenu->addAction(tr("Pass Through"));
+    passThroughAction->setCheckable(true);
+    connect(passThroughAction, &QAction::triggered, this, &MainWindow::handlePassThrough);
+    connect(imgMenu, &QMenu::aboutToShow, this, [this, ungroupAction, passThroughAction]() {
+        auto group = std::dynamic_pointer_cast<GroupLayer>(m_layerManager.activeLayer());
+        ungroupAction->setEnabled(group != nullptr);
+        passThroughAction->setEnabled(group != nullptr);
+        passThroughAction->setChecked(group && group->isPassThrough());
+    });
+    imgMenu->addSeparator();
+    QAction* revealMaskAction = imgMenu->addAction(tr("Add Layer Mask (Reveal All)"));
+    connect(revealMaskAction, &QAction::triggered, this, [this]() { handleAddLayerMask(true); });
+    QAction* hideMaskAction = imgMenu->addAction(tr("Add Layer Mask (Hide All)"));
+    connect(hideMaskAction, &QAction::triggered, this, [this]() { handleAddLayerMask(false); });
+    QAction* deleteMaskAction = imgMenu->addAction(tr("Delete Layer Mask"));
+    connect(deleteMaskAction, &QAction::triggered, this, &MainWindow::handleDeleteLayerMask);
+    m_editMaskAction = imgMenu->addAction(tr("Edit Layer Mask"));
+    m_editMaskAction->setCheckable(true);
+    connect(m_editMaskAction, &QAction::toggled, this, &MainWindow::setMaskEditing);
     imgMenu->addSeparator();
+
+    m_highPrecisionAction = imgMenu->addAction(tr("High Precision (Linear Float)"));
+    m_highPrecisionAction->setCheckable(true);
+    connect(m_highPrecisionAction, &QAction::toggled, this, [this](bool enabled) {
+        m_workingSpace = enabled ? WorkingSpace::LinearFloat : WorkingSpace::Display8Bit;
+        m_layerManager.setWorkingSpace(m_workingSpace);
+        updateComposite();
+    });
     imgBtn->setMenu(imgMenu);
 
     tb->addWidget(imgBtn);
@@ -247,6 +370,44 @@ QToolBar::separator {
     QMenu* viewMenu{new QMenu(this)};
     viewMenu->addAction(m_fitToScreenAction);
     viewMenu->addAction(m_panAction);
+    viewMenu->addSeparator();
+
+    m_profilerAction = viewMenu->addAction(tr("Profiler"));
+    m_profilerAction->setCheckable(true);
+    connect(m_profilerAction, &QAction::toggled, this, [this](bool visible) {
+        if (m_profilerDock)
+            m_profilerDock->setVisible(visible);
+    });
+
+    m_scopesAction = viewMenu->addAction(tr("Scopes"));
+    m_scopesAction->setCheckable(true);
+    connect(m_scopesAction, &QAction::toggled, this, [this](bool visible) {
+        if (m_scopesDock)
+            m_scopesDock->setVisible(visible);
+    });
+
+    QMenu* monitorMenu{viewMenu->addMenu(tr("Monitor Profile"))};
+    auto* monitorGroup = new QActionGroup(this);
+
+    QAction* srgbMonitorAction = monitorMenu->addAction(tr("sRGB"));
+    srgbMonitorAction->setCheckable(true);
+    srgbMonitorAction->setChecked(true);
+    monitorGroup->addAction(srgbMonitorAction);
+    connect(srgbMonitorAction, &QAction::triggered, this, [this]() {
+        m_monitorColorSpace = QColorSpace(QColorSpace::SRgb);
+        m_graphicsView->setDisplayProfiles(m_documentColorSpace, m_monitorColorSpace);
+    });
+
+    QAction* iccMonitorAction = monitorMenu->addAction(tr("Load ICC Profile..."));
+    iccMonitorAction->setCheckable(true);
+    monitorGroup->addAction(iccMonitorAction);
+    connect(iccMonitorAction, &QAction::triggered, this, [this]() {
+        if (auto profile = ImageIO::openColorProfile(this)) {
+            m_monitorColorSpace = *profile;
+            m_graphicsView->setDisplayProfiles(m_documentColorSpace, m_monitorColorSpace);
+        }
+    });
+
     viewBtn->setMenu(viewMenu);
 
     tb->addWidget(viewBtn);
@@ -437,6 +598,9 @@ void MainWindow::createFilterDock()
                 updateUndoRedoButtons();
             });
 
+    connect(m_filtersPanel, &FiltersPanel::autoToneRequested,
+            this, &MainWindow::handleAutoTone);
+
     connect(m_filtersPanel, &FiltersPanel::previewRequested,
             this, [this]()
             {
@@ -505,6 +669,52 @@ void MainWindow::createLayersDock()
 }
 
 
+void MainWindow::createProfilerDock()
+{
+    m_profilerDock = new QDockWidget(tr("Profiler"), this);
+    m_profilerDock->setFeatures(
+        QDockWidget::DockWidgetMovable |
+        QDockWidget::DockWidgetFloatable |
+        QDockWidget::DockWidgetClosable
+        );
+
+    m_profilerPanel = new ProfilerPanel(this);
+    m_profilerDock->setWidget(m_profilerPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_profilerDock);
+    m_profilerDock->hide();
+
+    connect(m_profilerDock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible)
+            m_profilerPanel->refresh();
+        if (m_profilerAction && !m_profilerDock->isHidden() != m_profilerAction->isChecked())
+            m_profilerAction->setChecked(!m_profilerDock->isHidden());
+    });
+}
+
+void MainWindow::createScopesDock()
+{
+    m_scopesDock = new QDockWidget(tr("Scopes"), this);
+    m_scopesDock->setFeatures(
+        QDockWidget::DockWidgetMovable |
+        QDockWidget::DockWidgetFloatable |
+        QDockWidget::DockWidgetClosable
+        );
+
+    m_scopesPanel = new ScopesPanel(this);
+    m_scopesDock->setWidget(m_scopesPanel);
+    addDockWidget(Qt::RightDockWidgetArea, m_scopesDock);
+    splitDockWidget(m_scopesDock, m_layersDock, Qt::Vertical);
+    m_scopesDock->hide();
+
+    connect(m_scopesDock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        // Frames are dropped while hidden, so catch up on the current one.
+        if (visible)
+            updateComposite();
+        if (m_scopesAction && !m_scopesDock->isHidden() != m_scopesAction->isChecked())
+            m_scopesAction->setChecked(!m_scopesDock->isHidden());
+    });
+}
+
 void MainWindow::setupShortcuts()
 {
     auto* zoomInShortcut{new QShortcut(QKeySequence("+"), this)};
@@ -552,8 +762,8 @@ void MainWindow::setupShortcuts()
 
 void MainWindow::initializeTools()
 {
-    m_brushTool = std::make_unique<BrushTool>(activeLayerImage(), [this]() { updateComposite(); }, m_graphicsView);
-    m_eraserTool = std::make_unique<EraserTool>(activeLayerImage(), [this]() { updateComposite(); }, m_graphicsView);
+    m_brushTool = std::make_unique<BrushTool>(activeLayerImage(), [this]() { syncMaskSurface(); updateComposite(); }, m_graphicsView);
+    m_eraserTool = std::make_unique<EraserTool>(activeLayerImage(), [this]() { syncMaskSurface(); updateComposite(); }, m_graphicsView);
 
     int size = m_brushSizeSpin ? m_brushSizeSpin->value() : 10;
     m_brushTool->setBrushSize(size);
@@ -620,7 +830,8 @@ void MainWindow::fitToScreen()
     if (!m_graphicsView || !m_scaleSlider)
         return;
 
-    auto* item = m_graphicsView->getPixmapItem();
+    if (!m_graphicsView->getCanvasItem())
+        return;
 
 
 
@@ -629,7 +840,7 @@ void MainWindow::fitToScreen()
 
 
 
-    m_graphicsView->fitInView(item, Qt::KeepAspectRatio);
+    m_graphicsView->fitInView(m_graphicsView->canvasSceneRect(), Qt::KeepAspectRatio);
 
 
     const double scale = m_graphicsView->transform().m11();
@@ -651,6 +862,34 @@ void MainWindow::fitToScreen()
 
 QImage* MainWindow::activeLayerImage()
 {
+    if (m_editMaskAction && m_editMaskAction->isChecked()) {
+        auto active = m_layerManager.activeLayer();
+        const std::shared_ptr<LayerMask> mask = active ? active->mask() : nullptr;
+        if (!mask) {
+            resetMaskSurface();
+            return nullptr;
+        }
+
+        // Only the part in view is copied: a surface over the whole mask
+        // costs four bytes per document pixel whenever editing starts or
+        // the mask is undone. Rebuilt when the mask changed other than
+        // through this surface, or the view has moved past it.
+        QRect area = mask->rect();
+        if (m_graphicsView)
+            area &= m_graphicsView->visibleSceneRect().toAlignedRect();
+
+        if (m_maskSurfaceFor.lock() != mask || m_maskSurfaceRevision != mask->revision()
+            || !m_maskSurfaceRect.contains(area)) {
+            m_maskSurface = mask->surface(area);
+            m_maskSurfaceRect = area;
+            m_maskSurfaceFor = mask;
+            m_maskSurfaceRevision = mask->revision();
+            if (m_graphicsView)
+                m_graphicsView->setMaskSurfaceRect(area);
+        }
+        return &m_maskSurface;
+    }
+
     auto layer = std::dynamic_pointer_cast<PixelLayer>(m_layerManager.activeLayer());
     if (!layer) return nullptr;
 
@@ -659,6 +898,85 @@ QImage* MainWindow::activeLayerImage()
     return &img;
 }
 
+// Copies the stroke in progress from the surface into the mask, so the
+// composite shows it while painting.
+void MainWindow::syncMaskSurface()
+{
+    if (!m_activeTool || !m_editMaskAction || !m_editMaskAction->isChecked())
+        return;
+
+    auto mask = m_maskSurfaceFor.lock();
+    const QRect rect = m_activeTool->strokeRect();
+    if (!mask || rect.isEmpty())
+        return;
+
+    mask->write(m_maskSurfaceRect.topLeft() + rect.topLeft(), LayerMask::paintedValues(m_maskSurface.copy(rect)));
+    m_maskSurfaceRevision = mask->revision();
+}
+
+void MainWindow::resetMaskSurface()
+{
+    m_maskSurface = QImage();
+    m_maskSurfaceRect = QRect();
+    m_maskSurfaceFor.reset();
+    if (m_graphicsView)
+        m_graphicsView->setMaskSurfaceRect(QRect());
+}
+
+void MainWindow::setMaskEditing(bool enabled)
+{
+    if (m_graphicsView)
+        m_graphicsView->setMaskEditing(enabled);
+
+    Tool::StrokeCommandFactory factory;
+    if (enabled) {
+        factory = [this](const QRect& rect, const QImage& before, const QImage& after, const QImage& coverage)
+            -> std::unique_ptr<Command> {
+            auto mask = m_maskSurfaceFor.lock();
+            if (!mask)
+                return nullptr;
+            return std::make_unique<MaskStrokeCommand>(
+                m_layerManager, mask,
+                rect.translated(m_maskSurfaceRect.topLeft()),
+                LayerMask::paintedValues(before),
+                LayerMask::paintedValues(after),
+                coverage);
+        };
+    } else {
+        resetMaskSurface();
+    }
+
+    for (Tool* tool : std::initializer_list<Tool*>{m_brushTool.get(), m_eraserTool.get()}) {
+        if (!tool)
+            continue;
+        tool->setStrokeCommandFactory(factory);
+        tool->setTargetImage(activeLayerImage());
+    }
+}
+
+void MainWindow::handleAddLayerMask(bool revealAll)
+{
+    const int index = m_layerManager.activeLayerIndex();
+    auto layer = m_layerManager.layerAt(index);
+    if (!layer || layer->mask() || !m_layerManager.canvasSize().isValid())
+        return;
+
+    auto mask = std::make_shared<LayerMask>(m_layerManager.canvasRect(), revealAll ? 255 : 0);
+    undoRedoStack.push(std::make_unique<SetLayerMaskCommand>(m_layerManager, index, std::move(mask)));
+    updateUndoRedoButtons();
+}
+
+void MainWindow::handleDeleteLayerMask()
+{
+    const int index = m_layerManager.activeLayerIndex();
+    auto layer = m_layerManager.layerAt(index);
+    if (!layer || !layer->mask())
+        return;
+
+    undoRedoStack.push(std::make_unique<SetLayerMaskCommand>(m_layerManager, index, nullptr));
+    updateUndoRedoButtons();
+}
+
 
 void MainWindow::updateActiveLayerImage(const QImage &image)
 {
@@ -675,6 +993,8 @@ void MainWindow::updateComposite()
     if (!m_graphicsView)
         return;
 
+    ProfileScope scope("ui", "MainWindow::updateComposite");
+
     QImage result = m_layerManager.composite();
 
 
@@ -685,10 +1005,78 @@ void MainWindow::updateComposite()
     }
     else
     {
-        m_graphicsView->setPixmap(QPixmap::fromImage(result));
+        m_graphicsView->setImage(result);
+
+        if (m_scopesPanel)
+            m_scopesPanel->setFrame(result);
     }
 }
 
+void MainWindow::handleAutoTone(int managerIndex)
+{
+    auto adj = std::dynamic_pointer_cast<AdjustmentLayer>(m_layerManager.layerAt(managerIndex));
+    if (!adj)
+        return;
+
+    // The settings describe what this layer receives, so analyse the layers
+    // below it, drawn small enough to take a few milliseconds at any size.
+    const QImage proxy = m_layerManager.compositeUpTo(managerIndex, AutoTone::ProxyLongSide);
+    if (proxy.isNull())
+        return;
+
+    FilterPipeline before = adj->pipeline();
+    FilterPipeline after = before;
+    AutoTone::apply(AutoTone::suggest(AutoTone::analyse(proxy)), after);
+
+    auto cmd = std::make_unique<ChangeLayerPipelineCommand>(
+        m_layerManager,
+        managerIndex,
+        std::move(before),
+        std::move(after)
+        );
+    undoRedoStack.push(std::move(cmd));
+    updateUndoRedoButtons();
+
+    if (m_filtersPanel) {
+        m_filtersPanel->setActiveLayer(
+            m_layerManager.activeLayer(),
+            m_layerManager.activeLayerIndex()
+            );
+    }
+}
+
+// Cropping only moves the canvas window. Trimming drops the pixels outside
+// it, which means copying every layer, so the copies are made on a worker
+// thread and applied only if nothing was edited in the meantime.
+void MainWindow::handleTrimToCanvas()
+{
+    const QRect canvasRect = m_layerManager.canvasRect();
+    if (canvasRect.isEmpty())
+        return;
+
+    auto layers = std::make_shared<std::vector<TrimCommand::LayerTrim>>(TrimCommand::snapshot(m_layerManager));
+    statusBar()->showMessage(tr("Trimming layers..."));
+
+    // The worker only touches the snapshot. The result is read on the GUI
+    // thread, in a slot Qt drops if the window goes away first.
+    QThread* worker = QThread::create([layers, canvasRect]() {
+        TrimCommand::trim(*layers, canvasRect);
+    });
+    worker->setParent(this);
+    connect(worker, &QThread::finished, this, [this, layers, canvasRect]() {
+        if (!TrimCommand::isCurrent(m_layerManager, *layers, canvasRect)) {
+            statusBar()->showMessage(tr("Trim discarded: the document changed while trimming"), 5000);
+            return;
+        }
+
+        undoRedoStack.push(std::make_unique<TrimCommand>(m_layerManager, std::move(*layers), canvasRect));
+        updateUndoRedoButtons();
+        statusBar()->clearMessage();
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    worker->start();
+}
+
 void MainWindow::handleAddLayer()
 {
     if (!m_layerManager.canvasSize().isValid())
@@ -699,6 +1087,7 @@ void MainWindow::handleAddLayer()
     QString name = tr("Layer %1").arg(m_layerManager.layerCount() + 1);
 
     auto layer = std::make_shared<PixelLayer>(name, newImage);
+    layer->setOffset(QPointF(m_layerManager.canvasOrigin()));
     auto command = std::make_unique<AddLayerCommand>(m_layerManager, layer);
     undoRedoStack.push(std::move(command));
     m_layerManager.setActiveLayerIndex(m_layerManager.layerCount() - 1);
@@ -738,33 +1127,24 @@ void MainWindow::handleAddAdjustmentLayer()
 }
 
 
-QImage MainWindow::prepareImageForCanvas(const QImage& source, const QSize& canvasSize) const
+void MainWindow::handleAddImageLayer()
 {
-    QImage converted = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-    if (!canvasSize.isValid())
-        return converted;
-
-    if (converted.size() == canvasSize)
-        return converted;
-
-    QImage result(canvasSize, QImage::Format_ARGB32_Premultiplied);
-    result.fill(Qt::transparent);
-
-    QImage scaled = converted.scaled(canvasSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    const QPoint topLeft((canvasSize.width() - scaled.width()) / 2,
-                         (canvasSize.height() - scaled.height()) / 2);
-
-    QPainter painter(&result);
-    painter.drawImage(topLeft, scaled);
+    addSmartLayer(false);
+}
 
-    return result;
+void MainWindow::handleAddLinkedImageLayer()
+{
+    addSmartLayer(true);
 }
 
-void MainWindow::handleAddImageLayer()
+// Placed images become smart layers: an embedded layer keeps the encoded
+// file, a linked one only its path, and both decode at the size they are
+// drawn. The image is fitted into the canvas window and centred.
+void MainWindow::addSmartLayer(bool linked)
 {
     const QString filePath = QFileDialog::getOpenFileName(
         this,
-        tr("Add Image Layer"),
+        linked ? tr("Add Linked Image Layer") : tr("Add Image Layer"),
         QString(),
         tr("Images (*.png *.jpg *.jpeg *.webp *.bmp)")
         );
@@ -772,22 +1152,30 @@ void MainWindow::handleAddImageLayer()
     if (filePath.isEmpty())
         return;
 
-    if (!m_layerManager.canvasSize().isValid())
+    const QSize canvasSize = m_layerManager.canvasSize();
+    if (!canvasSize.isValid())
         return;
 
-    QImage loaded(filePath);
-    if (loaded.isNull())
+    auto source = linked ? SmartSource::link(filePath) : SmartSource::embed(filePath);
+    if (!source) {
+        QMessageBox::warning(this, "Error", "Failed to open image");
         return;
-
-    const QImage prepared = prepareImageForCanvas(loaded, m_layerManager.canvasSize());
+    }
 
     const QString baseName = QFileInfo(filePath).completeBaseName();
     const QString layerName = baseName.isEmpty()
                                   ? tr("Image Layer %1").arg(m_layerManager.layerCount() + 1)
                                   : baseName;
 
+    const QSize size = source->size();
+    const QSize fitted = size.scaled(canvasSize, Qt::KeepAspectRatio);
+    const QPointF topLeft((canvasSize.width() - fitted.width()) / 2,
+                          (canvasSize.height() - fitted.height()) / 2);
+
     const int insertIndex = m_layerManager.activeLayerIndex() + 1;
-    auto layer = std::make_shared<PixelLayer>(layerName, prepared);
+    auto layer = std::make_shared<SmartLayer>(layerName, std::move(source));
+    layer->setScale(static_cast<float>(fitted.width()) / size.width());
+    layer->setOffset(QPointF(m_layerManager.canvasOrigin()) + topLeft);
     auto command = std::make_unique<AddLayerCommand>(m_layerManager, layer, insertIndex);
     undoRedoStack.push(std::move(command));
 
@@ -803,6 +1191,75 @@ void MainWindow::handleAddImageLayer()
     updateUndoRedoButtons();
 }
 
+// Decodes the smart layer at full resolution into an ordinary pixel layer
+// that keeps its placement, so it can be painted on.
+void MainWindow::handleRasterizeLayer()
+{
+    const int index = m_layerManager.activeLayerIndex();
+    auto smart = std::dynamic_pointer_cast<SmartLayer>(m_layerManager.layerAt(index));
+    if (!smart)
+        return;
+
+    const QImage pixels = smart->source()->full();
+    if (pixels.isNull()) {
+        QMessageBox::warning(this, "Error", "Failed to decode image");
+        return;
+    }
+
+    auto pixel = std::make_shared<PixelLayer>(smart->name(), pixels, smart->isVisible(), smart->opacity());
+    pixel->setBlendMode(smart->blendMode());
+    pixel->setClipped(smart->isClipped());
+    pixel->setOffset(smart->offset());
+    pixel->setScale(smart->scale());
+    pixel->setTransform(smart->transform());
+
+    undoRedoStack.push(std::make_unique<ReplaceLayerCommand>(m_layerManager, index, pixel));
+    updateUndoRedoButtons();
+
+    if (m_filtersPanel)
+        m_filtersPanel->setActiveLayer(m_layerManager.activeLayer(), index);
+}
+
+// Groups the active layer with the one below it, or on its own when it is
+// the bottom layer.
+void MainWindow::handleGroupLayers()
+{
+    const int index = m_layerManager.activeLayerIndex();
+    if (index < 0)
+        return;
+
+    const int first = std::max(0, index - 1);
+    auto group = std::make_shared<GroupLayer>(tr("Group %1").arg(m_layerManager.layerCount()));
+    undoRedoStack.push(std::make_unique<GroupLayersCommand>(m_layerManager, first, index - first + 1, group));
+    updateUndoRedoButtons();
+
+    if (m_filtersPanel)
+        m_filtersPanel->setActiveLayer(m_layerManager.activeLayer(), m_layerManager.activeLayerIndex());
+}
+
+void MainWindow::handleUngroupLayer()
+{
+    const int index = m_layerManager.activeLayerIndex();
+    if (!std::dynamic_pointer_cast<GroupLayer>(m_layerManager.layerAt(index)))
+        return;
+
+    undoRedoStack.push(std::make_unique<UngroupLayerCommand>(m_layerManager, index));
+    updateUndoRedoButtons();
+
+    if (m_filtersPanel)
+        m_filtersPanel->setActiveLayer(m_layerManager.activeLayer(), m_layerManager.activeLayerIndex());
+}
+
+void MainWindow::handlePassThrough(bool passThrough)
+{
+    const int index = m_layerManager.activeLayerIndex();
+    if (!std::dynamic_pointer_cast<GroupLayer>(m_layerManager.layerAt(index)))
+        return;
+
+    undoRedoStack.push(std::make_unique<SetGroupPassThroughCommand>(m_layerManager, index, passThrough));
+    updateUndoRedoButtons();
+}
+
 void MainWindow::selectActiveLayer(int index)
 {
     m_layerManager.setActiveLayerIndex(index);
@@ -919,17 +1376,30 @@ void MainWindow::openImage()
 void MainWindow::save()
 {
     QImage result = m_layerManager.composite();
-    QImage out = result.convertToFormat(QImage::Format_ARGB32);
-    ImageIO::saveImage(this, out, m_currentFilePath);
-
+    result.setColorSpace(m_documentColorSpace);
+    ExportStats stats;
+    if (ImageIO::saveImage(this, result, m_currentFilePath, m_exportOptions, &stats))
+        showExportStats(stats);
 }
 
 void MainWindow::saveAs()
 {
     QImage result = m_layerManager.composite();
-    QImage out = result.convertToFormat(QImage::Format_ARGB32);
-    ImageIO::saveImageAs(this, out, m_currentFilePath);
+    result.setColorSpace(m_documentColorSpace);
+    ExportStats stats;
+    if (ImageIO::saveImageAs(this, result, m_currentFilePath, m_exportOptions, &stats))
+        showExportStats(stats);
+}
 
+void MainWindow::showExportStats(const ExportStats& stats)
+{
+    statusBar()->showMessage(
+        tr("Exported %1 MB in %2 s (%3 MB/s, %4 threads)")
+            .arg(stats.bytesIn / (1024.0 * 1024.0), 0, 'f', 1)
+            .arg(stats.seconds, 0, 'f', 2)
+            .arg(stats.megabytesPerSecond(), 0, 'f', 1)
+            .arg(stats.threads),
+        5000);
 }
 
 void MainWindow::loadDocument(const QImage& img)
@@ -940,6 +1410,12 @@ void MainWindow::loadDocument(const QImage& img)
 
     m_layerManager = LayerManager{};
     m_layerManager.setCanvasSize(img.size());
+    m_layerManager.setWorkingSpace(m_workingSpace);
+
+    m_documentColorSpace = img.colorSpace().isValid()
+        ? img.colorSpace()
+        : QColorSpace(QColorSpace::SRgb);
+    m_graphicsView->setDisplayProfiles(m_documentColorSpace, m_monitorColorSpace);
 
 
 
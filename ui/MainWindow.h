@@ -16,10 +16,12 @@
 #include <QPushButton>
 #include <QToolButton>
 #include <QImage>
+#include <QColorSpace>
 #include <QSize>
 #include <QWidgetAction>
 
 #include "layers/layermanager.h"
+#include "image/exportencoder.h"
 #include "MyGraphicsView.h"
 #include "undoredostack.h"
 #include "brushtool.h"
@@ -27,6 +29,8 @@
 
 #include "filterspanel.h"
 #include "layerspanel.h"
+#include "profilerpanel.h"
+#include "scopespanel.h"
 
 class MainWindow : public QMainWindow
 {
@@ -56,6 +60,12 @@ private:
 
 
     QDockWidget* m_layersDock {nullptr};
+    QDockWidget* m_profilerDock {nullptr};
+    ProfilerPanel* m_profilerPanel {nullptr};
+    QAction* m_profilerAction {nullptr};
+    QDockWidget* m_scopesDock {nullptr};
+    ScopesPanel* m_scopesPanel {nullptr};
+    QAction* m_scopesAction {nullptr};
     LayersPanel* m_layersPanel {nullptr};
 
 
@@ -71,6 +81,8 @@ private:
     QAction* m_redoAction {nullptr};
 
     QAction* m_cropAction {nullptr};
+    QAction* m_highPrecisionAction {nullptr};
+    QAction* m_editMaskAction {nullptr};
 
     QAction* m_panAction {nullptr};
     QAction* m_fitToScreenAction {nullptr};
@@ -81,6 +93,10 @@ private:
 
 
     QString m_currentFilePath{};
+    ExportOptions m_exportOptions{};
+    WorkingSpace m_workingSpace{WorkingSpace::Display8Bit};
+    QColorSpace m_documentColorSpace{QColorSpace::SRgb};
+    QColorSpace m_monitorColorSpace{QColorSpace::SRgb};
 
     LayerManager m_layerManager{};
     UndoRedoStack undoRedoStack;
@@ -98,12 +114,21 @@ private:
     QPushButton* m_colorButton {nullptr};
     QColor m_brushColor {Qt::white};
 
+    // Working copy of the part of the active layer's mask in view, which
+    // the brush tools paint on while the mask is being edited.
+    QImage m_maskSurface;
+    QRect m_maskSurfaceRect;
+    std::weak_ptr<LayerMask> m_maskSurfaceFor;
+    int m_maskSurfaceRevision {-1};
+
     void applyGlobalStyle();
     void createActions();
     void createTopBar();
     void createCentralCanvas();
     void createFilterDock();
     void createLayersDock();
+    void createProfilerDock();
+    void createScopesDock();
     void setupShortcuts();
     void initializeTools();
     void setActiveTool(Tool* tool);
@@ -112,23 +137,37 @@ private:
     void updateComposite();
     void updateActiveLayerImage(const QImage &image);
     QImage* activeLayerImage();
+    void syncMaskSurface();
+    void resetMaskSurface();
+    void setMaskEditing(bool enabled);
     void selectActiveLayer(int index);
     void updateUndoRedoButtons();
 
     void handleAddLayer();
     void handleAddAdjustmentLayer();
     void handleAddImageLayer();
+    void handleAddLinkedImageLayer();
+    void handleRasterizeLayer();
+    void handleGroupLayers();
+    void handleUngroupLayer();
+    void handlePassThrough(bool passThrough);
+    void handleAddLayerMask(bool revealAll);
+    void handleDeleteLayerMask();
     void handleDeleteLayer(int managerIndex);
     void handleMoveLayer(int from, int to);
     void handleVisibilityChanged(int managerIndex, bool visible);
     void handleOpacityChanged(int managerIndex, float opacity);
+    void handleAutoTone(int managerIndex);
+    void handleTrimToCanvas();
+
+    void showExportStats(const ExportStats& stats);
 
     void loadDocument(const QImage& img);
     void resetEditorState();
     void finalizeDocumentLoad();
 
 
-    QImage prepareImageForCanvas(const QImage& source, const QSize& canvasSize) const;
+    void addSmartLayer(bool linked);
 
 private slots:
 
@@ -2,9 +2,11 @@
 
 #include <QVBoxLayout>
 #include <QCheckBox>
+#include <QComboBox>
 
 #include "filterslider.h"
 #include "collapsiblesection.h"
+#include "curvewidget.h"
 #include <QStyle>
 #include "layers/layer.h"
 #include "pipeline/filterpipeline.h"
@@ -32,6 +34,7 @@
 #include "filters/vignettefilter.h"
 #include "filters/bwfilter.h"
 #include <QPainter>
+#include <QRandomGenerator>
 
 
 FiltersPanel::FiltersPanel(QWidget* parent)
@@ -59,6 +62,9 @@ void FiltersPanel::buildUI()
         m_contrast   = new FilterSlider("Contrast", QIcon(":/icons/filters/contrast.svg"),  -100, 100, 0);
         m_brightness = new FilterSlider("Brightness", QIcon(":/icons/filters/brightness.svg"), -100, 100, 0);
 
+        m_autoTone = new QPushButton("Auto", this);
+
+        l->addWidget(m_autoTone);
         l->addWidget(m_brightness);
         l->addWidget(m_exposure);
         l->addWidget(m_contrast);
@@ -71,6 +77,13 @@ void FiltersPanel::buildUI()
         connectSlider(m_exposure,  [](auto& p,int v){ p.template setOrReplace<ExposureFilter>(v); });
         connectSlider(m_contrast,  [](auto& p,int v){ p.template setOrReplace<ContrastFilter>(v); });
         connectSlider(m_brightness,[](auto& p,int v){ p.template setOrReplace<BrightnessFilter>(v); });
+
+        connect(m_autoTone, &QPushButton::clicked, this, [this]() {
+            if (m_updating || !m_activeLayer) return;
+            if (m_activeLayer->type() != LayerType::Adjustment) return;
+
+            emit autoToneRequested(m_activeLayerIndex);
+        });
     }
 
     {
@@ -104,6 +117,69 @@ void FiltersPanel::buildUI()
         connectSlider(m_gamma,       [](auto& p,int v){ p.template setOrReplace<GammaFilter>(v); });
     }
 
+    {
+        auto* section = new CollapsibleSection("Curves", this);
+        section->setContentsMargins(0, 0, 0, 0);
+
+        auto* l = new QVBoxLayout();
+
+        m_curveChannel = new QComboBox(this);
+        m_curveChannel->addItems({"RGB", "Red", "Green", "Blue"});
+        m_curve = new CurveWidget(this);
+
+        l->addWidget(m_curveChannel);
+        l->addWidget(m_curve);
+
+        section->setContentLayout(l);
+        root->addWidget(section);
+
+        connect(m_curveChannel, &QComboBox::currentIndexChanged, this, [this](int) {
+            syncCurveFromActiveLayer();
+        });
+        connect(m_curve, &CurveWidget::editingFinished, this, &FiltersPanel::onCurveEdited);
+    }
+
+    {
+        auto* section = new CollapsibleSection("HSL", this);
+        section->setContentsMargins(0, 0, 0, 0);
+
+        auto* l = new QVBoxLayout();
+
+        m_hslBand = new QComboBox(this);
+        m_hslBand->addItems({"Red", "Orange", "Yellow", "Green", "Aqua", "Blue", "Purple", "Magenta"});
+        m_hslHue        = new FilterSlider("Hue", QIcon(":/icons/filters/tint.svg"),       -100, 100, 0);
+        m_hslSaturation = new FilterSlider("Saturation", QIcon(":/icons/filters/saturation.svg"), -100, 100, 0);
+        m_hslLuminance  = new FilterSlider("Luminance", QIcon(":/icons/filters/brightness.svg"), -100, 100, 0);
+
+        l->addWidget(m_hslBand);
+        l->addWidget(m_hslHue);
+        l->addWidget(m_hslSaturation);
+        l->addWidget(m_hslLuminance);
+
+        section->setContentLayout(l);
+        root->addWidget(section);
+
+        auto applyHsl = [this](void (*set)(HslFilter::Adjustment&, int)) {
+            return [this, set](FilterPipeline& p, int v) {
+                HslFilter hsl = p.find<HslFilter>() ? *p.find<HslFilter>() : HslFilter();
+                HslFilter::Adjustment adjustment = hsl.getAdjustment(currentHslBand());
+                set(adjustment, v);
+                hsl.setAdjustment(currentHslBand(), adjustment);
+                p.setOrReplace<HslFilter>(hsl);
+            };
+        };
+
+        connectSlider(m_hslHue,        applyHsl([](HslFilter::Adjustment& a, int v){ a.hue = v; }));
+        connectSlider(m_hslSaturation, applyHsl([](HslFilter::Adjustment& a, int v){ a.saturation = v; }));
+        connectSlider(m_hslLuminance,  applyHsl([](HslFilter::Adjustment& a, int v){ a.luminance = v; }));
+
+        connect(m_hslBand, &QComboBox::currentIndexChanged, this, [this](int) {
+            m_updating = true;
+            syncHslFromActiveLayer();
+            m_updating = false;
+        });
+    }
+
     {
         auto* section = new CollapsibleSection("Details", this);
         section->setContentsMargins(0, 0, 0, 0);
@@ -112,24 +188,57 @@ void FiltersPanel::buildUI()
 
         m_clarity = new FilterSlider("Clarity", QIcon(":/icons/filters/clarity.svg"),  -100, 100, 0);
         m_sharpen = new FilterSlider("Sharpen", QIcon(":/icons/filters/sharpness.svg"),   0,   100, 0);
+        m_sharpenRadius    = new FilterSlider("Sharpen Radius", QIcon(":/icons/filters/sharpness.svg"), 1, 10, 1);
+        m_sharpenThreshold = new FilterSlider("Threshold", QIcon(":/icons/filters/sharpness.svg"),      0, 100, 0);
         m_blur    = new FilterSlider("Blur", QIcon(":/icons/filters/blur.svg"),      0,   100, 0);
         m_fastBlur= new FilterSlider("Fast Blur", QIcon(":/icons/filters/fastblur.svg"), 0,   100, 0);
         m_grain   = new FilterSlider("Grain", QIcon(":/icons/filters/grain.svg"),     0,   100, 0);
+        m_grainSize = new FilterSlider("Grain Size", QIcon(":/icons/filters/grain.svg"), 0, 100, 0);
+        m_grainRoughness = new FilterSlider("Roughness", QIcon(":/icons/filters/grain.svg"), 0, 100, 50);
 
         l->addWidget(m_clarity);
         l->addWidget(m_sharpen);
+        l->addWidget(m_sharpenRadius);
+        l->addWidget(m_sharpenThreshold);
         l->addWidget(m_blur);
         l->addWidget(m_fastBlur);
         l->addWidget(m_grain);
+        l->addWidget(m_grainSize);
+        l->addWidget(m_grainRoughness);
 
         section->setContentLayout(l);
         root->addWidget(section);
 
         connectSlider(m_clarity,[](auto& p,int v){ p.template setOrReplace<ClarityFilter>(v); });
-        connectSlider(m_sharpen,[](auto& p,int v){ p.template setOrReplace<SharpenFilter>(v); });
+        auto applySharpen = [](void (*set)(SharpenFilter&, int)) {
+            return [set](FilterPipeline& p, int v) {
+                SharpenFilter sharpen = p.find<SharpenFilter>() ? *p.find<SharpenFilter>() : SharpenFilter(0);
+                set(sharpen, v);
+                p.setOrReplace<SharpenFilter>(sharpen);
+            };
+        };
+
+        connectSlider(m_sharpen,          applySharpen([](SharpenFilter& f, int v){ f.setSharpness(v); }));
+        connectSlider(m_sharpenRadius,    applySharpen([](SharpenFilter& f, int v){ f.setRadius(v); }));
+        connectSlider(m_sharpenThreshold, applySharpen([](SharpenFilter& f, int v){ f.setThreshold(v); }));
         connectSlider(m_blur,   [](auto& p,int v){ p.template setOrReplace<BlurFilter>(v); });
         connectSlider(m_fastBlur,   [](auto& p,int v){ p.template setOrReplace<FastBlurFilter>(v); });
-        connectSlider(m_grain,  [](auto& p,int v){ p.template setOrReplace<GrainFilter>(v); });
+
+        // A new grain filter draws its seed once; every later edit keeps it,
+        // so the pattern stays put on this layer while it is tuned.
+        auto applyGrain = [](void (*set)(GrainFilter&, int)) {
+            return [set](FilterPipeline& p, int v) {
+                GrainFilter grain = p.find<GrainFilter>()
+                                        ? *p.find<GrainFilter>()
+                                        : GrainFilter(0, 0, 50, QRandomGenerator::global()->generate());
+                set(grain, v);
+                p.setOrReplace<GrainFilter>(grain);
+            };
+        };
+
+        connectSlider(m_grain,          applyGrain([](GrainFilter& g, int v){ g.setGrain(v); }));
+        connectSlider(m_grainSize,      applyGrain([](GrainFilter& g, int v){ g.setSize(v); }));
+        connectSlider(m_grainRoughness, applyGrain([](GrainFilter& g, int v){ g.setRoughness(v); }));
     }
 
 
@@ -160,6 +269,10 @@ void FiltersPanel::buildUI()
         auto* l = new QVBoxLayout();
 
         m_vignette = new FilterSlider("Vignette", QIcon(":/icons/filters/vignette.svg"), -100, 100, 0);
+        m_vignetteCenterX   = new FilterSlider("Center X", QIcon(":/icons/filters/vignette.svg"), -100, 100, 0);
+        m_vignetteCenterY   = new FilterSlider("Center Y", QIcon(":/icons/filters/vignette.svg"), -100, 100, 0);
+        m_vignetteRoundness = new FilterSlider("Roundness", QIcon(":/icons/filters/vignette.svg"),   0, 100, 100);
+        m_vignetteFeather   = new FilterSlider("Feather", QIcon(":/icons/filters/vignette.svg"),     0, 100, 100);
         //m_bw = new QToolButton(this);
         //->setCheckable(true);
         //m_bw->setChecked(false);
@@ -172,13 +285,29 @@ void FiltersPanel::buildUI()
 
 
         l->addWidget(m_vignette);
+        l->addWidget(m_vignetteCenterX);
+        l->addWidget(m_vignetteCenterY);
+        l->addWidget(m_vignetteRoundness);
+        l->addWidget(m_vignetteFeather);
 
         // UNDER CONSTRUCTION // l->addWidget(m_bw);
 
         section->setContentLayout(l);
         root->addWidget(section);
 
-        connectSlider(m_vignette,[](auto& p,int v){ p.template setOrReplace<VignetteFilter>(v); });
+        auto applyVignette = [](void (*set)(VignetteFilter&, int)) {
+            return [set](FilterPipeline& p, int v) {
+                VignetteFilter vignette = p.find<VignetteFilter>() ? *p.find<VignetteFilter>() : VignetteFilter(0);
+                set(vignette, v);
+                p.setOrReplace<VignetteFilter>(vignette);
+            };
+        };
+
+        connectSlider(m_vignette,          applyVignette([](VignetteFilter& f, int v){ f.setVignette(v); }));
+        connectSlider(m_vignetteCenterX,   applyVignette([](VignetteFilter& f, int v){ f.setCenterX(v); }));
+        connectSlider(m_vignetteCenterY,   applyVignette([](VignetteFilter& f, int v){ f.setCenterY(v); }));
+        connectSlider(m_vignetteRoundness, applyVignette([](VignetteFilter& f, int v){ f.setRoundness(v); }));
+        connectSlider(m_vignetteFeather,   applyVignette([](VignetteFilter& f, int v){ f.setFeather(v); }));
 
         /** connect(m_bw, &QToolButton::toggled, this, [this](bool on){
             if (m_updating || !m_activeLayer) return;
@@ -268,6 +397,67 @@ void FiltersPanel::connectSlider(
                 }
             });
 }
+CurvesFilter::Channel FiltersPanel::currentCurveChannel() const
+{
+    return static_cast<CurvesFilter::Channel>(std::max(0, m_curveChannel->currentIndex()));
+}
+
+void FiltersPanel::syncCurveFromActiveLayer()
+{
+    static const QColor colors[] = {
+        QColor(220, 220, 220), QColor(230, 90, 90), QColor(90, 200, 90), QColor(100, 140, 240)
+    };
+
+    const CurvesFilter::Channel channel = currentCurveChannel();
+    m_curve->setCurveColor(colors[static_cast<int>(channel)]);
+
+    auto adj = std::dynamic_pointer_cast<AdjustmentLayer>(m_activeLayer);
+    auto* curves = adj ? adj->pipeline().find<CurvesFilter>() : nullptr;
+    m_curve->setPoints(curves ? curves->getPoints(channel) : CurvesFilter::defaultPoints());
+}
+
+void FiltersPanel::onCurveEdited(const CurvesFilter::Points& points)
+{
+    if (m_updating || !m_activeLayer) return;
+
+    auto adj = std::dynamic_pointer_cast<AdjustmentLayer>(m_activeLayer);
+    if (!adj) return;
+
+    const CurvesFilter::Channel channel = currentCurveChannel();
+
+    auto before = adj->pipeline();
+    CurvesFilter curves = before.find<CurvesFilter>() ? *before.find<CurvesFilter>() : CurvesFilter();
+    if (curves.getPoints(channel) == points)
+        return;
+
+    curves.setPoints(channel, points);
+
+    auto after = before;
+    after.setOrReplace<CurvesFilter>(curves);
+
+    emit pipelineChanged(
+        m_activeLayerIndex,
+        std::move(before),
+        std::move(after)
+        );
+}
+
+HslFilter::Band FiltersPanel::currentHslBand() const
+{
+    return static_cast<HslFilter::Band>(std::max(0, m_hslBand->currentIndex()));
+}
+
+void FiltersPanel::syncHslFromActiveLayer()
+{
+    auto adj = std::dynamic_pointer_cast<AdjustmentLayer>(m_activeLayer);
+    auto* hsl = adj ? adj->pipeline().find<HslFilter>() : nullptr;
+    const HslFilter::Adjustment adjustment = hsl ? hsl->getAdjustment(currentHslBand()) : HslFilter::Adjustment();
+
+    m_hslHue->setValue(adjustment.hue);
+    m_hslSaturation->setValue(adjustment.saturation);
+    m_hslLuminance->setValue(adjustment.luminance);
+}
+
 void FiltersPanel::setActiveLayer(std::shared_ptr<Layer> layer, int index)
 {
     m_activeLayer = std::move(layer);
@@ -283,6 +473,10 @@ void FiltersPanel::setActiveLayer(std::shared_ptr<Layer> layer, int index)
         s->style()->polish(s);
     }
 
+    m_curveChannel->setEnabled(isAdj);
+    m_curve->setEnabled(isAdj);
+    m_hslBand->setEnabled(isAdj);
+
     for (auto* sec : findChildren<CollapsibleSection*>()) {
         sec->setProperty("inactive", !isAdj);
         sec->style()->unpolish(sec);
@@ -314,6 +508,8 @@ void FiltersPanel::syncFromActiveLayer()
         m_blur->setValue(0);
         m_fastBlur->setValue(0);
         m_sharpen->setValue(0);
+        m_sharpenRadius->setValue(1);
+        m_sharpenThreshold->setValue(0);
         m_gamma->setValue(0);
         // m_bw->setChecked(false);
         m_temperature->setValue(0);
@@ -323,9 +519,17 @@ void FiltersPanel::syncFromActiveLayer()
         m_fade->setValue(0);
         m_clarity->setValue(0);
         m_grain->setValue(0);
+        m_grainSize->setValue(0);
+        m_grainRoughness->setValue(50);
         m_splithighlight->setValue(0);
         m_splitshadow->setValue(0);
         m_vignette->setValue(0);
+        m_vignetteCenterX->setValue(0);
+        m_vignetteCenterY->setValue(0);
+        m_vignetteRoundness->setValue(100);
+        m_vignetteFeather->setValue(100);
+        syncCurveFromActiveLayer();
+        syncHslFromActiveLayer();
 
         m_updating = false;
         return;
@@ -346,6 +550,8 @@ void FiltersPanel::syncFromActiveLayer()
     m_blur->setValue(p.find<BlurFilter>() ? p.find<BlurFilter>()->getBlur() : 0);
     m_fastBlur->setValue(p.find<FastBlurFilter>() ? p.find<FastBlurFilter>()->getBlur() : 0);
     m_sharpen->setValue(p.find<SharpenFilter>() ? p.find<SharpenFilter>()->getSharpness() : 0);
+    m_sharpenRadius->setValue(p.find<SharpenFilter>() ? p.find<SharpenFilter>()->getRadius() : 1);
+    m_sharpenThreshold->setValue(p.find<SharpenFilter>() ? p.find<SharpenFilter>()->getThreshold() : 0);
     m_gamma->setValue(p.find<GammaFilter>() ? p.find<GammaFilter>()->getGamma() : 0);
 
     m_temperature->setValue(p.find<TemperatureFilter>() ? p.find<TemperatureFilter>()->getTemperature() : 0);
@@ -356,9 +562,17 @@ void FiltersPanel::syncFromActiveLayer()
     m_fade->setValue(p.find<FadeFilter>() ? p.find<FadeFilter>()->getFade() : 0);
     m_clarity->setValue(p.find<ClarityFilter>() ? p.find<ClarityFilter>()->getClarity() : 0);
     m_grain->setValue(p.find<GrainFilter>() ? p.find<GrainFilter>()->getGrain() : 0);
+    m_grainSize->setValue(p.find<GrainFilter>() ? p.find<GrainFilter>()->getSize() : 0);
+    m_grainRoughness->setValue(p.find<GrainFilter>() ? p.find<GrainFilter>()->getRoughness() : 50);
     m_splithighlight->setValue(p.find<HighlightFilter>() ? p.find<HighlightFilter>()->getHighlight() : 0);
     m_splitshadow->setValue(p.find<ShadowFilter>() ? p.find<ShadowFilter>()->getShadow() : 0);
     m_vignette->setValue(p.find<VignetteFilter>() ? p.find<VignetteFilter>()->getVignette() : 0);
+    m_vignetteCenterX->setValue(p.find<VignetteFilter>() ? p.find<VignetteFilter>()->getCenterX() : 0);
+    m_vignetteCenterY->setValue(p.find<VignetteFilter>() ? p.find<VignetteFilter>()->getCenterY() : 0);
+    m_vignetteRoundness->setValue(p.find<VignetteFilter>() ? p.find<VignetteFilter>()->getRoundness() : 100);
+    m_vignetteFeather->setValue(p.find<VignetteFilter>() ? p.find<VignetteFilter>()->getFeather() : 100);
+    syncCurveFromActiveLayer();
+    syncHslFromActiveLayer();
 
     //m_bw->setChecked(p.find<BWFilter>() != nullptr);
 
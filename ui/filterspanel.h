@@ -6,11 +6,15 @@
 #include <QPushButton>
 #include <QToolButton>
 #include "pipeline/filterpipeline.h"
+#include "filters/curvesfilter.h"
+#include "filters/hslfilter.h"
 #include <map>
 class QVBoxLayout;
 class FilterSlider;
 class QCheckBox;
+class QComboBox;
 class CollapsibleSection;
+class CurveWidget;
 
 class Layer;
 class FilterPipeline;
@@ -34,6 +38,8 @@ signals:
 
     void previewRequested();
 
+    void autoToneRequested(int layerIndex);
+
 
 private:
     void buildUI();
@@ -42,6 +48,13 @@ private:
         std::function<void(FilterPipeline&, int)> apply
         );
 
+    CurvesFilter::Channel currentCurveChannel() const;
+    void syncCurveFromActiveLayer();
+    void onCurveEdited(const CurvesFilter::Points& points);
+
+    HslFilter::Band currentHslBand() const;
+    void syncHslFromActiveLayer();
+
     FilterPipeline m_pipelineBeforeSlider;
 
     std::shared_ptr<Layer> m_activeLayer;
@@ -58,9 +71,15 @@ private:
     FilterSlider* m_fade = nullptr;
     FilterSlider* m_clarity = nullptr;
     FilterSlider* m_grain = nullptr;
+    FilterSlider* m_grainSize = nullptr;
+    FilterSlider* m_grainRoughness = nullptr;
     FilterSlider* m_splithighlight = nullptr;
     FilterSlider* m_splitshadow = nullptr;
     FilterSlider* m_vignette = nullptr;
+    FilterSlider* m_vignetteCenterX = nullptr;
+    FilterSlider* m_vignetteCenterY = nullptr;
+    FilterSlider* m_vignetteRoundness = nullptr;
+    FilterSlider* m_vignetteFeather = nullptr;
     QPushButton* m_rotateRight = nullptr;
     QPushButton* m_rotateLeft = nullptr;
     QPushButton* m_flipH = nullptr;
@@ -71,9 +90,20 @@ private:
     FilterSlider* m_blur = nullptr;
     FilterSlider* m_fastBlur = nullptr;
     FilterSlider* m_sharpen = nullptr;
+    FilterSlider* m_sharpenRadius = nullptr;
+    FilterSlider* m_sharpenThreshold = nullptr;
     FilterSlider* m_gamma = nullptr;
+    QPushButton* m_autoTone = nullptr;
 
     QToolButton* m_bw = nullptr;
+
+    QComboBox* m_curveChannel = nullptr;
+    CurveWidget* m_curve = nullptr;
+
+    QComboBox* m_hslBand = nullptr;
+    FilterSlider* m_hslHue = nullptr;
+    FilterSlider* m_hslSaturation = nullptr;
+    FilterSlider* m_hslLuminance = nullptr;
 };
 
 #endif // FILTERSPANEL_H
@@ -4,6 +4,7 @@
 #include <QLabel>
 
 #include <QPainter>
+#include <QStyle>
 
 
 
@@ -167,7 +168,7 @@ void LayersPanel::setLayers(const std::vector<std::shared_ptr<Layer>>& layers, i
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable | Qt::ItemIsSelectable | Qt::ItemIsEnabled);
         item->setCheckState(layer && layer->isVisible() ? Qt::Checked : Qt::Unchecked);
 
-        if (dynamic_cast<PixelLayer*>(layer.get()))
+        if (dynamic_cast<PlacedLayer*>(layer.get()))
         {
             item->setIcon(QIcon(":/icons/layerspanel/layer.svg"));
         }
@@ -175,6 +176,12 @@ void LayersPanel::setLayers(const std::vector<std::shared_ptr<Layer>>& layers, i
         {
             item->setIcon(QIcon(":/icons/layerspanel/adjlayer.svg"));
         }
+        else if (auto* group = dynamic_cast<GroupLayer*>(layer.get()))
+        {
+            item->setIcon(style()->standardIcon(QStyle::SP_DirIcon));
+            item->setToolTip(tr("%n layer(s)", "", static_cast<int>(group->layers().size()))
+                             + (group->isPassThrough() ? tr(", pass through") : QString()));
+        }
 
         m_list->addItem(item);
 
@@ -0,0 +1,141 @@
+#include "profilerpanel.h"
+
+#include "image/imagepool.h"
+#include "profiling/profiler.h"
+#include "parallel/parallelfor.h"
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QVBoxLayout>
+
+namespace {
+enum Column {
+    ColumnScope,
+    ColumnCalls,
+    ColumnTotal,
+    ColumnAverage,
+    ColumnMax,
+    ColumnThroughput,
+    ColumnAllocated,
+    ColumnThreads,
+    ColumnCount
+};
+}
+
+ProfilerPanel::ProfilerPanel(QWidget* parent)
+    : QWidget(parent)
+{
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(8, 8, 8, 8);
+    layout->setSpacing(8);
+
+    auto* controls = new QHBoxLayout();
+    m_enabledCheck = new QCheckBox(tr("Record"), this);
+    m_clearButton = new QPushButton(tr("Clear"), this);
+    m_exportButton = new QPushButton(tr("Export Trace..."), this);
+    controls->addWidget(m_enabledCheck);
+    controls->addStretch(1);
+    controls->addWidget(m_clearButton);
+    controls->addWidget(m_exportButton);
+    layout->addLayout(controls);
+
+    m_table = new QTableWidget(0, ColumnCount, this);
+    m_table->setHorizontalHeaderLabels({
+        tr("Scope"), tr("Calls"), tr("Total ms"), tr("Avg ms"), tr("Max ms"),
+        tr("MPix/s"), tr("Alloc MB"), tr("Threads")
+    });
+    m_table->verticalHeader()->setVisible(false);
+    m_table->horizontalHeader()->setSectionResizeMode(ColumnScope, QHeaderView::Stretch);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionMode(QAbstractItemView::NoSelection);
+    layout->addWidget(m_table, 1);
+
+    m_statusLabel = new QLabel(this);
+    layout->addWidget(m_statusLabel);
+
+    connect(m_enabledCheck, &QCheckBox::toggled, this, &ProfilerPanel::onEnabledToggled);
+    connect(m_clearButton, &QPushButton::clicked, this, &ProfilerPanel::onClear);
+    connect(m_exportButton, &QPushButton::clicked, this, &ProfilerPanel::onExportTrace);
+
+    m_refreshTimer.setInterval(500);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &ProfilerPanel::refresh);
+
+    m_enabledCheck->setChecked(Profiler::isEnabled());
+    refresh();
+}
+
+void ProfilerPanel::onEnabledToggled(bool enabled)
+{
+    Profiler::setEnabled(enabled);
+
+    if (enabled)
+        m_refreshTimer.start();
+    else
+        m_refreshTimer.stop();
+
+    refresh();
+}
+
+void ProfilerPanel::onClear()
+{
+    Profiler::instance().clear();
+    refresh();
+}
+
+void ProfilerPanel::onExportTrace()
+{
+    const QString fileName = QFileDialog::getSaveFileName(
+        this,
+        tr("Export Trace"),
+        QStringLiteral("trace.json"),
+        tr("Trace Event JSON (*.json)")
+        );
+
+    if (fileName.isEmpty())
+        return;
+
+    if (!Profiler::instance().exportChromeTrace(fileName))
+        QMessageBox::warning(this, "Error", "Failed to export trace");
+}
+
+void ProfilerPanel::refresh()
+{
+    if (!isVisible())
+        return;
+
+    const std::vector<ProfileSummary> rows = Profiler::instance().summary();
+    m_table->setRowCount(static_cast<int>(rows.size()));
+
+    auto setCell = [this](int row, int column, const QString& text) {
+        auto* item = m_table->item(row, column);
+        if (!item) {
+            item = new QTableWidgetItem;
+            if (column != ColumnScope)
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            m_table->setItem(row, column, item);
+        }
+        item->setText(text);
+    };
+
+    for (int i = 0; i < static_cast<int>(rows.size()); ++i) {
+        const ProfileSummary& s = rows[static_cast<size_t>(i)];
+        setCell(i, ColumnScope, QString::fromUtf8(s.name));
+        setCell(i, ColumnCalls, QString::number(s.calls));
+        setCell(i, ColumnTotal, QString::number(s.totalMs, 'f', 1));
+        setCell(i, ColumnAverage, QString::number(s.averageMs(), 'f', 2));
+        setCell(i, ColumnMax, QString::number(s.maxMs, 'f', 2));
+        setCell(i, ColumnThroughput, QString::number(s.megapixelsPerSecond(), 'f', 1));
+        setCell(i, ColumnAllocated, QString::number(s.bytesAllocated / (1024.0 * 1024.0), 'f', 1));
+        setCell(i, ColumnThreads, QString::number(s.threadUtilisation * 100.0, 'f', 0) + "%");
+    }
+
+    const ImagePool::Stats pool = ImagePool::instance().stats();
+    m_statusLabel->setText(
+        tr("%1 events, %2 worker threads, buffer pool %3% hits, %4 MB resident")
+            .arg(Profiler::instance().eventCount())
+            .arg(ParallelFor::threadCount())
+            .arg(pool.hitRate() * 100.0, 0, 'f', 0)
+            .arg(pool.residentBytes() / (1024.0 * 1024.0), 0, 'f', 1));
+}
@@ -0,0 +1,34 @@
+#ifndef PROFILERPANEL_H
+#define PROFILERPANEL_H
+
+#include <QWidget>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QLabel>
+#include <QTimer>
+
+class ProfilerPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ProfilerPanel(QWidget* parent = nullptr);
+
+public slots:
+    void refresh();
+
+private slots:
+    void onEnabledToggled(bool enabled);
+    void onClear();
+    void onExportTrace();
+
+private:
+    QCheckBox* m_enabledCheck {nullptr};
+    QPushButton* m_clearButton {nullptr};
+    QPushButton* m_exportButton {nullptr};
+    QTableWidget* m_table {nullptr};
+    QLabel* m_statusLabel {nullptr};
+    QTimer m_refreshTimer;
+};
+
+#endif // PROFILERPANEL_H
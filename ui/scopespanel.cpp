@@ -0,0 +1,211 @@
+#include "scopespanel.h"
+
+#include "profiling/profiler.h"
+
+#include <QPainter>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kPlotHeight = 120;
+constexpr int kSpacing = 8;
+const QColor kBackground(24, 24, 24);
+const QColor kGrid(70, 70, 70);
+
+// Bins spread over several orders of magnitude; a log scale keeps sparse
+// colours visible next to a dominant one.
+int intensity(int count, double logPeak)
+{
+    if (count <= 0 || logPeak <= 0.0)
+        return 0;
+    return std::min(255, static_cast<int>(std::log1p(count) / logPeak * 255.0 + 0.5));
+}
+}
+
+ScopesPanel::ScopesPanel(QWidget* parent)
+    : QWidget(parent)
+{
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(8, 8, 8, 8);
+    layout->addStretch(1);
+
+    m_statusLabel = new QLabel(this);
+    layout->addWidget(m_statusLabel);
+
+    setMinimumHeight(kPlotHeight * 3 + kSpacing * 4 + 20);
+
+    m_worker = std::thread([this] { workerLoop(); });
+}
+
+ScopesPanel::~ScopesPanel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_worker.join();
+}
+
+void ScopesPanel::setFrame(const QImage& frame)
+{
+    if (!isVisible())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = frame;
+    }
+    m_wake.notify_one();
+}
+
+void ScopesPanel::workerLoop()
+{
+    Scopes scopes;
+
+    for (;;) {
+        QImage frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_pending.isNull(); });
+            if (m_stop)
+                return;
+            frame = m_pending;
+            m_pending = QImage();
+        }
+
+        int tiles = 0;
+        {
+            ProfileScope scope("ui", "Scopes::update");
+            tiles = scopes.update(frame);
+        }
+
+        // Queued to the GUI thread; dropped if the panel is gone by then.
+        QMetaObject::invokeMethod(this, [this, scopes, tiles]() {
+            showScopes(scopes, tiles);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void ScopesPanel::showScopes(const Scopes& scopes, int tiles)
+{
+    m_histogram = renderHistogram(scopes);
+    m_waveform = renderWaveform(scopes);
+    m_vectorscope = renderVectorscope(scopes);
+
+    m_statusLabel->setText(tr("%1 samples, %2 tiles updated").arg(scopes.sampleCount()).arg(tiles));
+    update();
+}
+
+QImage ScopesPanel::renderHistogram(const Scopes& scopes)
+{
+    QImage image(Scopes::Levels, kPlotHeight, QImage::Format_ARGB32_Premultiplied);
+    image.fill(kBackground);
+
+    int peak = 1;
+    for (int c = 0; c < Scopes::Luma; ++c)
+        peak = std::max(peak, *std::max_element(scopes.histogram(Scopes::Channel(c)),
+                                                scopes.histogram(Scopes::Channel(c)) + Scopes::Levels));
+    const double logPeak = std::log1p(peak);
+
+    // Channels add up, so overlapping ranges read as white like in print.
+    for (int x = 0; x < Scopes::Levels; ++x) {
+        int heights[3];
+        for (int c = 0; c < 3; ++c)
+            heights[c] = intensity(scopes.histogram(Scopes::Channel(c))[x], logPeak) * kPlotHeight / 255;
+
+        for (int y = 0; y < kPlotHeight; ++y) {
+            const int level = kPlotHeight - y;
+            const int r = level <= heights[0] ? 200 : 0;
+            const int g = level <= heights[1] ? 200 : 0;
+            const int b = level <= heights[2] ? 200 : 0;
+            if (r || g || b)
+                image.setPixel(x, y, qRgb(std::max(r, 24), std::max(g, 24), std::max(b, 24)));
+        }
+    }
+
+    return image;
+}
+
+QImage ScopesPanel::renderWaveform(const Scopes& scopes)
+{
+    const int width = std::max(1, scopes.waveformWidth());
+    QImage image(width, Scopes::Levels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(kBackground);
+
+    const std::vector<int>& bins = scopes.waveform();
+    if (bins.empty())
+        return image;
+
+    const double logPeak = std::log1p(*std::max_element(bins.begin(), bins.end()));
+
+    for (int level = 0; level < Scopes::Levels; ++level) {
+        QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(Scopes::Levels - 1 - level));
+        const int* counts = bins.data() + static_cast<size_t>(level) * width;
+        for (int x = 0; x < width; ++x) {
+            const int v = intensity(counts[x], logPeak);
+            if (v > 0)
+                row[x] = qRgb(v / 3, v, v / 3);
+        }
+    }
+
+    return image;
+}
+
+QImage ScopesPanel::renderVectorscope(const Scopes& scopes)
+{
+    const int size = Scopes::VectorscopeSize;
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(kBackground);
+
+    const std::vector<int>& bins = scopes.vectorscope();
+    const double logPeak = std::log1p(*std::max_element(bins.begin(), bins.end()));
+
+    for (int cr = 0; cr < size; ++cr) {
+        QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(size - 1 - cr));
+        for (int cb = 0; cb < size; ++cb) {
+            const int v = intensity(bins[static_cast<size_t>(cr) * size + cb], logPeak);
+            if (v > 0)
+                row[cb] = qRgb(v, v, v);
+        }
+    }
+
+    QPainter painter(&image);
+    painter.setPen(kGrid);
+    painter.drawLine(size / 2, 0, size / 2, size);
+    painter.drawLine(0, size / 2, size, size / 2);
+    painter.drawEllipse(QRectF(0.5, 0.5, size - 1.0, size - 1.0));
+
+    return image;
+}
+
+void ScopesPanel::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+
+    const int width = this->width() - 2 * kSpacing;
+    if (width <= 0)
+        return;
+
+    int top = kSpacing;
+    const QRect histogramRect(kSpacing, top, width, kPlotHeight);
+    top += kPlotHeight + kSpacing;
+    const QRect waveformRect(kSpacing, top, width, kPlotHeight);
+    top += kPlotHeight + kSpacing;
+    const int side = std::min(width, kPlotHeight);
+    const QRect vectorscopeRect(kSpacing + (width - side) / 2, top, side, side);
+
+    painter.fillRect(histogramRect, kBackground);
+    painter.fillRect(waveformRect, kBackground);
+    painter.fillRect(vectorscopeRect, kBackground);
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    if (!m_histogram.isNull())
+        painter.drawImage(histogramRect, m_histogram);
+    if (!m_waveform.isNull())
+        painter.drawImage(waveformRect, m_waveform);
+    if (!m_vectorscope.isNull())
+        painter.drawImage(vectorscopeRect, m_vectorscope);
+}
@@ -0,0 +1,49 @@
+#ifndef SCOPESPANEL_H
+#define SCOPESPANEL_H
+
+#include <QWidget>
+#include <QImage>
+#include <QLabel>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "scopes/scopes.h"
+
+// Shows the histogram, waveform and vectorscope of the rendered frame. Frames
+// are handed to a background thread that keeps only the newest one, so a
+// burst of edits costs one scope update. The plots are rasterised when a
+// result arrives; painting only draws the cached images.
+class ScopesPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ScopesPanel(QWidget* parent = nullptr);
+    ~ScopesPanel() override;
+
+    void setFrame(const QImage& frame);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    void workerLoop();
+    void showScopes(const Scopes& scopes, int tiles);
+
+    static QImage renderHistogram(const Scopes& scopes);
+    static QImage renderWaveform(const Scopes& scopes);
+    static QImage renderVectorscope(const Scopes& scopes);
+
+    QImage m_histogram;
+    QImage m_waveform;
+    QImage m_vectorscope;
+    QLabel* m_statusLabel {nullptr};
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    QImage m_pending;
+    bool m_stop {false};
+};
+
+#endif // SCOPESPANEL_H
@@ -0,0 +1,177 @@
+#include "curvewidget.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <algorithm>
+
+namespace {
+constexpr double HandleRadius = 4.0;
+constexpr double HitRadius = 8.0;
+constexpr int Margin = 6;
+}
+
+CurveWidget::CurveWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    setMinimumSize(160, 160);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    setMouseTracking(false);
+    m_table = CurvesFilter::evaluate(m_points);
+}
+
+QSize CurveWidget::sizeHint() const
+{
+    return QSize(220, 220);
+}
+
+void CurveWidget::setPoints(const CurvesFilter::Points& points)
+{
+    m_points = points.empty() ? CurvesFilter::defaultPoints() : points;
+    m_table = CurvesFilter::evaluate(m_points);
+    m_dragIndex = -1;
+    update();
+}
+
+void CurveWidget::setCurveColor(const QColor& color)
+{
+    m_curveColor = color;
+    update();
+}
+
+QRectF CurveWidget::plotRect() const
+{
+    const int side = std::min(width(), height()) - 2 * Margin;
+    return QRectF((width() - side) / 2.0, Margin, side, side);
+}
+
+QPointF CurveWidget::toWidget(const QPoint& value) const
+{
+    const QRectF r = plotRect();
+    return QPointF(r.left() + value.x() / 255.0 * r.width(),
+                   r.bottom() - value.y() / 255.0 * r.height());
+}
+
+QPoint CurveWidget::toValue(const QPointF& pos) const
+{
+    const QRectF r = plotRect();
+    const int x = qRound((pos.x() - r.left()) / r.width() * 255.0);
+    const int y = qRound((r.bottom() - pos.y()) / r.height() * 255.0);
+    return QPoint(std::clamp(x, 0, 255), std::clamp(y, 0, 255));
+}
+
+int CurveWidget::pointAt(const QPointF& pos) const
+{
+    for (int i = 0; i < static_cast<int>(m_points.size()); ++i) {
+        const QPointF d = toWidget(m_points[i]) - pos;
+        if (d.x() * d.x() + d.y() * d.y() <= HitRadius * HitRadius)
+            return i;
+    }
+    return -1;
+}
+
+void CurveWidget::paintEvent(QPaintEvent*)
+{
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing);
+
+    const QRectF r = plotRect();
+    p.fillRect(r, QColor(30, 30, 30));
+
+    p.setPen(QPen(QColor(60, 60, 60), 1));
+    for (int i = 1; i < 4; ++i) {
+        const double x = r.left() + r.width() * i / 4.0;
+        const double y = r.top() + r.height() * i / 4.0;
+        p.drawLine(QPointF(x, r.top()), QPointF(x, r.bottom()));
+        p.drawLine(QPointF(r.left(), y), QPointF(r.right(), y));
+    }
+
+    p.setPen(QPen(QColor(80, 80, 80), 1, Qt::DashLine));
+    p.drawLine(r.bottomLeft(), r.topRight());
+
+    QPainterPath path;
+    for (int v = 0; v < 256; ++v) {
+        const QPointF pt = toWidget(QPoint(v, m_table[v]));
+        if (v == 0)
+            path.moveTo(pt);
+        else
+            path.lineTo(pt);
+    }
+    p.setPen(QPen(m_curveColor, 1.5));
+    p.drawPath(path);
+
+    p.setPen(QPen(m_curveColor, 1));
+    for (int i = 0; i < static_cast<int>(m_points.size()); ++i) {
+        p.setBrush(i == m_dragIndex ? m_curveColor : QColor(30, 30, 30));
+        p.drawEllipse(toWidget(m_points[i]), HandleRadius, HandleRadius);
+    }
+}
+
+void CurveWidget::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton || !isEnabled())
+        return;
+
+    emit editingStarted();
+
+    m_dragIndex = pointAt(event->position());
+    if (m_dragIndex < 0) {
+        const QPoint value = toValue(event->position());
+        auto it = std::find_if(m_points.begin(), m_points.end(),
+                               [&](const QPoint& p) { return p.x() >= value.x(); });
+        if (it != m_points.end() && it->x() == value.x())
+            return;
+
+        m_dragIndex = static_cast<int>(it - m_points.begin());
+        m_points.insert(it, value);
+        m_table = CurvesFilter::evaluate(m_points);
+    }
+
+    update();
+}
+
+void CurveWidget::mouseMoveEvent(QMouseEvent* event)
+{
+    if (m_dragIndex < 0)
+        return;
+
+    QPoint value = toValue(event->position());
+    const int last = static_cast<int>(m_points.size()) - 1;
+
+    if (m_dragIndex == 0 || m_dragIndex == last) {
+        value.setX(m_points[m_dragIndex].x());
+    } else {
+        value.setX(std::clamp(value.x(),
+                              m_points[m_dragIndex - 1].x() + 1,
+                              m_points[m_dragIndex + 1].x() - 1));
+    }
+
+    m_points[m_dragIndex] = value;
+    m_table = CurvesFilter::evaluate(m_points);
+    update();
+}
+
+void CurveWidget::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton || m_dragIndex < 0)
+        return;
+
+    m_dragIndex = -1;
+    update();
+    emit editingFinished(m_points);
+}
+
+void CurveWidget::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    const int index = pointAt(event->position());
+    const int last = static_cast<int>(m_points.size()) - 1;
+    if (index <= 0 || index >= last)
+        return;
+
+    emit editingStarted();
+    m_points.erase(m_points.begin() + index);
+    m_table = CurvesFilter::evaluate(m_points);
+    m_dragIndex = -1;
+    update();
+    emit editingFinished(m_points);
+}
@@ -0,0 +1,47 @@
+#ifndef CURVEWIDGET_H
+#define CURVEWIDGET_H
+
+#include <QWidget>
+#include <QColor>
+#include "filters/curvesfilter.h"
+
+// Editor for one CurvesFilter channel. Click to add a point, drag to move
+// it, double-click an inner point to remove it. The end points only move
+// vertically.
+class CurveWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit CurveWidget(QWidget* parent = nullptr);
+
+    void setPoints(const CurvesFilter::Points& points);
+    const CurvesFilter::Points& points() const { return m_points; }
+
+    void setCurveColor(const QColor& color);
+
+    QSize sizeHint() const override;
+
+signals:
+    void editingStarted();
+    void editingFinished(const CurvesFilter::Points& points);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    QRectF plotRect() const;
+    QPointF toWidget(const QPoint& value) const;
+    QPoint toValue(const QPointF& pos) const;
+    int pointAt(const QPointF& pos) const;
+
+    CurvesFilter::Points m_points {CurvesFilter::defaultPoints()};
+    ToneCurve::Table m_table {};
+    QColor m_curveColor {220, 220, 220};
+    int m_dragIndex {-1};
+};
+
+#endif // CURVEWIDGET_H